@@ -0,0 +1,171 @@
+/**
+ * @file cache_alternates.c
+ * @brief Fork caches borrowing objects from their upstream cache
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "cache_alternates.h"
+
+/**
+ * @brief Check for a bare repository layout
+ */
+static int is_bare_repository(const char *path)
+{
+	char check[4096];
+	struct stat st;
+	
+	snprintf(check, sizeof(check), "%s/HEAD", path);
+	if (stat(check, &st) != 0 || !S_ISREG(st.st_mode)) {
+		return 0;
+	}
+	snprintf(check, sizeof(check), "%s/objects", path);
+	if (stat(check, &st) != 0 || !S_ISDIR(st.st_mode)) {
+		return 0;
+	}
+	snprintf(check, sizeof(check), "%s/refs", path);
+	return stat(check, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+/**
+ * @brief Point a repository's alternates at an upstream repository
+ */
+int cache_alternates_link(const char *repo_path, const char *upstream_path)
+{
+	if (!repo_path || !upstream_path || upstream_path[0] != '/') {
+		return CACHE_ALTERNATES_ERROR_INVALID;
+	}
+	
+	char info_dir[4096];
+	char path[4096 + sizeof("/alternates")];
+	char temp_path[sizeof(path) + sizeof(".tmp")];
+	snprintf(info_dir, sizeof(info_dir), "%s/objects/info", repo_path);
+	snprintf(path, sizeof(path), "%s/alternates", info_dir);
+	snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+	
+	if (mkdir(info_dir, 0755) != 0 && access(info_dir, W_OK) != 0) {
+		return CACHE_ALTERNATES_ERROR_IO;
+	}
+	
+	/* git reads alternates on every object lookup; never let it see half a line */
+	FILE *file = fopen(temp_path, "w");
+	if (!file) {
+		return CACHE_ALTERNATES_ERROR_IO;
+	}
+	int ok = fprintf(file, "%s/objects\n", upstream_path) > 0;
+	ok = fclose(file) == 0 && ok;
+	if (!ok || rename(temp_path, path) != 0) {
+		unlink(temp_path);
+		return CACHE_ALTERNATES_ERROR_IO;
+	}
+	
+	return CACHE_ALTERNATES_SUCCESS;
+}
+
+/**
+ * @brief Read the repository a cache borrows objects from
+ */
+int cache_alternates_upstream(const char *repo_path, char *upstream_path, size_t path_size)
+{
+	if (!repo_path || !upstream_path || path_size == 0) {
+		return CACHE_ALTERNATES_ERROR_INVALID;
+	}
+	
+	char path[4096];
+	snprintf(path, sizeof(path), "%s/objects/info/alternates", repo_path);
+	
+	FILE *file = fopen(path, "r");
+	if (!file) {
+		return 0;
+	}
+	
+	/* git-cache writes a single entry; the first one is the upstream */
+	char line[4096];
+	int found = 0;
+	while (!found && fgets(line, sizeof(line), file)) {
+		size_t len = strcspn(line, "\r\n");
+		line[len] = '\0';
+		if (len == 0 || line[0] == '#') {
+			continue;
+		}
+	
+		while (len > 1 && line[len - 1] == '/') {
+			line[--len] = '\0';
+		}
+		if (len > strlen("/objects") && strcmp(line + len - strlen("/objects"), "/objects") == 0) {
+			line[len - strlen("/objects")] = '\0';
+		}
+		found = 1;
+	}
+	fclose(file);
+	
+	if (!found) {
+		return 0;
+	}
+	
+	int len = snprintf(upstream_path, path_size, "%s", line);
+	return len >= 0 && (size_t)len < path_size ? 1 : CACHE_ALTERNATES_ERROR_INVALID;
+}
+
+/**
+ * @brief Check whether a repository borrows objects from a given upstream
+ */
+int cache_alternates_depends_on(const char *repo_path, const char *upstream_path)
+{
+	if (!repo_path || !upstream_path) {
+		return 0;
+	}
+	
+	char path[4096];
+	return cache_alternates_upstream(repo_path, path, sizeof(path)) == 1 &&
+	       strcmp(path, upstream_path) == 0;
+}
+
+/**
+ * @brief Find the cached upstream of a fork named <owner>-<name>
+ */
+int cache_alternates_find_upstream(const char *cache_root, const char *fork_name,
+                                   char *upstream_path, size_t path_size)
+{
+	if (!cache_root || !fork_name || !upstream_path) {
+		return 0;
+	}
+	
+	size_t name_len = strlen(fork_name);
+	for (const char *dash = strchr(fork_name, '-'); dash; dash = strchr(dash + 1, '-')) {
+		size_t owner_len = (size_t)(dash - fork_name);
+		if (owner_len == 0 || owner_len + 1 >= name_len) {
+			continue;
+		}
+	
+		int len = snprintf(upstream_path, path_size, "%s/github.com/%.*s/%s",
+		                   cache_root, (int)owner_len, fork_name, dash + 1);
+		if (len >= 0 && (size_t)len < path_size && is_bare_repository(upstream_path)) {
+			return 1;
+		}
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief Get human-readable error message for cache alternates error code
+ */
+const char* cache_alternates_error_string(int error_code)
+{
+	switch (error_code) {
+		case CACHE_ALTERNATES_SUCCESS:
+			return "Success";
+		case CACHE_ALTERNATES_ERROR_INVALID:
+			return "Invalid argument";
+		case CACHE_ALTERNATES_ERROR_IO:
+			return "Failed to write alternates";
+		default:
+			return "Unknown error";
+	}
+}
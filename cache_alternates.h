@@ -0,0 +1,79 @@
+#ifndef CACHE_ALTERNATES_H
+#define CACHE_ALTERNATES_H
+
+/**
+ * @file cache_alternates.h
+ * @brief Fork caches that borrow objects from their upstream cache
+ *
+ * A fork shares nearly all of its objects with the repository it was
+ * forked from. When the upstream is already cached, a new fork cache gets
+ * an objects/info/alternates entry pointing at the upstream's object
+ * directory: git finds the shared objects there and the fetch from the
+ * fork only transfers what the fork added. The upstream records the fork
+ * in its metadata fork_url, and it has to outlive every fork borrowing
+ * from it, so eviction removes forks before their upstream.
+ */
+
+#include <stddef.h>
+
+/**
+ * @brief Cache alternates error codes
+ */
+#define CACHE_ALTERNATES_SUCCESS         0
+#define CACHE_ALTERNATES_ERROR_INVALID  -1
+#define CACHE_ALTERNATES_ERROR_IO       -2
+
+/**
+ * @brief Point a repository's alternates at an upstream repository
+ *
+ * Replaces any existing alternates with the upstream's object directory.
+ *
+ * @param repo_path Bare repository that borrows objects
+ * @param upstream_path Bare repository that lends them
+ * @return CACHE_ALTERNATES_SUCCESS on success, error code on failure
+ */
+int cache_alternates_link(const char *repo_path, const char *upstream_path);
+
+/**
+ * @brief Read the repository a cache borrows objects from
+ * @param repo_path Bare repository path
+ * @param upstream_path Buffer for the upstream repository path
+ * @param path_size Size of buffer
+ * @return 1 if the repository has an upstream, 0 if it has none, negative
+ *         error code on failure
+ */
+int cache_alternates_upstream(const char *repo_path, char *upstream_path, size_t path_size);
+
+/**
+ * @brief Check whether a repository borrows objects from a given upstream
+ * @param repo_path Bare repository path
+ * @param upstream_path Upstream repository path
+ * @return 1 if it does, 0 otherwise
+ */
+int cache_alternates_depends_on(const char *repo_path, const char *upstream_path);
+
+/**
+ * @brief Find the cached upstream of a fork named <owner>-<name>
+ *
+ * Forks created by git-cache are named after the upstream's owner and
+ * name joined by a dash. Every dash in fork_name is tried as the split
+ * point, first to last, and the first <cache_root>/github.com/<owner>/<name>
+ * holding a bare repository wins.
+ *
+ * @param cache_root Cache root directory
+ * @param fork_name Fork repository name
+ * @param upstream_path Buffer for the upstream repository path
+ * @param path_size Size of buffer
+ * @return 1 if an upstream was found, 0 otherwise
+ */
+int cache_alternates_find_upstream(const char *cache_root, const char *fork_name,
+                                   char *upstream_path, size_t path_size);
+
+/**
+ * @brief Get human-readable error message for cache alternates error code
+ * @param error_code Cache alternates error code
+ * @return Error message string
+ */
+const char* cache_alternates_error_string(int error_code);
+
+#endif /* CACHE_ALTERNATES_H */
@@ -0,0 +1,518 @@
+/**
+ * @file cache_daemon.c
+ * @brief Unix socket protocol between git-cache and a long-running daemon implementation
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "cache_daemon.h"
+
+/**
+ * @brief Build the socket path for a cache root
+ */
+int cache_daemon_socket_path(const char *cache_root, char *path, size_t path_size)
+{
+	if (!cache_root || !path) {
+		return CACHE_DAEMON_ERROR_INVALID;
+	}
+	
+	/* sun_path is short, so check against it rather than PATH_MAX */
+	struct sockaddr_un addr;
+	int len = snprintf(path, path_size, "%s/%s", cache_root, CACHE_DAEMON_SOCKET_NAME);
+	if (len < 0 || (size_t)len >= path_size || (size_t)len >= sizeof(addr.sun_path)) {
+		return CACHE_DAEMON_ERROR_INVALID;
+	}
+	return CACHE_DAEMON_SUCCESS;
+}
+
+/**
+ * @brief Fill a socket address for path
+ */
+static int fill_address(const char *path, struct sockaddr_un *addr)
+{
+	if (!path || strlen(path) >= sizeof(addr->sun_path)) {
+		return CACHE_DAEMON_ERROR_INVALID;
+	}
+	
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	strcpy(addr->sun_path, path);
+	return CACHE_DAEMON_SUCCESS;
+}
+
+/**
+ * @brief Connect to a running daemon
+ */
+int cache_daemon_connect(const char *path)
+{
+	struct sockaddr_un addr;
+	if (fill_address(path, &addr) != CACHE_DAEMON_SUCCESS) {
+		return CACHE_DAEMON_ERROR_INVALID;
+	}
+	
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return CACHE_DAEMON_ERROR_IO;
+	}
+	
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		int saved_errno = errno;
+		close(fd);
+		return saved_errno == ENOENT || saved_errno == ECONNREFUSED ?
+		       CACHE_DAEMON_ERROR_NOT_RUNNING : CACHE_DAEMON_ERROR_IO;
+	}
+	
+	return fd;
+}
+
+/**
+ * @brief Create the listening socket, replacing a stale one
+ */
+int cache_daemon_listen(const char *path)
+{
+	struct sockaddr_un addr;
+	if (fill_address(path, &addr) != CACHE_DAEMON_SUCCESS) {
+		return CACHE_DAEMON_ERROR_INVALID;
+	}
+	
+	/* A socket file nobody answers on is left over from a daemon that died */
+	int probe = cache_daemon_connect(path);
+	if (probe >= 0) {
+		close(probe);
+		return CACHE_DAEMON_ERROR_RUNNING;
+	}
+	if (probe == CACHE_DAEMON_ERROR_NOT_RUNNING) {
+		unlink(path);
+	}
+	
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return CACHE_DAEMON_ERROR_IO;
+	}
+	
+	/* Only the owner may hand the daemon work */
+	mode_t old_umask = umask(077);
+	int bound = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+	umask(old_umask);
+	
+	if (bound != 0 || listen(fd, 64) != 0) {
+		close(fd);
+		return CACHE_DAEMON_ERROR_IO;
+	}
+	
+	return fd;
+}
+
+/**
+ * @brief Append a NUL-terminated string to a payload buffer
+ */
+static int append_string(char **buffer, size_t *len, size_t *capacity, const char *value)
+{
+	size_t value_len = strlen(value) + 1;
+	if (*len + value_len > CACHE_DAEMON_MAX_PAYLOAD) {
+		return CACHE_DAEMON_ERROR_INVALID;
+	}
+	
+	if (*len + value_len > *capacity) {
+		size_t new_capacity = *capacity ? *capacity : 1024;
+		while (new_capacity < *len + value_len) {
+			new_capacity *= 2;
+		}
+		char *new_buffer = realloc(*buffer, new_capacity);
+		if (!new_buffer) {
+			return CACHE_DAEMON_ERROR_MEMORY;
+		}
+		*buffer = new_buffer;
+		*capacity = new_capacity;
+	}
+	
+	memcpy(*buffer + *len, value, value_len);
+	*len += value_len;
+	return CACHE_DAEMON_SUCCESS;
+}
+
+/**
+ * @brief Write a whole buffer, retrying on interrupts and short writes
+ */
+static int write_all(int fd, const char *data, size_t len)
+{
+	while (len > 0) {
+		ssize_t written = write(fd, data, len);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return CACHE_DAEMON_ERROR_IO;
+		}
+		data += written;
+		len -= (size_t)written;
+	}
+	return CACHE_DAEMON_SUCCESS;
+}
+
+/**
+ * @brief Read exactly len bytes
+ */
+static int read_all(int fd, char *data, size_t len)
+{
+	while (len > 0) {
+		ssize_t got = read(fd, data, len);
+		if (got < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return CACHE_DAEMON_ERROR_IO;
+		}
+		if (got == 0) {
+			return CACHE_DAEMON_ERROR_PROTOCOL;
+		}
+		data += got;
+		len -= (size_t)got;
+	}
+	return CACHE_DAEMON_SUCCESS;
+}
+
+/**
+ * @brief Send a request with the caller's stdin, stdout and stderr attached
+ */
+int cache_daemon_send_request(int fd, enum cache_daemon_request_type type, const char *cwd,
+                              int argc, char *const argv[], char *const env[])
+{
+	if (fd < 0 || argc < 0 || (argc > 0 && !argv)) {
+		return CACHE_DAEMON_ERROR_INVALID;
+	}
+	
+	char *payload = NULL;
+	size_t len = 0;
+	size_t capacity = 0;
+	char number[32];
+	
+	int envc = 0;
+	while (env && env[envc]) {
+		envc++;
+	}
+	
+	int ret = append_string(&payload, &len, &capacity, CACHE_DAEMON_PROTOCOL);
+	snprintf(number, sizeof(number), "%d", (int)type);
+	if (ret == CACHE_DAEMON_SUCCESS) {
+		ret = append_string(&payload, &len, &capacity, number);
+	}
+	if (ret == CACHE_DAEMON_SUCCESS) {
+		ret = append_string(&payload, &len, &capacity, cwd ? cwd : "");
+	}
+	snprintf(number, sizeof(number), "%d", argc);
+	if (ret == CACHE_DAEMON_SUCCESS) {
+		ret = append_string(&payload, &len, &capacity, number);
+	}
+	for (int i = 0; i < argc && ret == CACHE_DAEMON_SUCCESS; i++) {
+		ret = append_string(&payload, &len, &capacity, argv[i]);
+	}
+	snprintf(number, sizeof(number), "%d", envc);
+	if (ret == CACHE_DAEMON_SUCCESS) {
+		ret = append_string(&payload, &len, &capacity, number);
+	}
+	for (int i = 0; i < envc && ret == CACHE_DAEMON_SUCCESS; i++) {
+		ret = append_string(&payload, &len, &capacity, env[i]);
+	}
+	if (ret != CACHE_DAEMON_SUCCESS) {
+		free(payload);
+		return ret;
+	}
+	
+	/* The descriptors ride along with the length prefix */
+	uint32_t payload_len = (uint32_t)len;
+	struct iovec iov = { &payload_len, sizeof(payload_len) };
+	int fds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+	union {
+		char buffer[CMSG_SPACE(sizeof(fds))];
+		struct cmsghdr align;
+	} control;
+	memset(&control, 0, sizeof(control));
+	
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buffer;
+	msg.msg_controllen = sizeof(control.buffer);
+	
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+	
+	ssize_t sent;
+	do {
+		sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+	} while (sent < 0 && errno == EINTR);
+	
+	if (sent != (ssize_t)sizeof(payload_len)) {
+		free(payload);
+		return CACHE_DAEMON_ERROR_IO;
+	}
+	
+	ret = write_all(fd, payload, len);
+	free(payload);
+	return ret;
+}
+
+/**
+ * @brief Take the next NUL-terminated string from a payload
+ */
+static char* next_string(char **cursor, const char *end)
+{
+	char *start = *cursor;
+	char *nul = memchr(start, '\0', (size_t)(end - start));
+	if (!nul) {
+		return NULL;
+	}
+	*cursor = nul + 1;
+	return start;
+}
+
+/**
+ * @brief Parse a non-negative count from a payload
+ */
+static int next_count(char **cursor, const char *end, int *count)
+{
+	char *text = next_string(cursor, end);
+	if (!text || text[0] == '\0') {
+		return CACHE_DAEMON_ERROR_PROTOCOL;
+	}
+	
+	char *number_end;
+	long value = strtol(text, &number_end, 10);
+	if (*number_end != '\0' || value < 0 || value > CACHE_DAEMON_MAX_PAYLOAD) {
+		return CACHE_DAEMON_ERROR_PROTOCOL;
+	}
+	*count = (int)value;
+	return CACHE_DAEMON_SUCCESS;
+}
+
+/**
+ * @brief Split a payload into a NULL-terminated string array
+ */
+static int next_strings(char **cursor, const char *end, int count, char ***out)
+{
+	*out = calloc((size_t)count + 1, sizeof(**out));
+	if (!*out) {
+		return CACHE_DAEMON_ERROR_MEMORY;
+	}
+	
+	for (int i = 0; i < count; i++) {
+		(*out)[i] = next_string(cursor, end);
+		if (!(*out)[i]) {
+			return CACHE_DAEMON_ERROR_PROTOCOL;
+		}
+	}
+	return CACHE_DAEMON_SUCCESS;
+}
+
+/**
+ * @brief Receive and decode a request
+ */
+int cache_daemon_read_request(int fd, struct cache_daemon_request *request)
+{
+	if (fd < 0 || !request) {
+		return CACHE_DAEMON_ERROR_INVALID;
+	}
+	
+	memset(request, 0, sizeof(*request));
+	request->fds[0] = request->fds[1] = request->fds[2] = -1;
+	
+	uint32_t payload_len = 0;
+	struct iovec iov = { &payload_len, sizeof(payload_len) };
+	union {
+		char buffer[CMSG_SPACE(sizeof(int) * 3)];
+		struct cmsghdr align;
+	} control;
+	
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buffer;
+	msg.msg_controllen = sizeof(control.buffer);
+	
+	ssize_t got;
+	do {
+		got = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+	} while (got < 0 && errno == EINTR);
+	
+	for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+			size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			if (count > 3) {
+				count = 3;
+			}
+			memcpy(request->fds, CMSG_DATA(cmsg), count * sizeof(int));
+		}
+	}
+	
+	if (got != (ssize_t)sizeof(payload_len) || (msg.msg_flags & MSG_CTRUNC) ||
+	    payload_len == 0 || payload_len > CACHE_DAEMON_MAX_PAYLOAD) {
+		cache_daemon_request_free(request);
+		return got < 0 ? CACHE_DAEMON_ERROR_IO : CACHE_DAEMON_ERROR_PROTOCOL;
+	}
+	
+	request->payload = malloc(payload_len);
+	if (!request->payload) {
+		cache_daemon_request_free(request);
+		return CACHE_DAEMON_ERROR_MEMORY;
+	}
+	
+	int ret = read_all(fd, request->payload, payload_len);
+	char *cursor = request->payload;
+	const char *end = request->payload + payload_len;
+	
+	const char *protocol = ret == CACHE_DAEMON_SUCCESS ? next_string(&cursor, end) : NULL;
+	if (ret == CACHE_DAEMON_SUCCESS && (!protocol || strcmp(protocol, CACHE_DAEMON_PROTOCOL) != 0)) {
+		ret = CACHE_DAEMON_ERROR_PROTOCOL;
+	}
+	
+	int type = 0;
+	if (ret == CACHE_DAEMON_SUCCESS) {
+		ret = next_count(&cursor, end, &type);
+	}
+	if (ret == CACHE_DAEMON_SUCCESS && type > CACHE_DAEMON_REQUEST_STOP) {
+		ret = CACHE_DAEMON_ERROR_PROTOCOL;
+	}
+	request->type = (enum cache_daemon_request_type)type;
+	
+	if (ret == CACHE_DAEMON_SUCCESS) {
+		request->cwd = next_string(&cursor, end);
+		if (!request->cwd) {
+			ret = CACHE_DAEMON_ERROR_PROTOCOL;
+		}
+	}
+	if (ret == CACHE_DAEMON_SUCCESS) {
+		ret = next_count(&cursor, end, &request->argc);
+	}
+	if (ret == CACHE_DAEMON_SUCCESS) {
+		ret = next_strings(&cursor, end, request->argc, &request->argv);
+	}
+	if (ret == CACHE_DAEMON_SUCCESS) {
+		ret = next_count(&cursor, end, &request->envc);
+	}
+	if (ret == CACHE_DAEMON_SUCCESS) {
+		ret = next_strings(&cursor, end, request->envc, &request->env);
+	}
+	
+	if (ret != CACHE_DAEMON_SUCCESS) {
+		cache_daemon_request_free(request);
+	}
+	return ret;
+}
+
+/**
+ * @brief Free a decoded request and close its descriptors
+ */
+void cache_daemon_request_free(struct cache_daemon_request *request)
+{
+	if (!request) {
+		return;
+	}
+	
+	for (int i = 0; i < 3; i++) {
+		if (request->fds[i] >= 0) {
+			close(request->fds[i]);
+		}
+	}
+	free(request->argv);
+	free(request->env);
+	free(request->payload);
+	memset(request, 0, sizeof(*request));
+	request->fds[0] = request->fds[1] = request->fds[2] = -1;
+}
+
+/**
+ * @brief Send the exit status that ends a request
+ */
+int cache_daemon_send_status(int fd, int status)
+{
+	char line[32];
+	int len = snprintf(line, sizeof(line), "%d\n", status);
+	return write_all(fd, line, (size_t)len);
+}
+
+/**
+ * @brief Wait for the exit status that ends a request
+ */
+int cache_daemon_read_status(int fd, int *status)
+{
+	if (fd < 0 || !status) {
+		return CACHE_DAEMON_ERROR_INVALID;
+	}
+	
+	char line[32];
+	size_t len = 0;
+	while (len < sizeof(line) - 1) {
+		ssize_t got = read(fd, line + len, 1);
+		if (got < 0 && errno == EINTR) {
+			continue;
+		}
+		if (got <= 0) {
+			return CACHE_DAEMON_ERROR_PROTOCOL;
+		}
+		if (line[len] == '\n') {
+			break;
+		}
+		len++;
+	}
+	line[len] = '\0';
+	
+	char *end;
+	long value = strtol(line, &end, 10);
+	if (len == 0 || *end != '\0') {
+		return CACHE_DAEMON_ERROR_PROTOCOL;
+	}
+	*status = (int)value;
+	return CACHE_DAEMON_SUCCESS;
+}
+
+/**
+ * @brief Check whether an environment entry is forwarded to the daemon
+ */
+int cache_daemon_forwards_env(const char *entry)
+{
+	if (!entry || !strchr(entry, '=')) {
+		return 0;
+	}
+	return strncmp(entry, "GIT_", 4) == 0 || strncmp(entry, "GITHUB_", 7) == 0;
+}
+
+/**
+ * @brief Get human-readable error message for cache daemon error code
+ */
+const char* cache_daemon_error_string(int error_code)
+{
+	switch (error_code) {
+		case CACHE_DAEMON_SUCCESS:
+			return "Success";
+		case CACHE_DAEMON_ERROR_INVALID:
+			return "Invalid argument or socket path too long";
+		case CACHE_DAEMON_ERROR_IO:
+			return "Socket I/O error";
+		case CACHE_DAEMON_ERROR_MEMORY:
+			return "Memory allocation failed";
+		case CACHE_DAEMON_ERROR_PROTOCOL:
+			return "Malformed request or reply";
+		case CACHE_DAEMON_ERROR_RUNNING:
+			return "A daemon is already running for this cache";
+		case CACHE_DAEMON_ERROR_NOT_RUNNING:
+			return "No daemon is running for this cache";
+		default:
+			return "Unknown error";
+	}
+}
@@ -0,0 +1,159 @@
+#ifndef CACHE_DAEMON_H
+#define CACHE_DAEMON_H
+
+/**
+ * @file cache_daemon.h
+ * @brief Unix socket protocol between git-cache and a long-running daemon
+ *
+ * `git-cache daemon` listens on a socket in the cache root. A CLI call
+ * sends its arguments, working directory and GIT_* / GITHUB_* environment
+ * in one message, with its stdin, stdout and stderr attached as
+ * SCM_RIGHTS file descriptors. The daemon's worker writes straight to the
+ * client's terminal and finishes by sending the exit status back over the
+ * socket, so the CLI only waits for one short reply.
+ *
+ * Message layout: a 32-bit payload length followed by NUL-terminated
+ * strings: protocol version, request type, working directory, argument
+ * count, arguments, environment count, environment entries.
+ */
+
+#include <stddef.h>
+
+/**
+ * @brief Socket file name inside the cache root
+ */
+#define CACHE_DAEMON_SOCKET_NAME "daemon.sock"
+
+/**
+ * @brief Environment variable that makes the CLI skip the daemon
+ */
+#define CACHE_DAEMON_DISABLE_ENV "GIT_CACHE_NO_DAEMON"
+
+/**
+ * @brief Protocol version sent with every request
+ */
+#define CACHE_DAEMON_PROTOCOL "git-cache-daemon-1"
+
+/**
+ * @brief Largest request payload accepted
+ */
+#define CACHE_DAEMON_MAX_PAYLOAD (1024 * 1024)
+
+/**
+ * @brief Cache daemon error codes
+ */
+#define CACHE_DAEMON_SUCCESS          0
+#define CACHE_DAEMON_ERROR_INVALID   -1
+#define CACHE_DAEMON_ERROR_IO        -2
+#define CACHE_DAEMON_ERROR_MEMORY    -3
+#define CACHE_DAEMON_ERROR_PROTOCOL  -4
+#define CACHE_DAEMON_ERROR_RUNNING   -5
+#define CACHE_DAEMON_ERROR_NOT_RUNNING -6
+
+/**
+ * @brief What the client asks for
+ */
+enum cache_daemon_request_type {
+	CACHE_DAEMON_REQUEST_RUN,     /**< Run a git-cache command line */
+	CACHE_DAEMON_REQUEST_STATUS,  /**< Describe the daemon */
+	CACHE_DAEMON_REQUEST_STOP     /**< Shut the daemon down */
+};
+
+/**
+ * @brief A decoded request
+ */
+struct cache_daemon_request {
+	enum cache_daemon_request_type type; /**< Request type */
+	char *cwd;                  /**< Client working directory */
+	int argc;                   /**< Argument count, including argv[0] */
+	char **argv;                /**< Arguments, NULL terminated */
+	int envc;                   /**< Environment entry count */
+	char **env;                 /**< NAME=value entries, NULL terminated */
+	int fds[3];                 /**< Client stdin, stdout, stderr (-1 if missing) */
+	char *payload;              /**< Backing storage for the strings */
+};
+
+/**
+ * @brief Build the socket path for a cache root
+ * @param cache_root Cache root directory
+ * @param path Buffer for the socket path
+ * @param path_size Size of buffer
+ * @return CACHE_DAEMON_SUCCESS, or CACHE_DAEMON_ERROR_INVALID if the path does not fit
+ */
+int cache_daemon_socket_path(const char *cache_root, char *path, size_t path_size);
+
+/**
+ * @brief Create the listening socket, replacing a stale one
+ * @param path Socket path
+ * @return Listening descriptor, CACHE_DAEMON_ERROR_RUNNING if another daemon
+ *         answers on path, or another negative error code
+ */
+int cache_daemon_listen(const char *path);
+
+/**
+ * @brief Connect to a running daemon
+ * @param path Socket path
+ * @return Connected descriptor, CACHE_DAEMON_ERROR_NOT_RUNNING if nothing
+ *         listens on path, or another negative error code
+ */
+int cache_daemon_connect(const char *path);
+
+/**
+ * @brief Send a request with the caller's stdin, stdout and stderr attached
+ * @param fd Connected descriptor
+ * @param type Request type
+ * @param cwd Working directory (may be NULL)
+ * @param argc Argument count
+ * @param argv Arguments
+ * @param env Environment entries to forward, NULL terminated (may be NULL)
+ * @return CACHE_DAEMON_SUCCESS on success, error code on failure
+ */
+int cache_daemon_send_request(int fd, enum cache_daemon_request_type type, const char *cwd,
+                              int argc, char *const argv[], char *const env[]);
+
+/**
+ * @brief Receive and decode a request
+ * @param fd Accepted descriptor
+ * @param request Output request; free with cache_daemon_request_free()
+ * @return CACHE_DAEMON_SUCCESS on success, error code on failure
+ */
+int cache_daemon_read_request(int fd, struct cache_daemon_request *request);
+
+/**
+ * @brief Free a decoded request and close its descriptors
+ * @param request Request to free
+ */
+void cache_daemon_request_free(struct cache_daemon_request *request);
+
+/**
+ * @brief Send the exit status that ends a request
+ * @param fd Connected descriptor
+ * @param status Exit status
+ * @return CACHE_DAEMON_SUCCESS on success, error code on failure
+ */
+int cache_daemon_send_status(int fd, int status);
+
+/**
+ * @brief Wait for the exit status that ends a request
+ * @param fd Connected descriptor
+ * @param status Output exit status
+ * @return CACHE_DAEMON_SUCCESS on success, CACHE_DAEMON_ERROR_PROTOCOL if the
+ *         daemon hung up without one
+ */
+int cache_daemon_read_status(int fd, int *status);
+
+/**
+ * @brief Check whether an environment entry is forwarded to the daemon
+ * @param entry NAME=value entry
+ * @return 1 for GIT_* and GITHUB_* entries, 0 otherwise
+ */
+int cache_daemon_forwards_env(const char *entry);
+
+/**
+ * @brief Get human-readable error message for cache daemon error code
+ * @param error_code Cache daemon error code
+ * @return Error message string
+ */
+const char* cache_daemon_error_string(int error_code);
+
+#endif /* CACHE_DAEMON_H */
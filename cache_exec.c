@@ -0,0 +1,661 @@
+/**
+ * @file cache_exec.c
+ * @brief posix_spawn based command executor with pipes and timeouts
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#include "cache_exec.h"
+
+extern char **environ;
+
+/**
+ * @brief Growing buffer for captured output
+ */
+struct exec_buffer {
+	char *data;
+	size_t len;
+	size_t capacity;
+};
+
+/**
+ * @brief A command running on a loop
+ */
+struct cache_exec_child {
+	pid_t pid;                  /* Process id */
+	int fds[2];                 /* stdout and stderr pipe read ends, -1 when closed */
+	struct exec_buffer output[2]; /* Captured stdout and stderr */
+	int captured[2];            /* Which streams are captured */
+	size_t max_output;          /* Capture limit per stream */
+	int own_group;              /* Whether the command leads its own process group */
+	uint64_t start_ms;          /* Spawn time */
+	uint64_t deadline_ms;       /* When the next kill signal is due, 0 for never */
+	int term_sent;              /* SIGTERM was sent for the timeout */
+	int timed_out;              /* The timeout passed */
+	int exited;                 /* The process was reaped */
+	int lost;                   /* Someone else reaped it, so its status is unknown */
+	int status;                 /* wait4() status once exited */
+	struct rusage usage;        /* wait4() resource usage once exited */
+	void *data;                 /* Caller data */
+};
+
+/**
+ * @brief Milliseconds on the monotonic clock
+ */
+static uint64_t now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Append to a capture buffer, dropping what is beyond the limit
+ */
+static void buffer_append(struct exec_buffer *buffer, const char *data, size_t len, size_t limit)
+{
+	if (buffer->len >= limit) {
+		return;
+	}
+	if (len > limit - buffer->len) {
+		len = limit - buffer->len;
+	}
+	
+	if (buffer->len + len + 1 > buffer->capacity) {
+		size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+		while (capacity < buffer->len + len + 1) {
+			capacity *= 2;
+		}
+		char *data_new = realloc(buffer->data, capacity);
+		if (!data_new) {
+			return;
+		}
+		buffer->data = data_new;
+		buffer->capacity = capacity;
+	}
+	
+	memcpy(buffer->data + buffer->len, data, len);
+	buffer->len += len;
+	buffer->data[buffer->len] = '\0';
+}
+
+/**
+ * @brief Read what a pipe has without blocking; closes it at end of file
+ */
+static void drain_pipe(struct cache_exec_child *child, int stream)
+{
+	char chunk[16384];
+	while (child->fds[stream] >= 0) {
+		ssize_t n = read(child->fds[stream], chunk, sizeof(chunk));
+		if (n > 0) {
+			buffer_append(&child->output[stream], chunk, (size_t)n, child->max_output);
+		} else if (n < 0 && errno == EINTR) {
+			continue;
+		} else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			return;
+		} else {
+			close(child->fds[stream]);
+			child->fds[stream] = -1;
+		}
+	}
+}
+
+/**
+ * @brief Build the environment of a command: the caller's with env applied
+ *
+ * Only the pointer array is allocated; the strings are shared.
+ */
+static char **build_environment(const char *const *env)
+{
+	size_t count = 0;
+	size_t extra = 0;
+	for (char **entry = environ; *entry; entry++) {
+		count++;
+	}
+	while (env[extra]) {
+		extra++;
+	}
+	
+	char **envp = calloc(count + extra + 1, sizeof(*envp));
+	if (!envp) {
+		return NULL;
+	}
+	
+	size_t n = 0;
+	for (char **entry = environ; *entry; entry++) {
+		const char *eq = strchr(*entry, '=');
+		size_t name_len = eq ? (size_t)(eq - *entry) : strlen(*entry);
+		int replaced = 0;
+		for (size_t i = 0; i < extra && !replaced; i++) {
+			replaced = strncmp(env[i], *entry, name_len) == 0 && env[i][name_len] == '=';
+		}
+		if (!replaced) {
+			envp[n++] = *entry;
+		}
+	}
+	for (size_t i = 0; i < extra; i++) {
+		envp[n++] = (char *)env[i];
+	}
+	
+	return envp;
+}
+
+/**
+ * @brief Close both ends of the pipes set up for a spawn
+ */
+static void close_pipes(int pipes[2][2])
+{
+	for (int i = 0; i < 2; i++) {
+		for (int j = 0; j < 2; j++) {
+			if (pipes[i][j] >= 0) {
+				close(pipes[i][j]);
+				pipes[i][j] = -1;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Start a command described by argv and options
+ */
+static int spawn_child(const char *const argv[], const struct cache_exec_options *options,
+                       struct cache_exec_child *child)
+{
+	memset(child, 0, sizeof(*child));
+	child->fds[0] = child->fds[1] = -1;
+	child->max_output = options->max_output ? options->max_output : CACHE_EXEC_MAX_OUTPUT;
+	
+	posix_spawn_file_actions_t actions;
+	posix_spawnattr_t attr;
+	if (posix_spawn_file_actions_init(&actions) != 0) {
+		return CACHE_EXEC_ERROR_SPAWN;
+	}
+	if (posix_spawnattr_init(&attr) != 0) {
+		posix_spawn_file_actions_destroy(&actions);
+		return CACHE_EXEC_ERROR_SPAWN;
+	}
+	
+	int ret = CACHE_EXEC_SUCCESS;
+	int pipes[2][2] = { { -1, -1 }, { -1, -1 } };
+	const enum cache_exec_stream modes[2] = { options->out, options->err };
+	for (int i = 0; i < 2 && ret == CACHE_EXEC_SUCCESS; i++) {
+		int target = i == 0 ? STDOUT_FILENO : STDERR_FILENO;
+		if (modes[i] == CACHE_EXEC_CAPTURE) {
+			/* Both ends are close-on-exec; only the dup2() copy reaches the command */
+			if (pipe2(pipes[i], O_CLOEXEC) != 0 ||
+			    fcntl(pipes[i][0], F_SETFL, O_NONBLOCK) != 0 ||
+			    posix_spawn_file_actions_adddup2(&actions, pipes[i][1], target) != 0) {
+				ret = CACHE_EXEC_ERROR_IO;
+			}
+			child->captured[i] = 1;
+		} else if (modes[i] == CACHE_EXEC_DISCARD) {
+			if (posix_spawn_file_actions_addopen(&actions, target, "/dev/null", O_WRONLY, 0) != 0) {
+				ret = CACHE_EXEC_ERROR_IO;
+			}
+		}
+	}
+	
+	if (ret == CACHE_EXEC_SUCCESS && options->in_path &&
+	    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, options->in_path, O_RDONLY, 0) != 0) {
+		ret = CACHE_EXEC_ERROR_IO;
+	}
+	
+	/* Without addchdir the directory change costs a shell after all */
+	const char *const *spawn_argv = argv;
+	const char **shell_argv = NULL;
+	if (ret == CACHE_EXEC_SUCCESS && options->cwd) {
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 29)
+		if (posix_spawn_file_actions_addchdir_np(&actions, options->cwd) != 0) {
+			ret = CACHE_EXEC_ERROR_SPAWN;
+		}
+#else
+		size_t argc = 0;
+		while (argv[argc]) {
+			argc++;
+		}
+		shell_argv = calloc(argc + 5, sizeof(*shell_argv));
+		if (!shell_argv) {
+			ret = CACHE_EXEC_ERROR_MEMORY;
+		} else {
+			shell_argv[0] = "/bin/sh";
+			shell_argv[1] = "-c";
+			shell_argv[2] = "cd \"$0\" && exec \"$@\"";
+			shell_argv[3] = options->cwd;
+			memcpy(shell_argv + 4, argv, argc * sizeof(*argv));
+			spawn_argv = shell_argv;
+		}
+#endif
+	}
+	
+	/* Timed commands get their own group so git's helpers are killed with them */
+	short flags = POSIX_SPAWN_SETSIGDEF;
+	sigset_t default_signals;
+	sigemptyset(&default_signals);
+	sigaddset(&default_signals, SIGPIPE);
+	if (options->timeout_ms > 0) {
+		flags |= POSIX_SPAWN_SETPGROUP;
+		posix_spawnattr_setpgroup(&attr, 0);
+		child->own_group = 1;
+	}
+	posix_spawnattr_setsigdefault(&attr, &default_signals);
+	posix_spawnattr_setflags(&attr, flags);
+	
+	char **envp = NULL;
+	if (ret == CACHE_EXEC_SUCCESS && options->env) {
+		envp = build_environment(options->env);
+		if (!envp) {
+			ret = CACHE_EXEC_ERROR_MEMORY;
+		}
+	}
+	
+	if (ret == CACHE_EXEC_SUCCESS) {
+		child->start_ms = now_ms();
+		if (posix_spawnp(&child->pid, spawn_argv[0], &actions, &attr, (char *const *)spawn_argv,
+		                 envp ? envp : environ) != 0) {
+			ret = CACHE_EXEC_ERROR_SPAWN;
+		}
+	}
+	
+	free(envp);
+	free(shell_argv);
+	posix_spawnattr_destroy(&attr);
+	posix_spawn_file_actions_destroy(&actions);
+	
+	if (ret != CACHE_EXEC_SUCCESS) {
+		close_pipes(pipes);
+		return ret;
+	}
+	
+	for (int i = 0; i < 2; i++) {
+		child->fds[i] = pipes[i][0];
+		if (pipes[i][1] >= 0) {
+			close(pipes[i][1]);
+		}
+	}
+	if (options->timeout_ms > 0) {
+		child->deadline_ms = child->start_ms + (uint64_t)options->timeout_ms;
+	}
+	return CACHE_EXEC_SUCCESS;
+}
+
+/**
+ * @brief Hand a reaped command's outcome to the caller
+ */
+static void fill_result(struct cache_exec_child *child, struct cache_exec_result *result)
+{
+	memset(result, 0, sizeof(*result));
+	if (child->lost) {
+		result->exit_code = -1;
+	} else if (WIFEXITED(child->status)) {
+		result->exit_code = WEXITSTATUS(child->status);
+	} else {
+		result->exit_code = -1;
+		result->term_signal = WIFSIGNALED(child->status) ? WTERMSIG(child->status) : 0;
+	}
+	result->timed_out = child->timed_out;
+	result->elapsed_ms = now_ms() - child->start_ms;
+	result->usage = child->usage;
+	
+	/* Captured streams always come back as strings, even when empty */
+	char **outputs[2] = { &result->out, &result->err };
+	size_t *lengths[2] = { &result->out_len, &result->err_len };
+	for (int i = 0; i < 2; i++) {
+		if (child->captured[i]) {
+			*outputs[i] = child->output[i].data ? child->output[i].data : strdup("");
+			*lengths[i] = child->output[i].len;
+			child->output[i].data = NULL;
+		}
+	}
+}
+
+/**
+ * @brief Send the next timeout signal to a command whose deadline passed
+ */
+static void enforce_timeout(struct cache_exec_child *child, uint64_t now)
+{
+	if (child->exited || child->deadline_ms == 0 || now < child->deadline_ms) {
+		return;
+	}
+	
+	pid_t target = child->own_group ? -child->pid : child->pid;
+	child->timed_out = 1;
+	if (!child->term_sent) {
+		kill(target, SIGTERM);
+		child->term_sent = 1;
+		child->deadline_ms = now + CACHE_EXEC_KILL_GRACE_MS;
+	} else {
+		kill(target, SIGKILL);
+		child->deadline_ms = 0;
+	}
+}
+
+/**
+ * @brief Initialize an empty loop
+ */
+void cache_exec_loop_init(struct cache_exec_loop *loop)
+{
+	if (loop) {
+		memset(loop, 0, sizeof(*loop));
+	}
+}
+
+/**
+ * @brief Start a command on a loop
+ */
+int cache_exec_spawn(struct cache_exec_loop *loop, const char *const argv[],
+                     const struct cache_exec_options *options, void *data)
+{
+	if (!loop || !argv || !argv[0]) {
+		return CACHE_EXEC_ERROR_INVALID;
+	}
+	
+	if (loop->count == loop->capacity) {
+		size_t capacity = loop->capacity ? loop->capacity * 2 : 8;
+		struct cache_exec_child *children = realloc(loop->children, capacity * sizeof(*children));
+		if (!children) {
+			return CACHE_EXEC_ERROR_MEMORY;
+		}
+		loop->children = children;
+		loop->capacity = capacity;
+	}
+	
+	struct cache_exec_options defaults;
+	memset(&defaults, 0, sizeof(defaults));
+	struct cache_exec_child *child = &loop->children[loop->count];
+	int ret = spawn_child(argv, options ? options : &defaults, child);
+	if (ret != CACHE_EXEC_SUCCESS) {
+		return ret;
+	}
+	
+	child->data = data;
+	loop->count++;
+	return CACHE_EXEC_SUCCESS;
+}
+
+/**
+ * @brief Wait until a command of a loop has finished
+ */
+int cache_exec_wait(struct cache_exec_loop *loop, int timeout_ms,
+                    struct cache_exec_result *result, void **data)
+{
+	if (!loop || !result) {
+		return CACHE_EXEC_ERROR_INVALID;
+	}
+	
+	uint64_t give_up = timeout_ms >= 0 ? now_ms() + (uint64_t)timeout_ms : 0;
+	struct pollfd *fds = NULL;
+	size_t fds_capacity = 0;
+	
+	while (loop->count > 0) {
+		uint64_t now = now_ms();
+		int poll_ms = -1;
+	
+		for (size_t i = 0; i < loop->count; i++) {
+			struct cache_exec_child *child = &loop->children[i];
+			if (!child->exited) {
+				pid_t pid = wait4(child->pid, &child->status, WNOHANG, &child->usage);
+				child->lost = pid < 0 && errno == ECHILD;
+				child->exited = pid == child->pid || child->lost;
+			}
+	
+			if (child->exited) {
+				/* Whatever a lingering grandchild writes later is not waited for */
+				drain_pipe(child, 0);
+				drain_pipe(child, 1);
+				for (int s = 0; s < 2; s++) {
+					if (child->fds[s] >= 0) {
+						close(child->fds[s]);
+						child->fds[s] = -1;
+					}
+				}
+	
+				fill_result(child, result);
+				if (data) {
+					*data = child->data;
+				}
+				free(child->output[0].data);
+				free(child->output[1].data);
+				loop->children[i] = loop->children[--loop->count];
+				free(fds);
+				return 1;
+			}
+	
+			enforce_timeout(child, now);
+			if (child->deadline_ms) {
+				int until = (int)(child->deadline_ms - now);
+				poll_ms = poll_ms < 0 || until < poll_ms ? until : poll_ms;
+			}
+		}
+		
+		/* Exits are not signalled on a pipe a grandchild still holds, so look again soon */
+		if (poll_ms < 0 || poll_ms > CACHE_EXEC_POLL_INTERVAL_MS) {
+			poll_ms = CACHE_EXEC_POLL_INTERVAL_MS;
+		}
+		if (give_up) {
+			if (now >= give_up) {
+				break;
+			}
+			if (give_up - now < (uint64_t)poll_ms) {
+				poll_ms = (int)(give_up - now);
+			}
+		}
+	
+		nfds_t nfds = 0;
+		if (fds_capacity < loop->count * 2) {
+			struct pollfd *fds_new = realloc(fds, loop->count * 2 * sizeof(*fds));
+			if (!fds_new) {
+				free(fds);
+				return CACHE_EXEC_ERROR_MEMORY;
+			}
+			fds = fds_new;
+			fds_capacity = loop->count * 2;
+		}
+		for (size_t i = 0; i < loop->count; i++) {
+			for (int s = 0; s < 2; s++) {
+				if (loop->children[i].fds[s] >= 0) {
+					fds[nfds].fd = loop->children[i].fds[s];
+					fds[nfds].events = POLLIN;
+					fds[nfds].revents = 0;
+					nfds++;
+				}
+			}
+		}
+	
+		if (poll(fds, nfds, poll_ms) < 0 && errno != EINTR) {
+			free(fds);
+			return CACHE_EXEC_ERROR_IO;
+		}
+	
+		for (size_t i = 0; i < loop->count; i++) {
+			drain_pipe(&loop->children[i], 0);
+			drain_pipe(&loop->children[i], 1);
+		}
+	}
+	
+	free(fds);
+	return 0;
+}
+
+/**
+ * @brief Kill and reap every command still running and free the loop
+ */
+void cache_exec_loop_destroy(struct cache_exec_loop *loop)
+{
+	if (!loop) {
+		return;
+	}
+	
+	for (size_t i = 0; i < loop->count; i++) {
+		struct cache_exec_child *child = &loop->children[i];
+		kill(child->own_group ? -child->pid : child->pid, SIGKILL);
+		while (waitpid(child->pid, NULL, 0) < 0 && errno == EINTR) {
+			continue;
+		}
+		for (int s = 0; s < 2; s++) {
+			if (child->fds[s] >= 0) {
+				close(child->fds[s]);
+			}
+			free(child->output[s].data);
+		}
+	}
+	
+	free(loop->children);
+	memset(loop, 0, sizeof(*loop));
+}
+
+/**
+ * @brief Run a command and wait for it
+ */
+int cache_exec_run(const char *const argv[], const struct cache_exec_options *options,
+                   struct cache_exec_result *result)
+{
+	if (!argv || !argv[0] || !result) {
+		return CACHE_EXEC_ERROR_INVALID;
+	}
+	
+	/* Leave a result that is safe to free even if nothing ran */
+	memset(result, 0, sizeof(*result));
+	result->exit_code = -1;
+	
+	struct cache_exec_loop loop;
+	cache_exec_loop_init(&loop);
+	int ret = cache_exec_spawn(&loop, argv, options, NULL);
+	if (ret == CACHE_EXEC_SUCCESS) {
+		ret = cache_exec_wait(&loop, -1, result, NULL);
+		ret = ret == 1 ? CACHE_EXEC_SUCCESS : (ret < 0 ? ret : CACHE_EXEC_ERROR_SPAWN);
+	}
+	cache_exec_loop_destroy(&loop);
+	return ret;
+}
+
+/**
+ * @brief Map a finished command to one exit status
+ */
+static int exit_status(int ret, const struct cache_exec_result *result)
+{
+	if (ret != CACHE_EXEC_SUCCESS) {
+		return -1;
+	}
+	return result->exit_code >= 0 ? result->exit_code : 128 + result->term_signal;
+}
+
+/**
+ * @brief Run a command and return its exit status
+ */
+int cache_exec_status(const char *const argv[], const char *cwd, int quiet)
+{
+	struct cache_exec_options options;
+	memset(&options, 0, sizeof(options));
+	options.cwd = cwd;
+	if (quiet) {
+		options.out = CACHE_EXEC_DISCARD;
+		options.err = CACHE_EXEC_DISCARD;
+	}
+	
+	struct cache_exec_result result;
+	int ret = cache_exec_run(argv, &options, &result);
+	cache_exec_free_result(&result);
+	return exit_status(ret, &result);
+}
+
+/**
+ * @brief Run a command and read the first line of its stdout
+ */
+int cache_exec_line(const char *const argv[], const char *cwd, char *line, size_t line_size)
+{
+	if (line && line_size > 0) {
+		line[0] = '\0';
+	}
+	
+	struct cache_exec_options options;
+	memset(&options, 0, sizeof(options));
+	options.cwd = cwd;
+	options.out = CACHE_EXEC_CAPTURE;
+	options.err = CACHE_EXEC_DISCARD;
+	
+	struct cache_exec_result result;
+	int ret = cache_exec_run(argv, &options, &result);
+	if (ret == CACHE_EXEC_SUCCESS && result.out && line && line_size > 0) {
+		size_t len = strcspn(result.out, "\r\n");
+		if (len >= line_size) {
+			len = line_size - 1;
+		}
+		memcpy(line, result.out, len);
+		line[len] = '\0';
+	}
+	cache_exec_free_result(&result);
+	return exit_status(ret, &result);
+}
+
+/**
+ * @brief Run a command and count the lines of its stdout
+ */
+int cache_exec_count_lines(const char *const argv[], const char *cwd, size_t *count)
+{
+	struct cache_exec_options options;
+	memset(&options, 0, sizeof(options));
+	options.cwd = cwd;
+	options.out = CACHE_EXEC_CAPTURE;
+	options.err = CACHE_EXEC_DISCARD;
+	
+	struct cache_exec_result result;
+	int ret = cache_exec_run(argv, &options, &result);
+	size_t lines = 0;
+	for (size_t i = 0; ret == CACHE_EXEC_SUCCESS && i < result.out_len; i++) {
+		lines += result.out[i] == '\n';
+	}
+	if (count) {
+		*count = lines;
+	}
+	cache_exec_free_result(&result);
+	return exit_status(ret, &result);
+}
+
+/**
+ * @brief Free the captured output of a result
+ */
+void cache_exec_free_result(struct cache_exec_result *result)
+{
+	if (!result) {
+		return;
+	}
+	
+	free(result->out);
+	free(result->err);
+	result->out = NULL;
+	result->err = NULL;
+	result->out_len = 0;
+	result->err_len = 0;
+}
+
+/**
+ * @brief Get human-readable error message for cache exec error code
+ */
+const char* cache_exec_error_string(int error_code)
+{
+	switch (error_code) {
+		case CACHE_EXEC_SUCCESS:
+			return "Success";
+		case CACHE_EXEC_ERROR_INVALID:
+			return "Invalid argument";
+		case CACHE_EXEC_ERROR_SPAWN:
+			return "Failed to start command";
+		case CACHE_EXEC_ERROR_MEMORY:
+			return "Memory allocation failed";
+		case CACHE_EXEC_ERROR_IO:
+			return "Pipe operation failed";
+		default:
+			return "Unknown error";
+	}
+}
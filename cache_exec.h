@@ -0,0 +1,204 @@
+#ifndef CACHE_EXEC_H
+#define CACHE_EXEC_H
+
+/**
+ * @file cache_exec.h
+ * @brief Running git and other helpers without a shell
+ *
+ * Commands are started with posix_spawn from an explicit argv and working
+ * directory instead of system("cd ... && ..."), which saves the /bin/sh
+ * process and all quoting. stdin can be read from a file; stdout and
+ * stderr can each be inherited, discarded or captured through
+ * non-blocking pipes. A command with a
+ * timeout runs in its own process group and is sent SIGTERM, then
+ * SIGKILL, when the timeout passes; the resource usage of every command is
+ * reported with its exit status.
+ *
+ * Many commands can run at once on a cache_exec_loop: cache_exec_spawn()
+ * starts one and cache_exec_wait() multiplexes their pipes with poll()
+ * until one of them has finished. The loop reaps only its own children, so
+ * it must not be mixed with waitpid(-1) in the same process.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+
+/**
+ * @brief Default limit on captured output per stream, in bytes
+ *
+ * Output beyond the limit is read and dropped so the child never blocks.
+ */
+#define CACHE_EXEC_MAX_OUTPUT (4 * 1024 * 1024)
+
+/**
+ * @brief Time a timed-out command gets between SIGTERM and SIGKILL, in ms
+ */
+#define CACHE_EXEC_KILL_GRACE_MS 2000
+
+/**
+ * @brief Longest time cache_exec_wait() sleeps before checking for exits, in ms
+ */
+#define CACHE_EXEC_POLL_INTERVAL_MS 50
+
+/**
+ * @brief Cache exec error codes
+ */
+#define CACHE_EXEC_SUCCESS          0
+#define CACHE_EXEC_ERROR_INVALID   -1
+#define CACHE_EXEC_ERROR_SPAWN     -2
+#define CACHE_EXEC_ERROR_MEMORY    -3
+#define CACHE_EXEC_ERROR_IO        -4
+
+/**
+ * @brief Where a command's stdout or stderr goes
+ */
+enum cache_exec_stream {
+	CACHE_EXEC_INHERIT,         /**< Share the caller's stream */
+	CACHE_EXEC_CAPTURE,         /**< Collect it into the result */
+	CACHE_EXEC_DISCARD          /**< Send it to /dev/null */
+};
+
+/**
+ * @brief How to run a command
+ *
+ * A zeroed structure runs the command in the current directory with the
+ * caller's streams and no timeout.
+ */
+struct cache_exec_options {
+	const char *cwd;            /**< Working directory (NULL for the current one) */
+	const char *const *env;     /**< NAME=value entries to set, NULL-terminated (NULL for none) */
+	const char *in_path;        /**< File stdin is read from, relative to the caller (NULL to share the caller's) */
+	enum cache_exec_stream out; /**< Handling of stdout */
+	enum cache_exec_stream err; /**< Handling of stderr */
+	int timeout_ms;             /**< Kill the command after this long (0 for no limit) */
+	size_t max_output;          /**< Capture limit per stream (0 for CACHE_EXEC_MAX_OUTPUT) */
+};
+
+/**
+ * @brief Outcome of a command
+ */
+struct cache_exec_result {
+	int exit_code;              /**< Exit status, -1 if the command was killed by a signal */
+	int term_signal;            /**< Signal that ended the command, 0 if it exited */
+	int timed_out;              /**< Whether the command was killed for its timeout */
+	char *out;                  /**< Captured stdout, NUL-terminated (NULL if not captured) */
+	size_t out_len;             /**< Bytes of captured stdout */
+	char *err;                  /**< Captured stderr, NUL-terminated (NULL if not captured) */
+	size_t err_len;             /**< Bytes of captured stderr */
+	uint64_t elapsed_ms;        /**< Wall clock time from spawn to exit */
+	struct rusage usage;        /**< Resources used by the command and its waited-for children */
+};
+
+struct cache_exec_child;
+
+/**
+ * @brief Set of commands running at the same time
+ */
+struct cache_exec_loop {
+	struct cache_exec_child *children; /**< Running commands */
+	size_t count;               /**< Number of running commands */
+	size_t capacity;            /**< Allocated entries */
+};
+
+/**
+ * @brief Run a command and wait for it
+ * @param argv Program and arguments, NULL-terminated; the program is looked up in PATH
+ * @param options How to run it (NULL for defaults)
+ * @param result Output outcome, free with cache_exec_free_result() even on failure
+ * @return CACHE_EXEC_SUCCESS if the command ran (whatever its exit status),
+ *         error code if it could not be started
+ */
+int cache_exec_run(const char *const argv[], const struct cache_exec_options *options,
+                   struct cache_exec_result *result);
+
+/**
+ * @brief Run a command and return its exit status
+ * @param argv Program and arguments, NULL-terminated
+ * @param cwd Working directory (NULL for the current one)
+ * @param quiet Discard stdout and stderr instead of sharing the caller's
+ * @return Exit status, 128 plus the signal number if the command was
+ *         killed, -1 if it could not be started
+ */
+int cache_exec_status(const char *const argv[], const char *cwd, int quiet);
+
+/**
+ * @brief Run a command and read the first line of its stdout
+ *
+ * stderr is discarded. The line is stored without its newline, truncated
+ * to fit, and is empty if the command printed nothing.
+ *
+ * @param argv Program and arguments, NULL-terminated
+ * @param cwd Working directory (NULL for the current one)
+ * @param line Buffer for the line
+ * @param line_size Size of buffer
+ * @return Exit status as for cache_exec_status()
+ */
+int cache_exec_line(const char *const argv[], const char *cwd, char *line, size_t line_size);
+
+/**
+ * @brief Run a command and count the lines of its stdout
+ *
+ * stderr is discarded.
+ *
+ * @param argv Program and arguments, NULL-terminated
+ * @param cwd Working directory (NULL for the current one)
+ * @param count Output number of lines, 0 if the command could not be started
+ * @return Exit status as for cache_exec_status()
+ */
+int cache_exec_count_lines(const char *const argv[], const char *cwd, size_t *count);
+
+/**
+ * @brief Free the captured output of a result
+ * @param result Result to clean up
+ */
+void cache_exec_free_result(struct cache_exec_result *result);
+
+/**
+ * @brief Initialize an empty loop
+ * @param loop Loop to initialize
+ */
+void cache_exec_loop_init(struct cache_exec_loop *loop);
+
+/**
+ * @brief Start a command on a loop
+ * @param loop Loop to add the command to
+ * @param argv Program and arguments, NULL-terminated
+ * @param options How to run it (NULL for defaults)
+ * @param data Caller data handed back by cache_exec_wait()
+ * @return CACHE_EXEC_SUCCESS on success, error code on failure
+ */
+int cache_exec_spawn(struct cache_exec_loop *loop, const char *const argv[],
+                     const struct cache_exec_options *options, void *data);
+
+/**
+ * @brief Wait until a command of a loop has finished
+ *
+ * Reads the pipes of all running commands meanwhile and enforces their
+ * timeouts.
+ *
+ * @param loop Loop to wait on
+ * @param timeout_ms Longest time to wait (-1 for no limit)
+ * @param result Output outcome of the finished command, free with cache_exec_free_result()
+ * @param data Output caller data of the finished command (may be NULL)
+ * @return 1 if a command finished, 0 if none is running or the wait timed
+ *         out, negative error code on failure
+ */
+int cache_exec_wait(struct cache_exec_loop *loop, int timeout_ms,
+                    struct cache_exec_result *result, void **data);
+
+/**
+ * @brief Kill and reap every command still running and free the loop
+ * @param loop Loop to destroy
+ */
+void cache_exec_loop_destroy(struct cache_exec_loop *loop);
+
+/**
+ * @brief Get human-readable error message for cache exec error code
+ * @param error_code Cache exec error code
+ * @return Error message string
+ */
+const char* cache_exec_error_string(int error_code);
+
+#endif /* CACHE_EXEC_H */
@@ -0,0 +1,193 @@
+/**
+ * @file cache_gc.c
+ * @brief Size-budgeted LRU eviction policy implementation
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <sys/statvfs.h>
+
+#include "cache_gc.h"
+
+/**
+ * @brief Parse a size such as "512M", "20G" or "1048576"
+ */
+int cache_gc_parse_size(const char *text, uint64_t *bytes)
+{
+	if (!text || !bytes) {
+		return CACHE_GC_ERROR_INVALID;
+	}
+	
+	while (isspace((unsigned char)*text)) {
+		text++;
+	}
+	if (!isdigit((unsigned char)*text)) {
+		return CACHE_GC_ERROR_INVALID;
+	}
+	
+	char *end;
+	errno = 0;
+	unsigned long long value = strtoull(text, &end, 10);
+	if (errno != 0) {
+		return CACHE_GC_ERROR_INVALID;
+	}
+	
+	unsigned int shift = 0;
+	switch (toupper((unsigned char)*end)) {
+		case 'K': shift = 10; end++; break;
+		case 'M': shift = 20; end++; break;
+		case 'G': shift = 30; end++; break;
+		case 'T': shift = 40; end++; break;
+		default: break;
+	}
+	if (shift > 0 && toupper((unsigned char)*end) == 'B') {
+		end++;
+	}
+	while (isspace((unsigned char)*end)) {
+		end++;
+	}
+	if (*end != '\0' || (shift > 0 && value > (UINT64_MAX >> shift))) {
+		return CACHE_GC_ERROR_INVALID;
+	}
+	
+	*bytes = (uint64_t)value << shift;
+	return CACHE_GC_SUCCESS;
+}
+
+/**
+ * @brief Format a size so that cache_gc_parse_size() reads it back exactly
+ */
+void cache_gc_format_size(uint64_t bytes, char *buffer, size_t buffer_size)
+{
+	static const char suffixes[] = "TGMK";
+	for (int i = 0; i < 4; i++) {
+		unsigned int shift = (unsigned int)(4 - i) * 10;
+		if (bytes > 0 && bytes % ((uint64_t)1 << shift) == 0) {
+			snprintf(buffer, buffer_size, "%llu%c",
+			         (unsigned long long)(bytes >> shift), suffixes[i]);
+			return;
+		}
+	}
+	snprintf(buffer, buffer_size, "%llu", (unsigned long long)bytes);
+}
+
+/**
+ * @brief Get the space available to unprivileged users on a filesystem
+ */
+int cache_gc_free_space(const char *path, uint64_t *bytes)
+{
+	if (!path || !bytes) {
+		return CACHE_GC_ERROR_INVALID;
+	}
+	
+	struct statvfs st;
+	if (statvfs(path, &st) != 0) {
+		return CACHE_GC_ERROR_IO;
+	}
+	
+	*bytes = (uint64_t)st.f_bavail * (uint64_t)st.f_frsize;
+	return CACHE_GC_SUCCESS;
+}
+
+/**
+ * @brief Compute how many bytes must be evicted to satisfy a policy
+ */
+uint64_t cache_gc_bytes_needed(const struct cache_gc_policy *policy, uint64_t total_size,
+                               uint64_t free_space, uint64_t extra_space)
+{
+	if (!policy) {
+		return 0;
+	}
+	
+	uint64_t needed = 0;
+	if (policy->max_cache_size > 0 && total_size + extra_space > policy->max_cache_size) {
+		needed = total_size + extra_space - policy->max_cache_size;
+	}
+	
+	/* Evicting a cache frees its size on the same filesystem */
+	uint64_t wanted_free = policy->min_free_space + extra_space;
+	if (wanted_free > free_space && wanted_free - free_space > needed) {
+		needed = wanted_free - free_space;
+	}
+	
+	return needed;
+}
+
+/**
+ * @brief Order evictable candidates first, oldest access first
+ */
+static int compare_candidates(const void *a, const void *b)
+{
+	const struct cache_gc_candidate *ca = (const struct cache_gc_candidate *)a;
+	const struct cache_gc_candidate *cb = (const struct cache_gc_candidate *)b;
+	
+	int a_busy = ca->ref_count > 0 || ca->dependents > 0;
+	int b_busy = cb->ref_count > 0 || cb->dependents > 0;
+	if (a_busy != b_busy) {
+		return a_busy - b_busy;
+	}
+	if (ca->last_access_time != cb->last_access_time) {
+		return ca->last_access_time < cb->last_access_time ? -1 : 1;
+	}
+	if (ca->size != cb->size) {
+		return ca->size > cb->size ? -1 : 1;
+	}
+	int cmp = strcmp(ca->owner, cb->owner);
+	return cmp != 0 ? cmp : strcmp(ca->name, cb->name);
+}
+
+/**
+ * @brief Order candidates for eviction
+ */
+size_t cache_gc_order(struct cache_gc_candidate *candidates, size_t count)
+{
+	if (!candidates || count == 0) {
+		return 0;
+	}
+	
+	qsort(candidates, count, sizeof(*candidates), compare_candidates);
+	
+	size_t evictable = 0;
+	while (evictable < count && candidates[evictable].ref_count <= 0 &&
+	       candidates[evictable].dependents <= 0) {
+		evictable++;
+	}
+	return evictable;
+}
+
+/**
+ * @brief Free the strings of a candidate list and the list itself
+ */
+void cache_gc_free_candidates(struct cache_gc_candidate *candidates, size_t count)
+{
+	if (!candidates) {
+		return;
+	}
+	
+	for (size_t i = 0; i < count; i++) {
+		free(candidates[i].owner);
+		free(candidates[i].name);
+	}
+	free(candidates);
+}
+
+/**
+ * @brief Get human-readable error message for cache GC error code
+ */
+const char* cache_gc_error_string(int error_code)
+{
+	switch (error_code) {
+		case CACHE_GC_SUCCESS:
+			return "Success";
+		case CACHE_GC_ERROR_INVALID:
+			return "Invalid size or argument";
+		case CACHE_GC_ERROR_IO:
+			return "Failed to query filesystem";
+		default:
+			return "Unknown error";
+	}
+}
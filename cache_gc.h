@@ -0,0 +1,115 @@
+#ifndef CACHE_GC_H
+#define CACHE_GC_H
+
+/**
+ * @file cache_gc.h
+ * @brief Size-budgeted LRU eviction policy for git-cache
+ *
+ * Decides which cached repositories to remove when the cache grows past
+ * max_cache_size or the filesystem holding it has less than min_free_space
+ * available. Only caches without active checkouts (ref_count == 0) and
+ * without forks borrowing their objects are ever chosen, least recently
+ * accessed first. Removing the caches is left to the caller, which has to
+ * lock each one first.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Cache GC error codes
+ */
+#define CACHE_GC_SUCCESS         0
+#define CACHE_GC_ERROR_INVALID  -1
+#define CACHE_GC_ERROR_IO       -2
+
+/**
+ * @brief Eviction policy (0 disables a limit)
+ */
+struct cache_gc_policy {
+	uint64_t max_cache_size;    /**< Largest total size of all caches in bytes */
+	uint64_t min_free_space;    /**< Smallest free space to leave on the cache filesystem */
+};
+
+/**
+ * @brief A cached repository that might be evicted
+ */
+struct cache_gc_candidate {
+	char *owner;                /**< Repository owner */
+	char *name;                 /**< Repository name */
+	uint64_t size;              /**< Cache size in bytes */
+	int64_t last_access_time;   /**< Last access time */
+	int ref_count;              /**< Number of active checkouts */
+	int dependents;             /**< Number of fork caches borrowing its objects */
+};
+
+/**
+ * @brief Parse a size such as "512M", "20G" or "1048576"
+ *
+ * Accepts an optional K, M, G or T suffix (powers of 1024, case
+ * insensitive, optionally followed by "B").
+ *
+ * @param text Size text
+ * @param bytes Output size in bytes
+ * @return CACHE_GC_SUCCESS on success, CACHE_GC_ERROR_INVALID if unparsable
+ */
+int cache_gc_parse_size(const char *text, uint64_t *bytes);
+
+/**
+ * @brief Format a size so that cache_gc_parse_size() reads it back exactly
+ *
+ * Uses the largest suffix that divides the size evenly, e.g. "20G".
+ *
+ * @param bytes Size in bytes
+ * @param buffer Output buffer
+ * @param buffer_size Size of buffer
+ */
+void cache_gc_format_size(uint64_t bytes, char *buffer, size_t buffer_size);
+
+/**
+ * @brief Get the space available to unprivileged users on a filesystem
+ * @param path Any path on the filesystem
+ * @param bytes Output free space in bytes
+ * @return CACHE_GC_SUCCESS on success, CACHE_GC_ERROR_IO on failure
+ */
+int cache_gc_free_space(const char *path, uint64_t *bytes);
+
+/**
+ * @brief Compute how many bytes must be evicted to satisfy a policy
+ * @param policy Eviction policy
+ * @param total_size Current total size of all caches
+ * @param free_space Current free space on the cache filesystem
+ * @param extra_space Additional free space wanted, e.g. for a pending clone
+ * @return Bytes to evict, 0 if the policy is already met
+ */
+uint64_t cache_gc_bytes_needed(const struct cache_gc_policy *policy, uint64_t total_size,
+                               uint64_t free_space, uint64_t extra_space);
+
+/**
+ * @brief Order candidates for eviction
+ *
+ * Moves evictable candidates (no checkouts and no dependents) to the
+ * front, least recently accessed first, larger caches first among equally
+ * old ones.
+ *
+ * @param candidates Candidates to reorder in place
+ * @param count Number of candidates
+ * @return Number of evictable candidates at the front
+ */
+size_t cache_gc_order(struct cache_gc_candidate *candidates, size_t count);
+
+/**
+ * @brief Free the strings of a candidate list and the list itself
+ * @param candidates Candidate list (may be NULL)
+ * @param count Number of candidates
+ */
+void cache_gc_free_candidates(struct cache_gc_candidate *candidates, size_t count);
+
+/**
+ * @brief Get human-readable error message for cache GC error code
+ * @param error_code Cache GC error code
+ * @return Error message string
+ */
+const char* cache_gc_error_string(int error_code);
+
+#endif /* CACHE_GC_H */
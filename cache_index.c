@@ -0,0 +1,757 @@
+/**
+ * @file cache_index.c
+ * @brief Persistent index of cached repositories implementation
+ *
+ * The index is rewritten as a whole into a temporary file and renamed
+ * into place, so readers mapping the old file are never disturbed.
+ * Writers serialize on a separate lock file.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+
+#include "git-cache.h"
+#include "cache_index.h"
+#include "cache_metadata.h"
+
+/* Lock file serializing index writers */
+#define CACHE_INDEX_LOCK_FILE "cache_index.lock"
+
+/* Unpacked index entry used while building a new index */
+struct index_entry {
+	struct cache_index_record record;
+	char *owner;
+	char *name;
+	char *url;
+};
+
+/* Growable list of entries */
+struct index_builder {
+	struct index_entry *entries;
+	size_t count;
+	size_t capacity;
+};
+
+/**
+ * @brief Hash a repository URL (64-bit FNV-1a)
+ */
+uint64_t cache_index_hash_url(const char *url)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	
+	if (!url) {
+		return 0;
+	}
+	
+	for (const unsigned char *p = (const unsigned char *)url; *p; p++) {
+		hash ^= *p;
+		hash *= 1099511628211ULL;
+	}
+	
+	return hash;
+}
+
+/**
+ * @brief Derive cache root from <root>/github.com/<owner>/<name>
+ */
+int cache_index_root_from_path(const char *cache_path, char *root, size_t root_size)
+{
+	if (!cache_path || !root || root_size == 0) {
+		return CACHE_INDEX_ERROR_INVALID;
+	}
+	
+	size_t len = strlen(cache_path);
+	while (len > 1 && cache_path[len - 1] == '/') {
+		len--;
+	}
+	
+	/* Walk back over <name> and <owner> */
+	size_t end = len;
+	for (int i = 0; i < 2; i++) {
+		while (end > 0 && cache_path[end - 1] != '/') {
+			end--;
+		}
+		if (end == 0) {
+			return CACHE_INDEX_ERROR_INVALID;
+		}
+		end--;
+	}
+	
+	const char *host = "/github.com";
+	size_t host_len = strlen(host);
+	if (end < host_len || strncmp(cache_path + end - host_len, host, host_len) != 0) {
+		return CACHE_INDEX_ERROR_INVALID;
+	}
+	
+	size_t root_len = end - host_len;
+	if (root_len == 0 || root_len >= root_size) {
+		return CACHE_INDEX_ERROR_INVALID;
+	}
+	
+	memcpy(root, cache_path, root_len);
+	root[root_len] = '\0';
+	return CACHE_INDEX_SUCCESS;
+}
+
+/**
+ * @brief Modification times an index is checked against
+ */
+struct tree_stamp {
+	int64_t root_sec;           /**< <root>/github.com mtime */
+	int64_t root_nsec;          /**< Nanosecond part */
+	uint64_t owners;            /**< Owner directory names and mtimes, folded together */
+};
+
+/**
+ * @brief Get the modification times of <root>/github.com and every owner directory
+ *
+ * github.com changes when an owner directory comes or goes, and an owner
+ * directory changes when a repository in it does. The owner directories
+ * are folded into one sum so readdir order does not matter.
+ */
+static void get_tree_stamp(const char *cache_root, struct tree_stamp *stamp)
+{
+	char github_path[4096];
+	struct stat st;
+	
+	memset(stamp, 0, sizeof(*stamp));
+	
+	snprintf(github_path, sizeof(github_path), "%s/github.com", cache_root);
+	if (stat(github_path, &st) != 0) {
+		return;
+	}
+	stamp->root_sec = (int64_t)st.st_mtim.tv_sec;
+	stamp->root_nsec = (int64_t)st.st_mtim.tv_nsec;
+	
+	DIR *github_dir = opendir(github_path);
+	if (!github_dir) {
+		return;
+	}
+	
+	int github_fd = dirfd(github_dir);
+	const struct dirent *entry;
+	while ((entry = readdir(github_dir)) != NULL) {
+		if (entry->d_name[0] == '.' ||
+		    fstatat(github_fd, entry->d_name, &st, 0) != 0 || !S_ISDIR(st.st_mode)) {
+			continue;
+		}
+		uint64_t hash = cache_index_hash_url(entry->d_name);
+		hash ^= (uint64_t)st.st_mtim.tv_sec * 1000000007ULL + (uint64_t)st.st_mtim.tv_nsec;
+		hash *= 1099511628211ULL;
+		stamp->owners += hash ^ (hash >> 29);
+	}
+	closedir(github_dir);
+}
+
+/**
+ * @brief Map the index for reading
+ */
+int cache_index_open(const char *cache_root, struct cache_index *index)
+{
+	if (!cache_root || !index) {
+		return CACHE_INDEX_ERROR_INVALID;
+	}
+	
+	memset(index, 0, sizeof(*index));
+	
+	char index_path[4096];
+	snprintf(index_path, sizeof(index_path), "%s/%s", cache_root, CACHE_INDEX_FILE);
+	
+	int fd = open(index_path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return errno == ENOENT ? CACHE_INDEX_ERROR_NOT_FOUND : CACHE_INDEX_ERROR_IO;
+	}
+	
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return CACHE_INDEX_ERROR_IO;
+	}
+	
+	size_t file_size = (size_t)st.st_size;
+	if (file_size < sizeof(struct cache_index_header)) {
+		close(fd);
+		return CACHE_INDEX_ERROR_CORRUPT;
+	}
+	
+	void *map = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return CACHE_INDEX_ERROR_IO;
+	}
+	
+	const struct cache_index_header *header = map;
+	size_t records_size = (size_t)header->record_count * sizeof(struct cache_index_record);
+	
+	if (memcmp(header->magic, CACHE_INDEX_MAGIC, sizeof(CACHE_INDEX_MAGIC)) != 0 ||
+	    header->version != CACHE_INDEX_VERSION ||
+	    header->record_size != sizeof(struct cache_index_record) ||
+	    header->strings_size == 0 ||
+	    sizeof(*header) + records_size + header->strings_size != file_size) {
+		munmap(map, file_size);
+		return CACHE_INDEX_ERROR_CORRUPT;
+	}
+	
+	index->map = map;
+	index->map_size = file_size;
+	index->header = header;
+	index->records = (const struct cache_index_record *)((const char *)map + sizeof(*header));
+	index->strings = (const char *)map + sizeof(*header) + records_size;
+	
+	/* String table must be NUL terminated so lookups cannot run off the end */
+	if (index->strings[header->strings_size - 1] != '\0') {
+		cache_index_close(index);
+		return CACHE_INDEX_ERROR_CORRUPT;
+	}
+	
+	/* A repository or owner directory added or removed behind our back makes the index stale */
+	struct tree_stamp stamp;
+	get_tree_stamp(cache_root, &stamp);
+	if (stamp.root_sec != header->root_mtime_sec || stamp.root_nsec != header->root_mtime_nsec ||
+	    stamp.owners != header->owners_stamp) {
+		return CACHE_INDEX_ERROR_STALE;
+	}
+	
+	return CACHE_INDEX_SUCCESS;
+}
+
+/**
+ * @brief Unmap index
+ */
+void cache_index_close(struct cache_index *index)
+{
+	if (!index) {
+		return;
+	}
+	
+	if (index->map) {
+		munmap(index->map, index->map_size);
+	}
+	memset(index, 0, sizeof(*index));
+}
+
+/**
+ * @brief Get string from string table
+ */
+const char* cache_index_string(const struct cache_index *index, uint32_t offset)
+{
+	if (!index || !index->header || offset >= index->header->strings_size) {
+		return "";
+	}
+	
+	return index->strings + offset;
+}
+
+/**
+ * @brief Find record by owner and name
+ */
+const struct cache_index_record* cache_index_find(const struct cache_index *index,
+	                                             const char *owner, const char *name)
+{
+	if (!index || !index->header || !owner || !name) {
+		return NULL;
+	}
+	
+	for (uint32_t i = 0; i < index->header->record_count; i++) {
+		const struct cache_index_record *record = &index->records[i];
+		if (strcmp(cache_index_string(index, record->owner_offset), owner) == 0 &&
+		    strcmp(cache_index_string(index, record->name_offset), name) == 0) {
+			return record;
+		}
+	}
+	
+	return NULL;
+}
+
+/**
+ * @brief Free builder entries
+ */
+static void builder_free(struct index_builder *builder)
+{
+	for (size_t i = 0; i < builder->count; i++) {
+		free(builder->entries[i].owner);
+		free(builder->entries[i].name);
+		free(builder->entries[i].url);
+	}
+	free(builder->entries);
+	memset(builder, 0, sizeof(*builder));
+}
+
+/**
+ * @brief Append an entry to the builder, taking copies of the strings
+ */
+static int builder_add(struct index_builder *builder, const struct cache_index_record *record,
+	                   const char *owner, const char *name, const char *url)
+{
+	if (builder->count == builder->capacity) {
+		size_t new_capacity = builder->capacity ? builder->capacity * 2 : 64;
+		struct index_entry *entries = realloc(builder->entries, new_capacity * sizeof(*entries));
+		if (!entries) {
+			return CACHE_INDEX_ERROR_MEMORY;
+		}
+		builder->entries = entries;
+		builder->capacity = new_capacity;
+	}
+	
+	struct index_entry *entry = &builder->entries[builder->count];
+	entry->record = *record;
+	entry->owner = strdup(owner ? owner : "");
+	entry->name = strdup(name ? name : "");
+	entry->url = strdup(url ? url : "");
+	
+	if (!entry->owner || !entry->name || !entry->url) {
+		free(entry->owner);
+		free(entry->name);
+		free(entry->url);
+		return CACHE_INDEX_ERROR_MEMORY;
+	}
+	
+	builder->count++;
+	return CACHE_INDEX_SUCCESS;
+}
+
+/**
+ * @brief Load every record of an existing index into the builder
+ */
+static int builder_load(struct index_builder *builder, const struct cache_index *index)
+{
+	for (uint32_t i = 0; i < index->header->record_count; i++) {
+		const struct cache_index_record *record = &index->records[i];
+		int ret = builder_add(builder, record,
+		                      cache_index_string(index, record->owner_offset),
+		                      cache_index_string(index, record->name_offset),
+		                      cache_index_string(index, record->url_offset));
+		if (ret != CACHE_INDEX_SUCCESS) {
+			return ret;
+		}
+	}
+	
+	return CACHE_INDEX_SUCCESS;
+}
+
+/**
+ * @brief Find entry index by owner and name, -1 if absent
+ */
+static long builder_find(const struct index_builder *builder, const char *owner, const char *name)
+{
+	for (size_t i = 0; i < builder->count; i++) {
+		if (strcmp(builder->entries[i].owner, owner) == 0 &&
+		    strcmp(builder->entries[i].name, name) == 0) {
+			return (long)i;
+		}
+	}
+	
+	return -1;
+}
+
+/**
+ * @brief Fill an index record from metadata
+ */
+static void record_from_metadata(struct cache_index_record *record, const struct cache_metadata *metadata)
+{
+	memset(record, 0, sizeof(*record));
+	
+	record->url_hash = cache_index_hash_url(metadata->original_url);
+	record->type = (int32_t)metadata->type;
+	record->strategy = (int32_t)metadata->strategy;
+	record->ref_count = (int32_t)metadata->ref_count;
+	record->created_time = (int64_t)metadata->created_time;
+	record->last_sync_time = (int64_t)metadata->last_sync_time;
+	record->last_access_time = (int64_t)metadata->last_access_time;
+	record->cache_size = (uint64_t)metadata->cache_size;
+	
+	record->flags = CACHE_INDEX_FLAG_METADATA;
+	if (metadata->has_submodules) {
+		record->flags |= CACHE_INDEX_FLAG_SUBMODULES;
+	}
+	if (metadata->is_fork_needed) {
+		record->flags |= CACHE_INDEX_FLAG_FORK;
+	}
+	if (metadata->is_private_fork) {
+		record->flags |= CACHE_INDEX_FLAG_PRIVATE;
+	}
+}
+
+/**
+ * @brief Serialize builder to <root>/cache_index.bin atomically
+ */
+static int builder_write(const struct index_builder *builder, const char *cache_root,
+	                     const struct tree_stamp *stamp)
+{
+	/* Lay out string table, offset 0 is the empty string */
+	size_t strings_size = 1;
+	for (size_t i = 0; i < builder->count; i++) {
+		strings_size += strlen(builder->entries[i].owner) + 1;
+		strings_size += strlen(builder->entries[i].name) + 1;
+		strings_size += strlen(builder->entries[i].url) + 1;
+	}
+	
+	if (strings_size > UINT32_MAX || builder->count > UINT32_MAX) {
+		return CACHE_INDEX_ERROR_INVALID;
+	}
+	
+	char *strings = malloc(strings_size);
+	struct cache_index_record *records = calloc(builder->count ? builder->count : 1, sizeof(*records));
+	if (!strings || !records) {
+		free(strings);
+		free(records);
+		return CACHE_INDEX_ERROR_MEMORY;
+	}
+	
+	size_t pos = 0;
+	strings[pos++] = '\0';
+	for (size_t i = 0; i < builder->count; i++) {
+		const struct index_entry *entry = &builder->entries[i];
+		const char *fields[3] = { entry->owner, entry->name, entry->url };
+		uint32_t offsets[3];
+	
+		for (int f = 0; f < 3; f++) {
+			size_t field_len = strlen(fields[f]);
+			if (field_len == 0) {
+				offsets[f] = 0;
+				continue;
+			}
+			offsets[f] = (uint32_t)pos;
+			memcpy(strings + pos, fields[f], field_len + 1);
+			pos += field_len + 1;
+		}
+	
+		records[i] = entry->record;
+		records[i].owner_offset = offsets[0];
+		records[i].name_offset = offsets[1];
+		records[i].url_offset = offsets[2];
+		records[i].reserved = 0;
+	}
+	strings_size = pos;
+	
+	struct cache_index_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CACHE_INDEX_MAGIC, sizeof(CACHE_INDEX_MAGIC));
+	header.version = CACHE_INDEX_VERSION;
+	header.record_size = sizeof(struct cache_index_record);
+	header.record_count = (uint32_t)builder->count;
+	header.strings_size = (uint32_t)strings_size;
+	header.root_mtime_sec = stamp->root_sec;
+	header.root_mtime_nsec = stamp->root_nsec;
+	header.owners_stamp = stamp->owners;
+	
+	char index_path[4096];
+	char temp_path[4096];
+	snprintf(index_path, sizeof(index_path), "%s/%s", cache_root, CACHE_INDEX_FILE);
+	snprintf(temp_path, sizeof(temp_path), "%s/%s.tmp.%d", cache_root, CACHE_INDEX_FILE, (int)getpid());
+	
+	int ret = CACHE_INDEX_SUCCESS;
+	FILE *file = fopen(temp_path, "wb");
+	if (!file) {
+		free(strings);
+		free(records);
+		return CACHE_INDEX_ERROR_IO;
+	}
+	
+	if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+	    (builder->count > 0 && fwrite(records, sizeof(*records), builder->count, file) != builder->count) ||
+	    fwrite(strings, 1, strings_size, file) != strings_size) {
+		ret = CACHE_INDEX_ERROR_IO;
+	}
+	
+	if (fclose(file) != 0) {
+		ret = CACHE_INDEX_ERROR_IO;
+	}
+	
+	if (ret == CACHE_INDEX_SUCCESS && rename(temp_path, index_path) != 0) {
+		ret = CACHE_INDEX_ERROR_IO;
+	}
+	
+	if (ret != CACHE_INDEX_SUCCESS) {
+		unlink(temp_path);
+	}
+	
+	free(strings);
+	free(records);
+	return ret;
+}
+
+/**
+ * @brief Take the index writer lock, returns fd or -1
+ */
+static int lock_index(const char *cache_root)
+{
+	char lock_path[4096];
+	snprintf(lock_path, sizeof(lock_path), "%s/%s", cache_root, CACHE_INDEX_LOCK_FILE);
+	
+	int fd = open(lock_path, O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		return -1;
+	}
+	
+	while (flock(fd, LOCK_EX) != 0) {
+		if (errno != EINTR) {
+			close(fd);
+			return -1;
+		}
+	}
+	
+	return fd;
+}
+
+/**
+ * @brief Release the index writer lock
+ */
+static void unlock_index(int fd)
+{
+	if (fd >= 0) {
+		flock(fd, LOCK_UN);
+		close(fd);
+	}
+}
+
+/**
+ * @brief Scan the cache tree into builder (caller holds the lock)
+ */
+static int scan_into_builder(const char *cache_root, struct index_builder *builder)
+{
+	char github_path[4096];
+	snprintf(github_path, sizeof(github_path), "%s/github.com", cache_root);
+	
+	DIR *github_dir = opendir(github_path);
+	if (!github_dir) {
+		return errno == ENOENT ? CACHE_INDEX_SUCCESS : CACHE_INDEX_ERROR_IO;
+	}
+	
+	const struct dirent *owner_entry;
+	while ((owner_entry = readdir(github_dir)) != NULL) {
+		if (owner_entry->d_name[0] == '.') {
+			continue;
+		}
+	
+		char owner_path[4096];
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+		snprintf(owner_path, sizeof(owner_path), "%s/%s", github_path, owner_entry->d_name);
+#pragma GCC diagnostic pop
+	
+		DIR *owner_dir = opendir(owner_path);
+		if (!owner_dir) {
+			continue;
+		}
+	
+		const struct dirent *repo_entry;
+		while ((repo_entry = readdir(owner_dir)) != NULL) {
+			/* Skip in-progress clones and backups */
+			if (repo_entry->d_name[0] == '.' || strstr(repo_entry->d_name, ".tmp.") ||
+			    strstr(repo_entry->d_name, ".backup.") || strstr(repo_entry->d_name, ".corrupted.")) {
+				continue;
+			}
+	
+			char repo_path[4096];
+			char head_path[4096];
+			struct stat st;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+			snprintf(repo_path, sizeof(repo_path), "%s/%s", owner_path, repo_entry->d_name);
+			snprintf(head_path, sizeof(head_path), "%s/HEAD", repo_path);
+#pragma GCC diagnostic pop
+	
+			/* Only bare repositories are cache entries */
+			if (stat(head_path, &st) != 0) {
+				continue;
+			}
+	
+			struct cache_index_record record;
+			struct cache_metadata metadata;
+			const char *url = NULL;
+			int has_metadata = (cache_metadata_load(repo_path, &metadata) == METADATA_SUCCESS);
+	
+			if (has_metadata) {
+				record_from_metadata(&record, &metadata);
+				url = metadata.original_url;
+			} else {
+				memset(&record, 0, sizeof(record));
+			}
+	
+			int ret = builder_add(builder, &record, owner_entry->d_name, repo_entry->d_name, url);
+	
+			if (has_metadata) {
+				cache_metadata_clear(&metadata);
+			}
+	
+			if (ret != CACHE_INDEX_SUCCESS) {
+				closedir(owner_dir);
+				closedir(github_dir);
+				return ret;
+			}
+		}
+		closedir(owner_dir);
+	}
+	closedir(github_dir);
+	
+	return CACHE_INDEX_SUCCESS;
+}
+
+/**
+ * @brief Rebuild while holding the writer lock
+ */
+static int rebuild_locked(const char *cache_root)
+{
+	struct index_builder builder = {0};
+	struct tree_stamp stamp;
+	
+	/* Sample the mtimes before scanning so concurrent additions mark it stale */
+	get_tree_stamp(cache_root, &stamp);
+	
+	int ret = scan_into_builder(cache_root, &builder);
+	if (ret == CACHE_INDEX_SUCCESS) {
+		ret = builder_write(&builder, cache_root, &stamp);
+	}
+	
+	int count = (int)builder.count;
+	builder_free(&builder);
+	
+	return ret == CACHE_INDEX_SUCCESS ? count : ret;
+}
+
+/**
+ * @brief Rebuild the index by scanning the cache directory
+ */
+int cache_index_rebuild(const char *cache_root)
+{
+	if (!cache_root) {
+		return CACHE_INDEX_ERROR_INVALID;
+	}
+	
+	int lock_fd = lock_index(cache_root);
+	if (lock_fd < 0) {
+		return CACHE_INDEX_ERROR_IO;
+	}
+	
+	int ret = rebuild_locked(cache_root);
+	
+	unlock_index(lock_fd);
+	return ret;
+}
+
+/**
+ * @brief Insert, replace or (metadata == NULL) remove a record
+ */
+static int modify_index(const char *cache_root, const char *owner, const char *name,
+	                    const struct cache_metadata *metadata)
+{
+	int lock_fd = lock_index(cache_root);
+	if (lock_fd < 0) {
+		return CACHE_INDEX_ERROR_IO;
+	}
+	
+	struct cache_index index;
+	int ret = cache_index_open(cache_root, &index);
+	if (ret != CACHE_INDEX_SUCCESS) {
+		/* Missing or stale index: a full scan picks up this change too */
+		cache_index_close(&index);
+		ret = rebuild_locked(cache_root);
+		unlock_index(lock_fd);
+		return ret < 0 ? ret : CACHE_INDEX_SUCCESS;
+	}
+	
+	struct index_builder builder = {0};
+	ret = builder_load(&builder, &index);
+	struct tree_stamp stamp;
+	stamp.root_sec = index.header->root_mtime_sec;
+	stamp.root_nsec = index.header->root_mtime_nsec;
+	stamp.owners = index.header->owners_stamp;
+	cache_index_close(&index);
+	
+	if (ret == CACHE_INDEX_SUCCESS) {
+		long pos = builder_find(&builder, owner, name);
+	
+		if (metadata) {
+			struct cache_index_record record;
+			record_from_metadata(&record, metadata);
+	
+			if (pos >= 0) {
+				struct index_entry *entry = &builder.entries[pos];
+				char *url = strdup(metadata->original_url ? metadata->original_url : "");
+				if (url) {
+					free(entry->url);
+					entry->url = url;
+					entry->record = record;
+				} else {
+					ret = CACHE_INDEX_ERROR_MEMORY;
+				}
+			} else {
+				ret = builder_add(&builder, &record, owner, name, metadata->original_url);
+			}
+		} else if (pos >= 0) {
+			struct index_entry *entry = &builder.entries[pos];
+			free(entry->owner);
+			free(entry->name);
+			free(entry->url);
+			memmove(entry, entry + 1, (builder.count - (size_t)pos - 1) * sizeof(*entry));
+			builder.count--;
+		}
+	}
+	
+	if (ret == CACHE_INDEX_SUCCESS) {
+		ret = builder_write(&builder, cache_root, &stamp);
+	}
+	
+	builder_free(&builder);
+	unlock_index(lock_fd);
+	return ret;
+}
+
+/**
+ * @brief Insert or replace record for repository
+ */
+int cache_index_update(const char *cache_root, const struct cache_metadata *metadata)
+{
+	if (!cache_root || !metadata || !metadata->owner || !metadata->name) {
+		return CACHE_INDEX_ERROR_INVALID;
+	}
+	
+	return modify_index(cache_root, metadata->owner, metadata->name, metadata);
+}
+
+/**
+ * @brief Remove record for repository
+ */
+int cache_index_remove(const char *cache_root, const char *owner, const char *name)
+{
+	if (!cache_root || !owner || !name) {
+		return CACHE_INDEX_ERROR_INVALID;
+	}
+	
+	return modify_index(cache_root, owner, name, NULL);
+}
+
+/**
+ * @brief Get error string for index error code
+ */
+const char* cache_index_error_string(int error_code)
+{
+	switch (error_code) {
+		case CACHE_INDEX_SUCCESS:
+			return "Success";
+		case CACHE_INDEX_ERROR_INVALID:
+			return "Invalid argument";
+		case CACHE_INDEX_ERROR_NOT_FOUND:
+			return "Index not found";
+		case CACHE_INDEX_ERROR_IO:
+			return "I/O error";
+		case CACHE_INDEX_ERROR_MEMORY:
+			return "Memory allocation failed";
+		case CACHE_INDEX_ERROR_CORRUPT:
+			return "Index file corrupt";
+		case CACHE_INDEX_ERROR_STALE:
+			return "Index out of date";
+		default:
+			return "Unknown error";
+	}
+}
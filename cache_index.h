@@ -0,0 +1,181 @@
+#ifndef CACHE_INDEX_H
+#define CACHE_INDEX_H
+
+/**
+ * @file cache_index.h
+ * @brief Persistent index of cached repositories for git-cache
+ *
+ * The index is a single binary file under the cache root holding one
+ * fixed-size record per cached repository, followed by a string table
+ * for owner, name and URL. It lets listing operations avoid walking
+ * the cache directory tree and parsing every metadata file.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "git-cache.h"
+
+/* Forward declarations */
+struct cache_metadata;
+
+/**
+ * @brief Index file name (relative to cache root)
+ */
+#define CACHE_INDEX_FILE "cache_index.bin"
+
+/**
+ * @brief Index format identification
+ */
+#define CACHE_INDEX_MAGIC   "GCINDEX"
+#define CACHE_INDEX_VERSION 2
+
+/**
+ * @brief Index error codes
+ */
+#define CACHE_INDEX_SUCCESS         0
+#define CACHE_INDEX_ERROR_INVALID  -1
+#define CACHE_INDEX_ERROR_NOT_FOUND -2
+#define CACHE_INDEX_ERROR_IO       -3
+#define CACHE_INDEX_ERROR_MEMORY   -4
+#define CACHE_INDEX_ERROR_CORRUPT  -5
+#define CACHE_INDEX_ERROR_STALE    -6
+
+/**
+ * @brief Record flags
+ */
+#define CACHE_INDEX_FLAG_METADATA   0x01  /**< Repository has a metadata file */
+#define CACHE_INDEX_FLAG_SUBMODULES 0x02  /**< Repository has submodules */
+#define CACHE_INDEX_FLAG_FORK       0x04  /**< Forking was needed */
+#define CACHE_INDEX_FLAG_PRIVATE    0x08  /**< Fork is private */
+
+/**
+ * @brief Index file header
+ */
+struct cache_index_header {
+	char magic[8];              /**< CACHE_INDEX_MAGIC */
+	uint32_t version;           /**< CACHE_INDEX_VERSION */
+	uint32_t record_size;       /**< sizeof(struct cache_index_record) */
+	uint32_t record_count;      /**< Number of records */
+	uint32_t strings_size;      /**< Size of string table in bytes */
+	int64_t root_mtime_sec;     /**< github.com directory mtime when written */
+	int64_t root_mtime_nsec;    /**< Nanosecond part of the mtime */
+	uint64_t owners_stamp;      /**< Owner directory names and mtimes folded together when written */
+};
+
+/**
+ * @brief Fixed-size index record, one per cached repository
+ */
+struct cache_index_record {
+	uint64_t url_hash;          /**< FNV-1a hash of the original URL */
+	uint32_t owner_offset;      /**< Owner offset in string table */
+	uint32_t name_offset;       /**< Name offset in string table */
+	uint32_t url_offset;        /**< Original URL offset in string table */
+	int32_t type;               /**< enum repo_type */
+	int32_t strategy;           /**< enum clone_strategy */
+	int32_t ref_count;          /**< Number of active checkouts */
+	int64_t created_time;       /**< When cache was created */
+	int64_t last_sync_time;     /**< Last synchronization time */
+	int64_t last_access_time;   /**< Last access time */
+	uint64_t cache_size;        /**< Cache size in bytes */
+	uint32_t flags;             /**< CACHE_INDEX_FLAG_* */
+	uint32_t reserved;          /**< Padding, always zero */
+};
+
+/**
+ * @brief Read-only mapping of an index file
+ */
+struct cache_index {
+	void *map;                                  /**< Mapped file contents */
+	size_t map_size;                            /**< Size of mapping */
+	const struct cache_index_header *header;    /**< File header */
+	const struct cache_index_record *records;   /**< Record array */
+	const char *strings;                        /**< String table */
+};
+
+/**
+ * @brief Map the index for reading
+ * @param cache_root Cache root directory
+ * @param index Index structure to populate
+ * @return CACHE_INDEX_SUCCESS, CACHE_INDEX_ERROR_STALE if a repository or
+ *         owner directory was added or removed since the index was
+ *         written, or another error code.
+ *         A stale index is still mapped and must be closed by the caller.
+ */
+int cache_index_open(const char *cache_root, struct cache_index *index);
+
+/**
+ * @brief Unmap an index opened with cache_index_open()
+ * @param index Index to close
+ */
+void cache_index_close(struct cache_index *index);
+
+/**
+ * @brief Get a string from the index string table
+ * @param index Open index
+ * @param offset Offset from a record
+ * @return String (empty string if offset is out of range)
+ */
+const char* cache_index_string(const struct cache_index *index, uint32_t offset);
+
+/**
+ * @brief Find a record by owner and name
+ * @param index Open index
+ * @param owner Repository owner
+ * @param name Repository name
+ * @return Matching record or NULL
+ */
+const struct cache_index_record* cache_index_find(const struct cache_index *index,
+	                                             const char *owner, const char *name);
+
+/**
+ * @brief Insert or replace the record for a repository
+ * @param cache_root Cache root directory
+ * @param metadata Repository metadata (owner and name required)
+ * @return CACHE_INDEX_SUCCESS on success, error code on failure
+ */
+int cache_index_update(const char *cache_root, const struct cache_metadata *metadata);
+
+/**
+ * @brief Remove the record for a repository
+ * @param cache_root Cache root directory
+ * @param owner Repository owner
+ * @param name Repository name
+ * @return CACHE_INDEX_SUCCESS on success, error code on failure
+ */
+int cache_index_remove(const char *cache_root, const char *owner, const char *name);
+
+/**
+ * @brief Rebuild the index by scanning the cache directory
+ * @param cache_root Cache root directory
+ * @return Number of repositories indexed, or negative error code
+ */
+int cache_index_rebuild(const char *cache_root);
+
+/**
+ * @brief Derive the cache root from a repository cache path
+ *
+ * Cache paths have the form <root>/github.com/<owner>/<name>.
+ *
+ * @param cache_path Repository cache path
+ * @param root Buffer for the cache root
+ * @param root_size Size of buffer
+ * @return CACHE_INDEX_SUCCESS on success, CACHE_INDEX_ERROR_INVALID if the
+ *         path is not inside a cache root
+ */
+int cache_index_root_from_path(const char *cache_path, char *root, size_t root_size);
+
+/**
+ * @brief Hash a repository URL for index lookups
+ * @param url Repository URL
+ * @return 64-bit FNV-1a hash
+ */
+uint64_t cache_index_hash_url(const char *url);
+
+/**
+ * @brief Get human-readable error message for index error code
+ * @param error_code Index error code
+ * @return Error message string
+ */
+const char* cache_index_error_string(int error_code);
+
+#endif /* CACHE_INDEX_H */
@@ -0,0 +1,304 @@
+/**
+ * @file cache_journal.c
+ * @brief Append-only binary journal of cache metadata events
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include "cache_journal.h"
+
+/**
+ * @brief Attempts to find a journal that was not compacted away meanwhile
+ */
+#define JOURNAL_OPEN_ATTEMPTS 8
+
+/**
+ * @brief Build the journal path of a cache
+ */
+static int journal_path(const char *cache_path, char *path, size_t path_size)
+{
+	int len = snprintf(path, path_size, "%s/%s", cache_path, CACHE_JOURNAL_FILE);
+	if (len < 0 || (size_t)len >= path_size) {
+		return CACHE_JOURNAL_ERROR_INVALID;
+	}
+	return CACHE_JOURNAL_SUCCESS;
+}
+
+/**
+ * @brief Check that a descriptor still refers to the file at path
+ */
+static int is_current(int fd, const char *path)
+{
+	struct stat fd_st;
+	struct stat path_st;
+	return fstat(fd, &fd_st) == 0 && stat(path, &path_st) == 0 &&
+	       fd_st.st_dev == path_st.st_dev && fd_st.st_ino == path_st.st_ino;
+}
+
+/**
+ * @brief Create a journal holding only its header
+ *
+ * The header is written to a temporary file that is then linked into
+ * place, so no appender ever sees a journal without one.
+ */
+static int create_journal(const char *path)
+{
+	char temp_path[4096 + 32];
+	snprintf(temp_path, sizeof(temp_path), "%s.tmp.%ld", path, (long)getpid());
+	
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	uint64_t id = ((uint64_t)now.tv_sec << 30) ^ (uint64_t)now.tv_nsec ^ ((uint64_t)getpid() << 12);
+	id &= (uint64_t)INT64_MAX;
+	
+	struct cache_journal_record header;
+	header.magic = CACHE_JOURNAL_MAGIC;
+	header.type = CACHE_JOURNAL_HEADER;
+	header.value = (int64_t)(id ? id : 1);
+	
+	int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		return CACHE_JOURNAL_ERROR_IO;
+	}
+	int ok = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header);
+	ok = close(fd) == 0 && ok;
+	
+	/* Whoever links first wins; everyone then appends to that journal */
+	if (ok && link(temp_path, path) != 0 && errno != EEXIST) {
+		ok = 0;
+	}
+	unlink(temp_path);
+	return ok ? CACHE_JOURNAL_SUCCESS : CACHE_JOURNAL_ERROR_IO;
+}
+
+/**
+ * @brief Read the records of an open journal
+ */
+static int read_records(int fd, struct cache_journal *journal)
+{
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		return CACHE_JOURNAL_ERROR_IO;
+	}
+	
+	/* A record torn by a crash at the end is left out */
+	size_t total = (size_t)st.st_size / sizeof(struct cache_journal_record);
+	if (total == 0) {
+		return CACHE_JOURNAL_SUCCESS;
+	}
+	
+	struct cache_journal_record *records = malloc(total * sizeof(*records));
+	if (!records) {
+		return CACHE_JOURNAL_ERROR_MEMORY;
+	}
+	
+	size_t size = total * sizeof(*records);
+	size_t done = 0;
+	while (done < size) {
+		ssize_t n = pread(fd, (char *)records + done, size - done, (off_t)done);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			break;
+		}
+		done += (size_t)n;
+	}
+	total = done / sizeof(*records);
+	
+	if (total == 0 || records[0].magic != CACHE_JOURNAL_MAGIC ||
+	    records[0].type != CACHE_JOURNAL_HEADER || records[0].value <= 0) {
+		free(records);
+		return CACHE_JOURNAL_SUCCESS;
+	}
+	
+	journal->id = (uint64_t)records[0].value;
+	journal->count = total - 1;
+	memmove(records, records + 1, journal->count * sizeof(*records));
+	journal->records = records;
+	return CACHE_JOURNAL_SUCCESS;
+}
+
+/**
+ * @brief Append an event to the journal of a cache
+ */
+int cache_journal_append(const char *cache_path, enum cache_journal_event type, int64_t value)
+{
+	if (!cache_path || type == CACHE_JOURNAL_HEADER) {
+		return CACHE_JOURNAL_ERROR_INVALID;
+	}
+	
+	char path[4096];
+	int ret = journal_path(cache_path, path, sizeof(path));
+	if (ret != CACHE_JOURNAL_SUCCESS) {
+		return ret;
+	}
+	
+	struct cache_journal_record record;
+	record.magic = CACHE_JOURNAL_MAGIC;
+	record.type = (uint32_t)type;
+	record.value = value;
+	
+	for (int attempt = 0; attempt < JOURNAL_OPEN_ATTEMPTS; attempt++) {
+		int fd = open(path, O_WRONLY | O_APPEND | O_CLOEXEC);
+		if (fd < 0) {
+			if (errno != ENOENT || create_journal(path) != CACHE_JOURNAL_SUCCESS) {
+				return CACHE_JOURNAL_ERROR_IO;
+			}
+			continue;
+		}
+		
+		/* A compaction holds the lock exclusively and unlinks the journal */
+		struct stat st;
+		if (flock(fd, LOCK_SH) != 0 || !is_current(fd, path) || fstat(fd, &st) != 0) {
+			close(fd);
+			continue;
+		}
+		
+		/* O_APPEND makes a write this small land whole at the end */
+		ssize_t written = write(fd, &record, sizeof(record));
+		close(fd);
+		if (written != (ssize_t)sizeof(record)) {
+			return CACHE_JOURNAL_ERROR_IO;
+		}
+		return (int)((size_t)st.st_size / sizeof(record));
+	}
+	
+	return CACHE_JOURNAL_ERROR_IO;
+}
+
+/**
+ * @brief Read the journal of a cache
+ */
+int cache_journal_read(const char *cache_path, struct cache_journal *journal)
+{
+	if (!cache_path || !journal) {
+		return CACHE_JOURNAL_ERROR_INVALID;
+	}
+	
+	memset(journal, 0, sizeof(*journal));
+	journal->lock_fd = -1;
+	
+	char path[4096];
+	int ret = journal_path(cache_path, path, sizeof(path));
+	if (ret != CACHE_JOURNAL_SUCCESS) {
+		return ret;
+	}
+	
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return errno == ENOENT ? CACHE_JOURNAL_SUCCESS : CACHE_JOURNAL_ERROR_IO;
+	}
+	ret = read_records(fd, journal);
+	close(fd);
+	return ret;
+}
+
+/**
+ * @brief Lock the journal of a cache against appends and read it
+ */
+int cache_journal_lock(const char *cache_path, struct cache_journal *journal)
+{
+	if (!cache_path || !journal) {
+		return CACHE_JOURNAL_ERROR_INVALID;
+	}
+	
+	memset(journal, 0, sizeof(*journal));
+	journal->lock_fd = -1;
+	
+	char path[4096];
+	int ret = journal_path(cache_path, path, sizeof(path));
+	if (ret != CACHE_JOURNAL_SUCCESS) {
+		return ret;
+	}
+	
+	for (int attempt = 0; attempt < JOURNAL_OPEN_ATTEMPTS; attempt++) {
+		int fd = open(path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return errno == ENOENT ? CACHE_JOURNAL_ERROR_NOT_FOUND : CACHE_JOURNAL_ERROR_IO;
+		}
+		
+		/* Another compaction may have removed it while we waited */
+		if (flock(fd, LOCK_EX) != 0 || !is_current(fd, path)) {
+			close(fd);
+			continue;
+		}
+		
+		ret = read_records(fd, journal);
+		if (ret != CACHE_JOURNAL_SUCCESS) {
+			close(fd);
+			return ret;
+		}
+		journal->lock_fd = fd;
+		return CACHE_JOURNAL_SUCCESS;
+	}
+	
+	return CACHE_JOURNAL_ERROR_IO;
+}
+
+/**
+ * @brief Remove a locked journal once its records are folded in
+ */
+int cache_journal_remove(const char *cache_path, struct cache_journal *journal)
+{
+	if (!cache_path || !journal || journal->lock_fd < 0) {
+		return CACHE_JOURNAL_ERROR_INVALID;
+	}
+	
+	char path[4096];
+	int ret = journal_path(cache_path, path, sizeof(path));
+	if (ret == CACHE_JOURNAL_SUCCESS && unlink(path) != 0) {
+		ret = CACHE_JOURNAL_ERROR_IO;
+	}
+	
+	/* Appenders waiting for the lock now see the unlinked inode and start anew */
+	cache_journal_free(journal);
+	return ret;
+}
+
+/**
+ * @brief Free a journal and release its lock
+ */
+void cache_journal_free(struct cache_journal *journal)
+{
+	if (!journal) {
+		return;
+	}
+	
+	if (journal->lock_fd >= 0) {
+		close(journal->lock_fd);
+	}
+	free(journal->records);
+	memset(journal, 0, sizeof(*journal));
+	journal->lock_fd = -1;
+}
+
+/**
+ * @brief Get human-readable error message for cache journal error code
+ */
+const char* cache_journal_error_string(int error_code)
+{
+	switch (error_code) {
+		case CACHE_JOURNAL_SUCCESS:
+			return "Success";
+		case CACHE_JOURNAL_ERROR_INVALID:
+			return "Invalid argument";
+		case CACHE_JOURNAL_ERROR_NOT_FOUND:
+			return "Journal not found";
+		case CACHE_JOURNAL_ERROR_IO:
+			return "Journal I/O error";
+		case CACHE_JOURNAL_ERROR_MEMORY:
+			return "Memory allocation failed";
+		default:
+			return "Unknown error";
+	}
+}
@@ -0,0 +1,133 @@
+#ifndef CACHE_JOURNAL_H
+#define CACHE_JOURNAL_H
+
+/**
+ * @file cache_journal.h
+ * @brief Append-only binary journal of cache metadata events
+ *
+ * Checkouts record their access and reference count changes as fixed-size
+ * records appended with O_APPEND to a journal next to cache_metadata.json,
+ * so the hot path costs one small write instead of rewriting the JSON.
+ * The first record holds a random journal id. Metadata stores which
+ * journal it last folded in and how many of its records, and replays the
+ * rest on load.
+ *
+ * Appenders hold a shared flock on the journal while they write. A
+ * compaction takes the exclusive lock, folds the records into the JSON,
+ * and unlinks the journal. An appender whose journal was unlinked under it
+ * notices the changed inode and writes to a new journal instead.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Journal file name (relative to cache directory)
+ */
+#define CACHE_JOURNAL_FILE "cache_metadata.journal"
+
+/**
+ * @brief Marks every record, so torn or foreign data is skipped
+ */
+#define CACHE_JOURNAL_MAGIC 0x4c4a4347u
+
+/**
+ * @brief Records after which the journal is folded into the metadata
+ */
+#define CACHE_JOURNAL_COMPACT_RECORDS 256
+
+/**
+ * @brief Cache journal error codes
+ */
+#define CACHE_JOURNAL_SUCCESS          0
+#define CACHE_JOURNAL_ERROR_INVALID   -1
+#define CACHE_JOURNAL_ERROR_NOT_FOUND -2
+#define CACHE_JOURNAL_ERROR_IO        -3
+#define CACHE_JOURNAL_ERROR_MEMORY    -4
+
+/**
+ * @brief Kinds of journal records
+ */
+enum cache_journal_event {
+	CACHE_JOURNAL_HEADER = 0,       /**< First record, value is the journal id */
+	CACHE_JOURNAL_ACCESS,           /**< Cache was used, value is the time */
+	CACHE_JOURNAL_SYNC,             /**< Cache was synchronized, value is the time */
+	CACHE_JOURNAL_MAINTENANCE,      /**< Packs were maintained, value is the time */
+	CACHE_JOURNAL_REF_ADD,          /**< Checkout was created, value is the time */
+	CACHE_JOURNAL_REF_DROP          /**< Checkout was removed, value is the time */
+};
+
+/**
+ * @brief On-disk journal record
+ */
+struct cache_journal_record {
+	uint32_t magic;             /**< CACHE_JOURNAL_MAGIC */
+	uint32_t type;              /**< enum cache_journal_event */
+	int64_t value;              /**< Time of the event, or the id in the header */
+};
+
+/**
+ * @brief Journal contents read into memory
+ */
+struct cache_journal {
+	uint64_t id;                /**< Journal id, 0 if there is no journal */
+	struct cache_journal_record *records; /**< Records after the header */
+	size_t count;               /**< Number of records after the header */
+	int lock_fd;                /**< Descriptor holding the exclusive lock, -1 if none */
+};
+
+/**
+ * @brief Append an event to the journal of a cache
+ *
+ * Creates the journal if there is none.
+ *
+ * @param cache_path Path to cache directory
+ * @param type Event
+ * @param value Event time
+ * @return Number of records in the journal after the append (at least 1),
+ *         or negative error code
+ */
+int cache_journal_append(const char *cache_path, enum cache_journal_event type, int64_t value);
+
+/**
+ * @brief Read the journal of a cache
+ * @param cache_path Path to cache directory
+ * @param journal Output journal, empty with id 0 if there is none; free with cache_journal_free()
+ * @return CACHE_JOURNAL_SUCCESS on success, error code on failure
+ */
+int cache_journal_read(const char *cache_path, struct cache_journal *journal);
+
+/**
+ * @brief Lock the journal of a cache against appends and read it
+ *
+ * The lock is held until cache_journal_remove() or cache_journal_free().
+ *
+ * @param cache_path Path to cache directory
+ * @param journal Output journal
+ * @return CACHE_JOURNAL_SUCCESS on success, CACHE_JOURNAL_ERROR_NOT_FOUND if
+ *         there is no journal, other error code on failure
+ */
+int cache_journal_lock(const char *cache_path, struct cache_journal *journal);
+
+/**
+ * @brief Remove a locked journal once its records are folded in
+ * @param cache_path Path to cache directory
+ * @param journal Journal locked with cache_journal_lock(), freed on return
+ * @return CACHE_JOURNAL_SUCCESS on success, error code on failure
+ */
+int cache_journal_remove(const char *cache_path, struct cache_journal *journal);
+
+/**
+ * @brief Free a journal and release its lock
+ * @param journal Journal to free
+ */
+void cache_journal_free(struct cache_journal *journal);
+
+/**
+ * @brief Get human-readable error message for cache journal error code
+ * @param error_code Cache journal error code
+ * @return Error message string
+ */
+const char* cache_journal_error_string(int error_code);
+
+#endif /* CACHE_JOURNAL_H */
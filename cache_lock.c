@@ -0,0 +1,311 @@
+/**
+ * @file cache_lock.c
+ * @brief Reader/writer locks implementation
+ *
+ * A process keeps one open lock file per locked path in a small table.
+ * The table belongs to the process that filled it: a forked child starts
+ * with an empty table, so it waits for its parent's locks like any other
+ * process instead of believing it holds them.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/file.h>
+
+#include "cache_lock.h"
+
+/* Backoff between attempts while waiting with a timeout */
+#define LOCK_POLL_MIN_MS 10
+#define LOCK_POLL_MAX_MS 250
+
+/**
+ * @brief A lock held by this process
+ */
+struct held_lock {
+	char *path;                 /**< Locked directory */
+	int fd;                     /**< Open lock file */
+	int count;                  /**< Nested acquisitions */
+	enum cache_lock_mode mode;  /**< Mode currently held */
+};
+
+static struct held_lock *held_locks = NULL;
+static size_t held_count = 0;
+static size_t held_capacity = 0;
+static pid_t held_pid = 0;
+
+/**
+ * @brief Forget locks inherited from a parent process
+ */
+static void forget_inherited_locks(void)
+{
+	pid_t pid = getpid();
+	if (held_pid == pid) {
+		return;
+	}
+	
+	/* Closing our copies leaves the parent's locks in place */
+	for (size_t i = 0; i < held_count; i++) {
+		close(held_locks[i].fd);
+		free(held_locks[i].path);
+	}
+	held_count = 0;
+	held_pid = pid;
+}
+
+/**
+ * @brief Find a held lock by path
+ */
+static struct held_lock *find_held_lock(const char *path)
+{
+	for (size_t i = 0; i < held_count; i++) {
+		if (strcmp(held_locks[i].path, path) == 0) {
+			return &held_locks[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Copy a resource path without trailing slashes
+ */
+static int normalize_path(const char *resource_path, char *path, size_t path_size)
+{
+	size_t len = strlen(resource_path);
+	while (len > 1 && resource_path[len - 1] == '/') {
+		len--;
+	}
+	if (len == 0 || len >= path_size) {
+		return -1;
+	}
+	memcpy(path, resource_path, len);
+	path[len] = '\0';
+	return 0;
+}
+
+/**
+ * @brief Build the lock file path, ".<name>.lock" next to the directory
+ */
+static int build_lock_path(const char *path, char *lock_path, size_t lock_size)
+{
+	const char *slash = strrchr(path, '/');
+	int len;
+	if (slash) {
+		len = snprintf(lock_path, lock_size, "%.*s/.%s.lock", (int)(slash - path), path, slash + 1);
+	} else {
+		len = snprintf(lock_path, lock_size, ".%s.lock", path);
+	}
+	return len > 0 && (size_t)len < lock_size ? 0 : -1;
+}
+
+/**
+ * @brief Milliseconds elapsed on the monotonic clock since start
+ */
+static long elapsed_ms(const struct timespec *start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long)(now.tv_sec - start->tv_sec) * 1000 +
+	       (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+/**
+ * @brief Take a flock, waiting up to timeout_seconds when it is contended
+ *
+ * A bounded wait polls with LOCK_NB instead of interrupting a blocked
+ * flock() with alarm(), which would replace the caller's own alarm.
+ */
+static int wait_for_lock(int fd, int operation, int block, unsigned int timeout_seconds,
+                         const char *path, int verbose)
+{
+	if (flock(fd, operation | LOCK_NB) == 0) {
+		return CACHE_LOCK_SUCCESS;
+	}
+	if (errno != EWOULDBLOCK) {
+		return CACHE_LOCK_ERROR_IO;
+	}
+	if (!block) {
+		return CACHE_LOCK_ERROR_BUSY;
+	}
+	
+	if (verbose) {
+		printf("Waiting for %s lock on %s...\n",
+		       operation == LOCK_EX ? "exclusive" : "shared", path);
+	}
+	
+	/* Without a timeout, block in the kernel */
+	if (timeout_seconds == 0) {
+		while (flock(fd, operation) != 0) {
+			if (errno != EINTR) {
+				return CACHE_LOCK_ERROR_IO;
+			}
+		}
+		return CACHE_LOCK_SUCCESS;
+	}
+	
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	long timeout_ms = (long)timeout_seconds * 1000;
+	long delay_ms = LOCK_POLL_MIN_MS;
+	
+	for (;;) {
+		long remaining_ms = timeout_ms - elapsed_ms(&start);
+		if (remaining_ms <= 0) {
+			return CACHE_LOCK_ERROR_TIMEOUT;
+		}
+		long sleep_ms = delay_ms < remaining_ms ? delay_ms : remaining_ms;
+		struct timespec pause = { sleep_ms / 1000, (sleep_ms % 1000) * 1000000 };
+		nanosleep(&pause, NULL);
+		
+		if (flock(fd, operation | LOCK_NB) == 0) {
+			return CACHE_LOCK_SUCCESS;
+		}
+		if (errno != EWOULDBLOCK && errno != EINTR) {
+			return CACHE_LOCK_ERROR_IO;
+		}
+		if (delay_ms < LOCK_POLL_MAX_MS) {
+			delay_ms = delay_ms * 2 < LOCK_POLL_MAX_MS ? delay_ms * 2 : LOCK_POLL_MAX_MS;
+		}
+	}
+}
+
+/**
+ * @brief Acquire a lock, optionally waiting for other processes
+ */
+static int lock_resource(const char *resource_path, enum cache_lock_mode mode, int block,
+                         unsigned int timeout_seconds, int verbose)
+{
+	char path[4096];
+	if (!resource_path || normalize_path(resource_path, path, sizeof(path)) != 0) {
+		return CACHE_LOCK_ERROR_INVALID;
+	}
+	
+	forget_inherited_locks();
+	
+	int operation = mode == CACHE_LOCK_EXCLUSIVE ? LOCK_EX : LOCK_SH;
+	
+	struct held_lock *held = find_held_lock(path);
+	if (held) {
+		if (mode == CACHE_LOCK_EXCLUSIVE && held->mode == CACHE_LOCK_SHARED) {
+			int ret = wait_for_lock(held->fd, LOCK_EX, block, timeout_seconds, path, verbose);
+			if (ret != CACHE_LOCK_SUCCESS) {
+				return ret;
+			}
+			held->mode = CACHE_LOCK_EXCLUSIVE;
+		}
+		held->count++;
+		return CACHE_LOCK_SUCCESS;
+	}
+	
+	if (held_count == held_capacity) {
+		size_t new_capacity = held_capacity ? held_capacity * 2 : 8;
+		struct held_lock *new_locks = realloc(held_locks, new_capacity * sizeof(*new_locks));
+		if (!new_locks) {
+			return CACHE_LOCK_ERROR_MEMORY;
+		}
+		held_locks = new_locks;
+		held_capacity = new_capacity;
+	}
+	
+	char lock_path[4096 + 16];
+	if (build_lock_path(path, lock_path, sizeof(lock_path)) != 0) {
+		return CACHE_LOCK_ERROR_INVALID;
+	}
+	
+	int fd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		return CACHE_LOCK_ERROR_IO;
+	}
+	
+	int ret = wait_for_lock(fd, operation, block, timeout_seconds, path, verbose);
+	if (ret != CACHE_LOCK_SUCCESS) {
+		close(fd);
+		return ret;
+	}
+	
+	char *path_copy = strdup(path);
+	if (!path_copy) {
+		close(fd);
+		return CACHE_LOCK_ERROR_MEMORY;
+	}
+	
+	held = &held_locks[held_count++];
+	held->path = path_copy;
+	held->fd = fd;
+	held->count = 1;
+	held->mode = mode;
+	return CACHE_LOCK_SUCCESS;
+}
+
+/**
+ * @brief Acquire a lock on a path, blocking until it is available
+ */
+int cache_lock_acquire(const char *resource_path, enum cache_lock_mode mode,
+                       unsigned int timeout_seconds, int verbose)
+{
+	return lock_resource(resource_path, mode, 1, timeout_seconds, verbose);
+}
+
+/**
+ * @brief Acquire a lock on a path only if no other process holds it
+ */
+int cache_lock_try_acquire(const char *resource_path, enum cache_lock_mode mode)
+{
+	return lock_resource(resource_path, mode, 0, 0, 0);
+}
+
+/**
+ * @brief Release one acquisition of a lock
+ */
+int cache_lock_release(const char *resource_path)
+{
+	char path[4096];
+	if (!resource_path || normalize_path(resource_path, path, sizeof(path)) != 0) {
+		return CACHE_LOCK_ERROR_INVALID;
+	}
+	
+	forget_inherited_locks();
+	
+	struct held_lock *held = find_held_lock(path);
+	if (!held) {
+		return CACHE_LOCK_ERROR_INVALID;
+	}
+	
+	if (--held->count > 0) {
+		return CACHE_LOCK_SUCCESS;
+	}
+	
+	/* Closing the last descriptor drops the flock */
+	close(held->fd);
+	free(held->path);
+	*held = held_locks[--held_count];
+	return CACHE_LOCK_SUCCESS;
+}
+
+/**
+ * @brief Get human-readable error message for cache lock error code
+ */
+const char* cache_lock_error_string(int error_code)
+{
+	switch (error_code) {
+		case CACHE_LOCK_SUCCESS:
+			return "Success";
+		case CACHE_LOCK_ERROR_INVALID:
+			return "Invalid lock path or lock not held";
+		case CACHE_LOCK_ERROR_IO:
+			return "Failed to open or lock lock file";
+		case CACHE_LOCK_ERROR_MEMORY:
+			return "Memory allocation failed";
+		case CACHE_LOCK_ERROR_TIMEOUT:
+			return "Timed out waiting for lock";
+		case CACHE_LOCK_ERROR_BUSY:
+			return "Locked by another process";
+		default:
+			return "Unknown error";
+	}
+}
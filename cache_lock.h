@@ -0,0 +1,81 @@
+#ifndef CACHE_LOCK_H
+#define CACHE_LOCK_H
+
+/**
+ * @file cache_lock.h
+ * @brief Reader/writer locks on cache repositories and checkouts
+ *
+ * Locks are flock(2) locks on a hidden lock file next to the locked
+ * directory (".<name>.lock"). Waiters without a timeout block in the
+ * kernel and waiters with one poll, so no signals or alarms are used;
+ * readers share the lock, and a lock disappears with the process holding
+ * it, so there are no stale lock files to clean up. Lock files are never removed,
+ * because removing one would let two processes lock different files for
+ * the same path.
+ *
+ * Locks are reentrant within a process: acquiring a path that is already
+ * held only counts the nesting. Lock file descriptors are close-on-exec,
+ * so commands started while holding a lock never keep it alive.
+ */
+
+/**
+ * @brief Seconds to wait for a contended lock before giving up
+ */
+#define CACHE_LOCK_TIMEOUT 60
+
+/**
+ * @brief Cache lock error codes
+ */
+#define CACHE_LOCK_SUCCESS         0
+#define CACHE_LOCK_ERROR_INVALID  -1
+#define CACHE_LOCK_ERROR_IO       -2
+#define CACHE_LOCK_ERROR_MEMORY   -3
+#define CACHE_LOCK_ERROR_TIMEOUT  -4
+#define CACHE_LOCK_ERROR_BUSY     -5
+
+/**
+ * @brief Lock modes
+ */
+enum cache_lock_mode {
+	CACHE_LOCK_SHARED,      /**< Readers, e.g. checkout creation and verify */
+	CACHE_LOCK_EXCLUSIVE    /**< Writers, e.g. fetch, repair and clean */
+};
+
+/**
+ * @brief Acquire a lock on a path, blocking until it is available
+ *
+ * Requesting an exclusive lock on a path this process holds shared
+ * converts the lock; like flock(2) the conversion is not atomic.
+ *
+ * @param resource_path Directory to lock (need not exist yet)
+ * @param mode Shared or exclusive
+ * @param timeout_seconds Give up after this many seconds (0 waits forever)
+ * @param verbose Report when waiting for another process
+ * @return CACHE_LOCK_SUCCESS on success, error code on failure
+ */
+int cache_lock_acquire(const char *resource_path, enum cache_lock_mode mode,
+                       unsigned int timeout_seconds, int verbose);
+
+/**
+ * @brief Acquire a lock on a path only if no other process holds it
+ * @param resource_path Directory to lock (need not exist yet)
+ * @param mode Shared or exclusive
+ * @return CACHE_LOCK_SUCCESS on success, CACHE_LOCK_ERROR_BUSY if contended
+ */
+int cache_lock_try_acquire(const char *resource_path, enum cache_lock_mode mode);
+
+/**
+ * @brief Release one acquisition of a lock
+ * @param resource_path Directory passed to cache_lock_acquire()
+ * @return CACHE_LOCK_SUCCESS on success, CACHE_LOCK_ERROR_INVALID if not held
+ */
+int cache_lock_release(const char *resource_path);
+
+/**
+ * @brief Get human-readable error message for cache lock error code
+ * @param error_code Cache lock error code
+ * @return Error message string
+ */
+const char* cache_lock_error_string(int error_code);
+
+#endif /* CACHE_LOCK_H */
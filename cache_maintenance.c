@@ -0,0 +1,201 @@
+/**
+ * @file cache_maintenance.c
+ * @brief Pack maintenance for cached bare repositories implementation
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "cache_maintenance.h"
+#include "cache_exec.h"
+
+/**
+ * @brief Check whether a file name ends with a suffix
+ */
+static int has_suffix(const char *name, const char *suffix)
+{
+	size_t name_len = strlen(name);
+	size_t suffix_len = strlen(suffix);
+	return name_len > suffix_len && strcmp(name + name_len - suffix_len, suffix) == 0;
+}
+
+/**
+ * @brief Inspect the object storage of a repository without running git
+ */
+int cache_maintenance_inspect(const char *repo_path, struct cache_maintenance_state *state)
+{
+	if (!repo_path || !state) {
+		return CACHE_MAINTENANCE_ERROR_INVALID;
+	}
+	
+	memset(state, 0, sizeof(*state));
+	
+	char path[4096];
+	snprintf(path, sizeof(path), "%s/objects/pack", repo_path);
+	
+	DIR *dir = opendir(path);
+	if (!dir) {
+		return CACHE_MAINTENANCE_ERROR_IO;
+	}
+	
+	const struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (has_suffix(entry->d_name, ".pack")) {
+			state->pack_count++;
+		} else if (has_suffix(entry->d_name, ".promisor")) {
+			state->partial = 1;
+		}
+	}
+	closedir(dir);
+	
+	snprintf(path, sizeof(path), "%s/objects/info/alternates", repo_path);
+	state->borrowed = access(path, F_OK) == 0;
+	
+	/* Object names are uniformly distributed over the 256 fan-out directories */
+	snprintf(path, sizeof(path), "%s/objects/17", repo_path);
+	dir = opendir(path);
+	if (dir) {
+		size_t loose = 0;
+		while ((entry = readdir(dir)) != NULL) {
+			if (strlen(entry->d_name) == 38) {
+				loose++;
+			}
+		}
+		closedir(dir);
+		state->loose_estimate = loose * 256;
+	}
+	
+	/* Small repositories may miss that one; prune-packed removes emptied directories */
+	if (state->loose_estimate == 0) {
+		snprintf(path, sizeof(path), "%s/objects", repo_path);
+		dir = opendir(path);
+		if (dir) {
+			while ((entry = readdir(dir)) != NULL) {
+				if (strlen(entry->d_name) == 2 && isxdigit((unsigned char)entry->d_name[0]) &&
+				    isxdigit((unsigned char)entry->d_name[1])) {
+					state->loose_estimate++;
+				}
+			}
+			closedir(dir);
+		}
+	}
+	
+	return CACHE_MAINTENANCE_SUCCESS;
+}
+
+/**
+ * @brief Decide whether a repository needs maintenance
+ */
+enum cache_maintenance_reason cache_maintenance_due(const struct cache_maintenance_policy *policy,
+                                                    const struct cache_maintenance_state *state,
+                                                    time_t last_maintenance, time_t now)
+{
+	if (!policy || !state) {
+		return CACHE_MAINTENANCE_NOT_DUE;
+	}
+	
+	if (policy->pack_threshold > 0 && state->pack_count >= (size_t)policy->pack_threshold) {
+		return CACHE_MAINTENANCE_PACKS;
+	}
+	if (state->loose_estimate >= CACHE_MAINTENANCE_LOOSE_THRESHOLD) {
+		return CACHE_MAINTENANCE_LOOSE;
+	}
+	
+	/* A single pack and nothing loose is already as good as it gets */
+	if (policy->interval_hours > 0 && (state->pack_count > 1 || state->loose_estimate > 0) &&
+	    now - last_maintenance >= (time_t)policy->interval_hours * 3600) {
+		return CACHE_MAINTENANCE_SCHEDULE;
+	}
+	
+	return CACHE_MAINTENANCE_NOT_DUE;
+}
+
+/**
+ * @brief Run git with args in a repository, hiding its output unless verbose
+ */
+static int run_maintenance_command(const char *repo_path, const char *const args[], int verbose)
+{
+	const char *argv[16] = { "git" };
+	size_t argc = 1;
+	for (size_t i = 0; args[i] && argc < sizeof(argv) / sizeof(argv[0]) - 1; i++) {
+		argv[argc++] = args[i];
+	}
+	argv[argc] = NULL;
+	
+	return cache_exec_status(argv, repo_path, !verbose) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Repack, write the multi-pack-index, bitmap and commit-graph
+ */
+int cache_maintenance_run(const char *repo_path, const struct cache_maintenance_state *state,
+                          int verbose)
+{
+	if (!repo_path || !state) {
+		return CACHE_MAINTENANCE_ERROR_INVALID;
+	}
+	
+	const char *bitmap = state->partial || state->borrowed ? NULL : "--write-bitmap-index";
+	
+	/* Roll the small packs and loose objects up; the big base pack stays */
+	const char *geometric[] = { "repack", "-d", "-q", "--geometric=2", "--write-midx", bitmap, NULL };
+	if (run_maintenance_command(repo_path, geometric, verbose) != 0) {
+		/* git older than 2.34: plain incremental repack, then the MIDX on its own */
+		const char *repack[] = { "repack", "-d", "-q", NULL };
+		const char *midx[] = { "multi-pack-index", "write", NULL };
+		if (run_maintenance_command(repo_path, repack, verbose) != 0) {
+			return CACHE_MAINTENANCE_ERROR_GIT;
+		}
+		run_maintenance_command(repo_path, midx, verbose);
+	}
+	
+	const char *commit_graph[] = { "commit-graph", "write", "--reachable", "--split", "--no-progress", NULL };
+	if (run_maintenance_command(repo_path, commit_graph, verbose) != 0) {
+		return CACHE_MAINTENANCE_ERROR_GIT;
+	}
+	
+	return CACHE_MAINTENANCE_SUCCESS;
+}
+
+/**
+ * @brief Get a short description of a maintenance reason
+ */
+const char* cache_maintenance_reason_string(enum cache_maintenance_reason reason)
+{
+	switch (reason) {
+		case CACHE_MAINTENANCE_NOT_DUE:
+			return "not due";
+		case CACHE_MAINTENANCE_PACKS:
+			return "too many packs";
+		case CACHE_MAINTENANCE_LOOSE:
+			return "too many loose objects";
+		case CACHE_MAINTENANCE_SCHEDULE:
+			return "scheduled";
+		default:
+			return "unknown";
+	}
+}
+
+/**
+ * @brief Get human-readable error message for cache maintenance error code
+ */
+const char* cache_maintenance_error_string(int error_code)
+{
+	switch (error_code) {
+		case CACHE_MAINTENANCE_SUCCESS:
+			return "Success";
+		case CACHE_MAINTENANCE_ERROR_INVALID:
+			return "Invalid argument";
+		case CACHE_MAINTENANCE_ERROR_IO:
+			return "Failed to read object directory";
+		case CACHE_MAINTENANCE_ERROR_GIT:
+			return "Git maintenance command failed";
+		default:
+			return "Unknown error";
+	}
+}
@@ -0,0 +1,113 @@
+#ifndef CACHE_MAINTENANCE_H
+#define CACHE_MAINTENANCE_H
+
+/**
+ * @file cache_maintenance.h
+ * @brief Pack maintenance for cached bare repositories
+ *
+ * Every sync fetch adds a small pack (or loose objects) to each cache.
+ * Maintenance rolls them up with a geometric repack, which only rewrites
+ * the small packs, then writes a multi-pack-index with a reachability
+ * bitmap and an incremental commit-graph. Objects are never pruned, so
+ * checkouts borrowing objects through alternates stay valid.
+ *
+ * Partial clones (caches with promisor packs) and fork caches borrowing
+ * from an upstream cache get no bitmap, since their own packs do not hold
+ * every reachable object.
+ */
+
+#include <stddef.h>
+#include <time.h>
+
+/**
+ * @brief Loose objects (estimated) that trigger maintenance, as git gc --auto
+ */
+#define CACHE_MAINTENANCE_LOOSE_THRESHOLD 6700
+
+/**
+ * @brief Cache maintenance error codes
+ */
+#define CACHE_MAINTENANCE_SUCCESS         0
+#define CACHE_MAINTENANCE_ERROR_INVALID  -1
+#define CACHE_MAINTENANCE_ERROR_IO       -2
+#define CACHE_MAINTENANCE_ERROR_GIT      -3
+
+/**
+ * @brief When maintenance is due (0 disables a trigger)
+ */
+struct cache_maintenance_policy {
+	int interval_hours;         /**< Maintain at least this often */
+	int pack_threshold;         /**< Maintain once a repository has this many packs */
+};
+
+/**
+ * @brief Object storage state of a repository
+ */
+struct cache_maintenance_state {
+	size_t pack_count;          /**< Number of packs in objects/pack */
+	size_t loose_estimate;      /**< Estimated number of loose objects */
+	int partial;                /**< Repository has promisor packs */
+	int borrowed;               /**< Repository borrows objects through alternates */
+};
+
+/**
+ * @brief Why maintenance is due
+ */
+enum cache_maintenance_reason {
+	CACHE_MAINTENANCE_NOT_DUE,  /**< Nothing to do */
+	CACHE_MAINTENANCE_PACKS,    /**< Pack count reached the threshold */
+	CACHE_MAINTENANCE_LOOSE,    /**< Too many loose objects */
+	CACHE_MAINTENANCE_SCHEDULE  /**< Interval since last maintenance elapsed */
+};
+
+/**
+ * @brief Inspect the object storage of a repository without running git
+ *
+ * Loose objects are estimated from one fan-out directory, like git gc --auto.
+ *
+ * @param repo_path Bare repository path
+ * @param state Output state
+ * @return CACHE_MAINTENANCE_SUCCESS on success, error code on failure
+ */
+int cache_maintenance_inspect(const char *repo_path, struct cache_maintenance_state *state);
+
+/**
+ * @brief Decide whether a repository needs maintenance
+ * @param policy Maintenance policy
+ * @param state State from cache_maintenance_inspect()
+ * @param last_maintenance Last maintenance (or creation) time
+ * @param now Current time
+ * @return Reason maintenance is due, CACHE_MAINTENANCE_NOT_DUE if it is not
+ */
+enum cache_maintenance_reason cache_maintenance_due(const struct cache_maintenance_policy *policy,
+                                                    const struct cache_maintenance_state *state,
+                                                    time_t last_maintenance, time_t now);
+
+/**
+ * @brief Repack, write the multi-pack-index, bitmap and commit-graph
+ *
+ * The caller must hold the repository's exclusive lock.
+ *
+ * @param repo_path Bare repository path
+ * @param state State from cache_maintenance_inspect()
+ * @param verbose Show git output
+ * @return CACHE_MAINTENANCE_SUCCESS on success, error code on failure
+ */
+int cache_maintenance_run(const char *repo_path, const struct cache_maintenance_state *state,
+                          int verbose);
+
+/**
+ * @brief Get a short description of a maintenance reason
+ * @param reason Maintenance reason
+ * @return Description string
+ */
+const char* cache_maintenance_reason_string(enum cache_maintenance_reason reason);
+
+/**
+ * @brief Get human-readable error message for cache maintenance error code
+ * @param error_code Cache maintenance error code
+ * @return Error message string
+ */
+const char* cache_maintenance_error_string(int error_code);
+
+#endif /* CACHE_MAINTENANCE_H */
@@ -19,6 +19,9 @@
 
 #include "git-cache.h"
 #include "cache_metadata.h"
+#include "cache_index.h"
+#include "cache_journal.h"
+#include "disk_usage.h"
 
 /* Metadata file name */
 #define METADATA_FILE "cache_metadata.json"
@@ -74,13 +77,39 @@ void cache_metadata_destroy(struct cache_metadata *metadata)
 		return;
 	}
 	
+	cache_metadata_clear(metadata);
+	free(metadata);
+}
+
+/**
+ * @brief Free the strings owned by a metadata structure
+ */
+void cache_metadata_clear(struct cache_metadata *metadata)
+{
+	if (!metadata) {
+		return;
+	}
+	
 	free(metadata->original_url);
 	free(metadata->fork_url);
 	free(metadata->owner);
 	free(metadata->name);
 	free(metadata->fork_organization);
 	free(metadata->default_branch);
-	free(metadata);
+	free(metadata->ref_filter);
+	free(metadata->sparse_checkout);
+	free(metadata->sparse_modifiable);
+	free(metadata->dependent_forks);
+	metadata->original_url = NULL;
+	metadata->fork_url = NULL;
+	metadata->owner = NULL;
+	metadata->name = NULL;
+	metadata->fork_organization = NULL;
+	metadata->default_branch = NULL;
+	metadata->ref_filter = NULL;
+	metadata->sparse_checkout = NULL;
+	metadata->sparse_modifiable = NULL;
+	metadata->dependent_forks = NULL;
 }
 
 /**
@@ -202,6 +231,37 @@ int cache_metadata_save(const char *cache_path, const struct cache_metadata *met
 		json_object_object_add(root, "default_branch", branch_obj);
 	}
 	
+	if (metadata->ref_filter) {
+		json_object *filter_obj = json_object_new_string(metadata->ref_filter);
+		json_object_object_add(root, "ref_filter", filter_obj);
+	}
+	
+	if (metadata->sparse_checkout) {
+		json_object *sparse_obj = json_object_new_string(metadata->sparse_checkout);
+		json_object_object_add(root, "sparse_checkout", sparse_obj);
+	}
+	
+	if (metadata->sparse_modifiable) {
+		json_object *sparse_obj = json_object_new_string(metadata->sparse_modifiable);
+		json_object_object_add(root, "sparse_modifiable", sparse_obj);
+	}
+	
+	if (metadata->dependent_forks) {
+		json_object *forks_array = json_object_new_array();
+		const char *p = metadata->dependent_forks;
+		while (forks_array && *p) {
+			p += strspn(p, " ");
+			size_t len = strcspn(p, " ");
+			char *url = len > 0 ? strndup(p, len) : NULL;
+			if (url) {
+				json_object_array_add(forks_array, json_object_new_string(url));
+				free(url);
+			}
+			p += len;
+		}
+		json_object_object_add(root, "dependent_forks", forks_array);
+	}
+	
 	/* Add enum fields */
 	json_object *type_obj = json_object_new_string(repo_type_to_string(metadata->type));
 	json_object_object_add(root, "type", type_obj);
@@ -219,12 +279,22 @@ int cache_metadata_save(const char *cache_path, const struct cache_metadata *met
 	json_object *access_obj = json_object_new_int64(metadata->last_access_time);
 	json_object_object_add(root, "last_access_time", access_obj);
 	
+	json_object *maintenance_obj = json_object_new_int64(metadata->last_maintenance_time);
+	json_object_object_add(root, "last_maintenance_time", maintenance_obj);
+	
 	json_object *size_obj = json_object_new_int64(metadata->cache_size);
 	json_object_object_add(root, "cache_size", size_obj);
 	
 	json_object *ref_obj = json_object_new_int(metadata->ref_count);
 	json_object_object_add(root, "ref_count", ref_obj);
 	
+	if (metadata->journal_id) {
+		json_object *journal_obj = json_object_new_int64((int64_t)metadata->journal_id);
+		json_object_object_add(root, "journal_id", journal_obj);
+		json_object *records_obj = json_object_new_int64((int64_t)metadata->journal_records);
+		json_object_object_add(root, "journal_records", records_obj);
+	}
+	
 	/* Add boolean fields */
 	json_object *fork_needed_obj = json_object_new_boolean(metadata->is_fork_needed);
 	json_object_object_add(root, "is_fork_needed", fork_needed_obj);
@@ -242,24 +312,114 @@ int cache_metadata_save(const char *cache_path, const struct cache_metadata *met
 		return METADATA_ERROR_MEMORY;
 	}
 	
-	FILE *file = fopen(metadata_path, "w");
+	/* Readers never see a partly written file, only the old or the new one */
+	char temp_path[4096 + 32];
+	snprintf(temp_path, sizeof(temp_path), "%s.tmp.%ld", metadata_path, (long)getpid());
+	
+	FILE *file = fopen(temp_path, "w");
 	if (!file) {
 		json_object_put(root);
 		return METADATA_ERROR_IO;
 	}
 	
-	if (fputs(json_string, file) == EOF) {
-		fclose(file);
-		json_object_put(root);
+	int ok = fputs(json_string, file) != EOF;
+	ok = fclose(file) == 0 && ok;
+	json_object_put(root);
+	
+	if (!ok || rename(temp_path, metadata_path) != 0) {
+		unlink(temp_path);
 		return METADATA_ERROR_IO;
 	}
 	
-	fclose(file);
-	json_object_put(root);
+	/* Keep the cache index in step; it is rebuilt on demand if this fails */
+	char cache_root[4096];
+	if (cache_index_root_from_path(cache_path, cache_root, sizeof(cache_root)) == CACHE_INDEX_SUCCESS) {
+		cache_index_update(cache_root, metadata);
+	}
 	
 	return METADATA_SUCCESS;
 }
 
+/**
+ * @brief Replay the journal records the metadata does not count yet
+ */
+static void apply_journal(struct cache_metadata *metadata, const struct cache_journal *journal)
+{
+	if (journal->id == 0) {
+		return;
+	}
+	
+	size_t start = journal->id == metadata->journal_id ? metadata->journal_records : 0;
+	for (size_t i = start; i < journal->count; i++) {
+		const struct cache_journal_record *record = &journal->records[i];
+		if (record->magic != CACHE_JOURNAL_MAGIC) {
+			continue;
+		}
+		
+		time_t when = (time_t)record->value;
+		switch (record->type) {
+			case CACHE_JOURNAL_REF_ADD:
+				metadata->ref_count++;
+				/* fall through */
+			case CACHE_JOURNAL_ACCESS:
+				if (when > metadata->last_access_time) {
+					metadata->last_access_time = when;
+				}
+				break;
+			case CACHE_JOURNAL_SYNC:
+				if (when > metadata->last_sync_time) {
+					metadata->last_sync_time = when;
+				}
+				break;
+			case CACHE_JOURNAL_MAINTENANCE:
+				if (when > metadata->last_maintenance_time) {
+					metadata->last_maintenance_time = when;
+				}
+				break;
+			case CACHE_JOURNAL_REF_DROP:
+				if (metadata->ref_count > 0) {
+					metadata->ref_count--;
+				}
+				break;
+			default:
+				break;
+		}
+	}
+	
+	metadata->journal_id = journal->id;
+	if (journal->count > start) {
+		metadata->journal_records = journal->count;
+	}
+}
+
+/**
+ * @brief Record an event in the journal, folding it in when it has grown
+ */
+static int record_event(const char *cache_path, enum cache_journal_event type)
+{
+	if (!cache_path) {
+		return METADATA_ERROR_INVALID;
+	}
+	
+	/* Events only make sense for caches with metadata to fold them into */
+	if (cache_metadata_exists(cache_path) != 1) {
+		return METADATA_ERROR_NOT_FOUND;
+	}
+	
+	int count = cache_journal_append(cache_path, type, (int64_t)time(NULL));
+	if (count < 0) {
+		return METADATA_ERROR_IO;
+	}
+	
+	if (type == CACHE_JOURNAL_SYNC || count >= CACHE_JOURNAL_COMPACT_RECORDS) {
+		int ret = cache_metadata_compact(cache_path);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+	return METADATA_SUCCESS;
+}
+
 /**
  * @brief Load metadata from storage
  */
@@ -280,9 +440,20 @@ int cache_metadata_load(const char *cache_path, struct cache_metadata *metadata)
 		return METADATA_ERROR_NOT_FOUND;
 	}
 	
+	/* The journal is read first: a compaction finishing in between then
+	 * leaves records that the newer file already counts as folded in */
+	struct cache_journal journal;
+	if (cache_journal_read(cache_path, &journal) != CACHE_JOURNAL_SUCCESS) {
+		journal.id = 0;
+		journal.records = NULL;
+		journal.count = 0;
+		journal.lock_fd = -1;
+	}
+	
 	/* Read file */
 	json_object *root = json_object_from_file(metadata_path);
 	if (!root) {
+		cache_journal_free(&journal);
 		return METADATA_ERROR_CORRUPT;
 	}
 	
@@ -321,6 +492,44 @@ int cache_metadata_load(const char *cache_path, struct cache_metadata *metadata)
 		if (str) metadata->default_branch = strdup(str);
 	}
 	
+	if (json_object_object_get_ex(root, "ref_filter", &obj)) {
+		const char *str = json_object_get_string(obj);
+		if (str) metadata->ref_filter = strdup(str);
+	}
+	
+	if (json_object_object_get_ex(root, "sparse_checkout", &obj)) {
+		const char *str = json_object_get_string(obj);
+		if (str) metadata->sparse_checkout = strdup(str);
+	}
+	
+	if (json_object_object_get_ex(root, "sparse_modifiable", &obj)) {
+		const char *str = json_object_get_string(obj);
+		if (str) metadata->sparse_modifiable = strdup(str);
+	}
+	
+	/* Kept as one space-separated string in memory; URLs contain no spaces */
+	if (json_object_object_get_ex(root, "dependent_forks", &obj) &&
+	    json_object_is_type(obj, json_type_array)) {
+		size_t total = 1;
+		size_t forks = json_object_array_length(obj);
+		for (size_t i = 0; i < forks; i++) {
+			const char *str = json_object_get_string(json_object_array_get_idx(obj, i));
+			total += str ? strlen(str) + 1 : 0;
+		}
+		if (forks > 0 && (metadata->dependent_forks = malloc(total)) != NULL) {
+			metadata->dependent_forks[0] = '\0';
+			for (size_t i = 0; i < forks; i++) {
+				const char *str = json_object_get_string(json_object_array_get_idx(obj, i));
+				if (str && str[0] != '\0' && !strchr(str, ' ')) {
+					if (metadata->dependent_forks[0] != '\0') {
+						strcat(metadata->dependent_forks, " ");
+					}
+					strcat(metadata->dependent_forks, str);
+				}
+			}
+		}
+	}
+	
 	/* Load enum fields */
 	if (json_object_object_get_ex(root, "type", &obj)) {
 		const char *str = json_object_get_string(obj);
@@ -345,6 +554,10 @@ int cache_metadata_load(const char *cache_path, struct cache_metadata *metadata)
 		metadata->last_access_time = json_object_get_int64(obj);
 	}
 	
+	if (json_object_object_get_ex(root, "last_maintenance_time", &obj)) {
+		metadata->last_maintenance_time = json_object_get_int64(obj);
+	}
+	
 	if (json_object_object_get_ex(root, "cache_size", &obj)) {
 		metadata->cache_size = json_object_get_int64(obj);
 	}
@@ -353,6 +566,14 @@ int cache_metadata_load(const char *cache_path, struct cache_metadata *metadata)
 		metadata->ref_count = json_object_get_int(obj);
 	}
 	
+	if (json_object_object_get_ex(root, "journal_id", &obj)) {
+		metadata->journal_id = (uint64_t)json_object_get_int64(obj);
+	}
+	
+	if (json_object_object_get_ex(root, "journal_records", &obj)) {
+		metadata->journal_records = (size_t)json_object_get_int64(obj);
+	}
+	
 	/* Load boolean fields */
 	if (json_object_object_get_ex(root, "is_fork_needed", &obj)) {
 		metadata->is_fork_needed = json_object_get_boolean(obj);
@@ -367,6 +588,9 @@ int cache_metadata_load(const char *cache_path, struct cache_metadata *metadata)
 	}
 	
 	json_object_put(root);
+	
+	apply_journal(metadata, &journal);
+	cache_journal_free(&journal);
 	return METADATA_SUCCESS;
 }
 
@@ -374,6 +598,30 @@ int cache_metadata_load(const char *cache_path, struct cache_metadata *metadata)
  * @brief Update last access time
  */
 int cache_metadata_update_access(const char *cache_path)
+{
+	return record_event(cache_path, CACHE_JOURNAL_ACCESS);
+}
+
+/**
+ * @brief Update last sync time
+ */
+int cache_metadata_update_sync(const char *cache_path)
+{
+	return record_event(cache_path, CACHE_JOURNAL_SYNC);
+}
+
+/**
+ * @brief Update last pack maintenance time
+ */
+int cache_metadata_update_maintenance(const char *cache_path)
+{
+	return record_event(cache_path, CACHE_JOURNAL_MAINTENANCE);
+}
+
+/**
+ * @brief Store the per-repository fetch ref filter
+ */
+int cache_metadata_update_ref_filter(const char *cache_path, const char *ref_filter)
 {
 	if (!cache_path) {
 		return METADATA_ERROR_INVALID;
@@ -385,24 +633,87 @@ int cache_metadata_update_access(const char *cache_path)
 		return ret;
 	}
 	
-	metadata.last_access_time = time(NULL);
-	ret = cache_metadata_save(cache_path, &metadata);
+	if (ref_filter && ref_filter[0] == '\0') {
+		ref_filter = NULL;
+	}
+	
+	int changed = (ref_filter == NULL) != (metadata.ref_filter == NULL) ||
+	              (ref_filter && strcmp(ref_filter, metadata.ref_filter) != 0);
+	if (changed) {
+		free(metadata.ref_filter);
+		metadata.ref_filter = ref_filter ? strdup(ref_filter) : NULL;
+		if (ref_filter && !metadata.ref_filter) {
+			ret = METADATA_ERROR_MEMORY;
+		} else {
+			ret = cache_metadata_save(cache_path, &metadata);
+		}
+	}
+	
+	/* Clean up stack-allocated metadata strings */
+	cache_metadata_clear(&metadata);
+	
+	return ret != METADATA_SUCCESS ? ret : changed;
+}
+
+/**
+ * @brief Check whether a space-separated list holds a word
+ */
+static int list_contains(const char *list, const char *word)
+{
+	size_t word_len = strlen(word);
+	const char *p = list;
+	while (p && *p) {
+		p += strspn(p, " ");
+		size_t len = strcspn(p, " ");
+		if (len == word_len && strncmp(p, word, len) == 0) {
+			return 1;
+		}
+		p += len;
+	}
+	return 0;
+}
+
+/**
+ * @brief Record a fork whose cache borrows objects from this cache
+ */
+int cache_metadata_add_dependent_fork(const char *cache_path, const char *fork_url)
+{
+	if (!cache_path || !fork_url || fork_url[0] == '\0' || strchr(fork_url, ' ')) {
+		return METADATA_ERROR_INVALID;
+	}
+	
+	struct cache_metadata metadata;
+	int ret = cache_metadata_load(cache_path, &metadata);
+	if (ret != METADATA_SUCCESS) {
+		return ret;
+	}
+	
+	int added = !list_contains(metadata.dependent_forks, fork_url);
+	if (added) {
+		size_t old_len = metadata.dependent_forks ? strlen(metadata.dependent_forks) : 0;
+		char *forks = realloc(metadata.dependent_forks, old_len + strlen(fork_url) + 2);
+		if (!forks) {
+			ret = METADATA_ERROR_MEMORY;
+		} else {
+			if (old_len > 0) {
+				forks[old_len++] = ' ';
+			}
+			strcpy(forks + old_len, fork_url);
+			metadata.dependent_forks = forks;
+			ret = cache_metadata_save(cache_path, &metadata);
+		}
+	}
 	
 	/* Clean up stack-allocated metadata strings */
-	free(metadata.original_url);
-	free(metadata.fork_url);
-	free(metadata.owner);
-	free(metadata.name);
-	free(metadata.fork_organization);
-	free(metadata.default_branch);
+	cache_metadata_clear(&metadata);
 	
-	return ret;
+	return ret != METADATA_SUCCESS ? ret : added;
 }
 
 /**
- * @brief Update last sync time
+ * @brief Store the sparse cone of a checkout
  */
-int cache_metadata_update_sync(const char *cache_path)
+int cache_metadata_update_sparse(const char *cache_path, int modifiable, const char *cone)
 {
 	if (!cache_path) {
 		return METADATA_ERROR_INVALID;
@@ -414,18 +725,23 @@ int cache_metadata_update_sync(const char *cache_path)
 		return ret;
 	}
 	
-	metadata.last_sync_time = time(NULL);
-	ret = cache_metadata_save(cache_path, &metadata);
+	char **stored = modifiable ? &metadata.sparse_modifiable : &metadata.sparse_checkout;
+	int changed = (cone == NULL) != (*stored == NULL) ||
+	              (cone && strcmp(cone, *stored) != 0);
+	if (changed) {
+		free(*stored);
+		*stored = cone ? strdup(cone) : NULL;
+		if (cone && !*stored) {
+			ret = METADATA_ERROR_MEMORY;
+		} else {
+			ret = cache_metadata_save(cache_path, &metadata);
+		}
+	}
 	
 	/* Clean up stack-allocated metadata strings */
-	free(metadata.original_url);
-	free(metadata.fork_url);
-	free(metadata.owner);
-	free(metadata.name);
-	free(metadata.fork_organization);
-	free(metadata.default_branch);
+	cache_metadata_clear(&metadata);
 	
-	return ret;
+	return ret != METADATA_SUCCESS ? ret : changed;
 }
 
 /**
@@ -437,23 +753,41 @@ size_t cache_metadata_calculate_size(const char *cache_path)
 		return 0;
 	}
 	
-	/* Use du command to calculate size */
-	char cmd[4096];
-	snprintf(cmd, sizeof(cmd), "du -sb %s 2>/dev/null | cut -f1", cache_path);
-	
-	FILE *pipe = popen(cmd, "r");
-	if (!pipe) {
+	uint64_t size = 0;
+	if (disk_usage_account(cache_path, &size) != DISK_USAGE_SUCCESS) {
 		return 0;
 	}
 	
-	char buffer[256];
-	size_t size = 0;
-	if (fgets(buffer, sizeof(buffer), pipe)) {
-		size = strtoull(buffer, NULL, 10);
+	return (size_t)size;
+}
+
+/**
+ * @brief Refresh stored cache size
+ */
+int cache_metadata_update_size(const char *cache_path)
+{
+	if (!cache_path) {
+		return METADATA_ERROR_INVALID;
+	}
+	
+	struct cache_metadata metadata;
+	int ret = cache_metadata_load(cache_path, &metadata);
+	if (ret != METADATA_SUCCESS) {
+		return ret;
+	}
+	
+	uint64_t size = 0;
+	if (disk_usage_account(cache_path, &size) != DISK_USAGE_SUCCESS) {
+		ret = METADATA_ERROR_IO;
+	} else if ((size_t)size != metadata.cache_size) {
+		metadata.cache_size = (size_t)size;
+		ret = cache_metadata_save(cache_path, &metadata);
 	}
 	
-	pclose(pipe);
-	return size;
+	/* Clean up stack-allocated metadata strings */
+	cache_metadata_clear(&metadata);
+	
+	return ret;
 }
 
 /**
@@ -475,33 +809,46 @@ int cache_metadata_exists(const char *cache_path)
 }
 
 /**
- * @brief Increment reference count
+ * @brief Fold the journal of a cache into its metadata file and index
  */
-int cache_metadata_increment_ref(const char *cache_path)
+int cache_metadata_compact(const char *cache_path)
 {
 	if (!cache_path) {
 		return METADATA_ERROR_INVALID;
 	}
 	
+	/* Appends wait until the folded journal is gone */
+	struct cache_journal journal;
+	int ret = cache_journal_lock(cache_path, &journal);
+	if (ret == CACHE_JOURNAL_ERROR_NOT_FOUND) {
+		return 0;
+	}
+	if (ret != CACHE_JOURNAL_SUCCESS) {
+		return METADATA_ERROR_IO;
+	}
+	
 	struct cache_metadata metadata;
-	int ret = cache_metadata_load(cache_path, &metadata);
+	ret = cache_metadata_load(cache_path, &metadata);
+	if (ret == METADATA_SUCCESS) {
+		ret = cache_metadata_save(cache_path, &metadata);
+		
+		cache_metadata_clear(&metadata);
+	}
+	
+	/* A crash before the unlink is harmless: the saved file counts the records */
 	if (ret != METADATA_SUCCESS) {
+		cache_journal_free(&journal);
 		return ret;
 	}
-	
-	metadata.ref_count++;
-	metadata.last_access_time = time(NULL);
-	ret = cache_metadata_save(cache_path, &metadata);
-	
-	/* Clean up stack-allocated metadata strings */
-	free(metadata.original_url);
-	free(metadata.fork_url);
-	free(metadata.owner);
-	free(metadata.name);
-	free(metadata.fork_organization);
-	free(metadata.default_branch);
-	
-	return ret;
+	return cache_journal_remove(cache_path, &journal) == CACHE_JOURNAL_SUCCESS ? 1 : METADATA_ERROR_IO;
+}
+
+/**
+ * @brief Increment reference count
+ */
+int cache_metadata_increment_ref(const char *cache_path)
+{
+	return record_event(cache_path, CACHE_JOURNAL_REF_ADD);
 }
 
 /**
@@ -509,30 +856,7 @@ int cache_metadata_increment_ref(const char *cache_path)
  */
 int cache_metadata_decrement_ref(const char *cache_path)
 {
-	if (!cache_path) {
-		return METADATA_ERROR_INVALID;
-	}
-	
-	struct cache_metadata metadata;
-	int ret = cache_metadata_load(cache_path, &metadata);
-	if (ret != METADATA_SUCCESS) {
-		return ret;
-	}
-	
-	if (metadata.ref_count > 0) {
-		metadata.ref_count--;
-	}
-	ret = cache_metadata_save(cache_path, &metadata);
-	
-	/* Clean up stack-allocated metadata strings */
-	free(metadata.original_url);
-	free(metadata.fork_url);
-	free(metadata.owner);
-	free(metadata.name);
-	free(metadata.fork_organization);
-	free(metadata.default_branch);
-	
-	return ret;
+	return record_event(cache_path, CACHE_JOURNAL_REF_DROP);
 }
 
 /**
@@ -560,6 +884,58 @@ int cache_metadata_get_by_url(const struct cache_config *config, const char *url
 	return ret;
 }
 
+/**
+ * @brief List cached repositories from the cache index
+ * @return Number of repositories, or METADATA_ERROR_NOT_FOUND if no usable index
+ */
+static int list_all_from_index(const struct cache_config *config,
+	                           int (*callback)(const struct cache_metadata *metadata, void *user_data),
+	                           void *user_data)
+{
+	struct cache_index index;
+	if (cache_index_open(config->cache_root, &index) != CACHE_INDEX_SUCCESS) {
+		cache_index_close(&index);
+		if (cache_index_rebuild(config->cache_root) < 0 ||
+		    cache_index_open(config->cache_root, &index) != CACHE_INDEX_SUCCESS) {
+			cache_index_close(&index);
+			return METADATA_ERROR_NOT_FOUND;
+		}
+	}
+	
+	int count = 0;
+	for (uint32_t i = 0; i < index.header->record_count; i++) {
+		const struct cache_index_record *record = &index.records[i];
+		if (!(record->flags & CACHE_INDEX_FLAG_METADATA)) {
+			continue;
+		}
+		
+		/* Strings point into the mapping; fields not in the index stay NULL */
+		struct cache_metadata metadata;
+		memset(&metadata, 0, sizeof(metadata));
+		metadata.original_url = (char *)cache_index_string(&index, record->url_offset);
+		metadata.owner = (char *)cache_index_string(&index, record->owner_offset);
+		metadata.name = (char *)cache_index_string(&index, record->name_offset);
+		metadata.type = (enum repo_type)record->type;
+		metadata.strategy = (enum clone_strategy)record->strategy;
+		metadata.created_time = (time_t)record->created_time;
+		metadata.last_sync_time = (time_t)record->last_sync_time;
+		metadata.last_access_time = (time_t)record->last_access_time;
+		metadata.cache_size = (size_t)record->cache_size;
+		metadata.ref_count = record->ref_count;
+		metadata.is_fork_needed = (record->flags & CACHE_INDEX_FLAG_FORK) != 0;
+		metadata.is_private_fork = (record->flags & CACHE_INDEX_FLAG_PRIVATE) != 0;
+		metadata.has_submodules = (record->flags & CACHE_INDEX_FLAG_SUBMODULES) != 0;
+		
+		if (callback(&metadata, user_data) != 0) {
+			break;
+		}
+		count++;
+	}
+	
+	cache_index_close(&index);
+	return count;
+}
+
 /**
  * @brief List all cached repositories with metadata
  */
@@ -571,6 +947,12 @@ int cache_metadata_list_all(const struct cache_config *config,
 		return METADATA_ERROR_INVALID;
 	}
 	
+	/* Prefer the index, fall back to walking the cache directory */
+	int indexed = list_all_from_index(config, callback, user_data);
+	if (indexed >= 0) {
+		return indexed;
+	}
+	
 	/* Walk through cache directory */
 	char github_path[4096];
 	snprintf(github_path, sizeof(github_path), "%s/github.com", config->cache_root);
@@ -617,12 +999,7 @@ int cache_metadata_list_all(const struct cache_config *config,
 					int ret = callback(&metadata, user_data);
 					
 					/* Clean up loaded metadata strings */
-					free(metadata.original_url);
-					free(metadata.fork_url);
-					free(metadata.owner);
-					free(metadata.name);
-					free(metadata.fork_organization);
-					free(metadata.default_branch);
+					cache_metadata_clear(&metadata);
 					
 					if (ret != 0) {
 						closedir(owner_dir);
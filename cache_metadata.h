@@ -34,12 +34,19 @@ struct cache_metadata {
 	time_t created_time;      /**< When cache was created */
 	time_t last_sync_time;    /**< Last synchronization time */
 	time_t last_access_time;  /**< Last access time */
+	time_t last_maintenance_time; /**< Last pack maintenance (0 if never) */
 	int is_fork_needed;       /**< Whether forking was needed */
 	int is_private_fork;      /**< Whether fork is private */
 	int has_submodules;       /**< Whether repository has submodules */
 	char *default_branch;     /**< Default branch name */
+	char *ref_filter;         /**< Branches and tags to fetch (NULL for the global filter) */
+	char *sparse_checkout;    /**< Sparse cone of the read-only checkout (NULL for the full tree) */
+	char *sparse_modifiable;  /**< Sparse cone of the modifiable checkout (NULL for the full tree) */
+	char *dependent_forks;    /**< Space-separated URLs of forks whose caches borrow objects from this one (NULL for none) */
 	size_t cache_size;        /**< Cache size in bytes */
 	int ref_count;            /**< Number of active checkouts */
+	uint64_t journal_id;      /**< Journal whose records are folded in (0 if none) */
+	size_t journal_records;   /**< Records of that journal folded in */
 };
 
 /**
@@ -65,6 +72,16 @@ struct cache_metadata* cache_metadata_create(const struct repo_info *repo);
  */
 void cache_metadata_destroy(struct cache_metadata *metadata);
 
+/**
+ * @brief Free the strings owned by a metadata structure
+ * @param metadata Metadata whose fields to release (the structure itself is kept)
+ *
+ * Every string field is freed and reset to NULL, so the structure can be
+ * loaded into again or cleared twice. Use this for stack-allocated metadata
+ * filled by cache_metadata_load().
+ */
+void cache_metadata_clear(struct cache_metadata *metadata);
+
 /**
  * @brief Save metadata to storage
  * @param cache_path Path to cache directory
@@ -83,6 +100,11 @@ int cache_metadata_load(const char *cache_path, struct cache_metadata *metadata)
 
 /**
  * @brief Update last access time
+ *
+ * Like the other event updates below, this appends a record to the cache's
+ * journal instead of rewriting the metadata file, and folds the journal in
+ * once it holds CACHE_JOURNAL_COMPACT_RECORDS records.
+ *
  * @param cache_path Path to cache directory
  * @return METADATA_SUCCESS on success, error code on failure
  */
@@ -90,11 +112,62 @@ int cache_metadata_update_access(const char *cache_path);
 
 /**
  * @brief Update last sync time
+ *
+ * The journal is folded in right away, so the cache index shows the sync
+ * to fast paths that only read the index.
+ *
  * @param cache_path Path to cache directory
  * @return METADATA_SUCCESS on success, error code on failure
  */
 int cache_metadata_update_sync(const char *cache_path);
 
+/**
+ * @brief Update last pack maintenance time
+ * @param cache_path Path to cache directory
+ * @return METADATA_SUCCESS on success, error code on failure
+ */
+int cache_metadata_update_maintenance(const char *cache_path);
+
+/**
+ * @brief Store the per-repository fetch ref filter
+ * @param cache_path Path to cache directory
+ * @param ref_filter Filter specification, NULL or empty to use the global filter
+ * @return 1 if the stored filter changed, 0 if it was already set,
+ *         negative error code on failure
+ */
+int cache_metadata_update_ref_filter(const char *cache_path, const char *ref_filter);
+
+/**
+ * @brief Record a fork whose cache borrows objects from this cache
+ *
+ * Forks are kept as a list, so every fork sharing an upstream keeps it
+ * from being evicted. The caller holds the exclusive cache lock.
+ *
+ * @param cache_path Path to the upstream cache directory
+ * @param fork_url URL of the fork
+ * @return 1 if the fork was added, 0 if it was already listed,
+ *         negative error code on failure
+ */
+int cache_metadata_add_dependent_fork(const char *cache_path, const char *fork_url);
+
+/**
+ * @brief Store the sparse cone of a checkout
+ * @param cache_path Path to cache directory
+ * @param modifiable Whether the cone is that of the modifiable checkout
+ * @param cone Canonical sparse spec, NULL for the full tree
+ * @return 1 if the stored cone changed, 0 if it was already set,
+ *         negative error code on failure
+ */
+int cache_metadata_update_sparse(const char *cache_path, int modifiable, const char *cone);
+
+/**
+ * @brief Fold the journal of a cache into its metadata file and index
+ * @param cache_path Path to cache directory
+ * @return 1 if a journal was folded in, 0 if there was none,
+ *         negative error code on failure
+ */
+int cache_metadata_compact(const char *cache_path);
+
 /**
  * @brief Increment reference count (active checkouts)
  * @param cache_path Path to cache directory
@@ -121,6 +194,12 @@ int cache_metadata_get_by_url(const struct cache_config *config, const char *url
 
 /**
  * @brief List all cached repositories with metadata
+ *
+ * Repositories are read from the cache index when it is usable. In that
+ * case only indexed fields are filled in; fork_url, fork_organization,
+ * default_branch and ref_filter are NULL, and the strings are only valid
+ * during the callback.
+ *
  * @param config Cache configuration
  * @param callback Function to call for each repository
  * @param user_data User data to pass to callback
@@ -132,11 +211,22 @@ int cache_metadata_list_all(const struct cache_config *config,
 
 /**
  * @brief Calculate cache directory size
+ *
+ * Uses incremental accounting (see disk_usage.h), so repeated calls
+ * only walk object directories that changed.
+ *
  * @param cache_path Path to cache directory
  * @return Size in bytes, or 0 on error
  */
 size_t cache_metadata_calculate_size(const char *cache_path);
 
+/**
+ * @brief Recalculate cache size and store it in metadata
+ * @param cache_path Path to cache directory
+ * @return METADATA_SUCCESS on success, error code on failure
+ */
+int cache_metadata_update_size(const char *cache_path);
+
 /**
  * @brief Check if metadata exists for cache
  * @param cache_path Path to cache directory
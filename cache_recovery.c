@@ -19,79 +19,120 @@
 
 #include "git-cache.h"
 #include "cache_recovery.h"
+#include "cache_metadata.h"
+#include "repo_probe.h"
+#include "cache_verify.h"
+#include "cache_exec.h"
 
 /**
- * @brief Check if a Git repository is valid and not corrupted
+ * @brief Map a native probe status to a recovery status
  */
-int verify_git_repository(const char *repo_path)
+static int probe_to_recovery_status(int probe_status)
+{
+	switch (probe_status) {
+		case REPO_PROBE_OK:
+			return CACHE_RECOVERY_OK;
+		case REPO_PROBE_ERROR_NOT_GIT:
+			return CACHE_RECOVERY_NOT_GIT_REPO;
+		case REPO_PROBE_ERROR_REFS:
+			return CACHE_RECOVERY_MISSING_REFS;
+		default:
+			return CACHE_RECOVERY_CORRUPTED;
+	}
+}
+
+/**
+ * @brief Probe a repository, detecting whether it is bare
+ */
+static int probe_repository(const char *repo_path, struct repo_probe *probe)
 {
 	if (!repo_path || access(repo_path, F_OK) != 0) {
 		return CACHE_RECOVERY_NOT_EXISTS;
 	}
 	
-	/* Check if it's a Git repository */
+	/* Non-bare repositories have a .git directory or gitdir file */
 	char git_dir[4096];
 	snprintf(git_dir, sizeof(git_dir), "%s/.git", repo_path);
-	if (access(git_dir, F_OK) != 0) {
-		/* Try bare repository */
+	int is_bare = access(git_dir, F_OK) != 0;
+	if (is_bare) {
 		snprintf(git_dir, sizeof(git_dir), "%s/refs", repo_path);
 		if (access(git_dir, F_OK) != 0) {
 			return CACHE_RECOVERY_NOT_GIT_REPO;
 		}
 	}
 	
-	/* Run git fsck to verify repository integrity */
-	char fsck_cmd[4096];
-	snprintf(fsck_cmd, sizeof(fsck_cmd), "cd %s && git fsck --quiet 2>/dev/null", repo_path);
-	
-	int status = system(fsck_cmd);
-	if (status != 0) {
+	return probe_to_recovery_status(repo_probe_repository(repo_path, is_bare, probe));
+}
+
+/**
+ * @brief Check if a Git repository is valid and not corrupted
+ */
+int verify_git_repository(const char *repo_path)
+{
+	struct repo_probe probe;
+	return probe_repository(repo_path, &probe);
+}
+
+/**
+ * @brief Run git fsck to verify every object in a repository
+ */
+static int run_git_fsck(const char *repo_path)
+{
+	static const char *const argv[] = { "git", "fsck", "--no-progress", NULL };
+	struct cache_exec_options options;
+	memset(&options, 0, sizeof(options));
+	options.cwd = repo_path;
+	options.out = CACHE_EXEC_DISCARD;
+	options.err = CACHE_EXEC_DISCARD;
+	
+	struct cache_exec_result result;
+	int ret = cache_exec_run(argv, &options, &result);
+	cache_exec_free_result(&result);
+	if (ret != CACHE_EXEC_SUCCESS || result.exit_code != 0) {
 		return CACHE_RECOVERY_CORRUPTED;
 	}
 	
 	return CACHE_RECOVERY_OK;
 }
 
+/**
+ * @brief Check a Git repository including full object verification
+ */
+int verify_git_repository_deep(const char *repo_path)
+{
+	int status = verify_git_repository(repo_path);
+	if (status != CACHE_RECOVERY_OK) {
+		return status;
+	}
+	
+	return run_git_fsck(repo_path);
+}
+
 /**
  * @brief Verify cache repository integrity
  */
-int verify_cache_repository(const char *cache_path)
+int verify_cache_repository(const char *cache_path, int deep)
 {
 	if (!cache_path) {
 		return CACHE_RECOVERY_INVALID_PATH;
 	}
 	
 	/* Check basic Git repository validity */
-	int basic_check = verify_git_repository(cache_path);
+	struct repo_probe probe;
+	int basic_check = probe_repository(cache_path, &probe);
 	if (basic_check != CACHE_RECOVERY_OK) {
 		return basic_check;
 	}
 	
-	/* Additional checks specific to bare repositories */
-	char refs_dir[4096];
-	snprintf(refs_dir, sizeof(refs_dir), "%s/refs/heads", cache_path);
-	if (access(refs_dir, F_OK) != 0) {
-		return CACHE_RECOVERY_MISSING_REFS;
-	}
-	
-	/* Check if we have at least one branch */
-	DIR *refs = opendir(refs_dir);
-	if (!refs) {
-		return CACHE_RECOVERY_MISSING_REFS;
-	}
-	
-	const struct dirent *entry;
-	int has_branches = 0;
-	while ((entry = readdir(refs)) != NULL) {
-		if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
-			has_branches = 1;
-			break;
-		}
+	/* Check if we have at least one branch, loose or packed */
+	if (probe.branch_count == 0) {
+		return CACHE_RECOVERY_EMPTY_REPO;
 	}
-	closedir(refs);
 	
-	if (!has_branches) {
-		return CACHE_RECOVERY_EMPTY_REPO;
+	/* Only packs and loose objects added since the last deep pass are checked */
+	if (deep) {
+		return cache_verify_objects(cache_path, NULL) == CACHE_VERIFY_SUCCESS ?
+		       CACHE_RECOVERY_OK : CACHE_RECOVERY_CORRUPTED;
 	}
 	
 	return CACHE_RECOVERY_OK;
@@ -164,26 +205,23 @@ int repair_cache_repository(const char *cache_path, const char *original_url, in
 	char backup_path[4096];
 	snprintf(backup_path, sizeof(backup_path), "%s.corrupted.%ld", cache_path, (long)time(NULL));
 	
-	char backup_cmd[8192];
-	snprintf(backup_cmd, sizeof(backup_cmd), "mv %s %s", cache_path, backup_path);
-	if (system(backup_cmd) != 0) {
+	const char *backup_argv[] = { "mv", "--", cache_path, backup_path, NULL };
+	if (cache_exec_status(backup_argv, NULL, 0) != 0) {
 		if (verbose) {
 			printf("Warning: Could not backup corrupted cache\n");
 		}
 	}
 	
 	/* Re-clone the repository */
-	char clone_cmd[8192];
-	snprintf(clone_cmd, sizeof(clone_cmd), "git clone --bare %s %s %s",
-		verbose ? "" : "-q", original_url, cache_path);
-	
-	if (system(clone_cmd) != 0) {
+	const char *clone_argv[] = { "git", "clone", "--bare", original_url, cache_path,
+	                             verbose ? NULL : "-q", NULL };
+	if (cache_exec_status(clone_argv, NULL, 0) != 0) {
 		if (verbose) {
 			printf("Failed to re-clone repository\n");
 		}
 		/* Restore backup if re-clone failed */
-		snprintf(backup_cmd, sizeof(backup_cmd), "mv %s %s", backup_path, cache_path);
-		if (system(backup_cmd) != 0) {
+		const char *restore_argv[] = { "mv", "--", backup_path, cache_path, NULL };
+		if (cache_exec_status(restore_argv, NULL, 0) != 0) {
 			if (verbose) {
 				printf("Critical: Could not restore backup!\n");
 			}
@@ -192,13 +230,22 @@ int repair_cache_repository(const char *cache_path, const char *original_url, in
 	}
 	
 	/* Verify the repaired repository */
-	if (verify_cache_repository(cache_path) != CACHE_RECOVERY_OK) {
+	if (verify_cache_repository(cache_path, 0) != CACHE_RECOVERY_OK) {
 		if (verbose) {
 			printf("Repaired repository still appears corrupted\n");
 		}
 		return CACHE_RECOVERY_REPAIR_FAILED;
 	}
 	
+	/* Checkout counts and fork records still hold; gc would evict a cache without them */
+	struct cache_metadata metadata;
+	if (cache_metadata_load(backup_path, &metadata) == METADATA_SUCCESS) {
+		if (cache_metadata_save(cache_path, &metadata) != METADATA_SUCCESS && verbose) {
+			printf("Warning: Could not carry over cache metadata\n");
+		}
+		cache_metadata_clear(&metadata);
+	}
+	
 	if (verbose) {
 		printf("Cache repository repaired successfully\n");
 		printf("Corrupted cache backed up to: %s\n", backup_path);
@@ -222,17 +269,15 @@ int repair_checkout_repository(const char *checkout_path, const char *cache_path
 	}
 	
 	/* Remove corrupted checkout */
-	char remove_cmd[4096];
-	snprintf(remove_cmd, sizeof(remove_cmd), "rm -rf %s", checkout_path);
-	if (system(remove_cmd) != 0) {
+	const char *remove_argv[] = { "rm", "-rf", "--", checkout_path, NULL };
+	if (cache_exec_status(remove_argv, NULL, 0) != 0) {
 		if (verbose) {
 			printf("Warning: Could not remove corrupted checkout\n");
 		}
 	}
 	
 	/* Recreate checkout from cache */
-	char clone_cmd[8192];
-	const char *strategy_flag = "";
+	const char *strategy_flag = NULL;
 	
 	switch (strategy) {
 		case CLONE_STRATEGY_SHALLOW:
@@ -246,19 +291,22 @@ int repair_checkout_repository(const char *checkout_path, const char *cache_path
 			break;
 		case CLONE_STRATEGY_FULL:
 		default:
-			strategy_flag = "";
 			break;
 	}
 	
-	snprintf(clone_cmd, sizeof(clone_cmd), 
-		"git clone %s --reference=%s %s %s %s",
-		verbose ? "" : "-q",
-		cache_path,
-		strategy_flag,
-		cache_path,
-		checkout_path);
+	char reference[4096 + 16];
+	snprintf(reference, sizeof(reference), "--reference=%s", cache_path);
 	
-	if (system(clone_cmd) != 0) {
+	const char *clone_argv[8] = { "git", "clone", reference, cache_path, checkout_path };
+	size_t argc = 5;
+	if (!verbose) {
+		clone_argv[argc++] = "-q";
+	}
+	if (strategy_flag) {
+		clone_argv[argc++] = strategy_flag;
+	}
+	clone_argv[argc] = NULL;
+	if (cache_exec_status(clone_argv, NULL, 0) != 0) {
 		if (verbose) {
 			printf("Failed to recreate checkout from cache\n");
 		}
@@ -289,7 +337,7 @@ int verify_and_repair_repository(struct repo_info *repo, const struct cache_conf
 		return CACHE_RECOVERY_INVALID_PATH;
 	}
 	
-	int cache_status = verify_cache_repository(repo->cache_path);
+	int cache_status = verify_cache_repository(repo->cache_path, config->deep_verify);
 	int checkout_status = CACHE_RECOVERY_OK;
 	int modifiable_status = CACHE_RECOVERY_OK;
 	
@@ -380,6 +428,8 @@ const char* cache_recovery_error_string(int error_code)
 			return "Invalid repository path";
 		case CACHE_RECOVERY_REPAIR_FAILED:
 			return "Repository repair failed";
+		case CACHE_RECOVERY_LOCKED:
+			return "Repository is locked by another process";
 		default:
 			return "Unknown error";
 	}
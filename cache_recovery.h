@@ -28,20 +28,37 @@ struct cache_config;
 #define CACHE_RECOVERY_WRONG_ALTERNATES -7
 #define CACHE_RECOVERY_INVALID_PATH    -8
 #define CACHE_RECOVERY_REPAIR_FAILED   -9
+#define CACHE_RECOVERY_LOCKED         -10
 
 /**
- * @brief Check if a Git repository is valid and not corrupted
+ * @brief Check if a Git repository is structurally valid
+ *
+ * Reads HEAD, refs and pack index headers directly; no git process
+ * is spawned.
+ *
  * @param repo_path Path to the repository
  * @return CACHE_RECOVERY_OK if valid, error code otherwise
  */
 int verify_git_repository(const char *repo_path);
 
+/**
+ * @brief Check a Git repository including a full git fsck
+ * @param repo_path Path to the repository
+ * @return CACHE_RECOVERY_OK if valid, error code otherwise
+ */
+int verify_git_repository_deep(const char *repo_path);
+
 /**
  * @brief Verify cache repository integrity
+ *
+ * A deep check verifies the objects added since the previous deep check,
+ * see cache_verify_objects(); the first one runs a full git fsck.
+ *
  * @param cache_path Path to the cache repository
+ * @param deep Non-zero to also verify objects
  * @return CACHE_RECOVERY_OK if valid, error code otherwise
  */
-int verify_cache_repository(const char *cache_path);
+int verify_cache_repository(const char *cache_path, int deep);
 
 /**
  * @brief Verify checkout repository integrity
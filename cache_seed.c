@@ -0,0 +1,315 @@
+/**
+ * @file cache_seed.c
+ * @brief Resumable, bundle-seeded initial clone implementation
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "cache_seed.h"
+#include "cache_exec.h"
+
+/**
+ * @brief Exit code curl uses when the server ignores a range request
+ */
+#define CURL_RANGE_ERROR 33
+
+/**
+ * @brief Run a command in cwd, hiding its output unless verbose; returns its exit code
+ */
+static int run_seed_command(const char *const argv[], const char *cwd, int verbose)
+{
+	if (verbose) {
+		printf("Executing:");
+		for (size_t i = 0; argv[i]; i++) {
+			printf(" %s", argv[i]);
+		}
+		printf("\n");
+	}
+	
+	return cache_exec_status(argv, cwd, !verbose);
+}
+
+/**
+ * @brief Check for a bare repository layout
+ */
+static int is_bare_repository(const char *path)
+{
+	char check[4096];
+	struct stat st;
+	
+	snprintf(check, sizeof(check), "%s/HEAD", path);
+	if (stat(check, &st) != 0 || !S_ISREG(st.st_mode)) {
+		return 0;
+	}
+	snprintf(check, sizeof(check), "%s/objects", path);
+	if (stat(check, &st) != 0 || !S_ISDIR(st.st_mode)) {
+		return 0;
+	}
+	snprintf(check, sizeof(check), "%s/refs", path);
+	return stat(check, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+/**
+ * @brief Build the partial repository path for a cache path
+ */
+int cache_seed_partial_path(const char *cache_path, char *path, size_t path_size)
+{
+	if (!cache_path || !path || cache_path[0] == '\0') {
+		return CACHE_SEED_ERROR_INVALID;
+	}
+	
+	int len = snprintf(path, path_size, "%s%s", cache_path, CACHE_SEED_PARTIAL_SUFFIX);
+	return len >= 0 && (size_t)len < path_size ? CACHE_SEED_SUCCESS : CACHE_SEED_ERROR_INVALID;
+}
+
+/**
+ * @brief Build the bundle URL of a repository under a base URL
+ */
+int cache_seed_bundle_url(const char *base, const char *owner, const char *name,
+                          char *url, size_t url_size)
+{
+	if (!base || !owner || !name || !url || base[0] == '\0' || owner[0] == '\0' ||
+	    name[0] == '\0') {
+		return CACHE_SEED_ERROR_INVALID;
+	}
+	
+	size_t base_len = strlen(base);
+	while (base_len > 1 && base[base_len - 1] == '/') {
+		base_len--;
+	}
+	
+	int len = snprintf(url, url_size, "%.*s/%s/%s.bundle", (int)base_len, base, owner, name);
+	return len >= 0 && (size_t)len < url_size ? CACHE_SEED_SUCCESS : CACHE_SEED_ERROR_INVALID;
+}
+
+/**
+ * @brief Reuse a partial repository or create an empty one
+ */
+int cache_seed_prepare(const char *partial_path, const char *url, int verbose)
+{
+	if (!partial_path || !url) {
+		return CACHE_SEED_ERROR_INVALID;
+	}
+	
+	const char *remove_argv[] = { "rm", "-rf", "--", partial_path, NULL };
+	struct stat st;
+	
+	if (stat(partial_path, &st) == 0) {
+		if (S_ISDIR(st.st_mode) && is_bare_repository(partial_path)) {
+			return 1;
+		}
+	
+		/* Half-created by something else; start over */
+		if (run_seed_command(remove_argv, NULL, verbose) != 0) {
+			return CACHE_SEED_ERROR_IO;
+		}
+	}
+	
+	/* clone --bare leaves origin without a fetch refspec; so do we */
+	const char *init_argv[] = { "git", "init", "--bare", "--quiet", partial_path, NULL };
+	const char *url_argv[] = { "git", "config", "remote.origin.url", url, NULL };
+	if (run_seed_command(init_argv, NULL, verbose) != 0 ||
+	    run_seed_command(url_argv, partial_path, verbose) != 0) {
+		run_seed_command(remove_argv, NULL, verbose);
+		return CACHE_SEED_ERROR_GIT;
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief Check whether a bundle was already imported into a partial repository
+ */
+int cache_seed_is_seeded(const char *partial_path)
+{
+	if (!partial_path) {
+		return 0;
+	}
+	
+	char marker[4096];
+	snprintf(marker, sizeof(marker), "%s/%s", partial_path, CACHE_SEED_MARKER);
+	return access(marker, F_OK) == 0;
+}
+
+/**
+ * @brief Download an http(s) bundle, continuing an earlier partial download
+ */
+static int download_bundle(const char *partial_path, const char *bundle_url, char *bundle_path,
+                           size_t bundle_path_size, int verbose)
+{
+	char part_path[4096 + sizeof(".part")];
+	snprintf(bundle_path, bundle_path_size, "%s/%s", partial_path, CACHE_SEED_BUNDLE_FILE);
+	snprintf(part_path, sizeof(part_path), "%s.part", bundle_path);
+	
+	if (access(bundle_path, F_OK) == 0) {
+		return CACHE_SEED_SUCCESS;
+	}
+	
+	const char *curl_argv[] = { "curl", "-fsSL", "--retry", "2", "-C", "-", "-o", part_path,
+	                            bundle_url, NULL };
+	int result = run_seed_command(curl_argv, NULL, verbose);
+	
+	/* Servers without range support: start the download again */
+	if (result == CURL_RANGE_ERROR) {
+		unlink(part_path);
+		result = run_seed_command(curl_argv, NULL, verbose);
+	}
+	
+	if (result != 0) {
+		/* What arrived so far is kept for the next attempt */
+		return CACHE_SEED_ERROR_DOWNLOAD;
+	}
+	
+	if (rename(part_path, bundle_path) != 0) {
+		return CACHE_SEED_ERROR_IO;
+	}
+	return CACHE_SEED_SUCCESS;
+}
+
+/**
+ * @brief Import branches and tags from a bundle into a partial repository
+ */
+int cache_seed_from_bundle(const char *partial_path, const char *bundle_url, int verbose)
+{
+	if (!partial_path || !bundle_url || bundle_url[0] == '\0') {
+		return CACHE_SEED_ERROR_INVALID;
+	}
+	
+	char bundle_path[4096];
+	int downloaded = 0;
+	
+	if (strncmp(bundle_url, "http://", 7) == 0 || strncmp(bundle_url, "https://", 8) == 0) {
+		int ret = download_bundle(partial_path, bundle_url, bundle_path, sizeof(bundle_path),
+		                          verbose);
+		if (ret != CACHE_SEED_SUCCESS) {
+			return ret;
+		}
+		downloaded = 1;
+	} else {
+		const char *local = strncmp(bundle_url, "file://", 7) == 0 ? bundle_url + 7 : bundle_url;
+		snprintf(bundle_path, sizeof(bundle_path), "%s", local);
+		if (access(bundle_path, R_OK) != 0) {
+			return CACHE_SEED_ERROR_DOWNLOAD;
+		}
+	}
+	
+	const char *verify_argv[] = { "git", "bundle", "verify", "--quiet", bundle_path, NULL };
+	if (run_seed_command(verify_argv, partial_path, verbose) != 0) {
+		if (downloaded) {
+			unlink(bundle_path);
+		}
+		return CACHE_SEED_ERROR_GIT;
+	}
+	
+	const char *fetch_argv[] = { "git", "fetch", "--quiet", bundle_path, "+refs/heads/*:refs/heads/*",
+	                             "+refs/tags/*:refs/tags/*", NULL };
+	if (run_seed_command(fetch_argv, partial_path, verbose) != 0) {
+		return CACHE_SEED_ERROR_GIT;
+	}
+	
+	char marker[4096];
+	snprintf(marker, sizeof(marker), "%s/%s", partial_path, CACHE_SEED_MARKER);
+	FILE *file = fopen(marker, "w");
+	if (!file) {
+		return CACHE_SEED_ERROR_IO;
+	}
+	fprintf(file, "%s\n", bundle_url);
+	fclose(file);
+	
+	/* The objects are in the repository now */
+	if (downloaded) {
+		unlink(bundle_path);
+	}
+	return CACHE_SEED_SUCCESS;
+}
+
+/**
+ * @brief Check that a repository has a branch
+ */
+static int has_branch(const char *repo_path, const char *ref)
+{
+	const char *argv[] = { "git", "rev-parse", "--verify", "--quiet", ref, NULL };
+	return run_seed_command(argv, repo_path, 0) == 0;
+}
+
+/**
+ * @brief Point HEAD of a fetched repository at origin's default branch
+ */
+int cache_seed_set_head(const char *partial_path, int verbose)
+{
+	if (!partial_path) {
+		return CACHE_SEED_ERROR_INVALID;
+	}
+	
+	char head[2048] = "";
+	char line[2048];
+	
+	/* The symref line comes first: "ref: refs/heads/<branch>\tHEAD" */
+	const char *ls_remote_argv[] = { "git", "ls-remote", "--symref", "origin", "HEAD", NULL };
+	if (cache_exec_line(ls_remote_argv, partial_path, line, sizeof(line)) == 0) {
+		char *tab = strchr(line, '\t');
+		if (strncmp(line, "ref: refs/heads/", 16) == 0 && tab) {
+			*tab = '\0';
+			snprintf(head, sizeof(head), "%s", line + 5);
+		}
+	}
+	
+	if (head[0] == '\0' || !has_branch(partial_path, head)) {
+		if (has_branch(partial_path, "refs/heads/main")) {
+			strcpy(head, "refs/heads/main");
+		} else if (has_branch(partial_path, "refs/heads/master")) {
+			strcpy(head, "refs/heads/master");
+		} else {
+			/* Keep git init's default */
+			return CACHE_SEED_SUCCESS;
+		}
+	}
+	
+	const char *symref_argv[] = { "git", "symbolic-ref", "HEAD", head, NULL };
+	return run_seed_command(symref_argv, partial_path, verbose) == 0 ? CACHE_SEED_SUCCESS :
+	                                                                   CACHE_SEED_ERROR_GIT;
+}
+
+/**
+ * @brief Remove seeding leftovers before the partial repository is moved into place
+ */
+void cache_seed_finish(const char *partial_path)
+{
+	if (!partial_path) {
+		return;
+	}
+	
+	char path[4096];
+	snprintf(path, sizeof(path), "%s/%s", partial_path, CACHE_SEED_MARKER);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/%s", partial_path, CACHE_SEED_BUNDLE_FILE);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/%s.part", partial_path, CACHE_SEED_BUNDLE_FILE);
+	unlink(path);
+}
+
+/**
+ * @brief Get human-readable error message for cache seed error code
+ */
+const char* cache_seed_error_string(int error_code)
+{
+	switch (error_code) {
+		case CACHE_SEED_SUCCESS:
+			return "Success";
+		case CACHE_SEED_ERROR_INVALID:
+			return "Invalid argument";
+		case CACHE_SEED_ERROR_IO:
+			return "Filesystem operation failed";
+		case CACHE_SEED_ERROR_GIT:
+			return "Git command failed";
+		case CACHE_SEED_ERROR_DOWNLOAD:
+			return "Bundle download failed";
+		default:
+			return "Unknown error";
+	}
+}
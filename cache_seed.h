@@ -0,0 +1,134 @@
+#ifndef CACHE_SEED_H
+#define CACHE_SEED_H
+
+/**
+ * @file cache_seed.h
+ * @brief Resumable, bundle-seeded initial clones of cache repositories
+ *
+ * A new cache is built in <cache_path>.tmp.partial with git init --bare and
+ * git fetch instead of git clone, so everything already received survives
+ * a failed attempt and the next clone continues from it. Before the first
+ * fetch from origin the partial repository can be seeded from a git bundle
+ * (GIT_CACHE_BUNDLE_URI or a mirror serving a .bundle); origin then only
+ * sends what the bundle lacks. HTTP bundle downloads resume with ranged
+ * requests. Once the fetch succeeds the partial repository is validated
+ * and moved into place.
+ */
+
+#include <stddef.h>
+
+/**
+ * @brief Suffix of the partial repository next to the cache path
+ *
+ * Contains ".tmp." so index rebuilds and sync scans skip it.
+ */
+#define CACHE_SEED_PARTIAL_SUFFIX ".tmp.partial"
+
+/**
+ * @brief Environment variable with the base URL of prebuilt bundles
+ *
+ * The bundle of owner/name is looked up at <base>/<owner>/<name>.bundle.
+ */
+#define CACHE_SEED_BUNDLE_ENV "GIT_CACHE_BUNDLE_URI"
+
+/**
+ * @brief File in a partial repository recording that a bundle was imported
+ */
+#define CACHE_SEED_MARKER "git-cache-seeded"
+
+/**
+ * @brief Downloaded bundle inside a partial repository
+ */
+#define CACHE_SEED_BUNDLE_FILE "seed.bundle"
+
+/**
+ * @brief Cache seed error codes
+ */
+#define CACHE_SEED_SUCCESS          0
+#define CACHE_SEED_ERROR_INVALID   -1
+#define CACHE_SEED_ERROR_IO        -2
+#define CACHE_SEED_ERROR_GIT       -3
+#define CACHE_SEED_ERROR_DOWNLOAD  -4
+
+/**
+ * @brief Build the partial repository path for a cache path
+ * @param cache_path Final cache repository path
+ * @param path Buffer for the partial path
+ * @param path_size Size of buffer
+ * @return CACHE_SEED_SUCCESS on success, error code on failure
+ */
+int cache_seed_partial_path(const char *cache_path, char *path, size_t path_size);
+
+/**
+ * @brief Build the bundle URL of a repository under a base URL
+ * @param base Base URL or directory (trailing slashes are ignored)
+ * @param owner Repository owner
+ * @param name Repository name
+ * @param url Buffer for the bundle URL
+ * @param url_size Size of buffer
+ * @return CACHE_SEED_SUCCESS on success, error code on failure
+ */
+int cache_seed_bundle_url(const char *base, const char *owner, const char *name,
+                          char *url, size_t url_size);
+
+/**
+ * @brief Reuse a partial repository or create an empty one
+ *
+ * A directory that is not a bare repository is removed first. A new
+ * repository gets origin configured the way git clone --bare does.
+ *
+ * @param partial_path Partial repository path
+ * @param url Origin URL
+ * @param verbose Print the commands that run
+ * @return 1 if an existing partial repository is resumed, 0 if a new one was
+ *         created, negative error code on failure
+ */
+int cache_seed_prepare(const char *partial_path, const char *url, int verbose);
+
+/**
+ * @brief Check whether a bundle was already imported into a partial repository
+ * @param partial_path Partial repository path
+ * @return 1 if seeded, 0 otherwise
+ */
+int cache_seed_is_seeded(const char *partial_path);
+
+/**
+ * @brief Import branches and tags from a bundle into a partial repository
+ *
+ * http(s) bundles are downloaded into the partial repository first and an
+ * interrupted download is continued on the next call. Local paths and
+ * file:// URLs are read in place. A bundle that fails verification is
+ * deleted so it is fetched again next time.
+ *
+ * @param partial_path Partial repository path
+ * @param bundle_url Bundle URL or path
+ * @param verbose Print the commands that run
+ * @return CACHE_SEED_SUCCESS on success, error code on failure
+ */
+int cache_seed_from_bundle(const char *partial_path, const char *bundle_url, int verbose);
+
+/**
+ * @brief Point HEAD of a fetched repository at origin's default branch
+ *
+ * Falls back to main or master when origin does not advertise HEAD.
+ *
+ * @param partial_path Repository path
+ * @param verbose Print the commands that run
+ * @return CACHE_SEED_SUCCESS on success, error code on failure
+ */
+int cache_seed_set_head(const char *partial_path, int verbose);
+
+/**
+ * @brief Remove seeding leftovers before the partial repository is moved into place
+ * @param partial_path Partial repository path
+ */
+void cache_seed_finish(const char *partial_path);
+
+/**
+ * @brief Get human-readable error message for cache seed error code
+ * @param error_code Cache seed error code
+ * @return Error message string
+ */
+const char* cache_seed_error_string(int error_code);
+
+#endif /* CACHE_SEED_H */
@@ -0,0 +1,387 @@
+/**
+ * @file cache_serve.c
+ * @brief git:// protocol front end that serves the bare caches to peers implementation
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include "cache_serve.h"
+
+/**
+ * @brief Listen for git-daemon connections
+ */
+int cache_serve_listen(const char *address, int port)
+{
+	if (port <= 0 || port > 65535) {
+		return CACHE_SERVE_ERROR_INVALID;
+	}
+	
+	char service[16];
+	snprintf(service, sizeof(service), "%d", port);
+	
+	/* Nothing is authenticated, so other machines only connect when asked for */
+	if (!address) {
+		address = CACHE_SERVE_DEFAULT_ADDRESS;
+	}
+	
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+	
+	struct addrinfo *addresses = NULL;
+	if (getaddrinfo(address, service, &hints, &addresses) != 0) {
+		return CACHE_SERVE_ERROR_INVALID;
+	}
+	
+	int fd = CACHE_SERVE_ERROR_IO;
+	for (struct addrinfo *ai = addresses; ai; ai = ai->ai_next) {
+		int candidate = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+		if (candidate < 0) {
+			continue;
+		}
+		int on = 1;
+		setsockopt(candidate, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+		if (bind(candidate, ai->ai_addr, ai->ai_addrlen) == 0 && listen(candidate, 128) == 0) {
+			fd = candidate;
+			break;
+		}
+		close(candidate);
+	}
+	
+	freeaddrinfo(addresses);
+	return fd;
+}
+
+/**
+ * @brief Copy a string into a fixed buffer, failing if it does not fit
+ */
+static int copy_field(char *dest, size_t dest_size, const char *src, size_t len)
+{
+	if (len >= dest_size) {
+		return CACHE_SERVE_ERROR_PROTOCOL;
+	}
+	memcpy(dest, src, len);
+	dest[len] = '\0';
+	return CACHE_SERVE_SUCCESS;
+}
+
+/**
+ * @brief Decode the payload of a request pkt-line
+ */
+int cache_serve_parse_request(const char *packet, size_t len, struct cache_serve_request *request)
+{
+	if (!packet || !request) {
+		return CACHE_SERVE_ERROR_INVALID;
+	}
+	
+	memset(request, 0, sizeof(*request));
+	const char *end = packet + len;
+	
+	/* "<service> <path>", NUL-terminated; older clients end it with a newline */
+	const char *command_end = memchr(packet, '\0', len);
+	if (!command_end) {
+		command_end = end;
+	}
+	size_t command_len = (size_t)(command_end - packet);
+	if (command_len > 0 && packet[command_len - 1] == '\n') {
+		command_len--;
+	}
+	const char *space = memchr(packet, ' ', command_len);
+	if (!space || space == packet || space + 1 == packet + command_len ||
+	    copy_field(request->service, sizeof(request->service), packet,
+	               (size_t)(space - packet)) != CACHE_SERVE_SUCCESS ||
+	    copy_field(request->path, sizeof(request->path), space + 1,
+	               (size_t)(packet + command_len - space - 1)) != CACHE_SERVE_SUCCESS) {
+		return CACHE_SERVE_ERROR_PROTOCOL;
+	}
+	
+	/* Then "host=<host>\0", then an empty string and the extra parameters */
+	const char *p = command_end < end ? command_end + 1 : end;
+	if (p < end && strncmp(p, "host=", 5) == 0) {
+		const char *host_end = memchr(p, '\0', (size_t)(end - p));
+		if (!host_end) {
+			host_end = end;
+		}
+		if (copy_field(request->host, sizeof(request->host), p + 5,
+		               (size_t)(host_end - p - 5)) != CACHE_SERVE_SUCCESS) {
+			return CACHE_SERVE_ERROR_PROTOCOL;
+		}
+		p = host_end < end ? host_end + 1 : end;
+	}
+	
+	if (p < end && *p == '\0') {
+		size_t used = 0;
+		for (p++; p < end; ) {
+			const char *param_end = memchr(p, '\0', (size_t)(end - p));
+			if (!param_end) {
+				param_end = end;
+			}
+			size_t param_len = (size_t)(param_end - p);
+			/* Like git daemon, GIT_PROTOCOL gets the parameters joined with ':' */
+			if (param_len > 0) {
+				if (used + param_len + 2 > sizeof(request->protocol)) {
+					return CACHE_SERVE_ERROR_PROTOCOL;
+				}
+				if (used > 0) {
+					request->protocol[used++] = ':';
+				}
+				memcpy(request->protocol + used, p, param_len);
+				used += param_len;
+				request->protocol[used] = '\0';
+			}
+			p = param_end + 1;
+		}
+	}
+	
+	return CACHE_SERVE_SUCCESS;
+}
+
+/**
+ * @brief Read exactly len bytes
+ */
+static int read_full(int fd, char *buffer, size_t len)
+{
+	size_t done = 0;
+	while (done < len) {
+		ssize_t n = read(fd, buffer + done, len - done);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return CACHE_SERVE_ERROR_IO;
+		}
+		done += (size_t)n;
+	}
+	return CACHE_SERVE_SUCCESS;
+}
+
+/**
+ * @brief Read and decode the request pkt-line of a connection
+ */
+int cache_serve_read_request(int fd, struct cache_serve_request *request)
+{
+	if (fd < 0 || !request) {
+		return CACHE_SERVE_ERROR_INVALID;
+	}
+	
+	char length[5];
+	if (read_full(fd, length, 4) != CACHE_SERVE_SUCCESS) {
+		return CACHE_SERVE_ERROR_IO;
+	}
+	length[4] = '\0';
+	for (int i = 0; i < 4; i++) {
+		if (!isxdigit((unsigned char)length[i])) {
+			return CACHE_SERVE_ERROR_PROTOCOL;
+		}
+	}
+	
+	/* The length counts its own four bytes */
+	size_t packet_len = (size_t)strtoul(length, NULL, 16);
+	if (packet_len <= 4 || packet_len - 4 > CACHE_SERVE_MAX_PACKET) {
+		return CACHE_SERVE_ERROR_PROTOCOL;
+	}
+	packet_len -= 4;
+	
+	char *packet = malloc(packet_len);
+	if (!packet) {
+		return CACHE_SERVE_ERROR_IO;
+	}
+	int ret = read_full(fd, packet, packet_len);
+	if (ret == CACHE_SERVE_SUCCESS) {
+		ret = cache_serve_parse_request(packet, packet_len, request);
+	}
+	free(packet);
+	return ret;
+}
+
+/**
+ * @brief Check that a path component is a plain GitHub owner or repository name
+ */
+static int is_plain_name(const char *name, size_t len)
+{
+	if (len == 0 || name[0] == '.' || name[0] == '-') {
+		return 0;
+	}
+	for (size_t i = 0; i < len; i++) {
+		if (!isalnum((unsigned char)name[i]) && !strchr("._-", name[i])) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * @brief Map a requested path to the upstream URL of its cache
+ */
+int cache_serve_repo_url(const char *path, char *url, size_t url_size)
+{
+	if (!path || !url || url_size == 0) {
+		return CACHE_SERVE_ERROR_INVALID;
+	}
+	
+	/* Caches of other hosts are not kept, so github.com is optional */
+	const char *p = path;
+	while (*p == '/') {
+		p++;
+	}
+	if (strncmp(p, "github.com/", 11) == 0) {
+		p += 11;
+	}
+	
+	size_t owner_len = strcspn(p, "/");
+	const char *name = p + owner_len;
+	if (*name != '/') {
+		return CACHE_SERVE_ERROR_PATH;
+	}
+	name++;
+	
+	size_t name_len = strcspn(name, "/");
+	if (strspn(name + name_len, "/") != strlen(name + name_len)) {
+		return CACHE_SERVE_ERROR_PATH;
+	}
+	if (name_len > 4 && strncmp(name + name_len - 4, ".git", 4) == 0) {
+		name_len -= 4;
+	}
+	if (!is_plain_name(p, owner_len) || !is_plain_name(name, name_len)) {
+		return CACHE_SERVE_ERROR_PATH;
+	}
+	
+	int len = snprintf(url, url_size, "https://github.com/%.*s/%.*s",
+	                   (int)owner_len, p, (int)name_len, name);
+	if (len < 0 || (size_t)len >= url_size) {
+		url[0] = '\0';
+		return CACHE_SERVE_ERROR_PATH;
+	}
+	return CACHE_SERVE_SUCCESS;
+}
+
+/**
+ * @brief Check whether a repository is on an export list
+ */
+int cache_serve_exported(const char *exports, const char *owner, const char *name)
+{
+	if (!exports || !owner || !name) {
+		return 0;
+	}
+	
+	char repo[512];
+	int len = snprintf(repo, sizeof(repo), "%s/%s", owner, name);
+	if (len < 0 || (size_t)len >= sizeof(repo)) {
+		return 0;
+	}
+	
+	const char *p = exports;
+	while (*p) {
+		p += strspn(p, " ,\t");
+		size_t word_len = strcspn(p, " ,\t");
+		if (word_len == 0) {
+			break;
+		}
+		char pattern[512];
+		if (word_len < sizeof(pattern)) {
+			memcpy(pattern, p, word_len);
+			pattern[word_len] = '\0';
+			if (fnmatch(pattern, repo, 0) == 0) {
+				return 1;
+			}
+		}
+		p += word_len;
+	}
+	return 0;
+}
+
+/**
+ * @brief Build the URL a client fetches a cache from on a peer
+ */
+int cache_serve_peer_url(const char *peer, const char *owner, const char *name,
+                         char *url, size_t url_size)
+{
+	if (!peer || !owner || !name || !url || url_size == 0 || peer[0] == '\0') {
+		return CACHE_SERVE_ERROR_INVALID;
+	}
+	
+	size_t peer_len = strlen(peer);
+	while (peer_len > 0 && peer[peer_len - 1] == '/') {
+		peer_len--;
+	}
+	
+	int len = snprintf(url, url_size, "%.*s/github.com/%s/%s", (int)peer_len, peer, owner, name);
+	if (len < 0 || (size_t)len >= url_size) {
+		url[0] = '\0';
+		return CACHE_SERVE_ERROR_INVALID;
+	}
+	return CACHE_SERVE_SUCCESS;
+}
+
+/**
+ * @brief Send an error the client's git prints as "remote error"
+ */
+int cache_serve_send_error(int fd, const char *message)
+{
+	if (fd < 0 || !message) {
+		return CACHE_SERVE_ERROR_INVALID;
+	}
+	
+	char packet[1024];
+	int len = snprintf(packet, sizeof(packet), "0000ERR %s\n", message);
+	if (len < 0) {
+		return CACHE_SERVE_ERROR_INVALID;
+	}
+	if ((size_t)len >= sizeof(packet)) {
+		len = (int)sizeof(packet) - 1;
+		packet[len - 1] = '\n';
+	}
+	
+	/* Fill in the pkt-line length now that it is known */
+	char length[5];
+	snprintf(length, sizeof(length), "%04x", (unsigned)len);
+	memcpy(packet, length, 4);
+	
+	size_t done = 0;
+	while (done < (size_t)len) {
+		ssize_t n = write(fd, packet + done, (size_t)len - done);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return CACHE_SERVE_ERROR_IO;
+		}
+		done += (size_t)n;
+	}
+	return CACHE_SERVE_SUCCESS;
+}
+
+/**
+ * @brief Get human-readable error message for cache serve error code
+ */
+const char* cache_serve_error_string(int error_code)
+{
+	switch (error_code) {
+		case CACHE_SERVE_SUCCESS:
+			return "Success";
+		case CACHE_SERVE_ERROR_INVALID:
+			return "Invalid argument or address";
+		case CACHE_SERVE_ERROR_IO:
+			return "Socket I/O error";
+		case CACHE_SERVE_ERROR_PROTOCOL:
+			return "Malformed request";
+		case CACHE_SERVE_ERROR_PATH:
+			return "Path does not name a cached repository";
+		case CACHE_SERVE_ERROR_DENIED:
+			return "Repository is not exported by this cache";
+		default:
+			return "Unknown error";
+	}
+}
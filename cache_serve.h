@@ -0,0 +1,165 @@
+#ifndef CACHE_SERVE_H
+#define CACHE_SERVE_H
+
+/**
+ * @file cache_serve.h
+ * @brief git:// protocol front end that serves the bare caches to peers
+ *
+ * `git-cache serve` listens for git-daemon protocol connections so other
+ * machines on the network can clone and fetch from this cache instead of
+ * from GitHub. A connection starts with one pkt-line:
+ *
+ *     git-upload-pack /github.com/owner/name\0host=node:9418\0\0version=2\0
+ *
+ * The path names the cache under the cache root ("/owner/name" and a
+ * ".git" suffix are accepted too). The protocol has no authentication, so
+ * only caches that already exist and match the operator's export list
+ * (`--export`) are served; a miss is refused rather than cloned with the
+ * server's credentials. A hit is refreshed as a clone would, and then the
+ * connection is handed to git upload-pack. Only fetches are served;
+ * pushes are refused. The server binds the loopback address unless
+ * `--listen` names another one.
+ *
+ * Clients set GIT_CACHE_PEER (or [clone] peer) to git://node:port. Each of
+ * their caches then registers the peer as a "performance" mirror and
+ * fetches from it first, falling back to origin when the peer fails.
+ */
+
+#include <stddef.h>
+
+/**
+ * @brief Port git daemon uses, and serve listens on by default
+ */
+#define CACHE_SERVE_DEFAULT_PORT 9418
+
+/**
+ * @brief Address serve binds unless --listen names another one
+ */
+#define CACHE_SERVE_DEFAULT_ADDRESS "127.0.0.1"
+
+/**
+ * @brief Largest pkt-line payload, as defined by the git protocol
+ */
+#define CACHE_SERVE_MAX_PACKET 65516
+
+/**
+ * @brief Time a client has to send its request, in seconds
+ */
+#define CACHE_SERVE_REQUEST_TIMEOUT 10
+
+/**
+ * @brief Inactivity after which upload-pack gives up on a client, in seconds
+ */
+#define CACHE_SERVE_UPLOAD_TIMEOUT 600
+
+/**
+ * @brief Connections served at the same time unless --jobs says otherwise
+ */
+#define CACHE_SERVE_MAX_CONNECTIONS 32
+
+/**
+ * @brief Seconds a served cache is used without a fetch unless GIT_CACHE_FRESH_TTL is set
+ */
+#define CACHE_SERVE_FRESH_TTL 300
+
+/**
+ * @brief Cache serve error codes
+ */
+#define CACHE_SERVE_SUCCESS          0
+#define CACHE_SERVE_ERROR_INVALID   -1
+#define CACHE_SERVE_ERROR_IO        -2
+#define CACHE_SERVE_ERROR_PROTOCOL  -3
+#define CACHE_SERVE_ERROR_PATH      -4
+#define CACHE_SERVE_ERROR_DENIED    -5
+
+/**
+ * @brief A decoded git-daemon request
+ */
+struct cache_serve_request {
+	char service[32];           /**< Service, e.g. "git-upload-pack" */
+	char path[1024];            /**< Requested repository path */
+	char host[256];             /**< Host the client connected to ("" if not sent) */
+	char protocol[256];         /**< Extra parameters joined with ':' for GIT_PROTOCOL ("" if none) */
+};
+
+/**
+ * @brief Listen for git-daemon connections
+ * @param address Address to bind (NULL for CACHE_SERVE_DEFAULT_ADDRESS)
+ * @param port TCP port
+ * @return Listening descriptor, or negative error code
+ */
+int cache_serve_listen(const char *address, int port);
+
+/**
+ * @brief Decode the payload of a request pkt-line
+ * @param packet Payload without the 4-byte length
+ * @param len Payload length
+ * @param request Output request
+ * @return CACHE_SERVE_SUCCESS on success, error code on failure
+ */
+int cache_serve_parse_request(const char *packet, size_t len, struct cache_serve_request *request);
+
+/**
+ * @brief Read and decode the request pkt-line of a connection
+ * @param fd Accepted descriptor
+ * @param request Output request
+ * @return CACHE_SERVE_SUCCESS on success, error code on failure
+ */
+int cache_serve_read_request(int fd, struct cache_serve_request *request);
+
+/**
+ * @brief Map a requested path to the upstream URL of its cache
+ *
+ * Every component must be a plain GitHub owner or repository name, so a
+ * request cannot reach outside the cache root.
+ *
+ * @param path Requested path, e.g. "/github.com/owner/name.git"
+ * @param url Buffer for the URL, e.g. "https://github.com/owner/name"
+ * @param url_size Size of buffer
+ * @return CACHE_SERVE_SUCCESS on success, CACHE_SERVE_ERROR_PATH if the path
+ *         does not name a cache
+ */
+int cache_serve_repo_url(const char *path, char *url, size_t url_size);
+
+/**
+ * @brief Check whether a repository is on an export list
+ *
+ * The list holds words separated by spaces or commas. Each is a shell
+ * glob matched against "owner/name": an owner followed by a star exports
+ * all of that owner's caches, and a lone star every cache.
+ *
+ * @param exports Export list (NULL or empty exports nothing)
+ * @param owner Repository owner
+ * @param name Repository name
+ * @return 1 if exported, 0 if not
+ */
+int cache_serve_exported(const char *exports, const char *owner, const char *name);
+
+/**
+ * @brief Build the URL a client fetches a cache from on a peer
+ * @param peer Peer base URL, e.g. "git://node:9418"
+ * @param owner Repository owner
+ * @param name Repository name
+ * @param url Buffer for the URL
+ * @param url_size Size of buffer
+ * @return CACHE_SERVE_SUCCESS on success, error code on failure
+ */
+int cache_serve_peer_url(const char *peer, const char *owner, const char *name,
+                         char *url, size_t url_size);
+
+/**
+ * @brief Send an error the client's git prints as "remote error"
+ * @param fd Connected descriptor
+ * @param message Error message
+ * @return CACHE_SERVE_SUCCESS on success, error code on failure
+ */
+int cache_serve_send_error(int fd, const char *message);
+
+/**
+ * @brief Get human-readable error message for cache serve error code
+ * @param error_code Cache serve error code
+ * @return Error message string
+ */
+const char* cache_serve_error_string(int error_code);
+
+#endif /* CACHE_SERVE_H */
@@ -0,0 +1,214 @@
+/**
+ * @file cache_trace.c
+ * @brief Per-phase timing and trace output implementation
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "cache_trace.h"
+
+/**
+ * @brief Accumulated timings of one phase
+ */
+struct phase_total {
+	const char *phase;          /**< Phase name */
+	unsigned long count;        /**< Finished spans */
+	double total_ms;            /**< Summed wall time */
+	double max_ms;              /**< Longest span */
+	double child_cpu_ms;        /**< Summed child user + system time */
+};
+
+static int trace_fd = -1;
+static int timings_enabled = 0;
+static int trace_depth = 0;
+static struct phase_total phase_totals[CACHE_TRACE_MAX_PHASES];
+static size_t phase_count = 0;
+
+/**
+ * @brief Set up tracing from the command line and GIT_CACHE_TRACE
+ */
+int cache_trace_init(int timings)
+{
+	timings_enabled = timings;
+	
+	const char *path = getenv(CACHE_TRACE_ENV_VAR);
+	if (!path || path[0] == '\0' || trace_fd >= 0) {
+		return CACHE_TRACE_SUCCESS;
+	}
+	
+	trace_fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	return trace_fd >= 0 ? CACHE_TRACE_SUCCESS : CACHE_TRACE_ERROR_IO;
+}
+
+/**
+ * @brief Start a span
+ */
+void cache_trace_begin(struct cache_trace_span *span, const char *phase, const char *detail)
+{
+	if (!span) {
+		return;
+	}
+	
+	span->active = trace_fd >= 0 || timings_enabled;
+	if (!span->active) {
+		return;
+	}
+	
+	span->phase = phase ? phase : "unknown";
+	snprintf(span->detail, sizeof(span->detail), "%s", detail ? detail : "");
+	span->depth = trace_depth++;
+	getrusage(RUSAGE_CHILDREN, &span->children_start);
+	clock_gettime(CLOCK_MONOTONIC, &span->start);
+}
+
+/**
+ * @brief Milliseconds between two timevals
+ */
+static double timeval_ms(const struct timeval *end, const struct timeval *start)
+{
+	return (double)(end->tv_sec - start->tv_sec) * 1000.0 +
+	       (double)(end->tv_usec - start->tv_usec) / 1000.0;
+}
+
+/**
+ * @brief Add a finished span to the per-phase summary
+ */
+static void add_phase_total(const char *phase, double elapsed_ms, double child_cpu_ms)
+{
+	struct phase_total *total = NULL;
+	for (size_t i = 0; i < phase_count; i++) {
+		if (strcmp(phase_totals[i].phase, phase) == 0) {
+			total = &phase_totals[i];
+			break;
+		}
+	}
+	if (!total) {
+		if (phase_count == CACHE_TRACE_MAX_PHASES) {
+			return;
+		}
+		total = &phase_totals[phase_count++];
+		memset(total, 0, sizeof(*total));
+		total->phase = phase;
+	}
+	
+	total->count++;
+	total->total_ms += elapsed_ms;
+	total->child_cpu_ms += child_cpu_ms;
+	if (elapsed_ms > total->max_ms) {
+		total->max_ms = elapsed_ms;
+	}
+}
+
+/**
+ * @brief Copy a string into a JSON string body, escaping as needed
+ */
+static size_t json_escape(const char *in, char *out, size_t out_size)
+{
+	size_t len = 0;
+	for (; *in && len + 7 < out_size; in++) {
+		unsigned char c = (unsigned char)*in;
+		if (c == '"' || c == '\\') {
+			out[len++] = '\\';
+			out[len++] = (char)c;
+		} else if (c < 0x20) {
+			len += (size_t)snprintf(out + len, out_size - len, "\\u%04x", c);
+		} else {
+			out[len++] = (char)c;
+		}
+	}
+	out[len] = '\0';
+	return len;
+}
+
+/**
+ * @brief Finish a span, recording it in the summary and trace file
+ */
+void cache_trace_end(struct cache_trace_span *span, int result)
+{
+	if (!span || !span->active) {
+		return;
+	}
+	
+	struct timespec end;
+	struct rusage children;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	getrusage(RUSAGE_CHILDREN, &children);
+	span->active = 0;
+	trace_depth = span->depth;
+	
+	double elapsed_ms = (double)(end.tv_sec - span->start.tv_sec) * 1000.0 +
+	                    (double)(end.tv_nsec - span->start.tv_nsec) / 1000000.0;
+	double child_user_ms = timeval_ms(&children.ru_utime, &span->children_start.ru_utime);
+	double child_sys_ms = timeval_ms(&children.ru_stime, &span->children_start.ru_stime);
+	
+	if (timings_enabled) {
+		add_phase_total(span->phase, elapsed_ms, child_user_ms + child_sys_ms);
+	}
+	
+	if (trace_fd < 0) {
+		return;
+	}
+	
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	
+	char phase[128];
+	char detail[sizeof(span->detail) * 2];
+	json_escape(span->phase, phase, sizeof(phase));
+	json_escape(span->detail, detail, sizeof(detail));
+	
+	/* ru_maxrss of children is the largest child so far, not a delta */
+	char line[2048];
+	int len = snprintf(line, sizeof(line),
+	                   "{\"ts\":%lld.%03ld,\"pid\":%ld,\"phase\":\"%s\",\"detail\":\"%s\","
+	                   "\"depth\":%d,\"elapsed_ms\":%.3f,\"child_user_ms\":%.3f,"
+	                   "\"child_sys_ms\":%.3f,\"child_maxrss_kb\":%ld,\"result\":%d}\n",
+	                   (long long)now.tv_sec, now.tv_nsec / 1000000, (long)getpid(), phase, detail,
+	                   span->depth, elapsed_ms, child_user_ms, child_sys_ms,
+	                   children.ru_maxrss, result);
+	if (len > 0 && (size_t)len < sizeof(line)) {
+		ssize_t written = write(trace_fd, line, (size_t)len);
+		(void)written;
+	}
+}
+
+/**
+ * @brief Print the per-phase summary if --timings was given
+ */
+void cache_trace_report(FILE *out)
+{
+	if (!timings_enabled || !out) {
+		return;
+	}
+	
+	fprintf(out, "\nTimings:\n");
+	fprintf(out, "  %-20s %7s %12s %12s %14s\n", "phase", "count", "total ms", "max ms",
+	        "child cpu ms");
+	for (size_t i = 0; i < phase_count; i++) {
+		const struct phase_total *total = &phase_totals[i];
+		fprintf(out, "  %-20s %7lu %12.1f %12.1f %14.1f\n", total->phase, total->count,
+		        total->total_ms, total->max_ms, total->child_cpu_ms);
+	}
+}
+
+/**
+ * @brief Get human-readable error message for cache trace error code
+ */
+const char* cache_trace_error_string(int error_code)
+{
+	switch (error_code) {
+		case CACHE_TRACE_SUCCESS:
+			return "Success";
+		case CACHE_TRACE_ERROR_INVALID:
+			return "Invalid argument";
+		case CACHE_TRACE_ERROR_IO:
+			return "Failed to open trace file";
+		default:
+			return "Unknown error";
+	}
+}
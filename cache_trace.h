@@ -0,0 +1,90 @@
+#ifndef CACHE_TRACE_H
+#define CACHE_TRACE_H
+
+/**
+ * @file cache_trace.h
+ * @brief Per-phase timing and machine-readable trace output for git-cache
+ *
+ * A span covers one phase of work (lock wait, cache clone, checkout, API
+ * request, ...). Each span records monotonic wall time and the CPU time of
+ * child processes (git) that finished while it was open.
+ *
+ * With GIT_CACHE_TRACE=<file> every finished span is appended to the file
+ * as one JSON line, written with a single write(2) so lines from parallel
+ * workers never interleave. With --timings a per-phase summary is printed
+ * when the command finishes. Spans do nothing when neither is on.
+ *
+ * Forked workers inherit the trace file but keep their own summary, so
+ * --timings only covers work done in the main process.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+/**
+ * @brief Environment variable naming the trace file
+ */
+#define CACHE_TRACE_ENV_VAR "GIT_CACHE_TRACE"
+
+/**
+ * @brief Distinct phase names kept for the --timings summary
+ */
+#define CACHE_TRACE_MAX_PHASES 32
+
+/**
+ * @brief Cache trace error codes
+ */
+#define CACHE_TRACE_SUCCESS         0
+#define CACHE_TRACE_ERROR_INVALID  -1
+#define CACHE_TRACE_ERROR_IO       -2
+
+/**
+ * @brief One timed phase; lives on the caller's stack
+ */
+struct cache_trace_span {
+	const char *phase;              /**< Phase name (static string) */
+	char detail[512];               /**< Repository, path or URL the phase worked on */
+	struct timespec start;          /**< CLOCK_MONOTONIC start */
+	struct rusage children_start;   /**< RUSAGE_CHILDREN at start */
+	int depth;                      /**< Nesting depth when started */
+	int active;                     /**< Tracing was on when started */
+};
+
+/**
+ * @brief Set up tracing from the command line and GIT_CACHE_TRACE
+ * @param timings Print a per-phase summary from cache_trace_report()
+ * @return CACHE_TRACE_SUCCESS, or CACHE_TRACE_ERROR_IO if the trace file cannot be opened
+ */
+int cache_trace_init(int timings);
+
+/**
+ * @brief Start a span
+ * @param span Span to start
+ * @param phase Phase name, e.g. "clone.cache" (must outlive the span)
+ * @param detail What the phase works on (may be NULL)
+ */
+void cache_trace_begin(struct cache_trace_span *span, const char *phase, const char *detail);
+
+/**
+ * @brief Finish a span, recording it in the summary and trace file
+ * @param span Span started with cache_trace_begin()
+ * @param result Result code of the phase
+ */
+void cache_trace_end(struct cache_trace_span *span, int result);
+
+/**
+ * @brief Print the per-phase summary if --timings was given
+ * @param out Output stream
+ */
+void cache_trace_report(FILE *out);
+
+/**
+ * @brief Get human-readable error message for cache trace error code
+ * @param error_code Cache trace error code
+ * @return Error message string
+ */
+const char* cache_trace_error_string(int error_code);
+
+#endif /* CACHE_TRACE_H */
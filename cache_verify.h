@@ -0,0 +1,131 @@
+#ifndef CACHE_VERIFY_H
+#define CACHE_VERIFY_H
+
+/**
+ * @file cache_verify.h
+ * @brief Incremental object verification of cached bare repositories
+ *
+ * A full git fsck re-hashes every object on every run, although packs never
+ * change once written. The first deep verification of a cache runs git fsck
+ * and records each pack's name, size, trailing checksum and verification
+ * time in git-cache-verify next to the cache metadata. Later passes only run
+ * git verify-pack on packs that are not recorded (or whose size or checksum
+ * changed) and re-hash loose objects written since the previous pass.
+ * Dropping the state with cache_verify_reset() makes the next pass a full
+ * git fsck again, including the connectivity check.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @brief Verification state file inside a cache repository
+ */
+#define CACHE_VERIFY_STATE_FILE "git-cache-verify"
+
+/**
+ * @brief Buffer size for a hex pack checksum (SHA-256 and a NUL)
+ */
+#define CACHE_VERIFY_CHECKSUM_SIZE 65
+
+/**
+ * @brief Cache verify error codes
+ */
+#define CACHE_VERIFY_SUCCESS          0
+#define CACHE_VERIFY_ERROR_INVALID   -1
+#define CACHE_VERIFY_ERROR_IO        -2
+#define CACHE_VERIFY_ERROR_MEMORY    -3
+#define CACHE_VERIFY_ERROR_CORRUPT   -4
+
+/**
+ * @brief Verification record of one pack
+ */
+struct cache_verify_pack {
+	char *name;                 /**< Pack file name in objects/pack */
+	uint64_t size;              /**< Pack size in bytes */
+	char checksum[CACHE_VERIFY_CHECKSUM_SIZE]; /**< Trailing pack checksum, hex */
+	time_t verified_time;       /**< When the pack passed verification */
+};
+
+/**
+ * @brief Verification state of a repository
+ */
+struct cache_verify_state {
+	struct cache_verify_pack *packs; /**< Verified packs */
+	size_t pack_count;          /**< Number of verified packs */
+	time_t loose_time;          /**< Loose objects older than this are verified */
+	time_t verified_time;       /**< Last completed pass (0 if never) */
+};
+
+/**
+ * @brief What a verification pass looked at
+ */
+struct cache_verify_result {
+	int full;                   /**< Ran a full git fsck */
+	size_t packs_checked;       /**< Packs verified in this pass */
+	size_t packs_skipped;       /**< Packs unchanged since they were verified */
+	size_t loose_checked;       /**< Loose objects re-hashed in this pass */
+};
+
+/**
+ * @brief Load the verification state of a repository
+ *
+ * A missing state file yields an empty state.
+ *
+ * @param repo_path Bare repository path
+ * @param state Output state, free with cache_verify_free_state()
+ * @return CACHE_VERIFY_SUCCESS on success, error code on failure
+ */
+int cache_verify_load_state(const char *repo_path, struct cache_verify_state *state);
+
+/**
+ * @brief Save the verification state of a repository
+ * @param repo_path Bare repository path
+ * @param state State to save
+ * @return CACHE_VERIFY_SUCCESS on success, error code on failure
+ */
+int cache_verify_save_state(const char *repo_path, const struct cache_verify_state *state);
+
+/**
+ * @brief Free the packs of a verification state
+ * @param state State to free
+ */
+void cache_verify_free_state(struct cache_verify_state *state);
+
+/**
+ * @brief Get the time of the last completed verification pass
+ * @param repo_path Bare repository path
+ * @return Time of the last pass, 0 if the repository was never verified
+ */
+time_t cache_verify_last_time(const char *repo_path);
+
+/**
+ * @brief Forget all verification results so the next pass is a full one
+ * @param repo_path Bare repository path
+ * @return CACHE_VERIFY_SUCCESS on success, error code on failure
+ */
+int cache_verify_reset(const char *repo_path);
+
+/**
+ * @brief Verify the objects of a repository added since the last pass
+ *
+ * Without a saved state this runs git fsck and records every pack. Packs
+ * and loose objects that pass are recorded even when others fail, so the
+ * next pass only looks at the failures and what is new.
+ *
+ * @param repo_path Bare repository path
+ * @param result Optional output describing the pass
+ * @return CACHE_VERIFY_SUCCESS if every checked object is intact,
+ *         CACHE_VERIFY_ERROR_CORRUPT if one is not, other error code on failure
+ */
+int cache_verify_objects(const char *repo_path, struct cache_verify_result *result);
+
+/**
+ * @brief Get human-readable error message for cache verify error code
+ * @param error_code Cache verify error code
+ * @return Error message string
+ */
+const char* cache_verify_error_string(int error_code);
+
+#endif /* CACHE_VERIFY_H */
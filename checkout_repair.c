@@ -21,6 +21,30 @@
 #include "checkout_repair.h"
 #include "cache_recovery.h"
 #include "cache_metadata.h"
+#include "cache_lock.h"
+#include "ref_tips.h"
+#include "cache_exec.h"
+
+/**
+ * @brief Run git in a checkout and return its exit status, -1 if it could not run
+ */
+static int run_checkout_git(const char *checkout_path, const char *const argv[],
+                            enum cache_exec_stream out, size_t *out_len)
+{
+	struct cache_exec_options options;
+	memset(&options, 0, sizeof(options));
+	options.cwd = checkout_path;
+	options.out = out;
+	options.err = out == CACHE_EXEC_INHERIT ? CACHE_EXEC_INHERIT : CACHE_EXEC_DISCARD;
+	
+	struct cache_exec_result result;
+	int ret = cache_exec_run(argv, &options, &result);
+	if (out_len) {
+		*out_len = result.out_len;
+	}
+	cache_exec_free_result(&result);
+	return ret == CACHE_EXEC_SUCCESS ? result.exit_code : -1;
+}
 
 /**
  * @brief Get modification time of a directory
@@ -75,7 +99,7 @@ int cache_newer_than_checkout(const char *checkout_path, const char *cache_path,
 /**
  * @brief Check if checkout needs repair due to cache updates
  */
-int checkout_needs_repair(const char *checkout_path, const char *cache_path, time_t last_cache_sync)
+int checkout_needs_repair(const char *checkout_path, const char *cache_path)
 {
 	if (!checkout_path || !cache_path) {
 		return CHECKOUT_REPAIR_INVALID_ARGS;
@@ -87,52 +111,51 @@ int checkout_needs_repair(const char *checkout_path, const char *cache_path, tim
 		return 1; /* Needs repair */
 	}
 	
-	/* Check if cache is newer than checkout */
-	time_t checkout_time, cache_time;
-	int newer = cache_newer_than_checkout(checkout_path, cache_path, &checkout_time, &cache_time);
-	if (newer < 0) {
-		return newer; /* Error */
+	/* Find the branch the checkout is on; detached checkouts are left alone */
+	char checkout_git[4096];
+	snprintf(checkout_git, sizeof(checkout_git), "%s/.git", checkout_path);
+	
+	char head_sha[REF_TIPS_HEX_MAX];
+	char branch_ref[1024];
+	if (ref_tips_resolve(checkout_git, "HEAD", head_sha, branch_ref, sizeof(branch_ref)) != REF_TIPS_SUCCESS ||
+	    strncmp(branch_ref, "refs/heads/", strlen("refs/heads/")) != 0) {
+		return 0;
 	}
+	const char *branch = branch_ref + strlen("refs/heads/");
 	
-	if (newer > 0) {
-		/* Cache has been updated after checkout was created */
-		return 1;
+	/* The cache holds upstream branches under the same name */
+	char cache_sha[REF_TIPS_HEX_MAX];
+	int ret = ref_tips_resolve(cache_path, branch_ref, cache_sha, NULL, 0);
+	if (ret == REF_TIPS_ERROR_NOT_FOUND) {
+		return 0;
+	} else if (ret != REF_TIPS_SUCCESS) {
+		return CHECKOUT_REPAIR_NO_CACHE;
 	}
 	
-	/* If we have last sync time, check if checkout is older */
-	if (last_cache_sync > 0 && checkout_time < last_cache_sync) {
-		return 1;
+	if (strcmp(head_sha, cache_sha) == 0) {
+		return 0; /* Already at the cache tip */
 	}
 	
-	/* Check if checkout has uncommitted changes */
-	char status_cmd[8192];
-	snprintf(status_cmd, sizeof(status_cmd), 
-	         "cd \"%s\" && git status --porcelain 2>/dev/null | grep -q '^'", 
-	         checkout_path);
+	/* Only move checkouts sitting on their upstream tip, never local commits */
+	char tracking_ref[1024 + 32];
+	char tracking_sha[REF_TIPS_HEX_MAX];
+	snprintf(tracking_ref, sizeof(tracking_ref), "refs/remotes/origin/%s", branch);
+	if (ref_tips_resolve(checkout_git, tracking_ref, tracking_sha, NULL, 0) != REF_TIPS_SUCCESS ||
+	    strcmp(head_sha, tracking_sha) != 0) {
+		return 0;
+	}
 	
-	int has_changes = system(status_cmd) == 0;
+	/* Check if checkout has uncommitted changes; only reached for stale checkouts */
+	static const char *const status_argv[] = { "git", "status", "--porcelain", NULL };
+	size_t status_len = 0;
+	int has_changes = run_checkout_git(checkout_path, status_argv, CACHE_EXEC_CAPTURE,
+	                                   &status_len) != 0 || status_len > 0;
 	if (has_changes) {
 		/* Has uncommitted changes, don't repair automatically */
 		return 0;
 	}
 	
-	/* Check if checkout is behind cache */
-	char behind_cmd[8192];
-	snprintf(behind_cmd, sizeof(behind_cmd),
-	         "cd \"%s\" && git rev-list HEAD..origin/HEAD --count 2>/dev/null",
-	         checkout_path);
-	
-	FILE *pipe = popen(behind_cmd, "r");
-	if (pipe) {
-		int behind_count = 0;
-		if (fscanf(pipe, "%d", &behind_count) == 1 && behind_count > 0) {
-			pclose(pipe);
-			return 1; /* Behind origin, needs update */
-		}
-		pclose(pipe);
-	}
-	
-	return 0; /* No repair needed */
+	return 1; /* Behind the cache, needs update */
 }
 
 /**
@@ -149,13 +172,8 @@ int update_checkout_from_cache(const char *checkout_path, const char *cache_path
 	}
 	
 	/* Fetch latest changes from cache */
-	char fetch_cmd[8192];
-	snprintf(fetch_cmd, sizeof(fetch_cmd),
-	         "cd \"%s\" && git fetch origin 2>&1",
-	         checkout_path);
-	
-	int fetch_result = system(fetch_cmd);
-	if (WEXITSTATUS(fetch_result) != 0) {
+	static const char *const fetch_argv[] = { "git", "fetch", "origin", NULL };
+	if (run_checkout_git(checkout_path, fetch_argv, CACHE_EXEC_INHERIT, NULL) != 0) {
 		if (verbose) {
 			printf("Failed to fetch from cache\n");
 		}
@@ -163,13 +181,8 @@ int update_checkout_from_cache(const char *checkout_path, const char *cache_path
 	}
 	
 	/* Reset to origin/HEAD */
-	char reset_cmd[8192];
-	snprintf(reset_cmd, sizeof(reset_cmd),
-	         "cd \"%s\" && git reset --hard origin/HEAD 2>&1",
-	         checkout_path);
-	
-	int reset_result = system(reset_cmd);
-	if (WEXITSTATUS(reset_result) != 0) {
+	static const char *const reset_argv[] = { "git", "reset", "--hard", "origin/HEAD", NULL };
+	if (run_checkout_git(checkout_path, reset_argv, CACHE_EXEC_INHERIT, NULL) != 0) {
 		if (verbose) {
 			printf("Failed to reset to origin/HEAD\n");
 		}
@@ -177,12 +190,8 @@ int update_checkout_from_cache(const char *checkout_path, const char *cache_path
 	}
 	
 	/* Clean untracked files */
-	char clean_cmd[8192];
-	snprintf(clean_cmd, sizeof(clean_cmd),
-	         "cd \"%s\" && git clean -fd 2>&1",
-	         checkout_path);
-	
-	if (system(clean_cmd) != 0) {
+	static const char *const clean_argv[] = { "git", "clean", "-fd", NULL };
+	if (run_checkout_git(checkout_path, clean_argv, CACHE_EXEC_INHERIT, NULL) != 0) {
 		if (verbose) {
 			printf("Warning: Failed to clean untracked files\n");
 		}
@@ -273,6 +282,36 @@ int validate_checkout_references(const char *checkout_path, const char *expected
 	return found_correct;
 }
 
+/**
+ * @brief Check and repair one checkout, locking it exclusively and the cache shared
+ * @return 1 if repaired, 0 if not needed or not repaired
+ */
+static int repair_checkout_if_needed(const char *checkout_path, const char *cache_path,
+	                                enum clone_strategy strategy, const char *kind, int verbose)
+{
+	if (cache_lock_acquire(cache_path, CACHE_LOCK_SHARED, CACHE_LOCK_TIMEOUT, verbose) != CACHE_LOCK_SUCCESS) {
+		return 0;
+	}
+	if (cache_lock_acquire(checkout_path, CACHE_LOCK_EXCLUSIVE, CACHE_LOCK_TIMEOUT, verbose) != CACHE_LOCK_SUCCESS) {
+		cache_lock_release(cache_path);
+		return 0;
+	}
+	
+	int repaired = 0;
+	if (checkout_needs_repair(checkout_path, cache_path) > 0) {
+		if (verbose) {
+			printf("Repairing %s checkout: %s\n", kind, checkout_path);
+		}
+		
+		repaired = repair_outdated_checkout(checkout_path, cache_path, strategy, verbose) ==
+		           CHECKOUT_REPAIR_SUCCESS;
+	}
+	
+	cache_lock_release(checkout_path);
+	cache_lock_release(cache_path);
+	return repaired;
+}
+
 /**
  * @brief Check and repair all checkouts for a repository
  */
@@ -284,51 +323,16 @@ int repair_all_checkouts_for_repo(struct repo_info *repo, const struct cache_con
 	
 	int repaired_count = 0;
 	
-	/* Get last sync time from metadata */
-	struct cache_metadata metadata;
-	time_t last_sync = 0;
-	if (cache_metadata_load(repo->cache_path, &metadata) == METADATA_SUCCESS) {
-		last_sync = metadata.last_sync_time;
-		
-		/* Clean up loaded metadata */
-		free(metadata.original_url);
-		free(metadata.fork_url);
-		free(metadata.owner);
-		free(metadata.name);
-		free(metadata.fork_organization);
-		free(metadata.default_branch);
-	}
-	
 	/* Check read-only checkout */
 	if (repo->checkout_path && access(repo->checkout_path, F_OK) == 0) {
-		int needs_repair = checkout_needs_repair(repo->checkout_path, repo->cache_path, last_sync);
-		if (needs_repair > 0) {
-			if (config->verbose) {
-				printf("Repairing read-only checkout: %s\n", repo->checkout_path);
-			}
-			
-			int result = repair_outdated_checkout(repo->checkout_path, repo->cache_path, 
-			                                     repo->strategy, config->verbose);
-			if (result == CHECKOUT_REPAIR_SUCCESS) {
-				repaired_count++;
-			}
-		}
+		repaired_count += repair_checkout_if_needed(repo->checkout_path, repo->cache_path,
+		                                            repo->strategy, "read-only", config->verbose);
 	}
 	
 	/* Check modifiable checkout */
 	if (repo->modifiable_path && access(repo->modifiable_path, F_OK) == 0) {
-		int needs_repair = checkout_needs_repair(repo->modifiable_path, repo->cache_path, last_sync);
-		if (needs_repair > 0) {
-			if (config->verbose) {
-				printf("Repairing modifiable checkout: %s\n", repo->modifiable_path);
-			}
-			
-			int result = repair_outdated_checkout(repo->modifiable_path, repo->cache_path, 
-			                                     repo->strategy, config->verbose);
-			if (result == CHECKOUT_REPAIR_SUCCESS) {
-				repaired_count++;
-			}
-		}
+		repaired_count += repair_checkout_if_needed(repo->modifiable_path, repo->cache_path,
+		                                            repo->strategy, "modifiable", config->verbose);
 	}
 	
 	return repaired_count;
@@ -421,6 +425,44 @@ int repair_all_outdated_checkouts(struct cache_config *config, int force_repair)
 	return data.repaired_count;
 }
 
+/**
+ * @brief Repair the checkouts of the given cache repositories only
+ */
+int repair_checkouts_for_caches(struct cache_config *config, const char *const *cache_paths, size_t count)
+{
+	if (!config || (!cache_paths && count > 0)) {
+		return CHECKOUT_REPAIR_INVALID_ARGS;
+	}
+	
+	struct repair_callback_data data = {
+		.config = config,
+		.force_repair = 0,
+		.repaired_count = 0,
+		.error_count = 0
+	};
+	
+	for (size_t i = 0; i < count; i++) {
+		struct cache_metadata metadata;
+		if (cache_metadata_load(cache_paths[i], &metadata) != METADATA_SUCCESS) {
+			data.error_count++;
+			continue;
+		}
+		
+		if (metadata.owner && metadata.name) {
+			repair_repo_callback(&metadata, &data);
+		}
+		
+		cache_metadata_clear(&metadata);
+	}
+	
+	if (config->verbose) {
+		printf("Checked %zu changed repositories, repaired %d checkouts, %d errors\n", 
+		       count, data.repaired_count, data.error_count);
+	}
+	
+	return data.repaired_count;
+}
+
 /**
  * @brief Detect orphaned checkouts (cache no longer exists)
  */
@@ -29,12 +29,17 @@ struct cache_metadata;
 
 /**
  * @brief Check if checkout needs repair due to cache updates
+ *
+ * A clean checkout needs an update when its branch tip, still equal to
+ * its origin tracking ref, differs from the same branch in the cache.
+ * Commit SHAs are read directly from the refs; git is only run to look
+ * for uncommitted changes once a checkout is known to be behind.
+ *
  * @param checkout_path Path to checkout directory
  * @param cache_path Path to cache repository
- * @param last_cache_sync Time when cache was last synchronized
  * @return 1 if repair needed, 0 if not needed, negative on error
  */
-int checkout_needs_repair(const char *checkout_path, const char *cache_path, time_t last_cache_sync);
+int checkout_needs_repair(const char *checkout_path, const char *cache_path);
 
 /**
  * @brief Repair a checkout that has become outdated
@@ -63,6 +68,19 @@ int repair_all_checkouts_for_repo(struct repo_info *repo, const struct cache_con
  */
 int repair_all_outdated_checkouts(struct cache_config *config, int force_repair);
 
+/**
+ * @brief Repair the checkouts of the given cache repositories only
+ *
+ * Used after a sync with the repositories whose ref tips moved, so
+ * checkouts of unchanged repositories are not examined at all.
+ *
+ * @param config Cache configuration
+ * @param cache_paths Cache repository paths
+ * @param count Number of paths
+ * @return Number of checkouts repaired, or negative error code
+ */
+int repair_checkouts_for_caches(struct cache_config *config, const char *const *cache_paths, size_t count);
+
 /**
  * @brief Check if checkout references are valid and point to correct cache
  * @param checkout_path Path to checkout directory
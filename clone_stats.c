@@ -0,0 +1,241 @@
+/**
+ * @file clone_stats.c
+ * @brief Recorded clone timings implementation
+ *
+ * The log is plain text, one record per line, so it can be inspected and
+ * trimmed by hand. Records are short enough to be written with a single
+ * O_APPEND write, which keeps concurrent writers from interleaving.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "clone_stats.h"
+
+/**
+ * @brief Strategy names used in the log, indexed by enum clone_strategy
+ */
+static const char *const strategy_names[CLONE_STATS_STRATEGIES] = {
+	"full", "shallow", "treeless", "blobless"
+};
+
+/**
+ * @brief Build the stats log path
+ */
+static int stats_path(const char *cache_root, char *path, size_t path_size)
+{
+	int len = snprintf(path, path_size, "%s/%s", cache_root, CLONE_STATS_FILE);
+	return len > 0 && (size_t)len < path_size ? 0 : -1;
+}
+
+/**
+ * @brief Append a record to the stats log
+ */
+int clone_stats_append(const char *cache_root, const struct clone_stats_record *record)
+{
+	if (!cache_root || !record || record->repo[0] == '\0' ||
+	    record->strategy < 0 || record->strategy >= CLONE_STATS_STRATEGIES ||
+	    strpbrk(record->repo, " \t\r\n")) {
+		return CLONE_STATS_ERROR_INVALID;
+	}
+	
+	char path[4096];
+	if (stats_path(cache_root, path, sizeof(path)) != 0) {
+		return CLONE_STATS_ERROR_INVALID;
+	}
+	
+	char line[512];
+	int len = snprintf(line, sizeof(line), "%lld %s %s %llu %llu %llu %llu %s\n",
+	                   (long long)record->recorded_at, record->repo,
+	                   strategy_names[record->strategy],
+	                   (unsigned long long)record->wall_ms,
+	                   (unsigned long long)record->bytes,
+	                   (unsigned long long)record->objects,
+	                   (unsigned long long)record->estimated_size,
+	                   record->success ? "ok" : "fail");
+	if (len <= 0 || (size_t)len >= sizeof(line)) {
+		return CLONE_STATS_ERROR_INVALID;
+	}
+	
+	int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if (fd < 0) {
+		return CLONE_STATS_ERROR_IO;
+	}
+	
+	ssize_t written = write(fd, line, (size_t)len);
+	int close_ret = close(fd);
+	
+	return written == len && close_ret == 0 ? CLONE_STATS_SUCCESS : CLONE_STATS_ERROR_IO;
+}
+
+/**
+ * @brief Parse one log line
+ */
+static int parse_record(const char *line, struct clone_stats_record *record)
+{
+	long long recorded_at;
+	char strategy[16];
+	char result[8];
+	unsigned long long wall_ms, bytes, objects, estimated_size;
+	
+	memset(record, 0, sizeof(*record));
+	if (sscanf(line, "%lld %255s %15s %llu %llu %llu %llu %7s", &recorded_at, record->repo,
+	           strategy, &wall_ms, &bytes, &objects, &estimated_size, result) != 8) {
+		return -1;
+	}
+	
+	int found = -1;
+	for (int i = 0; i < CLONE_STATS_STRATEGIES; i++) {
+		if (strcmp(strategy, strategy_names[i]) == 0) {
+			found = i;
+		}
+	}
+	if (found < 0) {
+		return -1;
+	}
+	
+	record->recorded_at = (time_t)recorded_at;
+	record->strategy = (enum clone_strategy)found;
+	record->wall_ms = wall_ms;
+	record->bytes = bytes;
+	record->objects = objects;
+	record->estimated_size = estimated_size;
+	record->success = strcmp(result, "ok") == 0;
+	return 0;
+}
+
+/**
+ * @brief Load the most recent records from the stats log
+ */
+int clone_stats_load(const char *cache_root, struct clone_stats_record **records, size_t *count)
+{
+	if (!cache_root || !records || !count) {
+		return CLONE_STATS_ERROR_INVALID;
+	}
+	
+	*records = NULL;
+	*count = 0;
+	
+	char path[4096];
+	if (stats_path(cache_root, path, sizeof(path)) != 0) {
+		return CLONE_STATS_ERROR_INVALID;
+	}
+	
+	FILE *fp = fopen(path, "r");
+	if (!fp) {
+		return errno == ENOENT ? CLONE_STATS_SUCCESS : CLONE_STATS_ERROR_IO;
+	}
+	
+	struct clone_stats_record *ring = malloc(CLONE_STATS_MAX_RECORDS * sizeof(*ring));
+	if (!ring) {
+		fclose(fp);
+		return CLONE_STATS_ERROR_MEMORY;
+	}
+	
+	/* Keep the newest CLONE_STATS_MAX_RECORDS entries */
+	size_t total = 0;
+	char line[512];
+	while (fgets(line, sizeof(line), fp)) {
+		if (line[0] == '#' || parse_record(line, &ring[total % CLONE_STATS_MAX_RECORDS]) != 0) {
+			continue;
+		}
+		total++;
+	}
+	fclose(fp);
+	
+	size_t kept = total < CLONE_STATS_MAX_RECORDS ? total : CLONE_STATS_MAX_RECORDS;
+	if (total > CLONE_STATS_MAX_RECORDS) {
+		/* Rotate so records are oldest first */
+		struct clone_stats_record *ordered = malloc(kept * sizeof(*ordered));
+		if (!ordered) {
+			free(ring);
+			return CLONE_STATS_ERROR_MEMORY;
+		}
+		size_t start = total % CLONE_STATS_MAX_RECORDS;
+		memcpy(ordered, ring + start, (kept - start) * sizeof(*ordered));
+		memcpy(ordered + (kept - start), ring, start * sizeof(*ordered));
+		free(ring);
+		ring = ordered;
+	}
+	
+	*records = ring;
+	*count = kept;
+	return CLONE_STATS_SUCCESS;
+}
+
+/**
+ * @brief Estimate the time to a usable checkout for each strategy
+ */
+void clone_stats_estimate(const struct clone_stats_record *records, size_t count,
+                          const char *repo, uint64_t estimated_size,
+                          struct clone_stats_estimate estimates[CLONE_STATS_STRATEGIES])
+{
+	double weight_ok[CLONE_STATS_STRATEGIES] = { 0 };
+	double weight_all[CLONE_STATS_STRATEGIES] = { 0 };
+	double weighted_ms[CLONE_STATS_STRATEGIES] = { 0 };
+	
+	for (size_t i = 0; records && i < count; i++) {
+		const struct clone_stats_record *record = &records[i];
+		if (record->strategy < 0 || record->strategy >= CLONE_STATS_STRATEGIES) {
+			continue;
+		}
+	
+		double weight;
+		double ms = (double)record->wall_ms;
+		if (repo && strcmp(record->repo, repo) == 0) {
+			weight = 1.0;
+		} else if (estimated_size > 0 && record->estimated_size > 0) {
+			double ratio = (double)estimated_size / (double)record->estimated_size;
+			if (ratio < 0.5 || ratio > 2.0) {
+				continue;
+			}
+			weight = 0.5;
+			ms *= ratio;
+		} else {
+			continue;
+		}
+	
+		weight_all[record->strategy] += weight;
+		if (record->success) {
+			weight_ok[record->strategy] += weight;
+			weighted_ms[record->strategy] += weight * ms;
+		}
+	}
+	
+	/* Strategies that never succeeded get no observations */
+	for (int s = 0; s < CLONE_STATS_STRATEGIES; s++) {
+		if (weight_ok[s] <= 0) {
+			estimates[s].expected_ms = 0;
+			estimates[s].observations = 0;
+			continue;
+		}
+		double mean_ms = weighted_ms[s] / weight_ok[s];
+		double success_rate = weight_ok[s] / weight_all[s];
+		estimates[s].expected_ms = mean_ms / success_rate;
+		estimates[s].observations = weight_all[s];
+	}
+}
+
+/**
+ * @brief Get human-readable error message for clone stats error code
+ */
+const char* clone_stats_error_string(int error_code)
+{
+	switch (error_code) {
+		case CLONE_STATS_SUCCESS:
+			return "Success";
+		case CLONE_STATS_ERROR_INVALID:
+			return "Invalid argument";
+		case CLONE_STATS_ERROR_IO:
+			return "I/O error";
+		case CLONE_STATS_ERROR_MEMORY:
+			return "Memory allocation failed";
+		default:
+			return "Unknown error";
+	}
+}
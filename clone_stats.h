@@ -0,0 +1,109 @@
+#ifndef CLONE_STATS_H
+#define CLONE_STATS_H
+
+/**
+ * @file clone_stats.h
+ * @brief Recorded clone timings for git-cache strategy selection
+ *
+ * Every fresh clone appends one line to an append-only log under the
+ * cache root: repository, strategy, wall time until the checkout was
+ * usable, bytes and objects received and the size estimate the strategy
+ * was chosen from. The history is used to predict which strategy gets a
+ * usable checkout fastest for a repository, or for repositories of a
+ * similar size.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "git-cache.h"
+
+/**
+ * @brief Stats log file name (relative to cache root)
+ */
+#define CLONE_STATS_FILE "clone_stats.log"
+
+/**
+ * @brief Most recent records considered when loading the log
+ */
+#define CLONE_STATS_MAX_RECORDS 4096
+
+/**
+ * @brief Number of concrete clone strategies (excludes CLONE_STRATEGY_AUTO)
+ */
+#define CLONE_STATS_STRATEGIES 4
+
+/**
+ * @brief Clone stats error codes
+ */
+#define CLONE_STATS_SUCCESS        0
+#define CLONE_STATS_ERROR_INVALID -1
+#define CLONE_STATS_ERROR_IO      -2
+#define CLONE_STATS_ERROR_MEMORY  -3
+
+/**
+ * @brief One recorded clone
+ */
+struct clone_stats_record {
+	time_t recorded_at;         /**< When the clone finished */
+	char repo[256];             /**< Repository as owner/name */
+	enum clone_strategy strategy; /**< Strategy used */
+	uint64_t wall_ms;           /**< Time until the checkout was usable */
+	uint64_t bytes;             /**< Object bytes received */
+	uint64_t objects;           /**< Objects received */
+	uint64_t estimated_size;    /**< Size estimate at decision time, 0 if unknown */
+	int success;                /**< Whether the clone succeeded */
+};
+
+/**
+ * @brief Expected cost of one strategy derived from the history
+ */
+struct clone_stats_estimate {
+	double expected_ms;         /**< Expected time to a usable checkout */
+	double observations;        /**< Weighted number of observations behind it */
+};
+
+/**
+ * @brief Append a record to the stats log
+ * @param cache_root Cache root directory
+ * @param record Record to append
+ * @return CLONE_STATS_SUCCESS on success, error code on failure
+ */
+int clone_stats_append(const char *cache_root, const struct clone_stats_record *record);
+
+/**
+ * @brief Load the most recent records from the stats log
+ * @param cache_root Cache root directory
+ * @param records Output array, free with free()
+ * @param count Output number of records
+ * @return CLONE_STATS_SUCCESS on success (empty if no log exists), error code on failure
+ */
+int clone_stats_load(const char *cache_root, struct clone_stats_record **records, size_t *count);
+
+/**
+ * @brief Estimate the time to a usable checkout for each strategy
+ *
+ * Successful clones of the same repository count fully. Clones of other
+ * repositories within a factor of two in estimated size count half and
+ * are scaled linearly by size. Failures raise the expected time of the
+ * strategy in proportion to its failure rate.
+ *
+ * @param records History records
+ * @param count Number of records
+ * @param repo Repository as owner/name (may be NULL)
+ * @param estimated_size Size estimate of the repository, 0 if unknown
+ * @param estimates Output, indexed by enum clone_strategy
+ */
+void clone_stats_estimate(const struct clone_stats_record *records, size_t count,
+                          const char *repo, uint64_t estimated_size,
+                          struct clone_stats_estimate estimates[CLONE_STATS_STRATEGIES]);
+
+/**
+ * @brief Get human-readable error message for clone stats error code
+ * @param error_code Clone stats error code
+ * @return Error message string
+ */
+const char* clone_stats_error_string(int error_code);
+
+#endif /* CLONE_STATS_H */
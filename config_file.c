@@ -16,13 +16,65 @@
 #include <ctype.h>
 #include <limits.h>
 #include <pwd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <time.h>
 
 #include "git-cache.h"
 #include "config_file.h"
+#include "cache_gc.h"
 
 /* Global configuration storage */
 static struct config_file global_config = {0};
 
+/* Most configuration sources load_configuration() reads */
+#define CONFIG_MAX_SOURCES 4
+
+/* Snapshot file identification */
+#define CONFIG_SNAPSHOT_MAGIC "GCCONF1"
+
+/**
+ * @brief A configuration file the snapshot was built from
+ */
+struct config_source {
+	char path[PATH_MAX];
+	int present;
+	struct stat st;
+};
+
+/**
+ * @brief Snapshot file header, followed by sources, entries and the string table
+ */
+struct config_snapshot_header {
+	char magic[8];
+	uint32_t source_count;
+	uint32_t entry_count;
+	uint32_t strings_size;
+	uint32_t reserved;
+};
+
+/**
+ * @brief Source file state a snapshot is valid for
+ */
+struct config_snapshot_source {
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+	int64_t size;
+	uint64_t inode;
+	uint32_t path_offset;
+	uint32_t present;
+};
+
+/**
+ * @brief One merged entry; offsets point into the string table
+ */
+struct config_snapshot_entry {
+	uint32_t section_offset;
+	uint32_t key_offset;
+	uint32_t value_offset;
+	uint32_t has_section;
+};
+
 /**
  * @brief Get user's home directory
  */
@@ -237,6 +289,7 @@ static int add_config_entry(struct config_entry **entries, const char *section,
 	entry->key = strdup(key);
 	entry->value = strdup(value);
 	entry->next = *entries;
+	entry->hash_next = NULL;
 	
 	if (!entry->key || !entry->value || (section && !entry->section)) {
 		free(entry->section);
@@ -250,6 +303,117 @@ static int add_config_entry(struct config_entry **entries, const char *section,
 	return CONFIG_SUCCESS;
 }
 
+/**
+ * @brief Hash a section/key pair with FNV-1a
+ */
+static uint64_t config_hash(const char *section, const char *key)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	
+	/* No section must not collide with an empty [] section */
+	const unsigned char *p = (const unsigned char *)(section ? section : "\x01");
+	while (*p) {
+		hash = (hash ^ *p++) * 1099511628211ULL;
+	}
+	hash *= 1099511628211ULL; /* NUL separator */
+	for (p = (const unsigned char *)key; *p; p++) {
+		hash = (hash ^ *p) * 1099511628211ULL;
+	}
+	
+	return hash;
+}
+
+/**
+ * @brief Check whether an entry belongs to a section (NULL only matches NULL)
+ */
+static int section_matches(const struct config_entry *entry, const char *section)
+{
+	return (!section && !entry->section) ||
+	       (section && entry->section && strcmp(section, entry->section) == 0);
+}
+
+/**
+ * @brief Look up an entry in a configuration's hash table
+ */
+static struct config_entry* config_table_find(const struct config_file *config_file,
+	                                          const char *section, const char *key)
+{
+	if (!config_file->buckets || !key) {
+		return NULL;
+	}
+	
+	size_t bucket = config_hash(section, key) & (config_file->bucket_count - 1);
+	struct config_entry *entry = config_file->buckets[bucket];
+	while (entry) {
+		if (section_matches(entry, section) && strcmp(key, entry->key) == 0) {
+			return entry;
+		}
+		entry = entry->hash_next;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Double the hash table (or create it) and rehash every entry
+ */
+static int config_table_grow(struct config_file *config_file)
+{
+	size_t bucket_count = config_file->bucket_count ? config_file->bucket_count * 2 : 32;
+	struct config_entry **buckets = calloc(bucket_count, sizeof(*buckets));
+	if (!buckets) {
+		return CONFIG_ERROR_MEMORY;
+	}
+	
+	for (struct config_entry *entry = config_file->entries; entry; entry = entry->next) {
+		size_t bucket = config_hash(entry->section, entry->key) & (bucket_count - 1);
+		entry->hash_next = buckets[bucket];
+		buckets[bucket] = entry;
+	}
+	
+	free(config_file->buckets);
+	config_file->buckets = buckets;
+	config_file->bucket_count = bucket_count;
+	return CONFIG_SUCCESS;
+}
+
+/**
+ * @brief Insert an entry into a configuration, replacing the value of an existing one
+ */
+static int config_table_put(struct config_file *config_file, const char *section,
+	                        const char *key, const char *value)
+{
+	struct config_entry *entry = config_table_find(config_file, section, key);
+	if (entry) {
+		char *new_value = strdup(value);
+		if (!new_value) {
+			return CONFIG_ERROR_MEMORY;
+		}
+		free(entry->value);
+		entry->value = new_value;
+		return CONFIG_SUCCESS;
+	}
+	
+	/* Keep the load factor below 3/4 */
+	if ((config_file->entry_count + 1) * 4 > config_file->bucket_count * 3) {
+		int ret = config_table_grow(config_file);
+		if (ret != CONFIG_SUCCESS) {
+			return ret;
+		}
+	}
+	
+	int ret = add_config_entry(&config_file->entries, section, key, value);
+	if (ret != CONFIG_SUCCESS) {
+		return ret;
+	}
+	
+	entry = config_file->entries;
+	size_t bucket = config_hash(section, key) & (config_file->bucket_count - 1);
+	entry->hash_next = config_file->buckets[bucket];
+	config_file->buckets[bucket] = entry;
+	config_file->entry_count++;
+	return CONFIG_SUCCESS;
+}
+
 /**
  * @brief Parse configuration file content
  */
@@ -306,14 +470,10 @@ int parse_config_content(const char *content, struct config_file *config_file)
 }
 
 /**
- * @brief Load configuration from specific file
+ * @brief Read and parse a configuration file
  */
-int load_config_file(const char *file_path, struct cache_config *config)
+static int read_config_file(const char *file_path, struct config_file *parsed_config)
 {
-	if (!file_path || !config) {
-		return CONFIG_ERROR_INVALID;
-	}
-	
 	if (!config_file_exists(file_path)) {
 		return CONFIG_ERROR_NOT_FOUND;
 	}
@@ -345,10 +505,23 @@ int load_config_file(const char *file_path, struct cache_config *config)
 	fclose(file);
 	
 	/* Parse content */
+	int ret = parse_config_content(content, parsed_config);
+	free(content);
+	return ret;
+}
+
+/**
+ * @brief Load configuration from specific file
+ */
+int load_config_file(const char *file_path, struct cache_config *config)
+{
+	if (!file_path || !config) {
+		return CONFIG_ERROR_INVALID;
+	}
+	
 	struct config_file parsed_config = {0};
-	int ret = parse_config_content(content, &parsed_config);
+	int ret = read_config_file(file_path, &parsed_config);
 	if (ret != CONFIG_SUCCESS) {
-		free(content);
 		return ret;
 	}
 	
@@ -356,11 +529,23 @@ int load_config_file(const char *file_path, struct cache_config *config)
 	ret = apply_config_entries(parsed_config.entries, config);
 	
 	cleanup_config_entries(parsed_config.entries);
-	free(content);
 	
 	return ret;
 }
 
+/**
+ * @brief Parse a size entry such as "20G", keeping the old value if invalid
+ */
+static void apply_size_entry(const struct config_entry *entry, uint64_t *bytes)
+{
+	uint64_t value;
+	if (cache_gc_parse_size(entry->value, &value) != CACHE_GC_SUCCESS) {
+		fprintf(stderr, "warning: ignoring invalid %s '%s'\n", entry->key, entry->value);
+		return;
+	}
+	*bytes = value;
+}
+
 /**
  * @brief Apply configuration entries to cache config
  */
@@ -398,6 +583,10 @@ int apply_config_entries(struct config_entry *entries, struct cache_config *conf
 			} else if (strcmp(entry->key, "force") == 0) {
 				config->force = (strcmp(entry->value, "true") == 0 || 
 				                strcmp(entry->value, "1") == 0);
+			} else if (strcmp(entry->key, "max_cache_size") == 0) {
+				apply_size_entry(entry, &config->max_cache_size);
+			} else if (strcmp(entry->key, "min_free_space") == 0) {
+				apply_size_entry(entry, &config->min_free_space);
 			}
 		}
 		
@@ -418,6 +607,33 @@ int apply_config_entries(struct config_entry *entries, struct cache_config *conf
 			} else if (strcmp(entry->key, "recursive_submodules") == 0) {
 				config->recursive_submodules = (strcmp(entry->value, "true") == 0 || 
 				                               strcmp(entry->value, "1") == 0);
+			} else if (strcmp(entry->key, "local_checkout") == 0) {
+				config->local_checkout = (strcmp(entry->value, "true") == 0 || 
+				                         strcmp(entry->value, "1") == 0);
+			} else if (strcmp(entry->key, "fresh_ttl") == 0) {
+				int ttl = atoi(entry->value);
+				config->fresh_ttl = ttl > 0 ? ttl : 0;
+			} else if (strcmp(entry->key, "stale_while_revalidate") == 0) {
+				config->stale_while_revalidate = (strcmp(entry->value, "true") == 0 || 
+				                                 strcmp(entry->value, "1") == 0);
+			} else if (strcmp(entry->key, "ref_filter") == 0) {
+				if (config->ref_filter) {
+					free(config->ref_filter);
+					config->ref_filter = NULL;
+				}
+				config->ref_filter = strdup(entry->value);
+				if (!config->ref_filter) {
+					return CONFIG_ERROR_MEMORY;
+				}
+			} else if (strcmp(entry->key, "peer") == 0) {
+				if (config->peer_url) {
+					free(config->peer_url);
+					config->peer_url = NULL;
+				}
+				config->peer_url = strdup(entry->value);
+				if (!config->peer_url) {
+					return CONFIG_ERROR_MEMORY;
+				}
 			}
 		}
 		
@@ -442,49 +658,335 @@ int apply_config_entries(struct config_entry *entries, struct cache_config *conf
 }
 
 /**
- * @brief Load configuration from all available sources
+ * @brief Get the path of the parsed configuration cache
  */
-int load_configuration(struct cache_config *config)
+int get_config_snapshot_path(char *path, size_t path_size)
 {
-	if (!config) {
+	if (!path || path_size == 0) {
 		return CONFIG_ERROR_INVALID;
 	}
 	
-	int loaded_count = 0;
+	int ret;
+	const char *cache_home = getenv("XDG_CACHE_HOME");
+	if (cache_home && cache_home[0] == '/') {
+		ret = snprintf(path, path_size, "%s/%s", cache_home, CONFIG_SNAPSHOT_FILE);
+	} else {
+		const char *home = get_home_directory();
+		if (!home) {
+			return CONFIG_ERROR_NOT_FOUND;
+		}
+		ret = snprintf(path, path_size, "%s/.cache/%s", home, CONFIG_SNAPSHOT_FILE);
+	}
 	
-	/* Load system configuration */
-	if (config_file_exists(CONFIG_SYSTEM_PATH)) {
-		if (load_config_file(CONFIG_SYSTEM_PATH, config) == CONFIG_SUCCESS) {
-			loaded_count++;
+	if (ret < 0 || (size_t)ret >= path_size) {
+		return CONFIG_ERROR_INVALID;
+	}
+	return CONFIG_SUCCESS;
+}
+
+/**
+ * @brief Add a configuration source, made absolute so the snapshot does not depend on cwd
+ */
+static void add_config_source(struct config_source *sources, size_t *count, const char *path)
+{
+	struct config_source *source = &sources[*count];
+	int ret;
+	
+	if (path[0] == '/') {
+		ret = snprintf(source->path, sizeof(source->path), "%s", path);
+	} else {
+		char cwd[PATH_MAX];
+		if (!getcwd(cwd, sizeof(cwd))) {
+			return;
 		}
+		ret = snprintf(source->path, sizeof(source->path), "%s/%s", cwd, path);
+	}
+	if (ret < 0 || (size_t)ret >= sizeof(source->path)) {
+		return;
 	}
 	
-	/* Load user configuration */
-	char user_config_path[PATH_MAX];
-	if (get_user_config_path(user_config_path, sizeof(user_config_path)) == CONFIG_SUCCESS) {
-		if (config_file_exists(user_config_path)) {
-			if (load_config_file(user_config_path, config) == CONFIG_SUCCESS) {
-				loaded_count++;
-			}
+	source->present = stat(source->path, &source->st) == 0 && S_ISREG(source->st.st_mode);
+	(*count)++;
+}
+
+/**
+ * @brief List the configuration files in order of precedence, lowest first
+ */
+static size_t collect_config_sources(struct config_source *sources)
+{
+	size_t count = 0;
+	char path[PATH_MAX];
+	
+	add_config_source(sources, &count, CONFIG_SYSTEM_PATH);
+	if (get_user_config_path(path, sizeof(path)) == CONFIG_SUCCESS) {
+		add_config_source(sources, &count, path);
+	}
+	if (get_local_config_path(path, sizeof(path)) == CONFIG_SUCCESS) {
+		add_config_source(sources, &count, path);
+	}
+	
+	const char *env_config = getenv(CONFIG_ENV_VAR);
+	if (env_config && env_config[0] != '\0') {
+		add_config_source(sources, &count, env_config);
+	}
+	
+	return count;
+}
+
+/**
+ * @brief Check a snapshot source record against the file as it is now
+ */
+static int source_unchanged(const struct config_snapshot_source *record, const char *path,
+	                        const struct config_source *source)
+{
+	if (strcmp(path, source->path) != 0 || (int)record->present != source->present) {
+		return 0;
+	}
+	if (!source->present) {
+		return 1;
+	}
+	
+	return record->mtime_sec == (int64_t)source->st.st_mtim.tv_sec &&
+	       record->mtime_nsec == (int64_t)source->st.st_mtim.tv_nsec &&
+	       record->size == (int64_t)source->st.st_size &&
+	       record->inode == (uint64_t)source->st.st_ino;
+}
+
+/**
+ * @brief Load the merged entries from the snapshot if every source is unchanged
+ * @return CONFIG_SUCCESS if loaded, CONFIG_ERROR_NOT_FOUND if missing or stale
+ */
+static int load_config_snapshot(const struct config_source *sources, size_t source_count,
+	                            struct config_file *merged)
+{
+	char path[PATH_MAX];
+	if (get_config_snapshot_path(path, sizeof(path)) != CONFIG_SUCCESS) {
+		return CONFIG_ERROR_NOT_FOUND;
+	}
+	
+	FILE *file = fopen(path, "rb");
+	if (!file) {
+		return CONFIG_ERROR_NOT_FOUND;
+	}
+	
+	struct config_snapshot_header header;
+	if (fread(&header, sizeof(header), 1, file) != 1 ||
+	    memcmp(header.magic, CONFIG_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+	    header.source_count != source_count || header.entry_count > 65536 ||
+	    header.strings_size == 0 || header.strings_size > 1024 * 1024) {
+		fclose(file);
+		return CONFIG_ERROR_NOT_FOUND;
+	}
+	
+	size_t body_size = header.source_count * sizeof(struct config_snapshot_source) +
+	                   header.entry_count * sizeof(struct config_snapshot_entry) +
+	                   header.strings_size;
+	char *body = malloc(body_size);
+	if (!body) {
+		fclose(file);
+		return CONFIG_ERROR_MEMORY;
+	}
+	
+	/* Anything but exactly the expected size is a stale or torn file */
+	int ok = fread(body, 1, body_size, file) == body_size && fgetc(file) == EOF;
+	fclose(file);
+	
+	const struct config_snapshot_source *records = (const struct config_snapshot_source *)body;
+	const struct config_snapshot_entry *entries =
+		(const struct config_snapshot_entry *)(records + header.source_count);
+	const char *strings = (const char *)(entries + header.entry_count);
+	ok = ok && strings[header.strings_size - 1] == '\0';
+	
+	for (uint32_t i = 0; ok && i < header.source_count; i++) {
+		ok = records[i].path_offset < header.strings_size &&
+		     source_unchanged(&records[i], strings + records[i].path_offset, &sources[i]);
+	}
+	for (uint32_t i = 0; ok && i < header.entry_count; i++) {
+		ok = entries[i].section_offset < header.strings_size &&
+		     entries[i].key_offset < header.strings_size &&
+		     entries[i].value_offset < header.strings_size;
+	}
+	
+	int ret = ok ? CONFIG_SUCCESS : CONFIG_ERROR_NOT_FOUND;
+	for (uint32_t i = 0; ret == CONFIG_SUCCESS && i < header.entry_count; i++) {
+		const char *section = entries[i].has_section ? strings + entries[i].section_offset : NULL;
+		ret = config_table_put(merged, section, strings + entries[i].key_offset,
+		                       strings + entries[i].value_offset);
+	}
+	
+	free(body);
+	return ret;
+}
+
+/**
+ * @brief Append a string to the snapshot string table
+ */
+static uint32_t add_snapshot_string(char *strings, size_t *used, const char *str)
+{
+	uint32_t offset = (uint32_t)*used;
+	size_t len = strlen(str) + 1;
+	memcpy(strings + *used, str, len);
+	*used += len;
+	return offset;
+}
+
+/**
+ * @brief Create parent directories of a file, ignoring ones that exist
+ */
+static void make_parent_directories(const char *path)
+{
+	char dir[PATH_MAX];
+	snprintf(dir, sizeof(dir), "%s", path);
+	for (char *slash = strchr(dir + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+		*slash = '\0';
+		mkdir(dir, 0700);
+		*slash = '/';
+	}
+}
+
+/**
+ * @brief Write the merged entries and the state of their sources to the snapshot
+ *
+ * A source modified within the last second could change again without its
+ * mtime moving, so no snapshot is written until it has settled.
+ */
+static void save_config_snapshot(const struct config_source *sources, size_t source_count,
+	                             const struct config_file *merged)
+{
+	time_t now = time(NULL);
+	for (size_t i = 0; i < source_count; i++) {
+		if (sources[i].present && sources[i].st.st_mtim.tv_sec >= now - 1) {
+			return;
 		}
 	}
 	
-	/* Load local configuration */
-	char local_config_path[PATH_MAX];
-	if (get_local_config_path(local_config_path, sizeof(local_config_path)) == CONFIG_SUCCESS) {
-		if (config_file_exists(local_config_path)) {
-			if (load_config_file(local_config_path, config) == CONFIG_SUCCESS) {
-				loaded_count++;
-			}
+	char path[PATH_MAX];
+	char temp_path[PATH_MAX + 32];
+	if (get_config_snapshot_path(path, sizeof(path)) != CONFIG_SUCCESS) {
+		return;
+	}
+	snprintf(temp_path, sizeof(temp_path), "%s.tmp.%ld", path, (long)getpid());
+	
+	size_t strings_size = 0;
+	for (size_t i = 0; i < source_count; i++) {
+		strings_size += strlen(sources[i].path) + 1;
+	}
+	for (const struct config_entry *entry = merged->entries; entry; entry = entry->next) {
+		strings_size += (entry->section ? strlen(entry->section) + 1 : 0) +
+		                strlen(entry->key) + 1 + strlen(entry->value) + 1;
+	}
+	strings_size++;
+	
+	struct config_snapshot_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CONFIG_SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.source_count = (uint32_t)source_count;
+	header.entry_count = (uint32_t)merged->entry_count;
+	header.strings_size = (uint32_t)strings_size;
+	
+	size_t body_size = source_count * sizeof(struct config_snapshot_source) +
+	                   merged->entry_count * sizeof(struct config_snapshot_entry) + strings_size;
+	char *body = calloc(1, body_size);
+	if (!body) {
+		return;
+	}
+	
+	struct config_snapshot_source *records = (struct config_snapshot_source *)body;
+	struct config_snapshot_entry *entries = (struct config_snapshot_entry *)(records + source_count);
+	char *strings = (char *)(entries + merged->entry_count);
+	size_t used = 0;
+	
+	/* Offset 0 is the empty string, used for entries without a section */
+	strings[used++] = '\0';
+	for (size_t i = 0; i < source_count; i++) {
+		records[i].path_offset = add_snapshot_string(strings, &used, sources[i].path);
+		records[i].present = (uint32_t)sources[i].present;
+		if (sources[i].present) {
+			records[i].mtime_sec = (int64_t)sources[i].st.st_mtim.tv_sec;
+			records[i].mtime_nsec = (int64_t)sources[i].st.st_mtim.tv_nsec;
+			records[i].size = (int64_t)sources[i].st.st_size;
+			records[i].inode = (uint64_t)sources[i].st.st_ino;
 		}
 	}
+	size_t count = 0;
+	for (const struct config_entry *entry = merged->entries; entry; entry = entry->next, count++) {
+		entries[count].has_section = entry->section != NULL;
+		entries[count].section_offset = entry->section ?
+			add_snapshot_string(strings, &used, entry->section) : 0;
+		entries[count].key_offset = add_snapshot_string(strings, &used, entry->key);
+		entries[count].value_offset = add_snapshot_string(strings, &used, entry->value);
+	}
 	
-	/* Load from environment variable */
-	const char *env_config = getenv(CONFIG_ENV_VAR);
-	if (env_config && config_file_exists(env_config)) {
-		if (load_config_file(env_config, config) == CONFIG_SUCCESS) {
-			loaded_count++;
+	/* The token may be in here: readable by the user only */
+	make_parent_directories(path);
+	int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		free(body);
+		return;
+	}
+	
+	int ok = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+	         write(fd, body, body_size) == (ssize_t)body_size;
+	ok = close(fd) == 0 && ok;
+	free(body);
+	
+	if (!ok || rename(temp_path, path) != 0) {
+		unlink(temp_path);
+	}
+}
+
+/**
+ * @brief Merge a configuration file into the snapshot, its entries overriding earlier ones
+ */
+static int merge_config_file(const char *file_path, struct config_file *merged)
+{
+	struct config_file parsed_config = {0};
+	int ret = read_config_file(file_path, &parsed_config);
+	if (ret != CONFIG_SUCCESS) {
+		return ret;
+	}
+	
+	for (const struct config_entry *entry = parsed_config.entries;
+	     entry && ret == CONFIG_SUCCESS; entry = entry->next) {
+		ret = config_table_put(merged, entry->section, entry->key, entry->value);
+	}
+	
+	cleanup_config_entries(parsed_config.entries);
+	return ret;
+}
+
+/**
+ * @brief Load configuration from all available sources
+ */
+int load_configuration(struct cache_config *config)
+{
+	if (!config) {
+		return CONFIG_ERROR_INVALID;
+	}
+	
+	struct config_source sources[CONFIG_MAX_SOURCES];
+	size_t source_count = collect_config_sources(sources);
+	
+	int loaded_count = 0;
+	for (size_t i = 0; i < source_count; i++) {
+		loaded_count += sources[i].present;
+	}
+	
+	/* Parse the files only when one changed since the snapshot was written */
+	cleanup_config_file(&global_config);
+	if (load_config_snapshot(sources, source_count, &global_config) != CONFIG_SUCCESS) {
+		cleanup_config_file(&global_config);
+		for (size_t i = 0; i < source_count; i++) {
+			if (sources[i].present) {
+				merge_config_file(sources[i].path, &global_config);
+			}
 		}
+		save_config_snapshot(sources, source_count, &global_config);
+	}
+	
+	int ret = apply_config_entries(global_config.entries, config);
+	if (ret != CONFIG_SUCCESS) {
+		return ret;
 	}
 	
 	return loaded_count > 0 ? CONFIG_SUCCESS : CONFIG_ERROR_NOT_FOUND;
@@ -518,6 +1020,12 @@ int create_default_config(const char *file_path)
 	fprintf(file, "# Enable verbose output by default\n");
 	fprintf(file, "# verbose = false\n");
 	fprintf(file, "\n");
+	fprintf(file, "# Evict least-recently-used caches beyond this total size (K, M, G, T)\n");
+	fprintf(file, "# max_cache_size = 20G\n");
+	fprintf(file, "\n");
+	fprintf(file, "# Evict least-recently-used caches to keep this much disk space free\n");
+	fprintf(file, "# min_free_space = 5G\n");
+	fprintf(file, "\n");
 	
 	fprintf(file, "[clone]\n");
 	fprintf(file, "# Default clone strategy: full, shallow, treeless, blobless, auto\n");
@@ -526,6 +1034,23 @@ int create_default_config(const char *file_path)
 	fprintf(file, "# Handle submodules recursively by default\n");
 	fprintf(file, "recursive_submodules = true\n");
 	fprintf(file, "\n");
+	fprintf(file, "# Build checkouts from the cache without contacting the remote\n");
+	fprintf(file, "# local_checkout = false\n");
+	fprintf(file, "\n");
+	fprintf(file, "# Skip the fetch for caches synced less than this many seconds ago\n");
+	fprintf(file, "# (default 0: always fetch)\n");
+	fprintf(file, "# fresh_ttl = 300\n");
+	fprintf(file, "\n");
+	fprintf(file, "# Past fresh_ttl, clone from the cache and fetch in the background\n");
+	fprintf(file, "# (no effect while fresh_ttl is 0)\n");
+	fprintf(file, "# stale_while_revalidate = false\n");
+	fprintf(file, "\n");
+	fprintf(file, "# Branches and tags to fetch: default, branch globs, tags, no-tags\n");
+	fprintf(file, "# ref_filter = default release/* no-tags\n");
+	fprintf(file, "\n");
+	fprintf(file, "# Fetch from this git-cache serve node first, origin only if it fails\n");
+	fprintf(file, "# peer = git://cache-node:9418\n");
+	fprintf(file, "\n");
 	
 	fprintf(file, "[github]\n");
 	fprintf(file, "# GitHub personal access token for API operations\n");
@@ -563,6 +1088,15 @@ int save_config_file(const char *file_path, const struct cache_config *config)
 	}
 	fprintf(file, "verbose = %s\n", config->verbose ? "true" : "false");
 	fprintf(file, "force = %s\n", config->force ? "true" : "false");
+	char size[32];
+	if (config->max_cache_size > 0) {
+		cache_gc_format_size(config->max_cache_size, size, sizeof(size));
+		fprintf(file, "max_cache_size = %s\n", size);
+	}
+	if (config->min_free_space > 0) {
+		cache_gc_format_size(config->min_free_space, size, sizeof(size));
+		fprintf(file, "min_free_space = %s\n", size);
+	}
 	fprintf(file, "\n");
 	
 	fprintf(file, "[clone]\n");
@@ -577,6 +1111,15 @@ int save_config_file(const char *file_path, const struct cache_config *config)
 	}
 	fprintf(file, "strategy = %s\n", strategy_name);
 	fprintf(file, "recursive_submodules = %s\n", config->recursive_submodules ? "true" : "false");
+	fprintf(file, "local_checkout = %s\n", config->local_checkout ? "true" : "false");
+	fprintf(file, "fresh_ttl = %d\n", config->fresh_ttl);
+	fprintf(file, "stale_while_revalidate = %s\n", config->stale_while_revalidate ? "true" : "false");
+	if (config->ref_filter) {
+		fprintf(file, "ref_filter = %s\n", config->ref_filter);
+	}
+	if (config->peer_url) {
+		fprintf(file, "peer = %s\n", config->peer_url);
+	}
 	fprintf(file, "\n");
 	
 	fprintf(file, "[github]\n");
@@ -615,6 +1158,45 @@ void print_configuration(const struct cache_config *config)
 	printf("Verbose:              %s\n", config->verbose ? "true" : "false");
 	printf("Force:                %s\n", config->force ? "true" : "false");
 	printf("Recursive submodules: %s\n", config->recursive_submodules ? "true" : "false");
+	printf("Local checkout:       %s\n", config->local_checkout ? "true" : "false");
+	if (config->fresh_ttl > 0) {
+		printf("Fresh TTL:            %ds\n", config->fresh_ttl);
+	} else {
+		printf("Fresh TTL:            (always fetch)\n");
+	}
+	printf("Serve stale:          %s\n", config->stale_while_revalidate ? "true" : "false");
+	printf("Ref filter:           %s\n", config->ref_filter && config->ref_filter[0] ?
+	       config->ref_filter : "(all branches)");
+	printf("Peer cache:           %s\n", config->peer_url && config->peer_url[0] ?
+	       config->peer_url : "(none)");
+	char size[32];
+	cache_gc_format_size(config->max_cache_size, size, sizeof(size));
+	printf("Max cache size:       %s\n", config->max_cache_size > 0 ? size : "(no limit)");
+	cache_gc_format_size(config->min_free_space, size, sizeof(size));
+	printf("Min free space:       %s\n", config->min_free_space > 0 ? size : "(no limit)");
+}
+
+/**
+ * @brief Create a directory and any missing parents, as mkdir -p does
+ * @return 0 if the directory exists afterwards, -1 otherwise
+ */
+static int make_directories(const char *path)
+{
+	char dir[PATH_MAX];
+	int len = snprintf(dir, sizeof(dir), "%s", path);
+	if (len <= 0 || (size_t)len >= sizeof(dir)) {
+		return -1;
+	}
+	
+	for (char *slash = strchr(dir + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+		*slash = '\0';
+		mkdir(dir, 0755);
+		*slash = '/';
+	}
+	
+	struct stat st;
+	return (mkdir(dir, 0755) == 0 || errno == EEXIST) && stat(dir, &st) == 0 &&
+	       S_ISDIR(st.st_mode) ? 0 : -1;
 }
 
 /**
@@ -631,9 +1213,7 @@ int validate_configuration(const struct cache_config *config)
 		struct stat st;
 		if (stat(config->cache_root, &st) != 0) {
 			/* Try to create directory */
-			char mkdir_cmd[4096];
-			snprintf(mkdir_cmd, sizeof(mkdir_cmd), "mkdir -p \"%s\"", config->cache_root);
-			if (system(mkdir_cmd) != 0) {
+			if (make_directories(config->cache_root) != 0) {
 				return CONFIG_ERROR_INVALID;
 			}
 		}
@@ -644,9 +1224,7 @@ int validate_configuration(const struct cache_config *config)
 		struct stat st;
 		if (stat(config->checkout_root, &st) != 0) {
 			/* Try to create directory */
-			char mkdir_cmd[4096];
-			snprintf(mkdir_cmd, sizeof(mkdir_cmd), "mkdir -p \"%s\"", config->checkout_root);
-			if (system(mkdir_cmd) != 0) {
+			if (make_directories(config->checkout_root) != 0) {
 				return CONFIG_ERROR_INVALID;
 			}
 		}
@@ -681,6 +1259,7 @@ void cleanup_config_file(struct config_file *config_file)
 	
 	free(config_file->path);
 	cleanup_config_entries(config_file->entries);
+	free(config_file->buckets);
 	memset(config_file, 0, sizeof(*config_file));
 }
 
@@ -712,17 +1291,7 @@ const char* config_get_error_string(int error_code)
  */
 static struct config_entry* find_config_entry(const char *section, const char *key)
 {
-	struct config_entry *entry = global_config.entries;
-	while (entry) {
-		if ((!section && !entry->section) || 
-		    (section && entry->section && strcmp(section, entry->section) == 0)) {
-			if (strcmp(key, entry->key) == 0) {
-				return entry;
-			}
-		}
-		entry = entry->next;
-	}
-	return NULL;
+	return config_table_find(&global_config, section, key);
 }
 
 /**
@@ -783,19 +1352,6 @@ int set_config_value(const char *section, const char *key, const char *value)
 		return CONFIG_ERROR_INVALID;
 	}
 	
-	/* Find existing entry */
-	struct config_entry *entry = find_config_entry(section, key);
-	if (entry) {
-		/* Update existing entry */
-		char *new_value = strdup(value);
-		if (!new_value) {
-			return CONFIG_ERROR_MEMORY;
-		}
-		free(entry->value);
-		entry->value = new_value;
-		return CONFIG_SUCCESS;
-	}
-	
-	/* Add new entry */
-	return add_config_entry(&global_config.entries, section, key, value);
-}
\ No newline at end of file
+	/* Updates an existing entry in place */
+	return config_table_put(&global_config, section, key, value);
+}
@@ -7,6 +7,12 @@
  * 
  * This module provides functionality for reading and managing configuration
  * files (.gitcacherc) to customize git-cache behavior and defaults.
+ *
+ * load_configuration() merges all configuration files into one snapshot
+ * with hashed section/key lookup, which get_config_string() and friends
+ * read. The merged snapshot is cached in a compact binary file together
+ * with the path, mtime, size and inode of every source file, so later runs
+ * only stat the sources instead of parsing them.
  */
 
 #include "git-cache.h"
@@ -22,6 +28,11 @@ struct cache_config;
 #define CONFIG_LOCAL_FILE     ".git/gitcacherc"
 #define CONFIG_ENV_VAR        "GIT_CACHE_CONFIG"
 
+/**
+ * @brief Parsed configuration cache, relative to $XDG_CACHE_HOME or ~/.cache
+ */
+#define CONFIG_SNAPSHOT_FILE  "git-cache/config.snapshot"
+
 /**
  * @brief Configuration file error codes
  */
@@ -52,6 +63,7 @@ struct config_entry {
 	char *key;
 	char *value;
 	struct config_entry *next;
+	struct config_entry *hash_next;  /**< Next entry in the same hash bucket */
 };
 
 /**
@@ -61,10 +73,18 @@ struct config_file {
 	char *path;
 	struct config_entry *entries;
 	time_t last_modified;
+	struct config_entry **buckets;   /**< Hash buckets over entries, NULL while empty */
+	size_t bucket_count;             /**< Number of buckets, a power of two */
+	size_t entry_count;              /**< Number of entries in the buckets */
 };
 
 /**
  * @brief Load configuration from all available sources
+ *
+ * Sources are the system, user, local and GIT_CACHE_CONFIG files, later
+ * ones overriding earlier ones. The merged entries become the snapshot
+ * read by get_config_string() and friends and are applied to config.
+ *
  * @param config Cache configuration to populate
  * @return CONFIG_SUCCESS on success, error code on failure
  */
@@ -143,6 +163,14 @@ int get_user_config_path(char *path, size_t path_size);
  */
 int get_local_config_path(char *path, size_t path_size);
 
+/**
+ * @brief Get the path of the parsed configuration cache
+ * @param path Buffer to store path
+ * @param path_size Size of buffer
+ * @return CONFIG_SUCCESS on success, error code on failure
+ */
+int get_config_snapshot_path(char *path, size_t path_size);
+
 /**
  * @brief Check if configuration file exists
  * @param file_path Path to configuration file
@@ -0,0 +1,540 @@
+/**
+ * @file disk_usage.c
+ * @brief In-process disk usage accounting implementation
+ *
+ * Trees are walked with openat/fdopendir/fstatat so each entry costs a
+ * single stat relative to an open directory. Files with more than one
+ * link are remembered by device and inode so they are only counted once.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "disk_usage.h"
+
+/**
+ * @brief Set of (device, inode) pairs for hardlink deduplication
+ */
+struct inode_set {
+	struct inode_key {
+		dev_t dev;
+		ino_t ino;
+	} *keys;
+	size_t capacity;
+	size_t count;
+};
+
+/**
+ * @brief Accounting state header
+ */
+struct usage_state_header {
+	char magic[8];              /**< DISK_USAGE_MAGIC */
+	uint32_t version;           /**< DISK_USAGE_VERSION */
+	uint32_t entry_count;       /**< Number of entries */
+};
+
+/**
+ * @brief Saved total for one object directory
+ */
+struct usage_state_entry {
+	char name[64];              /**< Path relative to the repository */
+	int64_t mtime_sec;          /**< Directory mtime when measured, 0 if not reusable */
+	int64_t mtime_nsec;         /**< Nanosecond part of the mtime */
+	uint64_t bytes;             /**< Allocated bytes including the directory */
+};
+
+/**
+ * @brief Growable list of state entries
+ */
+struct usage_state {
+	struct usage_state_entry *entries;
+	size_t count;
+	size_t capacity;
+};
+
+/**
+ * @brief Hash a (device, inode) pair
+ */
+static size_t inode_hash(dev_t dev, ino_t ino)
+{
+	uint64_t h = (uint64_t)ino * 0x9e3779b97f4a7c15ULL;
+	h ^= (uint64_t)dev + (h >> 29);
+	return (size_t)h;
+}
+
+/**
+ * @brief Insert into the set, returns 1 if newly added, 0 if seen, -1 on error
+ */
+static int inode_set_add(struct inode_set *set, dev_t dev, ino_t ino)
+{
+	/* Keep the load factor below one half */
+	if ((set->count + 1) * 2 > set->capacity) {
+		size_t new_capacity = set->capacity ? set->capacity * 2 : 256;
+		struct inode_key *new_keys = calloc(new_capacity, sizeof(*new_keys));
+		if (!new_keys) {
+			return -1;
+		}
+	
+		for (size_t i = 0; i < set->capacity; i++) {
+			if (set->keys[i].ino == 0) {
+				continue;
+			}
+			size_t slot = inode_hash(set->keys[i].dev, set->keys[i].ino) & (new_capacity - 1);
+			while (new_keys[slot].ino != 0) {
+				slot = (slot + 1) & (new_capacity - 1);
+			}
+			new_keys[slot] = set->keys[i];
+		}
+	
+		free(set->keys);
+		set->keys = new_keys;
+		set->capacity = new_capacity;
+	}
+	
+	size_t slot = inode_hash(dev, ino) & (set->capacity - 1);
+	while (set->keys[slot].ino != 0) {
+		if (set->keys[slot].ino == ino && set->keys[slot].dev == dev) {
+			return 0;
+		}
+		slot = (slot + 1) & (set->capacity - 1);
+	}
+	
+	set->keys[slot].dev = dev;
+	set->keys[slot].ino = ino;
+	set->count++;
+	return 1;
+}
+
+/**
+ * @brief Size contributed by one stat result
+ */
+static int account_stat(const struct stat *st, struct inode_set *seen, uint64_t *bytes)
+{
+	/* Directories cannot be hardlinked, other multi-link files count once */
+	if (!S_ISDIR(st->st_mode) && st->st_nlink > 1 && st->st_ino != 0) {
+		int added = inode_set_add(seen, st->st_dev, st->st_ino);
+		if (added < 0) {
+			return DISK_USAGE_ERROR_MEMORY;
+		}
+		if (added == 0) {
+			return DISK_USAGE_SUCCESS;
+		}
+	}
+	
+	*bytes += (uint64_t)st->st_blocks * 512;
+	return DISK_USAGE_SUCCESS;
+}
+
+/**
+ * @brief Sum the contents of an open directory (takes ownership of fd)
+ */
+static int walk_directory_fd(int fd, struct inode_set *seen, uint64_t *bytes)
+{
+	DIR *dir = fdopendir(fd);
+	if (!dir) {
+		close(fd);
+		return DISK_USAGE_ERROR_IO;
+	}
+	
+	int ret = DISK_USAGE_SUCCESS;
+	const struct dirent *entry;
+	while (ret == DISK_USAGE_SUCCESS && (entry = readdir(dir)) != NULL) {
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+			continue;
+		}
+	
+		struct stat st;
+		if (fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+			/* Entries can vanish while git is running, skip them */
+			continue;
+		}
+	
+		ret = account_stat(&st, seen, bytes);
+		if (ret != DISK_USAGE_SUCCESS || !S_ISDIR(st.st_mode)) {
+			continue;
+		}
+	
+		int child = openat(dirfd(dir), entry->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+		if (child >= 0) {
+			ret = walk_directory_fd(child, seen, bytes);
+		}
+	}
+	
+	closedir(dir);
+	return ret;
+}
+
+/**
+ * @brief Measure an entry relative to dir_fd, recursing into directories
+ */
+static int measure_at(int dir_fd, const char *name, struct inode_set *seen, uint64_t *bytes)
+{
+	struct stat st;
+	if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+		return errno == ENOENT ? DISK_USAGE_SUCCESS : DISK_USAGE_ERROR_IO;
+	}
+	
+	int ret = account_stat(&st, seen, bytes);
+	if (ret != DISK_USAGE_SUCCESS || !S_ISDIR(st.st_mode)) {
+		return ret;
+	}
+	
+	int fd = openat(dir_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0) {
+		return DISK_USAGE_ERROR_IO;
+	}
+	
+	return walk_directory_fd(fd, seen, bytes);
+}
+
+/**
+ * @brief Measure the disk usage of a directory tree
+ */
+int disk_usage_measure(const char *path, uint64_t *bytes)
+{
+	if (!path || !bytes) {
+		return DISK_USAGE_ERROR_INVALID;
+	}
+	
+	struct inode_set seen = { NULL, 0, 0 };
+	*bytes = 0;
+	int ret = measure_at(AT_FDCWD, path, &seen, bytes);
+	free(seen.keys);
+	return ret;
+}
+
+/**
+ * @brief Load saved per-directory totals, missing or invalid state is empty
+ */
+static void load_state(int repo_fd, struct usage_state *state)
+{
+	memset(state, 0, sizeof(*state));
+	
+	int fd = openat(repo_fd, DISK_USAGE_STATE_FILE, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return;
+	}
+	
+	struct usage_state_header header;
+	if (read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+	    memcmp(header.magic, DISK_USAGE_MAGIC, sizeof(DISK_USAGE_MAGIC)) != 0 ||
+	    header.version != DISK_USAGE_VERSION || header.entry_count > 65536) {
+		close(fd);
+		return;
+	}
+	
+	size_t count = header.entry_count;
+	struct usage_state_entry *entries = calloc(count ? count : 1, sizeof(*entries));
+	if (!entries) {
+		close(fd);
+		return;
+	}
+	
+	ssize_t want = (ssize_t)(count * sizeof(*entries));
+	if (read(fd, entries, (size_t)want) != want) {
+		free(entries);
+		close(fd);
+		return;
+	}
+	close(fd);
+	
+	for (size_t i = 0; i < count; i++) {
+		entries[i].name[sizeof(entries[i].name) - 1] = '\0';
+	}
+	
+	state->entries = entries;
+	state->count = count;
+	state->capacity = count;
+}
+
+/**
+ * @brief Write per-directory totals through a temporary file
+ */
+static int save_state(int repo_fd, const struct usage_state *state)
+{
+	struct usage_state_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, DISK_USAGE_MAGIC, sizeof(DISK_USAGE_MAGIC));
+	header.version = DISK_USAGE_VERSION;
+	header.entry_count = (uint32_t)state->count;
+	
+	char temp_name[128];
+	snprintf(temp_name, sizeof(temp_name), "%s.tmp.%d", DISK_USAGE_STATE_FILE, (int)getpid());
+	
+	int fd = openat(repo_fd, temp_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		return DISK_USAGE_ERROR_IO;
+	}
+	
+	int ret = DISK_USAGE_SUCCESS;
+	ssize_t entries_size = (ssize_t)(state->count * sizeof(*state->entries));
+	if (write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+	    (state->count > 0 && write(fd, state->entries, (size_t)entries_size) != entries_size)) {
+		ret = DISK_USAGE_ERROR_IO;
+	}
+	
+	if (close(fd) != 0) {
+		ret = DISK_USAGE_ERROR_IO;
+	}
+	
+	if (ret == DISK_USAGE_SUCCESS && renameat(repo_fd, temp_name, repo_fd, DISK_USAGE_STATE_FILE) != 0) {
+		ret = DISK_USAGE_ERROR_IO;
+	}
+	
+	if (ret != DISK_USAGE_SUCCESS) {
+		unlinkat(repo_fd, temp_name, 0);
+	}
+	
+	return ret;
+}
+
+/**
+ * @brief Find a saved entry by name
+ */
+static const struct usage_state_entry* find_state(const struct usage_state *state, const char *name)
+{
+	for (size_t i = 0; i < state->count; i++) {
+		if (strcmp(state->entries[i].name, name) == 0) {
+			return &state->entries[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Append an entry to state
+ */
+static int add_state(struct usage_state *state, const struct usage_state_entry *entry)
+{
+	if (state->count == state->capacity) {
+		size_t new_capacity = state->capacity ? state->capacity * 2 : 64;
+		struct usage_state_entry *new_entries = realloc(state->entries, new_capacity * sizeof(*new_entries));
+		if (!new_entries) {
+			return DISK_USAGE_ERROR_MEMORY;
+		}
+		state->entries = new_entries;
+		state->capacity = new_capacity;
+	}
+	
+	state->entries[state->count++] = *entry;
+	return DISK_USAGE_SUCCESS;
+}
+
+/**
+ * @brief Account an objects directory, reusing unchanged subdirectory totals
+ *
+ * prefix is the objects path relative to the repository, e.g. "objects".
+ */
+static int account_objects(int parent_fd, const char *prefix, const char *name,
+	                       const struct usage_state *old_state, struct usage_state *new_state,
+	                       struct inode_set *seen, uint64_t *bytes)
+{
+	struct stat st;
+	if (fstatat(parent_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISDIR(st.st_mode)) {
+		return measure_at(parent_fd, name, seen, bytes);
+	}
+	
+	int ret = account_stat(&st, seen, bytes);
+	if (ret != DISK_USAGE_SUCCESS) {
+		return ret;
+	}
+	
+	int fd = openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	DIR *dir = fd >= 0 ? fdopendir(fd) : NULL;
+	if (!dir) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		return DISK_USAGE_ERROR_IO;
+	}
+	
+	time_t now = time(NULL);
+	const struct dirent *entry;
+	while (ret == DISK_USAGE_SUCCESS && (entry = readdir(dir)) != NULL) {
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+			continue;
+		}
+	
+		struct stat child_st;
+		if (fstatat(dirfd(dir), entry->d_name, &child_st, AT_SYMLINK_NOFOLLOW) != 0) {
+			continue;
+		}
+	
+		if (!S_ISDIR(child_st.st_mode)) {
+			ret = account_stat(&child_st, seen, bytes);
+			continue;
+		}
+	
+		struct usage_state_entry saved;
+		memset(&saved, 0, sizeof(saved));
+		if (snprintf(saved.name, sizeof(saved.name), "%s/%s", prefix, entry->d_name) >= (int)sizeof(saved.name)) {
+			ret = measure_at(dirfd(dir), entry->d_name, seen, bytes);
+			continue;
+		}
+	
+		/* Unchanged directory mtime means no object was added or removed */
+		const struct usage_state_entry *old = find_state(old_state, saved.name);
+		if (old && old->mtime_sec != 0 &&
+		    old->mtime_sec == (int64_t)child_st.st_mtim.tv_sec &&
+		    old->mtime_nsec == (int64_t)child_st.st_mtim.tv_nsec) {
+			saved = *old;
+		} else {
+			ret = measure_at(dirfd(dir), entry->d_name, seen, &saved.bytes);
+			if (ret != DISK_USAGE_SUCCESS) {
+				continue;
+			}
+	
+			/* A directory modified this second may change again unnoticed */
+			if (child_st.st_mtim.tv_sec < now - 1) {
+				saved.mtime_sec = (int64_t)child_st.st_mtim.tv_sec;
+				saved.mtime_nsec = (int64_t)child_st.st_mtim.tv_nsec;
+			}
+		}
+	
+		*bytes += saved.bytes;
+		ret = add_state(new_state, &saved);
+	}
+	
+	closedir(dir);
+	return ret;
+}
+
+/**
+ * @brief Account a repository directory: objects incrementally, the rest fully
+ *
+ * top_level enables descending into .git and skipping the state file;
+ * is_git_dir marks dir_fd as a git directory whose objects/ may be reused.
+ */
+static int account_git_dir(int dir_fd, const char *prefix, int top_level, int is_git_dir,
+	                       const struct usage_state *old_state, struct usage_state *new_state,
+	                       struct inode_set *seen, uint64_t *bytes)
+{
+	int fd = dup(dir_fd);
+	DIR *dir = fd >= 0 ? fdopendir(fd) : NULL;
+	if (!dir) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		return DISK_USAGE_ERROR_IO;
+	}
+	
+	int ret = DISK_USAGE_SUCCESS;
+	const struct dirent *entry;
+	while (ret == DISK_USAGE_SUCCESS && (entry = readdir(dir)) != NULL) {
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+			continue;
+		}
+	
+		/* Our own bookkeeping is not part of the repository */
+		if (top_level && strncmp(entry->d_name, DISK_USAGE_STATE_FILE, strlen(DISK_USAGE_STATE_FILE)) == 0) {
+			continue;
+		}
+	
+		if (is_git_dir && strcmp(entry->d_name, "objects") == 0) {
+			char objects_prefix[32];
+			snprintf(objects_prefix, sizeof(objects_prefix), "%sobjects", prefix);
+			ret = account_objects(dirfd(dir), objects_prefix, entry->d_name,
+			                      old_state, new_state, seen, bytes);
+			continue;
+		}
+	
+		/* Work trees keep the repository in .git */
+		if (top_level && strcmp(entry->d_name, ".git") == 0) {
+			struct stat st;
+			int git_fd = openat(dirfd(dir), ".git", O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+			if (git_fd >= 0) {
+				if (fstat(git_fd, &st) == 0) {
+					ret = account_stat(&st, seen, bytes);
+				}
+				if (ret == DISK_USAGE_SUCCESS) {
+					ret = account_git_dir(git_fd, ".git/", 0, 1, old_state, new_state, seen, bytes);
+				}
+				close(git_fd);
+				continue;
+			}
+		}
+	
+		ret = measure_at(dirfd(dir), entry->d_name, seen, bytes);
+	}
+	
+	closedir(dir);
+	return ret;
+}
+
+/**
+ * @brief Measure a repository, reusing totals for unchanged object directories
+ */
+int disk_usage_account(const char *repo_path, uint64_t *bytes)
+{
+	if (!repo_path || !bytes) {
+		return DISK_USAGE_ERROR_INVALID;
+	}
+	
+	int repo_fd = open(repo_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (repo_fd < 0) {
+		return DISK_USAGE_ERROR_IO;
+	}
+	
+	struct usage_state old_state;
+	struct usage_state new_state;
+	struct inode_set seen = { NULL, 0, 0 };
+	load_state(repo_fd, &old_state);
+	memset(&new_state, 0, sizeof(new_state));
+	
+	uint64_t total = 0;
+	struct stat st;
+	int ret = DISK_USAGE_ERROR_IO;
+	if (fstat(repo_fd, &st) == 0) {
+		ret = account_stat(&st, &seen, &total);
+	}
+	/* In a work tree only .git/objects follows git's write rules */
+	int is_bare = faccessat(repo_fd, ".git", F_OK, 0) != 0;
+	if (ret == DISK_USAGE_SUCCESS) {
+		ret = account_git_dir(repo_fd, "", 1, is_bare, &old_state, &new_state, &seen, &total);
+	}
+	
+	if (ret == DISK_USAGE_SUCCESS) {
+		*bytes = total;
+	
+		/* Failing to save state only costs a full walk next time */
+		int changed = old_state.count != new_state.count ||
+		              (new_state.count > 0 &&
+		               memcmp(old_state.entries, new_state.entries, new_state.count * sizeof(*new_state.entries)) != 0);
+		if (changed) {
+			save_state(repo_fd, &new_state);
+		}
+	}
+	
+	free(seen.keys);
+	free(old_state.entries);
+	free(new_state.entries);
+	close(repo_fd);
+	return ret;
+}
+
+/**
+ * @brief Get error string for disk usage error code
+ */
+const char* disk_usage_error_string(int error_code)
+{
+	switch (error_code) {
+		case DISK_USAGE_SUCCESS:
+			return "Success";
+		case DISK_USAGE_ERROR_INVALID:
+			return "Invalid argument";
+		case DISK_USAGE_ERROR_IO:
+			return "I/O error";
+		case DISK_USAGE_ERROR_MEMORY:
+			return "Memory allocation failed";
+		default:
+			return "Unknown error";
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef DISK_USAGE_H
+#define DISK_USAGE_H
+
+/**
+ * @file disk_usage.h
+ * @brief In-process disk usage accounting for git-cache
+ *
+ * Sums allocated blocks (st_blocks) with openat/fstatat instead of
+ * running du. Hardlinked files are counted once per measurement.
+ * Repository accounting is incremental: object directories are only
+ * walked again when their mtime changed since the previous run, which
+ * is reliable because git only adds or removes pack and loose object
+ * files by rename or unlink.
+ */
+
+#include <stdint.h>
+
+/**
+ * @brief Accounting state file name (relative to repository path)
+ */
+#define DISK_USAGE_STATE_FILE "cache_usage.bin"
+
+/**
+ * @brief State file format identification
+ */
+#define DISK_USAGE_MAGIC   "GCUSAGE"
+#define DISK_USAGE_VERSION 1
+
+/**
+ * @brief Disk usage error codes
+ */
+#define DISK_USAGE_SUCCESS        0
+#define DISK_USAGE_ERROR_INVALID -1
+#define DISK_USAGE_ERROR_IO      -2
+#define DISK_USAGE_ERROR_MEMORY  -3
+
+/**
+ * @brief Measure the disk usage of a directory tree
+ * @param path Directory (or file) to measure
+ * @param bytes Output for allocated size in bytes
+ * @return DISK_USAGE_SUCCESS on success, error code on failure
+ */
+int disk_usage_measure(const char *path, uint64_t *bytes);
+
+/**
+ * @brief Measure a repository, reusing totals for unchanged object directories
+ *
+ * Per-directory totals for objects/ are kept in DISK_USAGE_STATE_FILE
+ * inside the repository and refreshed on every call.
+ *
+ * @param repo_path Repository path (bare or work tree)
+ * @param bytes Output for allocated size in bytes
+ * @return DISK_USAGE_SUCCESS on success, error code on failure
+ */
+int disk_usage_account(const char *repo_path, uint64_t *bytes);
+
+/**
+ * @brief Get human-readable error message for disk usage error code
+ * @param error_code Disk usage error code
+ * @return Error message string
+ */
+const char* disk_usage_error_string(int error_code);
+
+#endif /* DISK_USAGE_H */
@@ -18,6 +18,7 @@
 #include "git-cache.h"
 #include "fork_config.h"
 #include "github_api.h"
+#include "cache_exec.h"
 #include "config_file.h"
 
 /**
@@ -217,24 +218,18 @@ int configure_fork_remotes(const char *repo_path, const char *fork_url,
 	}
 	
 	/* Set origin to fork URL */
-	char set_origin_cmd[8192];
-	snprintf(set_origin_cmd, sizeof(set_origin_cmd),
-	         "cd \"%s\" && git remote set-url origin \"%s\" 2>/dev/null || "
-	         "git remote add origin \"%s\"",
-	         repo_path, fork_url, fork_url);
-	
-	if (system(set_origin_cmd) != 0) {
+	const char *set_origin[] = {"git", "remote", "set-url", "origin", fork_url, NULL};
+	const char *add_origin[] = {"git", "remote", "add", "origin", fork_url, NULL};
+	if (cache_exec_status(set_origin, repo_path, 1) != 0 &&
+	    cache_exec_status(add_origin, repo_path, 0) != 0) {
 		return -1;
 	}
 	
 	/* Add upstream remote */
-	char add_upstream_cmd[8192];
-	snprintf(add_upstream_cmd, sizeof(add_upstream_cmd),
-	         "cd \"%s\" && git remote add upstream \"%s\" 2>/dev/null || "
-	         "git remote set-url upstream \"%s\"",
-	         repo_path, upstream_url, upstream_url);
-	
-	if (system(add_upstream_cmd) != 0) {
+	const char *add_upstream[] = {"git", "remote", "add", "upstream", upstream_url, NULL};
+	const char *set_upstream[] = {"git", "remote", "set-url", "upstream", upstream_url, NULL};
+	if (cache_exec_status(add_upstream, repo_path, 1) != 0 &&
+	    cache_exec_status(set_upstream, repo_path, 0) != 0) {
 		return -1;
 	}
 	
@@ -251,32 +246,53 @@ int sync_fork_with_upstream(const struct repo_info *repo, const char *branch, in
 	}
 	
 	/* Fetch from upstream */
-	char fetch_cmd[4096];
-	snprintf(fetch_cmd, sizeof(fetch_cmd),
-	         "cd \"%s\" && git fetch upstream 2>&1",
-	         repo->modifiable_path);
+	const char *fetch[] = {"git", "fetch", "upstream", NULL};
+	if (cache_exec_status(fetch, repo->modifiable_path, 0) != 0) {
+		return -1;
+	}
+	
+	/* Sync default branch unless one is given */
+	char current[256];
+	if (!branch) {
+		const char *symbolic_ref[] = {"git", "symbolic-ref", "--short", "HEAD", NULL};
+		if (cache_exec_line(symbolic_ref, repo->modifiable_path, current, sizeof(current)) != 0 ||
+		    !current[0]) {
+			return -1;
+		}
+		branch = current;
+	}
 	
-	if (system(fetch_cmd) != 0) {
+	const char *checkout[] = {"git", "checkout", branch, NULL};
+	if (cache_exec_status(checkout, repo->modifiable_path, 0) != 0) {
 		return -1;
 	}
 	
 	/* Merge or rebase based on configuration */
-	char sync_cmd[8192];
-	if (branch) {
-		snprintf(sync_cmd, sizeof(sync_cmd),
-		         "cd \"%s\" && git checkout %s && git merge upstream/%s %s",
-		         repo->modifiable_path, branch, branch,
-		         force ? "--allow-unrelated-histories" : "");
-	} else {
-		/* Sync default branch */
-		snprintf(sync_cmd, sizeof(sync_cmd),
-		         "cd \"%s\" && git checkout $(git symbolic-ref --short HEAD) && "
-		         "git merge upstream/$(git symbolic-ref --short HEAD) %s",
-		         repo->modifiable_path,
-		         force ? "--allow-unrelated-histories" : "");
-	}
-	
-	return system(sync_cmd) == 0 ? 0 : -1;
+	char upstream_branch[sizeof(current) + 16];
+	if ((size_t)snprintf(upstream_branch, sizeof(upstream_branch), "upstream/%s", branch) >=
+	    sizeof(upstream_branch)) {
+		return -1;
+	}
+	const char *merge[] = {"git", "merge", upstream_branch,
+	                       force ? "--allow-unrelated-histories" : NULL, NULL};
+	
+	return cache_exec_status(merge, repo->modifiable_path, 0) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Read a commit count printed by git rev-list --count, 0 if unknown
+ */
+static int count_commits(const char *repo_path, const char *range)
+{
+	const char *rev_list[] = {"git", "rev-list", "--count", range, NULL};
+	char line[64];
+	int count;
+	
+	if (cache_exec_line(rev_list, repo_path, line, sizeof(line)) != 0 ||
+	    sscanf(line, "%d", &count) != 1) {
+		return 0;
+	}
+	return count;
 }
 
 /**
@@ -299,31 +315,8 @@ int get_fork_sync_status(const struct repo_info *repo, struct fork_sync_status *
 	}
 	
 	/* Get commits behind/ahead */
-	char behind_cmd[4096];
-	snprintf(behind_cmd, sizeof(behind_cmd),
-	         "cd \"%s\" && git rev-list --count HEAD..upstream/HEAD 2>/dev/null",
-	         repo->modifiable_path);
-	
-	FILE *pipe = popen(behind_cmd, "r");
-	if (pipe) {
-		if (fscanf(pipe, "%d", &status->commits_behind) != 1) {
-			status->commits_behind = 0;
-		}
-		pclose(pipe);
-	}
-	
-	char ahead_cmd[4096];
-	snprintf(ahead_cmd, sizeof(ahead_cmd),
-	         "cd \"%s\" && git rev-list --count upstream/HEAD..HEAD 2>/dev/null",
-	         repo->modifiable_path);
-	
-	pipe = popen(ahead_cmd, "r");
-	if (pipe) {
-		if (fscanf(pipe, "%d", &status->commits_ahead) != 1) {
-			status->commits_ahead = 0;
-		}
-		pclose(pipe);
-	}
+	status->commits_behind = count_commits(repo->modifiable_path, "HEAD..upstream/HEAD");
+	status->commits_ahead = count_commits(repo->modifiable_path, "upstream/HEAD..HEAD");
 	
 	status->last_sync = time(NULL);
 	status->has_conflicts = 0; /* Would need to actually try merge to detect */
@@ -11,6 +11,7 @@
  */
 
 #include <stddef.h>
+#include <stdint.h>
 
 /** @brief Version string for git-cache */
 #define VERSION "1.0.0"
@@ -60,8 +61,11 @@ enum cache_operation {
 	CACHE_OP_LIST,       /**< List cached repositories */
 	CACHE_OP_VERIFY,     /**< Verify cache integrity */
 	CACHE_OP_REPAIR,     /**< Repair outdated checkouts */
+	CACHE_OP_GC,         /**< Evict least-recently-used caches */
 	CACHE_OP_CONFIG,     /**< Show or modify configuration */
 	CACHE_OP_MIRROR,     /**< Manage remote mirrors */
+	CACHE_OP_DAEMON,     /**< Run or control the background daemon */
+	CACHE_OP_SERVE,      /**< Serve the caches to peers over git:// */
 	CACHE_OP_COMPLETION  /**< Manage shell completion */
 };
 
@@ -83,6 +87,8 @@ struct repo_info {
 	enum clone_strategy strategy; /**< Clone strategy used */
 	int is_fork_needed;    /**< Whether forking is required */
 	char *fork_organization; /**< Organization for fork (optional) */
+	uint64_t estimated_size; /**< Size estimate behind an auto-detected strategy, 0 if none */
+	int is_monorepo;       /**< Whether strategy detection flagged a monorepo */
 };
 
 /**
@@ -98,6 +104,15 @@ struct cache_config {
 	int verbose;           /**< Enable verbose output */
 	int force;             /**< Force operations */
 	int recursive_submodules; /**< Handle submodules recursively */
+	int deep_verify;       /**< Verify objects in addition to native probes */
+	int local_checkout;    /**< Build checkouts from the cache without network access */
+	uint64_t max_cache_size; /**< Evict caches beyond this total size in bytes (0 for no limit) */
+	uint64_t min_free_space; /**< Evict caches to keep this much disk free in bytes (0 for no limit) */
+	int fresh_ttl;         /**< Seconds after a sync that clone skips the fetch (0 to always fetch) */
+	int stale_while_revalidate; /**< Past fresh_ttl, serve the cache and fetch in the background */
+	char *ref_filter;      /**< Branches and tags caches fetch unless they set their own (NULL for all) */
+	const char *repo_ref_filter; /**< Filter to store for the repository being cloned (--refs) */
+	char *peer_url;        /**< Cache server fetched from before origin, e.g. git://node:9418 (NULL for none) */
 	void *fork_config;     /**< Fork configuration settings (opaque pointer) */
 };
 
@@ -119,6 +134,20 @@ struct cache_options {
 	int recursive_submodules; /**< Handle submodules */
 	char *organization;    /**< Organization for fork */
 	int make_private;      /**< Make forked repository private */
+	int deep_verify;       /**< Full object verification for verify */
+	int local_checkout;    /**< Build checkouts from the cache without network access */
+	char *manifest_file;   /**< File listing URLs for batch clone ("-" for stdin) */
+	int jobs;              /**< Concurrent batch clone jobs (0 for default) */
+	uint64_t max_cache_size; /**< gc size budget override (0 to use the configuration) */
+	uint64_t min_free_space; /**< gc free space override (0 to use the configuration) */
+	int timings;           /**< Print a per-phase timing summary */
+	int verify_budget;     /**< Seconds verify may keep starting checks (0 for no limit) */
+	char *ref_filter;      /**< Ref filter to store for the cloned repository */
+	char *sparse;          /**< Sparse directories for the checkouts (NULL to keep their cone) */
+	int no_sparse;         /**< Check out the full tree, also for detected monorepos */
+	char *listen_address;  /**< Address serve binds (NULL for the loopback address) */
+	char *serve_exports;   /**< Repositories serve offers, as "owner/name" globs (NULL for none) */
+	int port;              /**< Port serve listens on (0 for the default) */
 };
 
 /**
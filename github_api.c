@@ -1,10 +1,17 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <curl/curl.h>
 #include <json-c/json.h>
 
 #include "github_api.h"
+#include "cache_trace.h"
 
 /* HTTP response callback for libcurl */
 static size_t github_response_callback(void *contents, size_t size, size_t nmemb, struct github_response *response)
@@ -28,6 +35,90 @@ static size_t github_response_callback(void *contents, size_t size, size_t nmemb
 	return total_size;
 }
 
+/* Build the header list shared by all requests of a client */
+static struct curl_slist* github_build_headers(const char *token)
+{
+	char auth_header[GITHUB_MAX_TOKEN_LEN + 32];
+	snprintf(auth_header, sizeof(auth_header), "Authorization: token %s", token);
+	
+	struct curl_slist *headers = NULL;
+	const char *lines[3] = { "Accept: application/vnd.github.v3+json",
+	                         "Content-Type: application/json", auth_header };
+	for (int i = 0; i < 3; i++) {
+	    struct curl_slist *new_headers = curl_slist_append(headers, lines[i]);
+	    if (!new_headers) {
+	        curl_slist_free_all(headers);
+	        return NULL;
+	    }
+	    headers = new_headers;
+	}
+	
+	return headers;
+}
+
+/* Create the connection handles of a client; they are owned by the calling process */
+static int github_client_init_handles(struct github_client *client)
+{
+	client->curl = NULL;
+	client->share = NULL;
+	client->headers = NULL;
+	client->owner_pid = getpid();
+	
+	struct curl_slist *headers = github_build_headers(client->token);
+	CURLSH *share = curl_share_init();
+	CURL *curl = curl_easy_init();
+	if (!headers || !share || !curl) {
+	    curl_slist_free_all(headers);
+	    if (share) {
+	        curl_share_cleanup(share);
+	    }
+	    if (curl) {
+	        curl_easy_cleanup(curl);
+	    }
+	    return GITHUB_ERROR_MEMORY;
+	}
+	
+	/* DNS, TLS sessions and live connections are reused across all handles */
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+	
+	client->curl = curl;
+	client->share = share;
+	client->headers = headers;
+	return GITHUB_SUCCESS;
+}
+
+/* Release the connection handles of a client */
+static void github_client_free_handles(struct github_client *client)
+{
+	/* Handles inherited across fork share sockets with the parent, leave them alone */
+	if (client->owner_pid == getpid()) {
+	    if (client->curl) {
+	        curl_easy_cleanup(client->curl);
+	    }
+	    if (client->share) {
+	        curl_share_cleanup(client->share);
+	    }
+	    curl_slist_free_all(client->headers);
+	}
+	
+	client->curl = NULL;
+	client->share = NULL;
+	client->headers = NULL;
+}
+
+/* Make sure the client has handles usable by the current process */
+static int github_client_ensure_handles(struct github_client *client)
+{
+	if (client->curl && client->owner_pid == getpid()) {
+	    return GITHUB_SUCCESS;
+	}
+	
+	github_client_free_handles(client);
+	return github_client_init_handles(client);
+}
+
 /* Create GitHub API client */
 struct github_client* github_client_create(const char *token)
 {
@@ -56,6 +147,26 @@ struct github_client* github_client_create(const char *token)
 	strcpy(client->user_agent, "git-cache/1.0");
 	
 	client->timeout = 30;
+	client->cache_dir = NULL;
+	
+	/* A proxy or a test server can stand in for api.github.com */
+	const char *api_url = getenv(GITHUB_API_URL_ENV);
+	if (!api_url || !*api_url) {
+	    api_url = GITHUB_API_BASE_URL;
+	}
+	size_t api_url_len = strlen(api_url);
+	while (api_url_len > 0 && api_url[api_url_len - 1] == '/') {
+	    api_url_len--;
+	}
+	client->api_url = strndup(api_url, api_url_len);
+	
+	if (!client->api_url || github_client_init_handles(client) != GITHUB_SUCCESS) {
+	    free(client->api_url);
+	    free(client->user_agent);
+	    free(client->token);
+	    free(client);
+	    return NULL;
+	}
 	
 	return client;
 }
@@ -67,6 +178,9 @@ void github_client_destroy(struct github_client *client)
 	    return;
 	}
 	
+	github_client_free_handles(client);
+	free(client->cache_dir);
+	free(client->api_url);
 	free(client->token);
 	free(client->user_agent);
 	free(client);
@@ -83,6 +197,33 @@ int github_client_set_timeout(struct github_client *client, int timeout_seconds)
 	return GITHUB_SUCCESS;
 }
 
+/* Set directory for cached API responses */
+int github_client_set_cache_dir(struct github_client *client, const char *cache_dir)
+{
+	if (!client) {
+	    return GITHUB_ERROR_INVALID;
+	}
+	
+	free(client->cache_dir);
+	client->cache_dir = NULL;
+	
+	if (!cache_dir || cache_dir[0] == '\0') {
+	    return GITHUB_SUCCESS;
+	}
+	
+	/* Cached bodies may describe private repositories */
+	if (mkdir(cache_dir, 0700) != 0 && errno != EEXIST) {
+	    return GITHUB_ERROR_INVALID;
+	}
+	
+	client->cache_dir = strdup(cache_dir);
+	if (!client->cache_dir) {
+	    return GITHUB_ERROR_MEMORY;
+	}
+	
+	return GITHUB_SUCCESS;
+}
+
 /* Create GitHub response structure */
 static struct github_response* github_response_create(void)
 {
@@ -101,6 +242,9 @@ static struct github_response* github_response_create(void)
 	response->size = 0;
 	response->status_code = 0;
 	response->error_message = NULL;
+	response->etag = NULL;
+	response->last_modified = NULL;
+	response->from_cache = 0;
 	
 	return response;
 }
@@ -114,6 +258,8 @@ static void github_response_destroy(struct github_response *response)
 	
 	free(response->data);
 	free(response->error_message);
+	free(response->etag);
+	free(response->last_modified);
 	free(response);
 }
 
@@ -141,46 +287,338 @@ void github_repo_destroy(struct github_repo *repo)
 	free(repo->full_name);
 	free(repo->clone_url);
 	free(repo->ssh_url);
+	free(repo->language);
+	free(repo->parent_full_name);
 	free(repo);
 }
 
+/* HTTP header callback for libcurl, keeps cache validators */
+static size_t github_header_callback(char *buffer, size_t size, size_t nitems, struct github_response *response)
+{
+	size_t total_size = size * nitems;
+	char **target = NULL;
+	size_t name_len = 0;
+	
+	if (total_size > 5 && strncasecmp(buffer, "ETag:", 5) == 0) {
+	    target = &response->etag;
+	    name_len = 5;
+	} else if (total_size > 14 && strncasecmp(buffer, "Last-Modified:", 14) == 0) {
+	    target = &response->last_modified;
+	    name_len = 14;
+	}
+	
+	if (!target) {
+	    return total_size;
+	}
+	
+	const char *value = buffer + name_len;
+	size_t value_len = total_size - name_len;
+	while (value_len > 0 && (*value == ' ' || *value == '\t')) {
+	    value++;
+	    value_len--;
+	}
+	while (value_len > 0 && (value[value_len - 1] == '\r' || value[value_len - 1] == '\n' ||
+	                         value[value_len - 1] == ' ')) {
+	    value_len--;
+	}
+	
+	/* Redirects deliver several header blocks, the last one wins */
+	char *copy = malloc(value_len + 1);
+	if (copy) {
+	    memcpy(copy, value, value_len);
+	    copy[value_len] = '\0';
+	    free(*target);
+	    *target = copy;
+	}
+	
+	return total_size;
+}
+
+/* Continue an FNV-1a hash over a string */
+static uint64_t github_cache_hash(uint64_t hash, const char *text)
+{
+	for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+	    hash ^= *p;
+	    hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+/* Name the credentials a response was fetched with, without storing the token */
+static void github_cache_credential(const struct github_client *client, char *credential,
+	                               size_t credential_size)
+{
+	if (!client->token || client->token[0] == '\0') {
+	    snprintf(credential, credential_size, "anonymous");
+	    return;
+	}
+	
+	snprintf(credential, credential_size, "token %016llx",
+	         (unsigned long long)github_cache_hash(14695981039346656037ULL, client->token));
+}
+
+/* Build the cache file path for a URL fetched with the client's credentials */
+static void github_cache_path(const struct github_client *client, const char *url, char *path, size_t path_size)
+{
+	/* Private repositories answer differently per token, so tokens never share an entry */
+	char credential[64];
+	github_cache_credential(client, credential, sizeof(credential));
+	
+	/* FNV-1a; the credential and URL are stored in the entry so collisions are detected */
+	uint64_t hash = github_cache_hash(14695981039346656037ULL, credential);
+	hash = github_cache_hash(hash, "\n");
+	hash = github_cache_hash(hash, url);
+	
+	snprintf(path, path_size, "%s/%016llx%s", client->cache_dir, (unsigned long long)hash,
+	         GITHUB_CACHE_SUFFIX);
+}
+
+/* Read the next newline-terminated field of a cache entry */
+static char* github_cache_field(char **cursor, char *end)
+{
+	char *start = *cursor;
+	char *newline = memchr(start, '\n', (size_t)(end - start));
+	if (!newline) {
+	    return NULL;
+	}
+	
+	*newline = '\0';
+	*cursor = newline + 1;
+	return start;
+}
+
+/* Load a cached response for a URL */
+static struct github_cache_entry* github_cache_load(const struct github_client *client, const char *url)
+{
+	if (!client->cache_dir) {
+	    return NULL;
+	}
+	
+	char path[4096];
+	github_cache_path(client, url, path, sizeof(path));
+	
+	FILE *fp = fopen(path, "rb");
+	if (!fp) {
+	    return NULL;
+	}
+	
+	struct stat st;
+	if (fstat(fileno(fp), &st) != 0 || st.st_size <= 0 || st.st_size > GITHUB_MAX_CACHED_LEN) {
+	    fclose(fp);
+	    return NULL;
+	}
+	
+	size_t file_size = (size_t)st.st_size;
+	char *buffer = malloc(file_size + 1);
+	if (!buffer) {
+	    fclose(fp);
+	    return NULL;
+	}
+	
+	size_t read_size = fread(buffer, 1, file_size, fp);
+	fclose(fp);
+	if (read_size != file_size) {
+	    free(buffer);
+	    return NULL;
+	}
+	buffer[file_size] = '\0';
+	
+	char *cursor = buffer;
+	char *end = buffer + file_size;
+	char *magic = github_cache_field(&cursor, end);
+	char *stored_credential = magic ? github_cache_field(&cursor, end) : NULL;
+	char *stored_url = stored_credential ? github_cache_field(&cursor, end) : NULL;
+	char *etag = stored_url ? github_cache_field(&cursor, end) : NULL;
+	char *last_modified = etag ? github_cache_field(&cursor, end) : NULL;
+	
+	char credential[64];
+	github_cache_credential(client, credential, sizeof(credential));
+	if (!last_modified || strcmp(magic, GITHUB_CACHE_MAGIC) != 0 ||
+	    strcmp(stored_credential, credential) != 0 || strcmp(stored_url, url) != 0 ||
+	    (etag[0] == '\0' && last_modified[0] == '\0')) {
+	    free(buffer);
+	    return NULL;
+	}
+	
+	struct github_cache_entry *entry = malloc(sizeof(*entry));
+	if (!entry) {
+	    free(buffer);
+	    return NULL;
+	}
+	
+	entry->buffer = buffer;
+	entry->etag = etag;
+	entry->last_modified = last_modified;
+	entry->body = cursor;
+	entry->body_size = (size_t)(end - cursor);
+	return entry;
+}
+
+/* Free a cached response */
+static void github_cache_entry_free(struct github_cache_entry *entry)
+{
+	if (!entry) {
+	    return;
+	}
+	
+	free(entry->buffer);
+	free(entry);
+}
+
+/* Store a response with its validators, replacing any previous entry */
+static void github_cache_store(const struct github_client *client, const char *url,
+	                          const struct github_response *response)
+{
+	if (!client->cache_dir || (!response->etag && !response->last_modified) ||
+	    response->size > GITHUB_MAX_CACHED_LEN) {
+	    return;
+	}
+	
+	char path[4096];
+	char temp_path[4096 + 32];
+	github_cache_path(client, url, path, sizeof(path));
+	snprintf(temp_path, sizeof(temp_path), "%s.tmp.%d", path, (int)getpid());
+	
+	int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+	    return;
+	}
+	
+	FILE *fp = fdopen(fd, "wb");
+	if (!fp) {
+	    close(fd);
+	    unlink(temp_path);
+	    return;
+	}
+	
+	char credential[64];
+	github_cache_credential(client, credential, sizeof(credential));
+	fprintf(fp, "%s\n%s\n%s\n%s\n%s\n", GITHUB_CACHE_MAGIC, credential, url,
+	        response->etag ? response->etag : "",
+	        response->last_modified ? response->last_modified : "");
+	int ok = fwrite(response->data, 1, response->size, fp) == response->size;
+	
+	if (fclose(fp) != 0 || !ok || rename(temp_path, path) != 0) {
+	    unlink(temp_path);
+	}
+}
+
+/* Add conditional request headers for a cached entry, NULL if not conditional */
+static struct curl_slist* github_cache_headers(const struct github_client *client,
+	                                          const struct github_cache_entry *entry)
+{
+	if (!entry) {
+	    return NULL;
+	}
+	
+	struct curl_slist *headers = github_build_headers(client->token);
+	if (!headers) {
+	    return NULL;
+	}
+	
+	char line[1024];
+	if (entry->etag[0] != '\0') {
+	    snprintf(line, sizeof(line), "If-None-Match: %s", entry->etag);
+	} else {
+	    snprintf(line, sizeof(line), "If-Modified-Since: %s", entry->last_modified);
+	}
+	
+	struct curl_slist *new_headers = curl_slist_append(headers, line);
+	if (!new_headers) {
+	    curl_slist_free_all(headers);
+	    return NULL;
+	}
+	
+	return new_headers;
+}
+
+/* Resolve a finished GET against the cache: serve 304 from disk, store fresh 200s */
+static void github_cache_finish(const struct github_client *client, const char *url,
+	                           const struct github_cache_entry *entry, struct github_response *response)
+{
+	if (response->status_code == 304 && entry) {
+	    char *data = malloc(entry->body_size + 1);
+	    if (!data) {
+	        return;
+	    }
+	    memcpy(data, entry->body, entry->body_size);
+	    data[entry->body_size] = '\0';
+	    
+	    free(response->data);
+	    response->data = data;
+	    response->size = entry->body_size;
+	    response->status_code = 200;
+	    response->from_cache = 1;
+	} else if (response->status_code == 200) {
+	    github_cache_store(client, url, response);
+	}
+}
+
+/* Apply the options shared by single and concurrent requests */
+static void github_setup_handle(const struct github_client *client, CURL *curl, const char *url,
+	                           struct github_response *response)
+{
+	curl_easy_setopt(curl, CURLOPT_URL, url);
+	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, (struct curl_slist *)client->headers);
+	curl_easy_setopt(curl, CURLOPT_USERAGENT, client->user_agent);
+	curl_easy_setopt(curl, CURLOPT_TIMEOUT, (long)client->timeout);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, github_response_callback);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+	curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, github_header_callback);
+	curl_easy_setopt(curl, CURLOPT_HEADERDATA, response);
+	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(curl, CURLOPT_SHARE, (CURLSH *)client->share);
+	
+	/* Prefer HTTP/2 so concurrent requests multiplex over one connection */
+	curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+	curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+	curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+}
+
+/* Store a curl error in a response */
+static void github_set_curl_error(struct github_response *response, CURLcode res)
+{
+	response->error_message = malloc(256);
+	if (response->error_message) {
+	    snprintf(response->error_message, 256, "CURL error: %s", curl_easy_strerror(res));
+	}
+}
+
 /* Make HTTP request to GitHub API */
 static int github_make_request(struct github_client *client, const char *method, const char *url, 
 	                          const char *json_data, struct github_response **response)
 {
-	if (!client || !url || !response) {
+	if (!response) {
 	    return GITHUB_ERROR_INVALID;
 	}
 	
-	*response = github_response_create();
-	if (!*response) {
-	    return GITHUB_ERROR_MEMORY;
+	*response = NULL;
+	if (!client || !url) {
+	    return GITHUB_ERROR_INVALID;
 	}
 	
-	CURL *curl = curl_easy_init();
-	if (!curl) {
-	    github_response_destroy(*response);
-	    *response = NULL;
+	if (github_client_ensure_handles(client) != GITHUB_SUCCESS) {
 	    return GITHUB_ERROR_NETWORK;
 	}
 	
-	/* Set up headers */
-	struct curl_slist *headers = NULL;
-	char auth_header[GITHUB_MAX_TOKEN_LEN + 32];
-	snprintf(auth_header, sizeof(auth_header), "Authorization: token %s", client->token);
+	*response = github_response_create();
+	if (!*response) {
+	    return GITHUB_ERROR_MEMORY;
+	}
 	
-	headers = curl_slist_append(headers, "Accept: application/vnd.github.v3+json");
-	headers = curl_slist_append(headers, "Content-Type: application/json");
-	headers = curl_slist_append(headers, auth_header);
+	/* Reset clears options but keeps the connection, DNS and TLS session caches */
+	CURL *curl = client->curl;
+	curl_easy_reset(curl);
+	github_setup_handle(client, curl, url, *response);
 	
-	/* Configure curl */
-	curl_easy_setopt(curl, CURLOPT_URL, url);
-	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-	curl_easy_setopt(curl, CURLOPT_USERAGENT, client->user_agent);
-	curl_easy_setopt(curl, CURLOPT_TIMEOUT, client->timeout);
-	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, github_response_callback);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, *response);
-	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+	/* Revalidate cached GET responses instead of downloading them again */
+	int is_get = strcmp(method, "GET") == 0;
+	struct github_cache_entry *entry = is_get ? github_cache_load(client, url) : NULL;
+	struct curl_slist *conditional = github_cache_headers(client, entry);
+	if (conditional) {
+	    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, conditional);
+	}
 	
 	/* Set HTTP method */
 	if (strcmp(method, "POST") == 0) {
@@ -196,24 +634,57 @@ static int github_make_request(struct github_client *client, const char *method,
 	}
 	
 	/* Perform request */
+	char trace_detail[512];
+	snprintf(trace_detail, sizeof(trace_detail), "%s %s", method, url);
+	struct cache_trace_span span;
+	cache_trace_begin(&span, "github.api", trace_detail);
 	CURLcode res = curl_easy_perform(curl);
 	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &(*response)->status_code);
-	
-	/* Cleanup */
-	curl_slist_free_all(headers);
-	curl_easy_cleanup(curl);
+	cache_trace_end(&span, res == CURLE_OK ? (int)(*response)->status_code : -(int)res);
+	curl_slist_free_all(conditional);
 	
 	if (res != CURLE_OK) {
-	    (*response)->error_message = malloc(256);
-	    if ((*response)->error_message) {
-	        snprintf((*response)->error_message, 256, "CURL error: %s", curl_easy_strerror(res));
-	    }
+	    github_cache_entry_free(entry);
+	    github_set_curl_error(*response, res);
 	    return GITHUB_ERROR_NETWORK;
 	}
 	
+	if (is_get) {
+	    github_cache_finish(client, url, entry, *response);
+	}
+	github_cache_entry_free(entry);
+	
 	return GITHUB_SUCCESS;
 }
 
+/* Copy a string member of a JSON object, NULL if missing or null */
+static char* github_json_strdup(json_object *parent, const char *key)
+{
+	json_object *obj;
+	if (!parent || !json_object_object_get_ex(parent, key, &obj) ||
+	    !json_object_is_type(obj, json_type_string)) {
+	    return NULL;
+	}
+	
+	return strdup(json_object_get_string(obj));
+}
+
+/* Parse an ISO 8601 UTC timestamp such as 2024-01-31T12:00:00Z */
+static time_t github_parse_timestamp(const char *timestamp)
+{
+	struct tm tm;
+	memset(&tm, 0, sizeof(tm));
+	
+	if (!timestamp || sscanf(timestamp, "%d-%d-%dT%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+	                         &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6) {
+	    return 0;
+	}
+	
+	tm.tm_year -= 1900;
+	tm.tm_mon -= 1;
+	return timegm(&tm);
+}
+
 /* Parse JSON repository response */
 static int github_parse_repo_json(const char *json_str, struct github_repo *repo)
 {
@@ -285,10 +756,110 @@ static int github_parse_repo_json(const char *json_str, struct github_repo *repo
 	    repo->fork_count = json_object_get_int(obj);
 	}
 	
+	/* Parse sizing and activity fields */
+	if (json_object_object_get_ex(root, "size", &obj)) {
+	    int64_t size_kb = json_object_get_int64(obj);
+	    repo->size_kb = size_kb > 0 ? (uint64_t)size_kb : 0;
+	}
+	
+	if (json_object_object_get_ex(root, "pushed_at", &obj)) {
+	    repo->pushed_at = github_parse_timestamp(json_object_get_string(obj));
+	}
+	
+	repo->language = github_json_strdup(root, "language");
+	
+	if (json_object_object_get_ex(root, "parent", &obj)) {
+	    repo->parent_full_name = github_json_strdup(obj, "full_name");
+	}
+	
 	json_object_put(root);
 	return GITHUB_SUCCESS;
 }
 
+/* Parse a repository node of a GraphQL batch response */
+static int github_parse_graphql_repo(json_object *node, struct github_repo *repo)
+{
+	json_object *obj;
+	
+	if (json_object_object_get_ex(node, "owner", &obj)) {
+	    repo->owner = github_json_strdup(obj, "login");
+	}
+	repo->name = github_json_strdup(node, "name");
+	repo->full_name = github_json_strdup(node, "nameWithOwner");
+	repo->ssh_url = github_json_strdup(node, "sshUrl");
+	
+	if (json_object_object_get_ex(node, "url", &obj)) {
+	    const char *url = json_object_get_string(obj);
+	    if (url) {
+	        size_t len = strlen(url);
+	        repo->clone_url = malloc(len + 5);
+	        if (repo->clone_url) {
+	            snprintf(repo->clone_url, len + 5, "%s.git", url);
+	        }
+	    }
+	}
+	
+	if (json_object_object_get_ex(node, "isFork", &obj)) {
+	    repo->is_fork = json_object_get_boolean(obj);
+	}
+	
+	if (json_object_object_get_ex(node, "isPrivate", &obj)) {
+	    repo->is_private = json_object_get_boolean(obj);
+	}
+	
+	if (json_object_object_get_ex(node, "forkCount", &obj)) {
+	    repo->fork_count = json_object_get_int(obj);
+	}
+	
+	if (json_object_object_get_ex(node, "diskUsage", &obj)) {
+	    int64_t size_kb = json_object_get_int64(obj);
+	    repo->size_kb = size_kb > 0 ? (uint64_t)size_kb : 0;
+	}
+	
+	if (json_object_object_get_ex(node, "pushedAt", &obj)) {
+	    repo->pushed_at = github_parse_timestamp(json_object_get_string(obj));
+	}
+	
+	if (json_object_object_get_ex(node, "primaryLanguage", &obj)) {
+	    repo->language = github_json_strdup(obj, "name");
+	}
+	
+	if (json_object_object_get_ex(node, "parent", &obj)) {
+	    repo->parent_full_name = github_json_strdup(obj, "nameWithOwner");
+	}
+	
+	return repo->owner && repo->name ? GITHUB_SUCCESS : GITHUB_ERROR_JSON;
+}
+
+/* Turn a repository GET response into a github_repo */
+static int github_repo_from_response(const struct github_response *response, struct github_repo **result)
+{
+	if (response->status_code == 404) {
+	    return GITHUB_ERROR_NOT_FOUND;
+	}
+	
+	if (response->status_code == 403) {
+	    return GITHUB_ERROR_FORBIDDEN;
+	}
+	
+	if (response->status_code != 200) {
+	    return GITHUB_ERROR_NETWORK;
+	}
+	
+	*result = github_repo_create();
+	if (!*result) {
+	    return GITHUB_ERROR_MEMORY;
+	}
+	
+	int ret = github_parse_repo_json(response->data, *result);
+	if (ret != GITHUB_SUCCESS) {
+	    github_repo_destroy(*result);
+	    *result = NULL;
+	}
+	
+	return ret;
+}
+
 /* Get repository information */
 int github_get_repo(struct github_client *client, const char *owner, const char *repo, 
 	               struct github_repo **result)
@@ -298,47 +869,289 @@ int github_get_repo(struct github_client *client, const char *owner, const char
 	}
 	
 	char url[GITHUB_MAX_URL_LEN];
-	snprintf(url, sizeof(url), "%s/repos/%s/%s", GITHUB_API_BASE_URL, owner, repo);
+	snprintf(url, sizeof(url), "%s/repos/%s/%s", client->api_url, owner, repo);
 	
 	struct github_response *response;
 	int ret = github_make_request(client, "GET", url, NULL, &response);
 	
 	if (ret != GITHUB_SUCCESS) {
+	    github_response_destroy(response);
 	    return ret;
 	}
 	
-	if (response->status_code == 404) {
-	    github_response_destroy(response);
-	    return GITHUB_ERROR_NOT_FOUND;
+	ret = github_repo_from_response(response, result);
+	github_response_destroy(response);
+	return ret;
+}
+
+/* Get information for many repositories with concurrent requests */
+int github_get_repos(struct github_client *client, struct github_repo_request *requests, size_t count)
+{
+	if (!client || (!requests && count > 0)) {
+	    return GITHUB_ERROR_INVALID;
 	}
 	
-	if (response->status_code == 403) {
-	    github_response_destroy(response);
-	    return GITHUB_ERROR_FORBIDDEN;
+	for (size_t i = 0; i < count; i++) {
+	    requests[i].result = NULL;
+	    requests[i].status = GITHUB_ERROR_INVALID;
 	}
 	
-	if (response->status_code != 200) {
-	    github_response_destroy(response);
+	if (count == 0) {
+	    return GITHUB_SUCCESS;
+	}
+	
+	if (github_client_ensure_handles(client) != GITHUB_SUCCESS) {
 	    return GITHUB_ERROR_NETWORK;
 	}
 	
-	*result = github_repo_create();
-	if (!*result) {
-	    github_response_destroy(response);
+	CURLM *multi = curl_multi_init();
+	CURL **handles = calloc(count, sizeof(*handles));
+	struct github_response **responses = calloc(count, sizeof(*responses));
+	struct github_cache_entry **entries = calloc(count, sizeof(*entries));
+	struct curl_slist **conditionals = calloc(count, sizeof(*conditionals));
+	char (*urls)[GITHUB_MAX_URL_LEN] = calloc(count, sizeof(*urls));
+	if (!multi || !handles || !responses || !entries || !conditionals || !urls) {
+	    if (multi) {
+	        curl_multi_cleanup(multi);
+	    }
+	    free(handles);
+	    free(responses);
+	    free(entries);
+	    free(conditionals);
+	    free(urls);
 	    return GITHUB_ERROR_MEMORY;
 	}
 	
-	ret = github_parse_repo_json(response->data, *result);
-	github_response_destroy(response);
+	/* Multiplex over a few connections instead of opening one per request */
+	curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+	curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)GITHUB_MAX_CONNECTIONS);
 	
-	if (ret != GITHUB_SUCCESS) {
-	    github_repo_destroy(*result);
-	    *result = NULL;
+	int ret = GITHUB_SUCCESS;
+	for (size_t i = 0; i < count; i++) {
+	    if (!requests[i].owner || !requests[i].name) {
+	        continue;
+	    }
+	    
+	    responses[i] = github_response_create();
+	    handles[i] = curl_easy_init();
+	    if (!responses[i] || !handles[i]) {
+	        requests[i].status = GITHUB_ERROR_MEMORY;
+	        continue;
+	    }
+	    
+	    snprintf(urls[i], GITHUB_MAX_URL_LEN, "%s/repos/%s/%s", client->api_url,
+	             requests[i].owner, requests[i].name);
+	    github_setup_handle(client, handles[i], urls[i], responses[i]);
+	    curl_easy_setopt(handles[i], CURLOPT_PRIVATE, (void *)&requests[i]);
+	    
+	    entries[i] = github_cache_load(client, urls[i]);
+	    conditionals[i] = github_cache_headers(client, entries[i]);
+	    if (conditionals[i]) {
+	        curl_easy_setopt(handles[i], CURLOPT_HTTPHEADER, conditionals[i]);
+	    }
+	    
+	    if (curl_multi_add_handle(multi, handles[i]) != CURLM_OK) {
+	        requests[i].status = GITHUB_ERROR_NETWORK;
+	        curl_easy_cleanup(handles[i]);
+	        handles[i] = NULL;
+	    }
+	}
+	
+	/* Drive all transfers until none are left running */
+	int running = 0;
+	do {
+	    CURLMcode mc = curl_multi_perform(multi, &running);
+	    if (mc == CURLM_OK && running > 0) {
+	        mc = curl_multi_poll(multi, NULL, 0, 1000, NULL);
+	    }
+	    if (mc != CURLM_OK) {
+	        ret = GITHUB_ERROR_NETWORK;
+	        break;
+	    }
+	    
+	    CURLMsg *msg;
+	    int queued;
+	    while ((msg = curl_multi_info_read(multi, &queued)) != NULL) {
+	        if (msg->msg != CURLMSG_DONE) {
+	            continue;
+	        }
+	        
+	        struct github_repo_request *request = NULL;
+	        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&request);
+	        size_t index = (size_t)(request - requests);
+	        
+	        if (msg->data.result != CURLE_OK) {
+	            request->status = GITHUB_ERROR_NETWORK;
+	        } else {
+	            curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &responses[index]->status_code);
+	            github_cache_finish(client, urls[index], entries[index], responses[index]);
+	            request->status = github_repo_from_response(responses[index], &request->result);
+	        }
+	    }
+	} while (running > 0);
+	
+	for (size_t i = 0; i < count; i++) {
+	    if (handles[i]) {
+	        curl_multi_remove_handle(multi, handles[i]);
+	        curl_easy_cleanup(handles[i]);
+	    }
+	    github_response_destroy(responses[i]);
+	    github_cache_entry_free(entries[i]);
+	    curl_slist_free_all(conditionals[i]);
 	}
 	
+	curl_multi_cleanup(multi);
+	free(handles);
+	free(responses);
+	free(entries);
+	free(conditionals);
+	free(urls);
 	return ret;
 }
 
+/* Repository fields requested by GraphQL batch lookups */
+static const char github_graphql_fragment[] =
+	"fragment R on Repository{name nameWithOwner owner{login} url sshUrl isFork isPrivate "
+	"forkCount diskUsage pushedAt primaryLanguage{name} parent{nameWithOwner}}";
+
+/* Run one GraphQL query for up to GITHUB_GRAPHQL_BATCH repositories */
+static int github_graphql_batch(struct github_client *client, struct github_repo_request *requests, size_t count)
+{
+	/* Owners and names travel as variables so they never need escaping */
+	size_t query_size = sizeof(github_graphql_fragment) + count * 96 + 16;
+	char *query = malloc(query_size);
+	json_object *variables = json_object_new_object();
+	if (!query || !variables) {
+	    free(query);
+	    json_object_put(variables);
+	    return GITHUB_ERROR_MEMORY;
+	}
+	
+	size_t len = (size_t)snprintf(query, query_size, "query(");
+	size_t used = 0;
+	for (size_t i = 0; i < count; i++) {
+	    if (!requests[i].owner || !requests[i].name) {
+	        continue;
+	    }
+	    
+	    char key[32];
+	    snprintf(key, sizeof(key), "o%zu", i);
+	    json_object_object_add(variables, key, json_object_new_string(requests[i].owner));
+	    snprintf(key, sizeof(key), "n%zu", i);
+	    json_object_object_add(variables, key, json_object_new_string(requests[i].name));
+	    len += (size_t)snprintf(query + len, query_size - len, "%s$o%zu:String!,$n%zu:String!",
+	                            used ? "," : "", i, i);
+	    used++;
+	}
+	
+	if (used == 0) {
+	    free(query);
+	    json_object_put(variables);
+	    return GITHUB_SUCCESS;
+	}
+	
+	len += (size_t)snprintf(query + len, query_size - len, "){");
+	for (size_t i = 0; i < count; i++) {
+	    if (requests[i].owner && requests[i].name) {
+	        len += (size_t)snprintf(query + len, query_size - len,
+	                                "r%zu:repository(owner:$o%zu,name:$n%zu){...R}", i, i, i);
+	    }
+	}
+	snprintf(query + len, query_size - len, "}%s", github_graphql_fragment);
+	
+	json_object *body = json_object_new_object();
+	if (!body) {
+	    free(query);
+	    json_object_put(variables);
+	    return GITHUB_ERROR_MEMORY;
+	}
+	json_object_object_add(body, "query", json_object_new_string(query));
+	json_object_object_add(body, "variables", variables);
+	free(query);
+	
+	char url[GITHUB_MAX_URL_LEN];
+	snprintf(url, sizeof(url), "%s/graphql", client->api_url);
+	
+	struct github_response *response;
+	int ret = github_make_request(client, "POST", url, json_object_to_json_string(body), &response);
+	json_object_put(body);
+	
+	if (ret != GITHUB_SUCCESS) {
+	    github_response_destroy(response);
+	    return ret;
+	}
+	
+	if (response->status_code != 200) {
+	    ret = response->status_code == 403 ? GITHUB_ERROR_FORBIDDEN :
+	          response->status_code == 401 ? GITHUB_ERROR_AUTH : GITHUB_ERROR_NETWORK;
+	    github_response_destroy(response);
+	    return ret;
+	}
+	
+	json_object *root = json_tokener_parse(response->data);
+	github_response_destroy(response);
+	
+	json_object *data;
+	if (!root || !json_object_object_get_ex(root, "data", &data) ||
+	    !json_object_is_type(data, json_type_object)) {
+	    json_object_put(root);
+	    return GITHUB_ERROR_JSON;
+	}
+	
+	/* Unknown repositories come back as null with an entry in "errors" */
+	for (size_t i = 0; i < count; i++) {
+	    if (!requests[i].owner || !requests[i].name) {
+	        continue;
+	    }
+	    
+	    char key[32];
+	    json_object *node;
+	    snprintf(key, sizeof(key), "r%zu", i);
+	    if (!json_object_object_get_ex(data, key, &node) || !json_object_is_type(node, json_type_object)) {
+	        requests[i].status = GITHUB_ERROR_NOT_FOUND;
+	        continue;
+	    }
+	    
+	    requests[i].result = github_repo_create();
+	    if (!requests[i].result) {
+	        requests[i].status = GITHUB_ERROR_MEMORY;
+	        continue;
+	    }
+	    
+	    requests[i].status = github_parse_graphql_repo(node, requests[i].result);
+	    if (requests[i].status != GITHUB_SUCCESS) {
+	        github_repo_destroy(requests[i].result);
+	        requests[i].result = NULL;
+	    }
+	}
+	
+	json_object_put(root);
+	return GITHUB_SUCCESS;
+}
+
+/* Get information for many repositories with batched GraphQL queries */
+int github_get_repos_graphql(struct github_client *client, struct github_repo_request *requests, size_t count)
+{
+	if (!client || (!requests && count > 0)) {
+	    return GITHUB_ERROR_INVALID;
+	}
+	
+	for (size_t i = 0; i < count; i++) {
+	    requests[i].result = NULL;
+	    requests[i].status = GITHUB_ERROR_INVALID;
+	}
+	
+	for (size_t start = 0; start < count; start += GITHUB_GRAPHQL_BATCH) {
+	    size_t batch = count - start < GITHUB_GRAPHQL_BATCH ? count - start : GITHUB_GRAPHQL_BATCH;
+	    int ret = github_graphql_batch(client, requests + start, batch);
+	    if (ret != GITHUB_SUCCESS) {
+	        return ret;
+	    }
+	}
+	
+	return GITHUB_SUCCESS;
+}
+
 /* Fork repository */
 int github_fork_repo(struct github_client *client, const char *owner, const char *repo, 
 	                 const char *organization, struct github_repo **result)
@@ -348,7 +1161,7 @@ int github_fork_repo(struct github_client *client, const char *owner, const char
 	}
 	
 	char url[GITHUB_MAX_URL_LEN];
-	snprintf(url, sizeof(url), "%s/repos/%s/%s/forks", GITHUB_API_BASE_URL, owner, repo);
+	snprintf(url, sizeof(url), "%s/repos/%s/%s/forks", client->api_url, owner, repo);
 	
 	/* Create JSON payload for fork request */
 	json_object *fork_data = json_object_new_object();
@@ -432,7 +1245,7 @@ int github_set_repo_private(struct github_client *client, const char *owner, con
 	}
 	
 	char url[GITHUB_MAX_URL_LEN];
-	snprintf(url, sizeof(url), "%s/repos/%s/%s", GITHUB_API_BASE_URL, owner, repo);
+	snprintf(url, sizeof(url), "%s/repos/%s/%s", client->api_url, owner, repo);
 	
 	/* Create JSON payload for privacy update */
 	json_object *update_data = json_object_new_object();
@@ -668,7 +1481,7 @@ int github_validate_token(struct github_client *client)
 	}
 	
 	char url[GITHUB_MAX_URL_LEN];
-	snprintf(url, sizeof(url), "%s/user", GITHUB_API_BASE_URL);
+	snprintf(url, sizeof(url), "%s/user", client->api_url);
 	
 	struct github_response *response;
 	int ret = github_make_request(client, "GET", url, NULL, &response);
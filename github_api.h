@@ -10,15 +10,32 @@
  */
 
 #include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
 
 /** @brief Base URL for GitHub API requests */
 #define GITHUB_API_BASE_URL "https://api.github.com"
+/** @brief Environment variable overriding GITHUB_API_BASE_URL, e.g. for a proxy or a test server */
+#define GITHUB_API_URL_ENV "GITHUB_API_URL"
 /** @brief Maximum length for GitHub URLs */
 #define GITHUB_MAX_URL_LEN 512
 /** @brief Maximum length for GitHub tokens */
 #define GITHUB_MAX_TOKEN_LEN 256
 /** @brief Maximum length for GitHub API responses */
 #define GITHUB_MAX_RESPONSE_LEN 65536
+/** @brief Largest response body kept in the response cache */
+#define GITHUB_MAX_CACHED_LEN (1024 * 1024)
+/** @brief Response cache directory name below the cache root */
+#define GITHUB_CACHE_DIR_NAME ".github-api"
+/** @brief Response cache entry file suffix */
+#define GITHUB_CACHE_SUFFIX ".http"
+/** @brief First line of every response cache entry */
+#define GITHUB_CACHE_MAGIC "GCHTTP 2"
+/** @brief Maximum repositories looked up by one GraphQL query */
+#define GITHUB_GRAPHQL_BATCH 50
+/** @brief Maximum connections opened to the API host by concurrent requests */
+#define GITHUB_MAX_CONNECTIONS 4
 
 /**
  * @brief GitHub API response structure
@@ -31,6 +48,25 @@ struct github_response {
 	size_t size;          /**< Size of response data */
 	long status_code;     /**< HTTP status code */
 	char *error_message;  /**< Error message if request failed */
+	char *etag;           /**< ETag header of the response, if any */
+	char *last_modified;  /**< Last-Modified header of the response, if any */
+	int from_cache;       /**< Body was served from the response cache after a 304 */
+};
+
+/**
+ * @brief Cached API response loaded from disk
+ *
+ * Entries are stored as a magic line, the credentials (a hash of the
+ * token, or "anonymous"), the URL, the ETag and the Last-Modified value,
+ * one per line, followed by the raw body. Clients with different tokens
+ * never share an entry.
+ */
+struct github_cache_entry {
+	char *buffer;         /**< Whole entry; the fields below point into it */
+	const char *etag;     /**< Stored ETag, empty if none */
+	const char *last_modified; /**< Stored Last-Modified, empty if none */
+	const char *body;     /**< Cached response body */
+	size_t body_size;     /**< Size of cached body */
 };
 
 /**
@@ -48,17 +84,41 @@ struct github_repo {
 	int is_fork;      /**< Whether repository is a fork */
 	int is_private;   /**< Whether repository is private */
 	int fork_count;   /**< Number of forks */
+	uint64_t size_kb; /**< Repository size reported by GitHub in KiB */
+	time_t pushed_at; /**< Time of the last push, 0 if unknown */
+	char *language;   /**< Primary language, NULL if unknown */
+	char *parent_full_name; /**< Full name of the repository it was forked from, NULL if not a fork */
 };
 
 /**
  * @brief GitHub API client structure
  * 
  * Manages authentication and configuration for GitHub API requests.
+ * The client keeps one libcurl handle and a share handle for its whole
+ * lifetime so connections, DNS results and TLS sessions are reused
+ * between requests. Handles belong to the process that created them; a
+ * forked child transparently opens its own on first use.
  */
 struct github_client {
 	char *token;      /**< GitHub personal access token */
 	char *user_agent; /**< User agent string for requests */
 	int timeout;      /**< Request timeout in seconds */
+	char *cache_dir;  /**< Response cache directory, NULL to disable */
+	char *api_url;    /**< API base URL without trailing slash */
+	void *curl;       /**< Reused easy handle (CURL *) */
+	void *share;      /**< Shared connection/DNS/TLS cache (CURLSH *) */
+	void *headers;    /**< Request headers (struct curl_slist *) */
+	pid_t owner_pid;  /**< Process owning the handles */
+};
+
+/**
+ * @brief One entry of a concurrent repository lookup
+ */
+struct github_repo_request {
+	const char *owner;           /**< Repository owner username */
+	const char *name;            /**< Repository name */
+	struct github_repo *result;  /**< Repository information on success */
+	int status;                  /**< 0 on success, negative error code on failure */
 };
 
 /* Function prototypes */
@@ -90,6 +150,20 @@ void github_client_destroy(struct github_client *client);
  */
 int github_client_set_timeout(struct github_client *client, int timeout_seconds);
 
+/**
+ * @brief Enable the on-disk response cache
+ *
+ * GET responses carrying an ETag or Last-Modified header are stored in
+ * cache_dir. Later requests for the same URL are sent as conditional
+ * requests and a 304 Not Modified is answered from the stored body,
+ * which GitHub does not count against the rate limit.
+ *
+ * @param client GitHub API client
+ * @param cache_dir Cache directory, created if missing (NULL disables caching)
+ * @return 0 on success, negative on error
+ */
+int github_client_set_cache_dir(struct github_client *client, const char *cache_dir);
+
 /** @} */
 
 /**
@@ -109,6 +183,33 @@ int github_client_set_timeout(struct github_client *client, int timeout_seconds)
 int github_get_repo(struct github_client *client, const char *owner, const char *repo, 
 	               struct github_repo **result);
 
+/**
+ * @brief Get information for several repositories concurrently
+ *
+ * Requests are multiplexed over HTTP/2 where available, using at most
+ * GITHUB_MAX_CONNECTIONS connections. Each entry gets its own status.
+ *
+ * @param client GitHub API client
+ * @param requests Array of lookups; result and status are filled in
+ * @param count Number of entries in requests
+ * @return 0 if all transfers were driven to completion, negative error code otherwise
+ */
+int github_get_repos(struct github_client *client, struct github_repo_request *requests, size_t count);
+
+/**
+ * @brief Get information for many repositories with batched GraphQL queries
+ *
+ * Looks up GITHUB_GRAPHQL_BATCH repositories per round trip. Results carry
+ * the same fields as github_get_repo(), with size_kb taken from diskUsage.
+ * Repositories that do not exist get GITHUB_ERROR_NOT_FOUND.
+ *
+ * @param client GitHub API client
+ * @param requests Array of lookups; result and status are filled in
+ * @param count Number of entries in requests
+ * @return 0 if every batch returned a response, negative error code otherwise
+ */
+int github_get_repos_graphql(struct github_client *client, struct github_repo_request *requests, size_t count);
+
 /**
  * @brief Fork a repository on GitHub
  * @param client GitHub API client
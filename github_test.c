@@ -69,6 +69,15 @@ static int test_basic_functionality(void)
 	}
 	printf("✓ Invalid timeout handling works\n");
 	
+	/* Test concurrent lookup argument handling */
+	if (github_get_repos(client, NULL, 0) != GITHUB_SUCCESS ||
+	    github_get_repos(client, NULL, 1) != GITHUB_ERROR_INVALID) {
+	    printf("ERROR: Concurrent lookup argument handling failed\n");
+	    github_client_destroy(client);
+	    return 1;
+	}
+	printf("✓ Concurrent lookup argument handling works\n");
+	
 	github_client_destroy(client);
 	printf("✓ Client destruction works\n");
 	
@@ -0,0 +1,332 @@
+/**
+ * @file ref_filter.c
+ * @brief Branch and tag filters that narrow cache fetches
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "ref_filter.h"
+#include "cache_exec.h"
+
+/**
+ * @brief Check a branch name or glob for characters git or the shell would mind
+ */
+static int is_valid_branch(const char *name)
+{
+	if (name[0] == '\0' || name[0] == '-' || name[0] == '/' || strstr(name, "..") ||
+	    strstr(name, "//") || name[strlen(name) - 1] == '/') {
+		return 0;
+	}
+	
+	int stars = 0;
+	for (const char *p = name; *p; p++) {
+		if (*p == '*') {
+			stars++;
+		} else if (!isalnum((unsigned char)*p) && !strchr("._-/+@=%#", *p)) {
+			return 0;
+		}
+	}
+	
+	/* Refspec patterns allow a single wildcard */
+	return stars <= 1;
+}
+
+/**
+ * @brief Parse a filter spec
+ */
+int ref_filter_parse(const char *spec, struct ref_filter *filter)
+{
+	if (!filter) {
+		return REF_FILTER_ERROR_INVALID;
+	}
+	
+	memset(filter, 0, sizeof(*filter));
+	filter->tags = REF_FILTER_TAGS_DEFAULT;
+	if (!spec) {
+		return REF_FILTER_SUCCESS;
+	}
+	
+	const char *p = spec;
+	while (*p) {
+		size_t len = strcspn(p, " \t,");
+		if (len == 0) {
+			p++;
+			continue;
+		}
+		if (len >= REF_FILTER_NAME_SIZE) {
+			return REF_FILTER_ERROR_TOO_LONG;
+		}
+	
+		char word[REF_FILTER_NAME_SIZE];
+		memcpy(word, p, len);
+		word[len] = '\0';
+		p += len;
+	
+		if (strcmp(word, "default") == 0) {
+			filter->narrow = 1;
+		} else if (strcmp(word, "tags") == 0) {
+			filter->tags = REF_FILTER_TAGS_ALL;
+		} else if (strcmp(word, "no-tags") == 0) {
+			filter->tags = REF_FILTER_TAGS_NONE;
+		} else {
+			/* refs/heads/ spells out branches named like a keyword */
+			const char *branch = strncmp(word, "refs/heads/", 11) == 0 ? word + 11 : word;
+			if (!is_valid_branch(branch)) {
+				return REF_FILTER_ERROR_INVALID;
+			}
+			if (filter->branch_count == REF_FILTER_MAX_BRANCHES) {
+				return REF_FILTER_ERROR_TOO_LONG;
+			}
+			snprintf(filter->branches[filter->branch_count++], REF_FILTER_NAME_SIZE, "%s", branch);
+			filter->narrow = 1;
+		}
+	}
+	
+	return REF_FILTER_SUCCESS;
+}
+
+/**
+ * @brief Set the remote default branch a narrowed filter keeps
+ */
+int ref_filter_set_default(struct ref_filter *filter, const char *branch)
+{
+	if (!filter || !branch) {
+		return REF_FILTER_ERROR_INVALID;
+	}
+	
+	if (strncmp(branch, "refs/heads/", 11) == 0) {
+		branch += 11;
+	}
+	if (!is_valid_branch(branch) || strchr(branch, '*')) {
+		return REF_FILTER_ERROR_INVALID;
+	}
+	
+	int len = snprintf(filter->default_branch, sizeof(filter->default_branch), "%s", branch);
+	if (len < 0 || (size_t)len >= sizeof(filter->default_branch)) {
+		filter->default_branch[0] = '\0';
+		return REF_FILTER_ERROR_TOO_LONG;
+	}
+	return REF_FILTER_SUCCESS;
+}
+
+/**
+ * @brief Check whether a filter fetches fewer branches than all of them
+ */
+int ref_filter_is_narrow(const struct ref_filter *filter)
+{
+	return filter && filter->narrow && filter->default_branch[0] != '\0';
+}
+
+/**
+ * @brief Match a branch name against a glob with at most one '*'
+ */
+static int branch_matches(const char *glob, const char *name)
+{
+	const char *star = strchr(glob, '*');
+	if (!star) {
+		return strcmp(glob, name) == 0;
+	}
+	
+	/* Like a refspec, the wildcard also matches slashes */
+	size_t prefix_len = (size_t)(star - glob);
+	size_t suffix_len = strlen(star + 1);
+	size_t name_len = strlen(name);
+	return name_len >= prefix_len + suffix_len &&
+	       strncmp(name, glob, prefix_len) == 0 &&
+	       strcmp(name + name_len - suffix_len, star + 1) == 0;
+}
+
+/**
+ * @brief Check whether a filter fetches a branch
+ */
+int ref_filter_matches(const struct ref_filter *filter, const char *ref_name)
+{
+	if (!filter || !ref_name || strncmp(ref_name, "refs/heads/", 11) != 0) {
+		return 0;
+	}
+	
+	const char *branch = ref_name + 11;
+	if (!ref_filter_is_narrow(filter) || strcmp(branch, filter->default_branch) == 0) {
+		return 1;
+	}
+	for (size_t i = 0; i < filter->branch_count; i++) {
+		if (branch_matches(filter->branches[i], branch)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Append to an argument buffer, failing when it is full
+ *
+ * The format may use value for up to two %s conversions.
+ */
+static int append_arg(char *args, size_t args_size, size_t *used, const char *format,
+                      const char *value)
+{
+	int len = snprintf(args + *used, args_size - *used, format, value, value);
+	if (len < 0 || (size_t)len >= args_size - *used) {
+		return REF_FILTER_ERROR_TOO_LONG;
+	}
+	*used += (size_t)len;
+	return REF_FILTER_SUCCESS;
+}
+
+/**
+ * @brief Append a refspec for name to a fetch argument list
+ */
+static int add_refspec(struct ref_filter_args *args, size_t *refspec_count, const char *format,
+                       const char *name)
+{
+	if (args->argc >= REF_FILTER_MAX_ARGS || *refspec_count >= REF_FILTER_MAX_BRANCHES + 2) {
+		return REF_FILTER_ERROR_TOO_LONG;
+	}
+	
+	char *refspec = args->refspecs[(*refspec_count)++];
+	int len = snprintf(refspec, REF_FILTER_REFSPEC_SIZE, format, name, name);
+	if (len < 0 || len >= REF_FILTER_REFSPEC_SIZE) {
+		return REF_FILTER_ERROR_TOO_LONG;
+	}
+	args->argv[args->argc++] = refspec;
+	args->argv[args->argc] = NULL;
+	return REF_FILTER_SUCCESS;
+}
+
+/**
+ * @brief Build the git fetch arguments for a filter
+ */
+int ref_filter_fetch_args(const struct ref_filter *filter, const char *remote, int initial,
+                          struct ref_filter_args *args)
+{
+	if (!filter || !remote || !args) {
+		return REF_FILTER_ERROR_INVALID;
+	}
+	
+	size_t refspec_count = 0;
+	args->argc = 0;
+	if (filter->tags == REF_FILTER_TAGS_NONE) {
+		args->argv[args->argc++] = "--no-tags";
+	}
+	args->argv[args->argc++] = remote;
+	args->argv[args->argc] = NULL;
+	
+	int ret;
+	if (!ref_filter_is_narrow(filter)) {
+		ret = add_refspec(args, &refspec_count, "+refs/heads/*:refs/heads/*", "");
+	} else {
+		ret = add_refspec(args, &refspec_count, "+refs/heads/%s:refs/heads/%s",
+		                  filter->default_branch);
+		for (size_t i = 0; ret == REF_FILTER_SUCCESS && i < filter->branch_count; i++) {
+			if (strcmp(filter->branches[i], filter->default_branch) != 0) {
+				ret = add_refspec(args, &refspec_count, "+refs/heads/%s:refs/heads/%s",
+				                  filter->branches[i]);
+			}
+		}
+	}
+	
+	int all_tags = filter->tags == REF_FILTER_TAGS_ALL ||
+	               (filter->tags == REF_FILTER_TAGS_DEFAULT && initial);
+	if (ret == REF_FILTER_SUCCESS && all_tags) {
+		ret = add_refspec(args, &refspec_count, "+refs/tags/*:refs/tags/*", "");
+	}
+	
+	if (ret != REF_FILTER_SUCCESS) {
+		args->argc = 0;
+		args->argv[0] = NULL;
+	}
+	return ret;
+}
+
+/**
+ * @brief Write a filter back as a canonical spec
+ */
+int ref_filter_format(const struct ref_filter *filter, char *spec, size_t spec_size)
+{
+	if (!filter || !spec || spec_size == 0) {
+		return REF_FILTER_ERROR_INVALID;
+	}
+	
+	size_t used = 0;
+	int ret = REF_FILTER_SUCCESS;
+	spec[0] = '\0';
+	if (filter->narrow && filter->branch_count == 0) {
+		ret = append_arg(spec, spec_size, &used, "%s", "default");
+	}
+	for (size_t i = 0; ret == REF_FILTER_SUCCESS && i < filter->branch_count; i++) {
+		const char *branch = filter->branches[i];
+		int keyword = strcmp(branch, "default") == 0 || strcmp(branch, "tags") == 0 ||
+		              strcmp(branch, "no-tags") == 0;
+		char word[REF_FILTER_NAME_SIZE + sizeof("refs/heads/")];
+		snprintf(word, sizeof(word), "%s%s", keyword ? "refs/heads/" : "", branch);
+		ret = append_arg(spec, spec_size, &used, used ? " %s" : "%s", word);
+	}
+	
+	if (ret == REF_FILTER_SUCCESS && filter->tags != REF_FILTER_TAGS_DEFAULT) {
+		ret = append_arg(spec, spec_size, &used, used ? " %s" : "%s",
+		                 filter->tags == REF_FILTER_TAGS_ALL ? "tags" : "no-tags");
+	}
+	
+	if (ret != REF_FILTER_SUCCESS) {
+		spec[0] = '\0';
+	}
+	return ret;
+}
+
+/**
+ * @brief Ask origin of a repository for its default branch
+ */
+int ref_filter_remote_head(const char *repo_path, char *branch, size_t branch_size)
+{
+	if (!repo_path || !branch || branch_size == 0) {
+		return 0;
+	}
+	
+	static const char *const env[] = { "GIT_TERMINAL_PROMPT=0", NULL };
+	const char *argv[] = { "git", "-c", "protocol.version=2", "ls-remote", "--symref",
+	                       "origin", "HEAD", NULL };
+	struct cache_exec_options options;
+	memset(&options, 0, sizeof(options));
+	options.cwd = repo_path;
+	options.env = env;
+	options.out = CACHE_EXEC_CAPTURE;
+	options.err = CACHE_EXEC_DISCARD;
+	
+	struct cache_exec_result result;
+	int found = 0;
+	if (cache_exec_run(argv, &options, &result) == CACHE_EXEC_SUCCESS && result.out) {
+		for (const char *line = result.out; line; line = strchr(line, '\n')) {
+			line += *line == '\n';
+			size_t len = strcspn(line, "\t\n");
+			if (strncmp(line, "ref: refs/heads/", 16) == 0 && line[len] == '\t') {
+				int written = snprintf(branch, branch_size, "%.*s", (int)(len - 16), line + 16);
+				found = written >= 0 && (size_t)written < branch_size;
+				break;
+			}
+		}
+	}
+	cache_exec_free_result(&result);
+	
+	return found;
+}
+
+/**
+ * @brief Get human-readable error message for ref filter error code
+ */
+const char* ref_filter_error_string(int error_code)
+{
+	switch (error_code) {
+		case REF_FILTER_SUCCESS:
+			return "Success";
+		case REF_FILTER_ERROR_INVALID:
+			return "Invalid ref filter";
+		case REF_FILTER_ERROR_TOO_LONG:
+			return "Ref filter too long";
+		default:
+			return "Unknown error";
+	}
+}
@@ -0,0 +1,160 @@
+#ifndef REF_FILTER_H
+#define REF_FILTER_H
+
+/**
+ * @file ref_filter.h
+ * @brief Branch and tag filters that narrow cache fetches
+ *
+ * A filter spec is a list of words separated by spaces or commas:
+ * "default" keeps only the remote's default branch, any other word is a
+ * branch glob (e.g. "release-*", at most one '*'), and "tags" or "no-tags"
+ * fetch all tags on every fetch or none at all. An empty spec fetches all
+ * branches as before. A narrowed filter always keeps the default branch so
+ * HEAD of the cache stays valid. The refspecs built from a filter are sent
+ * with protocol v2, whose ref-prefix arguments make the server advertise
+ * only the refs that are asked for instead of every ref it has.
+ */
+
+#include <stddef.h>
+
+/**
+ * @brief Branch globs a filter holds at most
+ */
+#define REF_FILTER_MAX_BRANCHES 32
+
+/**
+ * @brief Buffer size of a branch name or glob
+ */
+#define REF_FILTER_NAME_SIZE 256
+
+/**
+ * @brief Buffer size of one refspec
+ */
+#define REF_FILTER_REFSPEC_SIZE (2 * REF_FILTER_NAME_SIZE + 32)
+
+/**
+ * @brief Most fetch arguments any filter produces
+ *
+ * --no-tags, the remote, the default branch, the branch globs and the tags.
+ */
+#define REF_FILTER_MAX_ARGS (REF_FILTER_MAX_BRANCHES + 4)
+
+/**
+ * @brief Ref filter error codes
+ */
+#define REF_FILTER_SUCCESS          0
+#define REF_FILTER_ERROR_INVALID   -1
+#define REF_FILTER_ERROR_TOO_LONG  -2
+
+/**
+ * @brief Which tags a fetch brings along
+ */
+enum ref_filter_tags {
+	REF_FILTER_TAGS_DEFAULT,    /**< All tags on the initial clone, followed tags afterwards */
+	REF_FILTER_TAGS_ALL,        /**< All tags on every fetch */
+	REF_FILTER_TAGS_NONE        /**< No tags */
+};
+
+/**
+ * @brief git fetch arguments built from a filter
+ */
+struct ref_filter_args {
+	const char *argv[REF_FILTER_MAX_ARGS + 1]; /**< Arguments, NULL-terminated */
+	size_t argc;                /**< Number of arguments */
+	char refspecs[REF_FILTER_MAX_BRANCHES + 2][REF_FILTER_REFSPEC_SIZE]; /**< Storage of the refspecs */
+};
+
+/**
+ * @brief Parsed ref filter
+ */
+struct ref_filter {
+	int narrow;                 /**< Only the default branch and the globs below */
+	char branches[REF_FILTER_MAX_BRANCHES][REF_FILTER_NAME_SIZE]; /**< Branch globs without refs/heads/ */
+	size_t branch_count;        /**< Number of branch globs */
+	enum ref_filter_tags tags;  /**< Tags to fetch */
+	char default_branch[REF_FILTER_NAME_SIZE]; /**< Remote default branch, "" if unknown */
+};
+
+/**
+ * @brief Parse a filter spec
+ *
+ * The default branch is left empty; set it with ref_filter_set_default().
+ *
+ * @param spec Filter spec, NULL or empty for all branches
+ * @param filter Output filter
+ * @return REF_FILTER_SUCCESS on success, error code on failure
+ */
+int ref_filter_parse(const char *spec, struct ref_filter *filter);
+
+/**
+ * @brief Set the remote default branch a narrowed filter keeps
+ * @param filter Filter to update
+ * @param branch Branch name, with or without refs/heads/
+ * @return REF_FILTER_SUCCESS on success, error code on failure
+ */
+int ref_filter_set_default(struct ref_filter *filter, const char *branch);
+
+/**
+ * @brief Check whether a filter fetches fewer branches than all of them
+ *
+ * A narrowed filter whose default branch is unknown fetches all branches.
+ *
+ * @param filter Filter
+ * @return 1 if only some branches are fetched, 0 otherwise
+ */
+int ref_filter_is_narrow(const struct ref_filter *filter);
+
+/**
+ * @brief Check whether a filter fetches a branch
+ * @param filter Filter
+ * @param ref_name Full ref name, e.g. "refs/heads/main"
+ * @return 1 if the ref is a fetched branch, 0 otherwise
+ */
+int ref_filter_matches(const struct ref_filter *filter, const char *ref_name);
+
+/**
+ * @brief Build the git fetch arguments for a filter
+ *
+ * Produces "[--no-tags] <remote> <refspec>...", each branch mapped to the
+ * same name as git clone --bare does. The arguments point into args and
+ * remote, and are meant to follow "git fetch" in an argv.
+ *
+ * @param filter Filter
+ * @param remote Remote to fetch from
+ * @param initial Whether this is the initial fetch of a new cache
+ * @param args Output arguments
+ * @return REF_FILTER_SUCCESS on success, error code on failure
+ */
+int ref_filter_fetch_args(const struct ref_filter *filter, const char *remote, int initial,
+                          struct ref_filter_args *args);
+
+/**
+ * @brief Write a filter back as a canonical spec
+ * @param filter Filter
+ * @param spec Buffer for the spec ("" for all branches)
+ * @param spec_size Size of buffer
+ * @return REF_FILTER_SUCCESS on success, error code on failure
+ */
+int ref_filter_format(const struct ref_filter *filter, char *spec, size_t spec_size);
+
+/**
+ * @brief Ask origin of a repository for its default branch
+ *
+ * Runs git ls-remote --symref origin HEAD, which with protocol v2 only
+ * advertises HEAD.
+ *
+ * @param repo_path Repository path
+ * @param branch Buffer for the branch name without refs/heads/
+ * @param branch_size Size of buffer
+ * @return 1 if found, 0 if not
+ */
+int ref_filter_remote_head(const char *repo_path, char *branch, size_t branch_size);
+
+/**
+ * @brief Get human-readable error message for ref filter error code
+ * @param error_code Ref filter error code
+ * @return Error message string
+ */
+const char* ref_filter_error_string(int error_code);
+
+#endif /* REF_FILTER_H */
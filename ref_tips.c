@@ -0,0 +1,395 @@
+/**
+ * @file ref_tips.c
+ * @brief Direct reading of git ref tips implementation
+ *
+ * Only the on-disk "files" ref backend is understood: packed-refs plus one
+ * file per loose ref under refs/. That is what every repository created by
+ * git-cache uses.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "ref_tips.h"
+
+/**
+ * @brief One ref and what it points to
+ */
+struct ref_entry {
+	char *name;                 /**< Full ref name */
+	char *value;                /**< Object name, or "ref: <target>" */
+	int loose;                  /**< Read from a loose ref file */
+};
+
+/**
+ * @brief Growable list of refs
+ */
+struct ref_list {
+	struct ref_entry *entries;
+	size_t count;
+	size_t capacity;
+};
+
+/**
+ * @brief Check for a full hex object name
+ */
+static int is_object_name(const char *value)
+{
+	size_t len = strspn(value, "0123456789abcdef");
+	return value[len] == '\0' && (len == 40 || len == 64);
+}
+
+/**
+ * @brief Append a ref to the list
+ */
+static int ref_list_add(struct ref_list *list, const char *name, const char *value, int loose)
+{
+	if (list->count == list->capacity) {
+		size_t new_capacity = list->capacity ? list->capacity * 2 : 64;
+		struct ref_entry *entries = realloc(list->entries, new_capacity * sizeof(*entries));
+		if (!entries) {
+			return REF_TIPS_ERROR_MEMORY;
+		}
+		list->entries = entries;
+		list->capacity = new_capacity;
+	}
+	
+	struct ref_entry *entry = &list->entries[list->count];
+	entry->name = strdup(name);
+	entry->value = strdup(value);
+	entry->loose = loose;
+	if (!entry->name || !entry->value) {
+		free(entry->name);
+		free(entry->value);
+		return REF_TIPS_ERROR_MEMORY;
+	}
+	list->count++;
+	return REF_TIPS_SUCCESS;
+}
+
+/**
+ * @brief Free a ref list
+ */
+static void ref_list_free(struct ref_list *list)
+{
+	for (size_t i = 0; i < list->count; i++) {
+		free(list->entries[i].name);
+		free(list->entries[i].value);
+	}
+	free(list->entries);
+	memset(list, 0, sizeof(*list));
+}
+
+/**
+ * @brief Read the first line of a file, without the line ending
+ */
+static int read_first_line(const char *path, char *line, size_t line_size)
+{
+	FILE *fp = fopen(path, "r");
+	if (!fp) {
+		return -1;
+	}
+	
+	int ok = fgets(line, (int)line_size, fp) != NULL;
+	fclose(fp);
+	if (!ok) {
+		return -1;
+	}
+	
+	line[strcspn(line, "\r\n")] = '\0';
+	return 0;
+}
+
+/**
+ * @brief Add every entry of packed-refs to the list
+ */
+static int read_packed_refs(const char *git_dir, struct ref_list *list)
+{
+	char path[4096];
+	snprintf(path, sizeof(path), "%s/packed-refs", git_dir);
+	
+	FILE *fp = fopen(path, "r");
+	if (!fp) {
+		return REF_TIPS_SUCCESS;
+	}
+	
+	int ret = REF_TIPS_SUCCESS;
+	char line[4096];
+	while (fgets(line, sizeof(line), fp)) {
+		/* Skip the header and peeled tag lines */
+		if (line[0] == '#' || line[0] == '^') {
+			continue;
+		}
+		line[strcspn(line, "\r\n")] = '\0';
+	
+		char *space = strchr(line, ' ');
+		if (!space) {
+			continue;
+		}
+		*space = '\0';
+		if (!is_object_name(line)) {
+			continue;
+		}
+	
+		ret = ref_list_add(list, space + 1, line, 0);
+		if (ret != REF_TIPS_SUCCESS) {
+			break;
+		}
+	}
+	
+	fclose(fp);
+	return ret;
+}
+
+/**
+ * @brief Add every loose ref below dir_path to the list
+ */
+static int read_loose_refs(const char *dir_path, const char *ref_prefix, struct ref_list *list)
+{
+	DIR *dir = opendir(dir_path);
+	if (!dir) {
+		return REF_TIPS_SUCCESS;
+	}
+	
+	int ret = REF_TIPS_SUCCESS;
+	const struct dirent *entry;
+	while (ret == REF_TIPS_SUCCESS && (entry = readdir(dir)) != NULL) {
+		size_t name_len = strlen(entry->d_name);
+		if (entry->d_name[0] == '.' ||
+		    (name_len > 5 && strcmp(entry->d_name + name_len - 5, ".lock") == 0)) {
+			continue;
+		}
+	
+		char path[4096];
+		char ref_name[4096];
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+		snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name);
+		snprintf(ref_name, sizeof(ref_name), "%s/%s", ref_prefix, entry->d_name);
+#pragma GCC diagnostic pop
+	
+		struct stat st;
+		if (lstat(path, &st) != 0) {
+			continue;
+		}
+	
+		if (S_ISDIR(st.st_mode)) {
+			ret = read_loose_refs(path, ref_name, list);
+		} else if (S_ISREG(st.st_mode)) {
+			char value[4096];
+			if (read_first_line(path, value, sizeof(value)) == 0 &&
+			    (is_object_name(value) || strncmp(value, "ref: ", 5) == 0)) {
+				ret = ref_list_add(list, ref_name, value, 1);
+			}
+		}
+	}
+	
+	closedir(dir);
+	return ret;
+}
+
+/**
+ * @brief Order refs by name, packed entries before loose ones
+ */
+static int compare_refs(const void *a, const void *b)
+{
+	const struct ref_entry *ra = (const struct ref_entry *)a;
+	const struct ref_entry *rb = (const struct ref_entry *)b;
+	int cmp = strcmp(ra->name, rb->name);
+	return cmp != 0 ? cmp : ra->loose - rb->loose;
+}
+
+/**
+ * @brief Feed bytes into a 64-bit FNV-1a hash
+ */
+static uint64_t fnv1a_update(uint64_t hash, const char *data, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+/**
+ * @brief Add one ref to a digest
+ */
+uint64_t ref_tips_digest_add(uint64_t digest, const char *name, const char *value)
+{
+	digest = fnv1a_update(digest, name, strlen(name) + 1);
+	return fnv1a_update(digest, value, strlen(value) + 1);
+}
+
+/**
+ * @brief Match refs starting with a prefix
+ */
+static int match_prefix(const char *name, void *data)
+{
+	const char *prefix = data;
+	return !prefix || strncmp(name, prefix, strlen(prefix)) == 0;
+}
+
+/**
+ * @brief Compute a digest over the ref tips of a repository
+ */
+int ref_tips_digest(const char *git_dir, const char *prefix, uint64_t *digest)
+{
+	return ref_tips_digest_matching(git_dir, match_prefix, (void *)prefix, digest);
+}
+
+/**
+ * @brief Compute a digest over the ref tips a matcher selects
+ */
+int ref_tips_digest_matching(const char *git_dir, int (*match)(const char *name, void *data),
+                             void *data, uint64_t *digest)
+{
+	if (!git_dir || !match || !digest) {
+		return REF_TIPS_ERROR_INVALID;
+	}
+	
+	struct ref_list list = { 0 };
+	int ret = read_packed_refs(git_dir, &list);
+	if (ret == REF_TIPS_SUCCESS) {
+		char refs_dir[4096];
+		snprintf(refs_dir, sizeof(refs_dir), "%s/refs", git_dir);
+		ret = read_loose_refs(refs_dir, "refs", &list);
+	}
+	if (ret != REF_TIPS_SUCCESS) {
+		ref_list_free(&list);
+		return ret;
+	}
+	
+	if (list.count > 0) {
+		qsort(list.entries, list.count, sizeof(*list.entries), compare_refs);
+	}
+	
+	/* Hash each name once, using the loose value where both exist */
+	uint64_t hash = REF_TIPS_DIGEST_INIT;
+	for (size_t i = 0; i < list.count; i++) {
+		if ((i + 1 < list.count && strcmp(list.entries[i].name, list.entries[i + 1].name) == 0) ||
+		    !match(list.entries[i].name, data)) {
+			continue;
+		}
+		hash = ref_tips_digest_add(hash, list.entries[i].name, list.entries[i].value);
+	}
+	
+	ref_list_free(&list);
+	*digest = hash;
+	return REF_TIPS_SUCCESS;
+}
+
+/**
+ * @brief Look a ref up in packed-refs
+ */
+static int find_packed_ref(const char *git_dir, const char *name, char *sha)
+{
+	char path[4096];
+	snprintf(path, sizeof(path), "%s/packed-refs", git_dir);
+	
+	FILE *fp = fopen(path, "r");
+	if (!fp) {
+		return REF_TIPS_ERROR_NOT_FOUND;
+	}
+	
+	int ret = REF_TIPS_ERROR_NOT_FOUND;
+	char line[4096];
+	while (fgets(line, sizeof(line), fp)) {
+		if (line[0] == '#' || line[0] == '^') {
+			continue;
+		}
+		line[strcspn(line, "\r\n")] = '\0';
+	
+		char *space = strchr(line, ' ');
+		if (!space || strcmp(space + 1, name) != 0) {
+			continue;
+		}
+		*space = '\0';
+		if (is_object_name(line)) {
+			strcpy(sha, line);
+			ret = REF_TIPS_SUCCESS;
+		}
+		break;
+	}
+	
+	fclose(fp);
+	return ret;
+}
+
+/**
+ * @brief Resolve a ref to the object it points to
+ */
+int ref_tips_resolve(const char *git_dir, const char *name, char *sha,
+                     char *resolved_name, size_t resolved_size)
+{
+	if (!git_dir || !name || !sha || strstr(name, "..")) {
+		return REF_TIPS_ERROR_INVALID;
+	}
+	
+	char current[1024];
+	if (strlen(name) >= sizeof(current)) {
+		return REF_TIPS_ERROR_INVALID;
+	}
+	strcpy(current, name);
+	
+	for (int depth = 0; depth <= REF_TIPS_MAX_SYMREF_DEPTH; depth++) {
+		char path[4096];
+		char value[1024];
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+		snprintf(path, sizeof(path), "%s/%s", git_dir, current);
+#pragma GCC diagnostic pop
+	
+		int found;
+		if (read_first_line(path, value, sizeof(value)) == 0) {
+			if (strncmp(value, "ref: ", 5) == 0) {
+				/* Follow the symbolic ref */
+				if (strstr(value + 5, "..")) {
+					return REF_TIPS_ERROR_INVALID;
+				}
+				memmove(current, value + 5, strlen(value + 5) + 1);
+				continue;
+			}
+			found = is_object_name(value);
+			if (found) {
+				strcpy(sha, value);
+			}
+		} else {
+			found = find_packed_ref(git_dir, current, sha) == REF_TIPS_SUCCESS;
+		}
+	
+		if (!found) {
+			return REF_TIPS_ERROR_NOT_FOUND;
+		}
+		if (resolved_name && resolved_size > 0) {
+			snprintf(resolved_name, resolved_size, "%s", current);
+		}
+		return REF_TIPS_SUCCESS;
+	}
+	
+	return REF_TIPS_ERROR_NOT_FOUND;
+}
+
+/**
+ * @brief Get human-readable error message for ref tips error code
+ */
+const char* ref_tips_error_string(int error_code)
+{
+	switch (error_code) {
+		case REF_TIPS_SUCCESS:
+			return "Success";
+		case REF_TIPS_ERROR_INVALID:
+			return "Invalid argument";
+		case REF_TIPS_ERROR_IO:
+			return "I/O error";
+		case REF_TIPS_ERROR_MEMORY:
+			return "Memory allocation failed";
+		case REF_TIPS_ERROR_NOT_FOUND:
+			return "Ref not found";
+		default:
+			return "Unknown error";
+	}
+}
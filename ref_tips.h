@@ -0,0 +1,102 @@
+#ifndef REF_TIPS_H
+#define REF_TIPS_H
+
+/**
+ * @file ref_tips.h
+ * @brief Direct reading of git ref tips for git-cache
+ *
+ * Reads packed-refs and loose refs without running git, so sync can tell
+ * which repositories actually moved a ref during a fetch and checkout
+ * repair can compare commit SHAs instead of directory mtimes. Loose refs
+ * take precedence over packed-refs entries of the same name, as in git.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Buffer size for a hex object name (SHA-1 or SHA-256) plus NUL
+ */
+#define REF_TIPS_HEX_MAX 65
+
+/**
+ * @brief Symbolic refs followed before giving up
+ */
+#define REF_TIPS_MAX_SYMREF_DEPTH 5
+
+/**
+ * @brief Ref tips error codes
+ */
+#define REF_TIPS_SUCCESS           0
+#define REF_TIPS_ERROR_INVALID    -1
+#define REF_TIPS_ERROR_IO         -2
+#define REF_TIPS_ERROR_MEMORY     -3
+#define REF_TIPS_ERROR_NOT_FOUND  -4
+
+/**
+ * @brief Initial value for digests built with ref_tips_digest_add()
+ */
+#define REF_TIPS_DIGEST_INIT 14695981039346656037ULL
+
+/**
+ * @brief Compute a digest over the ref tips of a repository
+ *
+ * Covers each ref under refs/ together with the object it points to (or
+ * its target for symbolic refs), so two digests differ exactly when a ref
+ * was created, deleted or moved in between.
+ *
+ * @param git_dir Git directory (bare repository or .git directory)
+ * @param prefix Only include refs starting with this, e.g. "refs/heads/" (NULL for all)
+ * @param digest Output digest
+ * @return REF_TIPS_SUCCESS on success, error code on failure
+ */
+int ref_tips_digest(const char *git_dir, const char *prefix, uint64_t *digest);
+
+/**
+ * @brief Compute a digest over the ref tips a matcher selects
+ *
+ * Same as ref_tips_digest() for the refs match() accepts.
+ *
+ * @param git_dir Git directory (bare repository or .git directory)
+ * @param match Returns non-zero for refs to include
+ * @param data Passed to match()
+ * @param digest Output digest
+ * @return REF_TIPS_SUCCESS on success, error code on failure
+ */
+int ref_tips_digest_matching(const char *git_dir, int (*match)(const char *name, void *data),
+                             void *data, uint64_t *digest);
+
+/**
+ * @brief Add one ref to a digest
+ *
+ * Starting from REF_TIPS_DIGEST_INIT and adding refs in strcmp() order of
+ * their names gives the same digest ref_tips_digest() computes, so ref
+ * listings from elsewhere (e.g. git ls-remote) can be compared with it.
+ *
+ * @param digest Digest so far
+ * @param name Full ref name
+ * @param value Object name the ref points to
+ * @return Updated digest
+ */
+uint64_t ref_tips_digest_add(uint64_t digest, const char *name, const char *value);
+
+/**
+ * @brief Resolve a ref to the object it points to
+ * @param git_dir Git directory (bare repository or .git directory)
+ * @param name Ref name, e.g. "HEAD" or "refs/heads/main"
+ * @param sha Output hex object name, REF_TIPS_HEX_MAX bytes
+ * @param resolved_name Output for the ref finally resolved after symbolic refs (may be NULL)
+ * @param resolved_size Size of resolved_name
+ * @return REF_TIPS_SUCCESS on success, REF_TIPS_ERROR_NOT_FOUND if the ref does not exist
+ */
+int ref_tips_resolve(const char *git_dir, const char *name, char *sha,
+                     char *resolved_name, size_t resolved_size);
+
+/**
+ * @brief Get human-readable error message for ref tips error code
+ * @param error_code Ref tips error code
+ * @return Error message string
+ */
+const char* ref_tips_error_string(int error_code);
+
+#endif /* REF_TIPS_H */
@@ -11,14 +11,34 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <dirent.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <errno.h>
 #include <time.h>
+#include <limits.h>
 
 #include "git-cache.h"
 #include "remote_sync.h"
 #include "cache_metadata.h"
+#include "ref_tips.h"
+#include "cache_exec.h"
+
+/* Expected transfer sizes used to weigh throughput against round trips */
+#define MIRROR_FETCH_BYTES        (1024.0 * 1024.0)
+#define MIRROR_CLONE_BYTES        (256.0 * 1024.0 * 1024.0)
+/* Assumed for mirrors without a measurement, so they still get tried */
+#define MIRROR_UNPROBED_RTT_MS    1000.0
+#define MIRROR_DEFAULT_KBPS       4096.0
+/* Weight of the newest sample in the smoothed history */
+#define MIRROR_HISTORY_WEIGHT     0.3
+/* Transfers smaller than this say more about latency than throughput */
+#define MIRROR_MIN_TRANSFER_BYTES 65536
+
+static struct remote_mirror* run_mirror_probes(struct remote_mirror **mirrors, int count,
+                                               int first_wins);
 
 /**
  * @brief Load synchronization configuration with defaults
@@ -37,6 +57,8 @@ int load_sync_config(struct sync_config *config)
 	config->retry_delay_seconds = 30;
 	config->preferred_mirror = NULL;
 	config->fallback_enabled = 1;
+	config->maintenance_interval_hours = 24 * 7;
+	config->maintenance_pack_threshold = 16;
 	
 	/* Load from environment variables */
 	const char *auto_sync = getenv("GIT_CACHE_AUTO_SYNC");
@@ -52,6 +74,33 @@ int load_sync_config(struct sync_config *config)
 		}
 	}
 	
+	const char *max_syncs = getenv("GIT_CACHE_MAX_CONCURRENT_SYNCS");
+	if (max_syncs) {
+		int max = atoi(max_syncs);
+		if (max > 0) {
+			config->max_concurrent_syncs = max;
+		}
+	}
+	
+	/* Zero is meaningful here: it turns the trigger off */
+	const char *maintenance_interval = getenv("GIT_CACHE_MAINTENANCE_INTERVAL");
+	if (maintenance_interval && maintenance_interval[0] != '\0') {
+		char *end;
+		long interval = strtol(maintenance_interval, &end, 10);
+		if (*end == '\0' && interval >= 0 && interval <= INT_MAX / 3600) {
+			config->maintenance_interval_hours = (int)interval;
+		}
+	}
+	
+	const char *maintenance_packs = getenv("GIT_CACHE_MAINTENANCE_PACKS");
+	if (maintenance_packs && maintenance_packs[0] != '\0') {
+		char *end;
+		long packs = strtol(maintenance_packs, &end, 10);
+		if (*end == '\0' && packs >= 0 && packs <= INT_MAX) {
+			config->maintenance_pack_threshold = (int)packs;
+		}
+	}
+	
 	const char *preferred_mirror = getenv("GIT_CACHE_PREFERRED_MIRROR");
 	if (preferred_mirror) {
 		config->preferred_mirror = strdup(preferred_mirror);
@@ -60,6 +109,25 @@ int load_sync_config(struct sync_config *config)
 	return SYNC_SUCCESS;
 }
 
+/**
+ * @brief Capture the names of the remotes of a repository, one per line
+ */
+static int list_remote_names(const char *repo_path, struct cache_exec_result *result)
+{
+	const char *argv[] = { "git", "remote", NULL };
+	struct cache_exec_options options;
+	memset(&options, 0, sizeof(options));
+	options.cwd = repo_path;
+	options.out = CACHE_EXEC_CAPTURE;
+	
+	if (cache_exec_run(argv, &options, result) != CACHE_EXEC_SUCCESS || result->exit_code != 0 ||
+	    !result->out) {
+		cache_exec_free_result(result);
+		return SYNC_ERROR_NETWORK;
+	}
+	return SYNC_SUCCESS;
+}
+
 /**
  * @brief Add remote mirror to repository
  */
@@ -70,15 +138,11 @@ int add_remote_mirror(const struct repo_info *repo, const char *mirror_name,
 		return SYNC_ERROR_INVALID;
 	}
 	
-	/* Add git remote to the cached repository */
-	char add_remote_cmd[8192];
-	snprintf(add_remote_cmd, sizeof(add_remote_cmd),
-	         "cd \"%s\" && git remote add \"%s\" \"%s\" 2>/dev/null || "
-	         "git remote set-url \"%s\" \"%s\"",
-	         repo->cache_path, mirror_name, mirror_url, mirror_name, mirror_url);
-	
-	int result = system(add_remote_cmd);
-	if (WEXITSTATUS(result) != 0) {
+	/* Add git remote to the cached repository, or repoint one that is there */
+	const char *add_argv[] = { "git", "remote", "add", mirror_name, mirror_url, NULL };
+	const char *set_url_argv[] = { "git", "remote", "set-url", mirror_name, mirror_url, NULL };
+	if (cache_exec_status(add_argv, repo->cache_path, 1) != 0 &&
+	    cache_exec_status(set_url_argv, repo->cache_path, 0) != 0) {
 		return SYNC_ERROR_NETWORK;
 	}
 	
@@ -107,19 +171,323 @@ int remove_remote_mirror(const struct repo_info *repo, const char *mirror_name)
 	}
 	
 	/* Remove git remote from the cached repository */
-	char remove_remote_cmd[4096];
-	snprintf(remove_remote_cmd, sizeof(remove_remote_cmd),
-	         "cd \"%s\" && git remote remove \"%s\" 2>/dev/null",
-	         repo->cache_path, mirror_name);
+	const char *remove_argv[] = { "git", "remote", "remove", mirror_name, NULL };
+	if (cache_exec_status(remove_argv, repo->cache_path, 1) != 0) {
+		return SYNC_ERROR_NOT_FOUND;
+	}
+	
+	/* Drop it from the registry so mirror selection stops probing it */
+	char metadata_file[4096];
+	char temp_file[4096];
+	snprintf(metadata_file, sizeof(metadata_file), "%s/mirrors.txt", repo->cache_path);
+	snprintf(temp_file, sizeof(temp_file), "%s/mirrors.txt.tmp", repo->cache_path);
+	
+	FILE *in = fopen(metadata_file, "r");
+	if (!in) {
+		return SYNC_SUCCESS;
+	}
+	FILE *out = fopen(temp_file, "w");
+	if (!out) {
+		fclose(in);
+		return SYNC_SUCCESS;
+	}
+	
+	size_t name_len = strlen(mirror_name);
+	char line[8192];
+	while (fgets(line, sizeof(line), in)) {
+		if (strncmp(line, mirror_name, name_len) == 0 && line[name_len] == '\t') {
+			continue;
+		}
+		fputs(line, out);
+	}
+	fclose(in);
+	if (fclose(out) == 0) {
+		rename(temp_file, metadata_file);
+	} else {
+		unlink(temp_file);
+	}
+	
+	return SYNC_SUCCESS;
+}
+
+/**
+ * @brief Milliseconds elapsed since a CLOCK_MONOTONIC start time
+ */
+static double elapsed_ms_since(const struct timespec *start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)(now.tv_sec - start->tv_sec) * 1000.0 +
+	       (double)(now.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+/**
+ * @brief Total size of the packs in a repository
+ */
+static uint64_t pack_bytes(const char *repo_path)
+{
+	char path[4096];
+	snprintf(path, sizeof(path), "%s/objects/pack", repo_path);
+	
+	DIR *dir = opendir(path);
+	if (!dir) {
+		return 0;
+	}
+	
+	uint64_t total = 0;
+	const struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		size_t len = strlen(entry->d_name);
+		if (len < 5 || strcmp(entry->d_name + len - 5, ".pack") != 0) {
+			continue;
+		}
+		struct stat st;
+		if (fstatat(dirfd(dir), entry->d_name, &st, 0) == 0) {
+			total += (uint64_t)st.st_size;
+		}
+	}
+	closedir(dir);
+	return total;
+}
+
+/**
+ * @brief Allocate a mirror list entry
+ */
+static struct remote_mirror* new_remote_mirror(const char *name, const char *url,
+                                               const char *type, int priority)
+{
+	struct remote_mirror *mirror = calloc(1, sizeof(*mirror));
+	if (!mirror) {
+		return NULL;
+	}
 	
-	int result = system(remove_remote_cmd);
-	if (WEXITSTATUS(result) != 0) {
+	mirror->name = strdup(name);
+	mirror->url = strdup(url);
+	mirror->type = strdup(type ? type : "backup");
+	mirror->priority = priority;
+	mirror->enabled = 1;
+	if (!mirror->name || !mirror->url || !mirror->type) {
+		cleanup_remote_mirrors(mirror);
+		return NULL;
+	}
+	return mirror;
+}
+
+/**
+ * @brief Find a mirror by name
+ */
+static struct remote_mirror* find_remote_mirror(struct remote_mirror *mirrors, const char *name)
+{
+	for (; mirrors; mirrors = mirrors->next) {
+		if (strcmp(mirrors->name, name) == 0) {
+			return mirrors;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Merge the saved history from MIRROR_STATS_FILE into a mirror list
+ */
+static void load_mirror_stats(const char *cache_path, struct remote_mirror *mirrors)
+{
+	char stats_file[4096];
+	snprintf(stats_file, sizeof(stats_file), "%s/%s", cache_path, MIRROR_STATS_FILE);
+	
+	FILE *file = fopen(stats_file, "r");
+	if (!file) {
+		return;
+	}
+	
+	char line[1024];
+	while (fgets(line, sizeof(line), file)) {
+		char name[256];
+		double rtt_ms, throughput_kbps;
+		int probe_count, failures, sync_status;
+		long long last_probe, last_sync;
+		if (sscanf(line, "%255[^\t]\t%lf\t%lf\t%d\t%d\t%lld\t%lld\t%d",
+		           name, &rtt_ms, &throughput_kbps, &probe_count, &failures,
+		           &last_probe, &last_sync, &sync_status) != 8) {
+			continue;
+		}
+		
+		struct remote_mirror *mirror = find_remote_mirror(mirrors, name);
+		if (!mirror) {
+			continue;
+		}
+		mirror->rtt_ms = rtt_ms;
+		mirror->throughput_kbps = throughput_kbps;
+		mirror->probe_count = probe_count;
+		mirror->consecutive_failures = failures;
+		mirror->last_probe = (time_t)last_probe;
+		mirror->last_sync = (time_t)last_sync;
+		mirror->sync_status = sync_status;
+	}
+	fclose(file);
+}
+
+/**
+ * @brief Record a sync outcome and transfer in a mirror's saved history
+ */
+static int update_mirror_record(const char *cache_path, const char *mirror_name, int status,
+                                const char *error_message, uint64_t bytes, double elapsed_ms)
+{
+	struct repo_info repo;
+	memset(&repo, 0, sizeof(repo));
+	repo.cache_path = (char *)cache_path;
+	
+	struct remote_mirror *mirrors = NULL;
+	if (list_remote_mirrors(&repo, &mirrors) < 0) {
+		return SYNC_ERROR_MEMORY;
+	}
+	
+	struct remote_mirror *mirror = find_remote_mirror(mirrors, mirror_name);
+	if (!mirror) {
+		cleanup_remote_mirrors(mirrors);
 		return SYNC_ERROR_NOT_FOUND;
 	}
 	
+	mirror->last_sync = time(NULL);
+	mirror->sync_status = status;
+	free(mirror->sync_error);
+	mirror->sync_error = error_message ? strdup(error_message) : NULL;
+	if (status == SYNC_SUCCESS) {
+		record_mirror_transfer(mirror, bytes, elapsed_ms);
+	}
+	
+	int ret = save_mirror_stats(cache_path, mirrors);
+	cleanup_remote_mirrors(mirrors);
+	return ret;
+}
+
+/**
+ * @brief List origin and the registered mirrors with their history
+ */
+int list_remote_mirrors(const struct repo_info *repo, struct remote_mirror **mirrors)
+{
+	if (!repo || !repo->cache_path || !mirrors) {
+		return SYNC_ERROR_INVALID;
+	}
+	
+	*mirrors = NULL;
+	struct remote_mirror *tail = NULL;
+	int count = 0;
+	
+	/* Origin is always a candidate */
+	const char *origin_argv[] = { "git", "config", "--get", "remote.origin.url", NULL };
+	char url[4096];
+	if (cache_exec_line(origin_argv, repo->cache_path, url, sizeof(url)) == 0 && url[0] != '\0') {
+		*mirrors = tail = new_remote_mirror("origin", url, "origin", 0);
+		if (!tail) {
+			return SYNC_ERROR_MEMORY;
+		}
+		count++;
+	}
+	
+	/* Then everything add_remote_mirror() registered; later lines win */
+	char metadata_file[4096];
+	snprintf(metadata_file, sizeof(metadata_file), "%s/mirrors.txt", repo->cache_path);
+	FILE *file = fopen(metadata_file, "r");
+	if (file) {
+		char line[8192];
+		while (fgets(line, sizeof(line), file)) {
+			line[strcspn(line, "\r\n")] = '\0';
+			char *fields[4] = { line, NULL, NULL, NULL };
+			for (int i = 1; i < 4; i++) {
+				fields[i] = fields[i - 1] ? strchr(fields[i - 1], '\t') : NULL;
+				if (fields[i]) {
+					*fields[i]++ = '\0';
+				}
+			}
+			if (!fields[1] || fields[0][0] == '\0' || fields[1][0] == '\0') {
+				continue;
+			}
+			char *priority_end = fields[3] ? strchr(fields[3], '\t') : NULL;
+			if (priority_end) {
+				*priority_end = '\0';
+			}
+			int priority = fields[3] ? atoi(fields[3]) : 0;
+			
+			struct remote_mirror *existing = find_remote_mirror(*mirrors, fields[0]);
+			if (existing) {
+				char *url = strdup(fields[1]);
+				if (url) {
+					free(existing->url);
+					existing->url = url;
+				}
+				existing->priority = priority;
+				continue;
+			}
+			
+			struct remote_mirror *mirror = new_remote_mirror(fields[0], fields[1], fields[2], priority);
+			if (!mirror) {
+				fclose(file);
+				cleanup_remote_mirrors(*mirrors);
+				*mirrors = NULL;
+				return SYNC_ERROR_MEMORY;
+			}
+			if (tail) {
+				tail->next = mirror;
+			} else {
+				*mirrors = mirror;
+			}
+			tail = mirror;
+			count++;
+		}
+		fclose(file);
+	}
+	
+	load_mirror_stats(repo->cache_path, *mirrors);
+	return count;
+}
+
+/**
+ * @brief Save the measured history of a mirror list to MIRROR_STATS_FILE
+ */
+int save_mirror_stats(const char *cache_path, const struct remote_mirror *mirrors)
+{
+	if (!cache_path) {
+		return SYNC_ERROR_INVALID;
+	}
+	
+	char stats_file[4096];
+	char temp_file[4096];
+	snprintf(stats_file, sizeof(stats_file), "%s/%s", cache_path, MIRROR_STATS_FILE);
+	snprintf(temp_file, sizeof(temp_file), "%s/%s.%ld.tmp", cache_path, MIRROR_STATS_FILE,
+	         (long)getpid());
+	
+	FILE *file = fopen(temp_file, "w");
+	if (!file) {
+		return SYNC_ERROR_INVALID;
+	}
+	
+	for (; mirrors; mirrors = mirrors->next) {
+		fprintf(file, "%s\t%.3f\t%.3f\t%d\t%d\t%lld\t%lld\t%d\n",
+		        mirrors->name, mirrors->rtt_ms, mirrors->throughput_kbps, mirrors->probe_count,
+		        mirrors->consecutive_failures, (long long)mirrors->last_probe,
+		        (long long)mirrors->last_sync, mirrors->sync_status);
+	}
+	
+	if (fclose(file) != 0 || rename(temp_file, stats_file) != 0) {
+		unlink(temp_file);
+		return SYNC_ERROR_INVALID;
+	}
 	return SYNC_SUCCESS;
 }
 
+/**
+ * @brief Update mirror sync status
+ */
+int update_mirror_sync_status(struct repo_info *repo, const char *mirror_name,
+	                         int status, const char *error_message)
+{
+	if (!repo || !repo->cache_path || !mirror_name) {
+		return SYNC_ERROR_INVALID;
+	}
+	
+	return update_mirror_record(repo->cache_path, mirror_name, status, error_message, 0, 0.0);
+}
+
 /**
  * @brief Synchronize repository with specific mirror
  */
@@ -130,14 +498,30 @@ int sync_with_mirror(const struct repo_info *repo, const char *mirror_name, int
 	}
 	
 	/* Fetch from the specific mirror */
-	char fetch_cmd[8192];
-	snprintf(fetch_cmd, sizeof(fetch_cmd),
-	         "cd \"%s\" && git fetch \"%s\" %s 2>&1",
-	         repo->cache_path, mirror_name, force ? "--force" : "");
+	const char *argv[] = { "git", "-c", "maintenance.auto=false", "-c", "gc.auto=0", "fetch",
+	                       mirror_name, force ? "--force" : NULL, NULL };
+	struct cache_exec_options options;
+	memset(&options, 0, sizeof(options));
+	options.cwd = repo->cache_path;
 	
-	int result = system(fetch_cmd);
-	if (WEXITSTATUS(result) != 0) {
-		return SYNC_ERROR_NETWORK;
+	uint64_t packed_before = pack_bytes(repo->cache_path);
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	
+	struct cache_exec_result result;
+	int status = cache_exec_run(argv, &options, &result) == CACHE_EXEC_SUCCESS &&
+	             result.exit_code == 0 ? SYNC_SUCCESS : SYNC_ERROR_NETWORK;
+	cache_exec_free_result(&result);
+	
+	/* Feed the transfer into the mirror's throughput history */
+	uint64_t packed_after = pack_bytes(repo->cache_path);
+	uint64_t received = packed_after > packed_before ? packed_after - packed_before : 0;
+	update_mirror_record(repo->cache_path, mirror_name, status,
+	                     status == SYNC_SUCCESS ? NULL : "fetch failed",
+	                     received, elapsed_ms_since(&start));
+	
+	if (status != SYNC_SUCCESS) {
+		return status;
 	}
 	
 	/* Update sync time in metadata */
@@ -163,23 +547,14 @@ int sync_with_mirrors(const struct repo_info *repo, const struct sync_config *co
 	result->start_time = time(NULL);
 	
 	/* Get list of configured remotes */
-	char list_remotes_cmd[4096];
-	snprintf(list_remotes_cmd, sizeof(list_remotes_cmd),
-	         "cd \"%s\" && git remote", repo->cache_path);
-	
-	FILE *pipe = popen(list_remotes_cmd, "r");
-	if (!pipe) {
+	struct cache_exec_result remotes;
+	if (list_remote_names(repo->cache_path, &remotes) != SYNC_SUCCESS) {
 		return SYNC_ERROR_NETWORK;
 	}
 	
-	char remote_name[256];
-	while (fgets(remote_name, sizeof(remote_name), pipe)) {
-		/* Remove newline */
-		size_t len = strlen(remote_name);
-		if (len > 0 && remote_name[len-1] == '\n') {
-			remote_name[len-1] = '\0';
-		}
-		
+	char *saveptr = NULL;
+	for (char *remote_name = strtok_r(remotes.out, "\n", &saveptr); remote_name;
+	     remote_name = strtok_r(NULL, "\n", &saveptr)) {
 		/* Skip origin remote for sync operations */
 		if (strcmp(remote_name, "origin") == 0) {
 			continue;
@@ -194,7 +569,7 @@ int sync_with_mirrors(const struct repo_info *repo, const struct sync_config *co
 		}
 	}
 	
-	pclose(pipe);
+	cache_exec_free_result(&remotes);
 	result->end_time = time(NULL);
 	
 	return result->error_count > 0 ? SYNC_ERROR_NETWORK : SYNC_SUCCESS;
@@ -210,42 +585,35 @@ int push_to_mirrors(const struct repo_info *repo, const char *branch, int force)
 	}
 	
 	/* Get list of configured remotes */
-	char list_remotes_cmd[4096];
-	snprintf(list_remotes_cmd, sizeof(list_remotes_cmd),
-	         "cd \"%s\" && git remote", repo->cache_path);
-	
-	FILE *pipe = popen(list_remotes_cmd, "r");
-	if (!pipe) {
+	struct cache_exec_result remotes;
+	if (list_remote_names(repo->cache_path, &remotes) != SYNC_SUCCESS) {
 		return SYNC_ERROR_NETWORK;
 	}
 	
 	int success_count = 0;
 	int error_count = 0;
-	char remote_name[256];
-	
-	while (fgets(remote_name, sizeof(remote_name), pipe)) {
-		/* Remove newline */
-		size_t len = strlen(remote_name);
-		if (len > 0 && remote_name[len-1] == '\n') {
-			remote_name[len-1] = '\0';
-		}
-		
+	char *saveptr = NULL;
+	for (char *remote_name = strtok_r(remotes.out, "\n", &saveptr); remote_name;
+	     remote_name = strtok_r(NULL, "\n", &saveptr)) {
 		/* Push to this mirror */
-		char push_cmd[8192];
-		snprintf(push_cmd, sizeof(push_cmd),
-		         "cd \"%s\" && git push %s \"%s\" %s 2>/dev/null",
-		         repo->cache_path, force ? "--force" : "", remote_name,
-		         branch ? branch : "--all");
+		const char *push_argv[] = { "git", "push", remote_name, branch ? branch : "--all",
+		                            force ? "--force" : NULL, NULL };
+		struct cache_exec_options options;
+		memset(&options, 0, sizeof(options));
+		options.cwd = repo->cache_path;
+		options.err = CACHE_EXEC_DISCARD;
 		
-		int result = system(push_cmd);
-		if (WEXITSTATUS(result) == 0) {
+		struct cache_exec_result result;
+		if (cache_exec_run(push_argv, &options, &result) == CACHE_EXEC_SUCCESS &&
+		    result.exit_code == 0) {
 			success_count++;
 		} else {
 			error_count++;
 		}
+		cache_exec_free_result(&result);
 	}
 	
-	pclose(pipe);
+	cache_exec_free_result(&remotes);
 	
 	return error_count > 0 ? SYNC_ERROR_NETWORK : SYNC_SUCCESS;
 }
@@ -262,16 +630,16 @@ int clone_from_best_mirror(const char *url, const char *target_path,
 	}
 	
 	/* Build strategy arguments */
-	char strategy_args[256] = "";
+	const char *strategy_arg = NULL;
 	switch (strategy) {
 		case CLONE_STRATEGY_SHALLOW:
-			strcpy(strategy_args, "--depth=1");
+			strategy_arg = "--depth=1";
 			break;
 		case CLONE_STRATEGY_TREELESS:
-			strcpy(strategy_args, "--filter=tree:0");
+			strategy_arg = "--filter=tree:0";
 			break;
 		case CLONE_STRATEGY_BLOBLESS:
-			strcpy(strategy_args, "--filter=blob:none");
+			strategy_arg = "--filter=blob:none";
 			break;
 		case CLONE_STRATEGY_FULL:
 		case CLONE_STRATEGY_AUTO:
@@ -280,138 +648,599 @@ int clone_from_best_mirror(const char *url, const char *target_path,
 			break;
 	}
 	
-	/* Try primary URL first */
-	char clone_cmd[8192];
-	snprintf(clone_cmd, sizeof(clone_cmd),
-	         "git clone %s \"%s\" \"%s\" 2>/dev/null",
-	         strategy_args, url, target_path);
-	
-	int result = system(clone_cmd);
-	if (WEXITSTATUS(result) == 0) {
-		return SYNC_SUCCESS;
+	/* Race the candidates' ref advertisements; the first to answer clones */
+	int count = 0;
+	struct remote_mirror *candidates = calloc((size_t)fallback_count + 1, sizeof(*candidates));
+	struct remote_mirror **order = calloc((size_t)fallback_count + 1, sizeof(*order));
+	if (!candidates || !order) {
+		free(candidates);
+		free(order);
+		return SYNC_ERROR_MEMORY;
 	}
-	
-	/* Try fallback mirrors */
+	/* Only url and the history fields are used; nothing here is freed */
+	candidates[count].url = (char *)url;
+	order[count] = &candidates[count];
+	count++;
 	for (int i = 0; i < fallback_count; i++) {
-		if (!fallback_mirrors[i]) {
+		if (fallback_mirrors[i]) {
+			candidates[count].url = (char *)fallback_mirrors[i];
+			order[count] = &candidates[count];
+			count++;
+		}
+	}
+	
+	const struct remote_mirror *winner = count > 1 ? run_mirror_probes(order, count, 1) : NULL;
+	
+	/* Winner first, then the rest in the order given */
+	int result = SYNC_ERROR_NETWORK;
+	int attempted = 0;
+	for (int i = -1; i < count && result != SYNC_SUCCESS; i++) {
+		const struct remote_mirror *candidate = i < 0 ? winner : order[i];
+		if (!candidate || (i >= 0 && candidate == winner)) {
 			continue;
 		}
 		
 		/* Remove failed attempt */
-		char rm_cmd[4096];
-		snprintf(rm_cmd, sizeof(rm_cmd), "rm -rf \"%s\"", target_path);
-		int cleanup_result = system(rm_cmd);
-		(void)cleanup_result; /* Cleanup is best effort */
+		if (attempted++ > 0 && access(target_path, F_OK) == 0) {
+			const char *rm_argv[] = { "rm", "-rf", "--", target_path, NULL };
+			cache_exec_status(rm_argv, NULL, 1); /* Cleanup is best effort */
+		}
 		
-		/* Try fallback mirror */
-		snprintf(clone_cmd, sizeof(clone_cmd),
-		         "git clone %s \"%s\" \"%s\" 2>/dev/null",
-		         strategy_args, fallback_mirrors[i], target_path);
+		/* The strategy argument goes last so a missing one ends the list */
+		const char *clone_argv[] = { "git", "clone", candidate->url, target_path,
+		                             strategy_arg, NULL };
+		struct cache_exec_options options;
+		memset(&options, 0, sizeof(options));
+		options.err = CACHE_EXEC_DISCARD;
 		
-		result = system(clone_cmd);
-		if (WEXITSTATUS(result) == 0) {
-			return SYNC_SUCCESS;
+		struct cache_exec_result clone_result;
+		if (cache_exec_run(clone_argv, &options, &clone_result) == CACHE_EXEC_SUCCESS &&
+		    clone_result.exit_code == 0) {
+			result = SYNC_SUCCESS;
 		}
+		cache_exec_free_result(&clone_result);
+	}
+	
+	free(candidates);
+	free(order);
+	return result;
+}
+
+/**
+ * @brief Fold a probe result into a mirror's history
+ */
+void record_mirror_probe(struct remote_mirror *mirror, int success, double rtt_ms, time_t now)
+{
+	if (!mirror) {
+		return;
+	}
+	
+	mirror->last_probe = now;
+	if (!success) {
+		mirror->consecutive_failures++;
+		return;
 	}
 	
-	return SYNC_ERROR_NETWORK;
+	mirror->rtt_ms = mirror->probe_count > 0 ?
+	                 MIRROR_HISTORY_WEIGHT * rtt_ms + (1.0 - MIRROR_HISTORY_WEIGHT) * mirror->rtt_ms :
+	                 rtt_ms;
+	mirror->probe_count++;
+	mirror->consecutive_failures = 0;
 }
 
 /**
- * @brief Test connectivity to mirror
+ * @brief Fold a fetch or clone transfer into a mirror's throughput history
  */
-__attribute__((unused))
-static int test_mirror_connection(const char *mirror_url)
+void record_mirror_transfer(struct remote_mirror *mirror, uint64_t bytes, double elapsed_ms)
 {
-	if (!mirror_url) {
+	if (!mirror || bytes < MIRROR_MIN_TRANSFER_BYTES || elapsed_ms <= 0.0) {
+		return;
+	}
+	
+	double kbps = (double)bytes / 1024.0 / (elapsed_ms / 1000.0);
+	mirror->throughput_kbps = mirror->throughput_kbps > 0.0 ?
+	                          MIRROR_HISTORY_WEIGHT * kbps +
+	                          (1.0 - MIRROR_HISTORY_WEIGHT) * mirror->throughput_kbps :
+	                          kbps;
+}
+
+/**
+ * @brief Check whether a mirror may be used
+ */
+int mirror_is_healthy(const struct remote_mirror *mirror, time_t now)
+{
+	if (!mirror || !mirror->enabled) {
 		return 0;
 	}
 	
-	/* Use git ls-remote to test connectivity */
-	char test_cmd[4096];
-	snprintf(test_cmd, sizeof(test_cmd),
-	         "git ls-remote \"%s\" HEAD >/dev/null 2>&1", mirror_url);
+	/* Give failing mirrors another chance once their history is stale */
+	return mirror->consecutive_failures < MIRROR_MAX_FAILURES ||
+	       now - mirror->last_probe >= MIRROR_PROBE_INTERVAL;
+}
+
+/**
+ * @brief Estimate how long an operation would take on a mirror
+ */
+double mirror_expected_cost(const struct remote_mirror *mirror, const char *operation_type)
+{
+	if (!mirror) {
+		return 0.0;
+	}
+	
+	double bytes = operation_type && strcmp(operation_type, "clone") == 0 ?
+	               MIRROR_CLONE_BYTES : MIRROR_FETCH_BYTES;
+	double rtt_ms = mirror->probe_count > 0 ? mirror->rtt_ms : MIRROR_UNPROBED_RTT_MS;
+	double kbps = mirror->throughput_kbps > 0.0 ? mirror->throughput_kbps : MIRROR_DEFAULT_KBPS;
 	
-	int result = system(test_cmd);
-	return WEXITSTATUS(result) == 0 ? 1 : 0;
+	return rtt_ms + bytes / 1024.0 / kbps * 1000.0;
 }
 
 /**
- * @brief Get optimal mirror based on availability
+ * @brief Ranking key of one mirror
  */
-const char* get_optimal_mirror(const struct repo_info *repo, const char *operation_type)
+struct mirror_rank {
+	struct remote_mirror *mirror;
+	int healthy;
+	double cost;
+};
+
+/**
+ * @brief Order healthy mirrors first, then by expected cost and priority
+ */
+static int compare_mirror_ranks(const void *a, const void *b)
 {
-	(void)operation_type; /* Unused for now */
+	const struct mirror_rank *ra = (const struct mirror_rank *)a;
+	const struct mirror_rank *rb = (const struct mirror_rank *)b;
 	
+	if (ra->healthy != rb->healthy) {
+		return rb->healthy - ra->healthy;
+	}
+	if (ra->cost != rb->cost) {
+		return ra->cost < rb->cost ? -1 : 1;
+	}
+	if (ra->mirror->priority != rb->mirror->priority) {
+		return ra->mirror->priority - rb->mirror->priority;
+	}
+	return strcmp(ra->mirror->name, rb->mirror->name);
+}
+
+/**
+ * @brief Sort a mirror list, healthy and cheapest first
+ */
+int rank_mirrors(struct remote_mirror **mirrors, const char *operation_type, time_t now)
+{
+	if (!mirrors || !*mirrors) {
+		return 0;
+	}
+	
+	size_t count = 0;
+	for (const struct remote_mirror *m = *mirrors; m; m = m->next) {
+		count++;
+	}
+	
+	struct mirror_rank *ranks = calloc(count, sizeof(*ranks));
+	if (!ranks) {
+		return 0;
+	}
+	
+	size_t i = 0;
+	for (struct remote_mirror *m = *mirrors; m; m = m->next, i++) {
+		ranks[i].mirror = m;
+		ranks[i].healthy = mirror_is_healthy(m, now);
+		ranks[i].cost = mirror_expected_cost(m, operation_type);
+	}
+	qsort(ranks, count, sizeof(*ranks), compare_mirror_ranks);
+	
+	int healthy = 0;
+	for (i = 0; i < count; i++) {
+		ranks[i].mirror->next = i + 1 < count ? ranks[i + 1].mirror : NULL;
+		healthy += ranks[i].healthy;
+	}
+	*mirrors = ranks[0].mirror;
+	
+	free(ranks);
+	return healthy;
+}
+
+/**
+ * @brief One running ref advertisement probe
+ */
+struct mirror_probe {
+	struct remote_mirror *mirror;
+	pid_t pid;
+	struct timespec start;
+};
+
+/**
+ * @brief Start git ls-remote against a mirror in its own process group
+ */
+static pid_t start_mirror_probe(const char *url)
+{
+	pid_t pid = fork();
+	if (pid == 0) {
+		setpgid(0, 0);
+		int devnull = open("/dev/null", O_RDWR);
+		if (devnull >= 0) {
+			dup2(devnull, STDIN_FILENO);
+			dup2(devnull, STDOUT_FILENO);
+			dup2(devnull, STDERR_FILENO);
+		}
+		setenv("GIT_TERMINAL_PROMPT", "0", 1);
+		/* Asking for HEAD alone keeps the advertisement small under protocol v2 */
+		execlp("git", "git", "ls-remote", url, "HEAD", (char *)NULL);
+		_exit(127);
+	}
+	if (pid > 0) {
+		setpgid(pid, pid);
+	}
+	return pid;
+}
+
+/**
+ * @brief Stop a probe and everything it started
+ */
+static void stop_mirror_probe(struct mirror_probe *probe)
+{
+	int status;
+	killpg(probe->pid, SIGKILL);
+	waitpid(probe->pid, &status, 0);
+	probe->pid = 0;
+}
+
+/**
+ * @brief Probe mirrors in parallel, recording each result in its history
+ *
+ * With first_wins the remaining probes are stopped as soon as one mirror
+ * answers, and the losers' history is left alone.
+ *
+ * @return First mirror to answer, or NULL if none did
+ */
+static struct remote_mirror* run_mirror_probes(struct remote_mirror **mirrors, int count,
+                                               int first_wins)
+{
+	struct mirror_probe *probes = calloc((size_t)count, sizeof(*probes));
+	if (!probes) {
+		return NULL;
+	}
+	
+	int pending = 0;
+	for (int i = 0; i < count; i++) {
+		probes[i].mirror = mirrors[i];
+		clock_gettime(CLOCK_MONOTONIC, &probes[i].start);
+		probes[i].pid = start_mirror_probe(mirrors[i]->url);
+		if (probes[i].pid > 0) {
+			pending++;
+		} else {
+			probes[i].pid = 0;
+		}
+	}
+	
+	struct remote_mirror *winner = NULL;
+	const struct timespec poll_interval = { 0, 2 * 1000 * 1000 };
+	while (pending > 0 && !(first_wins && winner)) {
+		for (int i = 0; i < count; i++) {
+			if (probes[i].pid == 0) {
+				continue;
+			}
+			
+			int status;
+			double elapsed_ms = elapsed_ms_since(&probes[i].start);
+			pid_t done = waitpid(probes[i].pid, &status, WNOHANG);
+			if (done == 0 && elapsed_ms < MIRROR_PROBE_TIMEOUT_MS) {
+				continue;
+			}
+			
+			int success = 0;
+			if (done == probes[i].pid) {
+				success = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+				probes[i].pid = 0;
+			} else if (done == 0) {
+				stop_mirror_probe(&probes[i]);
+			} else {
+				probes[i].pid = 0;
+			}
+			pending--;
+			
+			if (done >= 0) {
+				record_mirror_probe(probes[i].mirror, success, elapsed_ms, time(NULL));
+			}
+			if (success && !winner) {
+				winner = probes[i].mirror;
+			}
+		}
+		
+		if (pending > 0 && !(first_wins && winner)) {
+			nanosleep(&poll_interval, NULL);
+		}
+	}
+	
+	for (int i = 0; i < count; i++) {
+		if (probes[i].pid > 0) {
+			stop_mirror_probe(&probes[i]);
+		}
+	}
+	
+	free(probes);
+	return winner;
+}
+
+/**
+ * @brief Get optimal mirror based on measured latency and throughput
+ */
+const char* get_optimal_mirror(const struct repo_info *repo, const char *operation_type)
+{
 	if (!repo || !repo->cache_path) {
 		return NULL;
 	}
 	
-	/* For simplicity, return the first available remote that's not origin */
-	char list_remotes_cmd[4096];
-	snprintf(list_remotes_cmd, sizeof(list_remotes_cmd),
-	         "cd \"%s\" && git remote", repo->cache_path);
+	/* Nothing to choose from unless add_remote_mirror() registered something */
+	char metadata_file[4096];
+	snprintf(metadata_file, sizeof(metadata_file), "%s/mirrors.txt", repo->cache_path);
+	if (access(metadata_file, F_OK) != 0) {
+		return NULL;
+	}
+	
+	struct remote_mirror *mirrors = NULL;
+	int count = list_remote_mirrors(repo, &mirrors);
+	if (count <= 0) {
+		cleanup_remote_mirrors(mirrors);
+		return NULL;
+	}
 	
-	FILE *pipe = popen(list_remotes_cmd, "r");
-	if (!pipe) {
+	struct remote_mirror **candidates = calloc((size_t)count, sizeof(*candidates));
+	if (!candidates) {
+		cleanup_remote_mirrors(mirrors);
 		return NULL;
 	}
 	
+	/* Measure every mirror without recent history, all at once */
+	time_t now = time(NULL);
+	int stale = 0;
+	for (struct remote_mirror *m = mirrors; m; m = m->next) {
+		if (m->enabled && (m->probe_count == 0 || now - m->last_probe >= MIRROR_PROBE_INTERVAL)) {
+			candidates[stale++] = m;
+		}
+	}
+	if (stale > 0) {
+		run_mirror_probes(candidates, stale, 0);
+		now = time(NULL);
+	}
+	
+	int healthy = rank_mirrors(&mirrors, operation_type, now);
+	struct remote_mirror *best = healthy > 0 ? mirrors : NULL;
+	
+	/* History says who is usually fast; a race says who is fast right now */
+	if (stale == 0 && healthy > 1) {
+		int racing = 0;
+		for (struct remote_mirror *m = mirrors; m && racing < healthy &&
+		     racing < MIRROR_RACE_CANDIDATES; m = m->next) {
+			candidates[racing++] = m;
+		}
+		best = run_mirror_probes(candidates, racing, 1);
+	}
+	
 	static char best_remote[256];
-	char remote_name[256];
+	const char *result = NULL;
+	if (best) {
+		snprintf(best_remote, sizeof(best_remote), "%s", best->name);
+		result = best_remote;
+	}
 	
-	while (fgets(remote_name, sizeof(remote_name), pipe)) {
-		/* Remove newline */
-		size_t len = strlen(remote_name);
-		if (len > 0 && remote_name[len-1] == '\n') {
-			remote_name[len-1] = '\0';
+	save_mirror_stats(repo->cache_path, mirrors);
+	free(candidates);
+	cleanup_remote_mirrors(mirrors);
+	return result;
+}
+
+/**
+ * @brief Find the enabled performance mirror with the best priority
+ */
+int find_performance_mirror(const struct repo_info *repo, char *url, size_t url_size)
+{
+	if (!repo || !repo->cache_path || !url || url_size == 0) {
+		return 0;
+	}
+	
+	/* No mirrors.txt means no mirror; skip asking git for origin */
+	char metadata_file[4096];
+	snprintf(metadata_file, sizeof(metadata_file), "%s/mirrors.txt", repo->cache_path);
+	if (access(metadata_file, F_OK) != 0) {
+		return 0;
+	}
+	
+	struct remote_mirror *mirrors = NULL;
+	if (list_remote_mirrors(repo, &mirrors) <= 0) {
+		cleanup_remote_mirrors(mirrors);
+		return 0;
+	}
+	
+	const struct remote_mirror *best = NULL;
+	for (const struct remote_mirror *m = mirrors; m; m = m->next) {
+		if (m->enabled && m->type && strcmp(m->type, MIRROR_TYPE_PERFORMANCE) == 0 &&
+		    (!best || m->priority < best->priority)) {
+			best = m;
+		}
+	}
+	
+	int found = 0;
+	if (best) {
+		int len = snprintf(url, url_size, "%s", best->url);
+		found = len >= 0 && (size_t)len < url_size;
+	}
+	cleanup_remote_mirrors(mirrors);
+	return found;
+}
+
+/**
+ * @brief Order ls-remote lines by ref name
+ */
+static int compare_remote_refs(const void *a, const void *b)
+{
+	const char *ra = strchr(*(const char *const *)a, '\t');
+	const char *rb = strchr(*(const char *const *)b, '\t');
+	return strcmp(ra + 1, rb + 1);
+}
+
+/**
+ * @brief Select the refs a synchronization check compares
+ *
+ * Branches follow the filter. Tags count unless the cache fetches none or
+ * only follows them along narrowed branches, where tags on other branches
+ * are never fetched and would always look changed.
+ */
+static int match_filter(const char *name, void *data)
+{
+	const struct ref_filter *filter = data;
+	if (strncmp(name, "refs/tags/", 10) == 0) {
+		size_t len = strlen(name);
+		if (len > 3 && strcmp(name + len - 3, "^{}") == 0) {
+			return 0;
 		}
+		if (!filter) {
+			return 1;
+		}
+		return filter->tags == REF_FILTER_TAGS_ALL ||
+		       (filter->tags == REF_FILTER_TAGS_DEFAULT && !ref_filter_is_narrow(filter));
+	}
+	if (strncmp(name, "refs/heads/", 11) != 0) {
+		return 0;
+	}
+	return !filter || ref_filter_matches(filter, name);
+}
+
+/**
+ * @brief Start listing a remote's branches and tags for a synchronization check
+ */
+int sync_check_start(struct cache_exec_loop *loop, const struct repo_info *repo,
+                     const char *mirror_name, void *data)
+{
+	if (!loop || !repo || !repo->cache_path) {
+		return SYNC_ERROR_INVALID;
+	}
+	
+	/* Only the ref advertisement is exchanged, no object negotiation */
+	static const char *const env[] = { "GIT_TERMINAL_PROMPT=0", NULL };
+	const char *argv[] = { "git", "-c", "protocol.version=2", "ls-remote", "--heads",
+	                       "--tags", mirror_name ? mirror_name : "origin", NULL };
+	struct cache_exec_options options;
+	memset(&options, 0, sizeof(options));
+	options.cwd = repo->cache_path;
+	options.env = env;
+	options.out = CACHE_EXEC_CAPTURE;
+	options.err = CACHE_EXEC_DISCARD;
+	options.timeout_ms = SYNC_CHECK_TIMEOUT * 1000;
+	
+	return cache_exec_spawn(loop, argv, &options, data) == CACHE_EXEC_SUCCESS ?
+	       SYNC_SUCCESS : SYNC_ERROR_NETWORK;
+}
+
+/**
+ * @brief Compare a finished ref listing with the cache
+ */
+int sync_check_finish(const struct repo_info *repo, const struct cache_exec_result *result,
+                      const struct ref_filter *filter)
+{
+	if (!repo || !repo->cache_path || !result) {
+		return SYNC_ERROR_INVALID;
+	}
+	
+	/* If the remote could not be listed, let the fetch report the problem */
+	if (result->exit_code != 0 || !result->out) {
+		return 1;
+	}
+	
+	char **lines = NULL;
+	size_t count = 0;
+	size_t capacity = 0;
+	int failed = 0;
+	for (const char *line = result->out; *line; ) {
+		size_t len = strcspn(line, "\r\n");
+		const char *next = line + len;
+		next += strspn(next, "\r\n");
 		
-		/* Skip origin for mirror operations */
-		if (strcmp(remote_name, "origin") == 0) {
+		const char *tab = memchr(line, '\t', len);
+		if (!tab) {
+			line = next;
+			continue;
+		}
+		char *entry = strndup(line, len);
+		if (!entry) {
+			failed = 1;
+			break;
+		}
+		line = next;
+		if (!match_filter(strchr(entry, '\t') + 1, (void *)filter)) {
+			free(entry);
 			continue;
 		}
 		
-		/* Use first available mirror */
-		strcpy(best_remote, remote_name);
-		pclose(pipe);
-		return best_remote;
+		if (count == capacity) {
+			size_t new_capacity = capacity ? capacity * 2 : 64;
+			char **new_lines = realloc(lines, new_capacity * sizeof(*lines));
+			if (!new_lines) {
+				free(entry);
+				failed = 1;
+				break;
+			}
+			lines = new_lines;
+			capacity = new_capacity;
+		}
+		lines[count++] = entry;
 	}
 	
-	pclose(pipe);
-	return NULL;
+	/* Build the remote digest the same way ref_tips_digest() does */
+	uint64_t remote_digest = REF_TIPS_DIGEST_INIT;
+	if (!failed && count > 0) {
+		qsort(lines, count, sizeof(*lines), compare_remote_refs);
+	}
+	for (size_t i = 0; i < count; i++) {
+		char *tab = strchr(lines[i], '\t');
+		*tab = '\0';
+		remote_digest = ref_tips_digest_add(remote_digest, tab + 1, lines[i]);
+		free(lines[i]);
+	}
+	free(lines);
+	
+	if (failed) {
+		return 1;
+	}
+	
+	uint64_t local_digest;
+	int ret = ref_tips_digest_matching(repo->cache_path, match_filter, (void *)filter, &local_digest);
+	if (ret != REF_TIPS_SUCCESS) {
+		return 1;
+	}
+	
+	return remote_digest != local_digest ? 1 : 0;
 }
 
 /**
  * @brief Check if repository needs synchronization
  */
-int needs_synchronization(const struct repo_info *repo, const char *mirror_name)
+int needs_synchronization(const struct repo_info *repo, const char *mirror_name,
+                          const struct ref_filter *filter)
 {
-	(void)mirror_name; /* Unused for now */
-	
 	if (!repo || !repo->cache_path) {
 		return SYNC_ERROR_INVALID;
 	}
 	
-	/* Load metadata to check last sync time */
-	struct cache_metadata metadata;
-	if (cache_metadata_load(repo->cache_path, &metadata) != METADATA_SUCCESS) {
-		return 1; /* Assume sync needed if no metadata */
+	struct cache_exec_loop loop;
+	cache_exec_loop_init(&loop);
+	if (sync_check_start(&loop, repo, mirror_name, NULL) != SYNC_SUCCESS) {
+		cache_exec_loop_destroy(&loop);
+		return 1;
 	}
 	
-	time_t now = time(NULL);
-	time_t last_sync = metadata.last_sync_time;
-	
-	/* Free loaded metadata */
-	free(metadata.original_url);
-	free(metadata.fork_url);
-	free(metadata.owner);
-	free(metadata.name);
-	free(metadata.fork_organization);
-	free(metadata.default_branch);
-	
-	/* Check if sync is needed (more than 24 hours since last sync) */
-	return (now - last_sync) > (24 * 60 * 60) ? 1 : 0;
+	struct cache_exec_result result;
+	int ret = cache_exec_wait(&loop, -1, &result, NULL);
+	cache_exec_loop_destroy(&loop);
+	if (ret != 1) {
+		return 1;
+	}
+	
+	ret = sync_check_finish(repo, &result, filter);
+	cache_exec_free_result(&result);
+	return ret;
 }
 
 /**
@@ -11,6 +11,9 @@
  */
 
 #include "git-cache.h"
+#include "ref_filter.h"
+#include "cache_exec.h"
+#include <stdint.h>
 #include <time.h>
 
 /* Forward declarations */
@@ -29,9 +32,31 @@ struct remote_mirror {
 	time_t last_sync;     /**< Last synchronization time */
 	int sync_status;      /**< Last sync status (0=success) */
 	char *sync_error;     /**< Last sync error message */
+	double rtt_ms;        /**< Smoothed ref advertisement round trip */
+	double throughput_kbps; /**< Smoothed fetch throughput in KiB/s (0 if unknown) */
+	int probe_count;      /**< Probes recorded so far */
+	int consecutive_failures; /**< Failed probes since the last success */
+	time_t last_probe;    /**< Time of the last probe */
 	struct remote_mirror *next; /**< Next mirror in list */
 };
 
+/**
+ * @brief Mirror selection tuning
+ *
+ * Mirrors are the remotes registered in the cache's mirrors.txt, plus
+ * origin. Their measured history is kept in mirror-stats.txt next to it.
+ */
+#define MIRROR_STATS_FILE        "mirror-stats.txt"  /**< Per-cache probe history */
+#define MIRROR_PROBE_INTERVAL    3600   /**< Re-probe mirrors older than this (seconds) */
+#define MIRROR_PROBE_TIMEOUT_MS  10000  /**< Give up on a probe after this long */
+#define MIRROR_MAX_FAILURES      3      /**< Failed probes in a row that mark a mirror unhealthy */
+#define MIRROR_RACE_CANDIDATES   3      /**< Top-ranked mirrors raced before a fetch */
+
+/**
+ * @brief Longest time a synchronization check may list a remote, in seconds
+ */
+#define SYNC_CHECK_TIMEOUT 60
+
 /**
  * @brief Remote synchronization configuration
  */
@@ -43,6 +68,8 @@ struct sync_config {
 	int retry_delay_seconds;    /**< Delay between retries */
 	char *preferred_mirror;     /**< Preferred mirror for new clones */
 	int fallback_enabled;       /**< Enable fallback to other mirrors */
+	int maintenance_interval_hours; /**< Pack maintenance interval in hours (0 disables) */
+	int maintenance_pack_threshold; /**< Packs that trigger maintenance (0 disables) */
 };
 
 /**
@@ -91,6 +118,10 @@ int remove_remote_mirror(const struct repo_info *repo, const char *mirror_name);
 
 /**
  * @brief List all remote mirrors for repository
+ *
+ * The list starts with origin, followed by the mirrors registered in
+ * mirrors.txt, each with its history from MIRROR_STATS_FILE.
+ *
  * @param repo Repository information
  * @param mirrors Output pointer to mirror list
  * @return Number of mirrors found, or negative error code
@@ -134,12 +165,89 @@ int test_mirror_connectivity(const struct repo_info *repo, int **results);
 
 /**
  * @brief Get optimal mirror for operation based on performance
+ *
+ * Mirrors without a recent probe are probed in parallel first. Otherwise
+ * the top MIRROR_RACE_CANDIDATES healthy mirrors race a ref advertisement
+ * and the first to answer wins. Probe results are saved to the history.
+ *
  * @param repo Repository information
  * @param operation_type Type of operation (clone, fetch, push)
- * @return Best mirror name, or NULL if none available
+ * @return Best remote name (possibly "origin"), or NULL to use origin because no
+ *         mirrors are configured or none answered
  */
 const char* get_optimal_mirror(const struct repo_info *repo, const char *operation_type);
 
+/**
+ * @brief Mirror type of a git-cache serve node
+ *
+ * Fetches go to a performance mirror first, straight into the cache's own
+ * branches, and to origin only when the mirror fails.
+ */
+#define MIRROR_TYPE_PERFORMANCE "performance"
+
+/**
+ * @brief Find the enabled performance mirror with the best priority
+ * @param repo Repository information
+ * @param url Buffer for the mirror URL
+ * @param url_size Size of buffer
+ * @return 1 if found, 0 if not
+ */
+int find_performance_mirror(const struct repo_info *repo, char *url, size_t url_size);
+
+/**
+ * @brief Fold a probe result into a mirror's history
+ * @param mirror Mirror to update
+ * @param success Whether the probe succeeded
+ * @param rtt_ms Probe duration in milliseconds
+ * @param now Probe time
+ */
+void record_mirror_probe(struct remote_mirror *mirror, int success, double rtt_ms, time_t now);
+
+/**
+ * @brief Fold a fetch or clone transfer into a mirror's throughput history
+ * @param mirror Mirror to update
+ * @param bytes Bytes received
+ * @param elapsed_ms Transfer duration in milliseconds
+ */
+void record_mirror_transfer(struct remote_mirror *mirror, uint64_t bytes, double elapsed_ms);
+
+/**
+ * @brief Check whether a mirror may be used
+ *
+ * A mirror whose last MIRROR_MAX_FAILURES probes failed is skipped until
+ * MIRROR_PROBE_INTERVAL has passed since its last probe.
+ *
+ * @param mirror Mirror to check
+ * @param now Current time
+ * @return 1 if healthy, 0 if not
+ */
+int mirror_is_healthy(const struct remote_mirror *mirror, time_t now);
+
+/**
+ * @brief Estimate how long an operation would take on a mirror
+ * @param mirror Mirror to estimate
+ * @param operation_type "clone" weighs throughput, anything else round trips
+ * @return Expected cost in milliseconds
+ */
+double mirror_expected_cost(const struct remote_mirror *mirror, const char *operation_type);
+
+/**
+ * @brief Sort a mirror list, healthy and cheapest first
+ * @param mirrors Mirror list, reordered in place
+ * @param operation_type Type of operation (clone, fetch, push)
+ * @param now Current time
+ * @return Number of healthy mirrors at the front of the list
+ */
+int rank_mirrors(struct remote_mirror **mirrors, const char *operation_type, time_t now);
+
+/**
+ * @brief Save the measured history of a mirror list to MIRROR_STATS_FILE
+ * @param cache_path Cached repository path
+ * @param mirrors Mirror list
+ * @return SYNC_SUCCESS on success, error code on failure
+ */
+int save_mirror_stats(const char *cache_path, const struct remote_mirror *mirrors);
+
 /**
  * @brief Push repository changes to all mirrors
  * @param repo Repository information
@@ -182,6 +290,10 @@ int save_sync_config(const struct sync_config *config);
 
 /**
  * @brief Clone from best available mirror
+ *
+ * All candidates race a ref advertisement in parallel; the first to answer
+ * serves the clone, and the others are tried in order if it fails.
+ *
  * @param url Primary repository URL
  * @param target_path Local path for clone
  * @param strategy Clone strategy to use
@@ -229,11 +341,46 @@ const char* sync_get_error_string(int error_code);
 
 /**
  * @brief Check if repository needs synchronization
+ *
+ * Lists the remote's branches and tags with git ls-remote, which only
+ * exchanges the ref advertisement, and compares them with the cache's
+ * refs/heads/ and refs/tags/. Any difference, or a remote that cannot be
+ * listed, means a fetch is needed. With a ref filter only the branches and
+ * tags it fetches are compared on both sides; tags are left out when the
+ * filter fetches none or only follows them along narrowed branches.
+ *
+ * @param repo Repository information
+ * @param mirror_name Remote to check (NULL for origin)
+ * @param filter Branches and tags the cache fetches (NULL for all)
+ * @return 1 if sync needed, 0 if not, negative on error
+ */
+int needs_synchronization(const struct repo_info *repo, const char *mirror_name,
+                          const struct ref_filter *filter);
+
+/**
+ * @brief Start the remote listing of a synchronization check on a loop
+ *
+ * Lets many checks run at once; pass each finished listing to
+ * sync_check_finish(). needs_synchronization() is the same for one cache.
+ *
+ * @param loop Loop to start git ls-remote on
+ * @param repo Repository information
+ * @param mirror_name Remote to check (NULL for origin)
+ * @param data Caller data handed back by cache_exec_wait()
+ * @return SYNC_SUCCESS on success, error code on failure
+ */
+int sync_check_start(struct cache_exec_loop *loop, const struct repo_info *repo,
+                     const char *mirror_name, void *data);
+
+/**
+ * @brief Compare a finished remote listing with the cache
  * @param repo Repository information
- * @param mirror_name Specific mirror to check (NULL for any)
+ * @param result Outcome of the command started by sync_check_start()
+ * @param filter Branches and tags the cache fetches (NULL for all)
  * @return 1 if sync needed, 0 if not, negative on error
  */
-int needs_synchronization(const struct repo_info *repo, const char *mirror_name);
+int sync_check_finish(const struct repo_info *repo, const struct cache_exec_result *result,
+                      const struct ref_filter *filter);
 
 /**
  * @brief Update mirror sync status
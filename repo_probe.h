@@ -0,0 +1,116 @@
+#ifndef REPO_PROBE_H
+#define REPO_PROBE_H
+
+/**
+ * @file repo_probe.h
+ * @brief Native Git repository probes for git-cache
+ *
+ * Checks repository structure by reading files directly instead of
+ * spawning git: HEAD, loose refs, packed-refs, the object directory and
+ * pack index headers. These probes are cheap enough to run on every
+ * repository during sync, verify and checkout. Full object verification
+ * still requires git fsck.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Probe status codes
+ */
+#define REPO_PROBE_OK              0
+#define REPO_PROBE_ERROR_INVALID  -1
+#define REPO_PROBE_ERROR_NOT_GIT  -2
+#define REPO_PROBE_ERROR_HEAD     -3
+#define REPO_PROBE_ERROR_REFS     -4
+#define REPO_PROBE_ERROR_OBJECTS  -5
+#define REPO_PROBE_ERROR_PACK     -6
+#define REPO_PROBE_ERROR_NOT_FOUND -7
+
+/**
+ * @brief Maximum object id length in hex (SHA-256)
+ */
+#define REPO_PROBE_OID_HEX_MAX 64
+
+/**
+ * @brief Results of probing a repository
+ */
+struct repo_probe {
+	char git_dir[4096];         /**< Repository git directory */
+	char common_dir[4096];      /**< Directory holding refs and objects */
+	int head_detached;          /**< HEAD holds an object id */
+	char head_ref[256];         /**< Symbolic HEAD target, e.g. refs/heads/main */
+	char head_oid[REPO_PROBE_OID_HEX_MAX + 1]; /**< Resolved HEAD, empty if unborn */
+	int loose_ref_count;        /**< Loose refs under refs/ */
+	int packed_ref_count;       /**< Entries in packed-refs */
+	int branch_count;           /**< Loose and packed refs/heads/ entries, -1 if unknown (reftable) */
+	int pack_count;             /**< Pack index files checked */
+	uint64_t packed_objects;    /**< Objects across all packs */
+};
+
+/**
+ * @brief Locate git and common directories for a repository
+ * @param repo_path Repository path (work tree or bare repository)
+ * @param is_bare Non-zero if repo_path is itself the git directory
+ * @param probe Probe structure; git_dir and common_dir are filled in
+ * @return REPO_PROBE_OK on success, error code on failure
+ */
+int repo_probe_locate(const char *repo_path, int is_bare, struct repo_probe *probe);
+
+/**
+ * @brief Read and validate HEAD
+ * @param probe Probe with git_dir/common_dir set; head fields are filled in
+ * @return REPO_PROBE_OK on success, error code on failure
+ */
+int repo_probe_head(struct repo_probe *probe);
+
+/**
+ * @brief Validate loose refs and packed-refs, counting them
+ * @param probe Probe with common_dir set; ref counts are filled in
+ * @return REPO_PROBE_OK on success, error code on failure
+ */
+int repo_probe_refs(struct repo_probe *probe);
+
+/**
+ * @brief Validate the object directory and every pack index header
+ * @param probe Probe with common_dir set; pack counts are filled in
+ * @return REPO_PROBE_OK on success, error code on failure
+ */
+int repo_probe_objects(struct repo_probe *probe);
+
+/**
+ * @brief Check a pack .idx file and its .pack header
+ * @param idx_path Path to the .idx file
+ * @param object_count Output for number of objects (may be NULL)
+ * @return REPO_PROBE_OK on success, REPO_PROBE_ERROR_PACK on failure
+ */
+int repo_probe_pack_index(const char *idx_path, uint32_t *object_count);
+
+/**
+ * @brief Resolve a ref to an object id without running git
+ * @param common_dir Directory holding refs (see struct repo_probe)
+ * @param refname Full ref name, e.g. refs/heads/main
+ * @param oid Buffer for hex object id
+ * @param oid_size Size of buffer (at least REPO_PROBE_OID_HEX_MAX + 1)
+ * @return REPO_PROBE_OK, REPO_PROBE_ERROR_NOT_FOUND if the ref does not
+ *         exist, or another error code
+ */
+int repo_probe_read_ref(const char *common_dir, const char *refname, char *oid, size_t oid_size);
+
+/**
+ * @brief Run all structural probes on a repository
+ * @param repo_path Repository path
+ * @param is_bare Non-zero for bare repositories
+ * @param probe Output structure (may be NULL)
+ * @return REPO_PROBE_OK if the repository looks sound, error code otherwise
+ */
+int repo_probe_repository(const char *repo_path, int is_bare, struct repo_probe *probe);
+
+/**
+ * @brief Get human-readable error message for probe status
+ * @param error_code Probe status code
+ * @return Error message string
+ */
+const char* repo_probe_error_string(int error_code);
+
+#endif /* REPO_PROBE_H */
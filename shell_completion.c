@@ -31,8 +31,8 @@ static const char bash_completion_script[] =
 "    cur=\"${COMP_WORDS[COMP_CWORD]}\"\n"
 "    prev=\"${COMP_WORDS[COMP_CWORD-1]}\"\n"
 "\n"
-"    commands=\"clone status clean sync list verify repair config mirror completion\"\n"
-"    opts=\"-h --help -v --verbose -V --version -f --force --strategy --depth --org --private --recursive\"\n"
+"    commands=\"clone status clean sync list verify repair gc config mirror daemon serve completion\"\n"
+"    opts=\"-h --help -v --verbose -V --version -f --force --strategy --depth --org --private --recursive --deep --budget --local --refs --sparse --no-sparse --from-file -j --jobs --port --listen --export --max-size --min-free --timings\"\n"
 "\n"
 "    if [[ ${COMP_CWORD} == 1 ]]; then\n"
 "        COMPREPLY=($(compgen -W \"${commands}\" -- ${cur}))\n"
@@ -48,6 +48,18 @@ static const char bash_completion_script[] =
 "            COMPREPLY=($(compgen -W \"1 5 10 50\" -- ${cur}))\n"
 "            return 0\n"
 "            ;;\n"
+"        --refs)\n"
+"            COMPREPLY=($(compgen -W \"default tags no-tags\" -- ${cur}))\n"
+"            return 0\n"
+"            ;;\n"
+"        --port)\n"
+"            COMPREPLY=($(compgen -W \"9418\" -- ${cur}))\n"
+"            return 0\n"
+"            ;;\n"
+"        --from-file)\n"
+"            COMPREPLY=($(compgen -f -- ${cur}))\n"
+"            return 0\n"
+"            ;;\n"
 "        clone)\n"
 "            # Complete git URLs\n"
 "            if [[ ${cur} == git@* ]] || [[ ${cur} == https://* ]] || [[ ${cur} == http://* ]]; then\n"
@@ -62,6 +74,10 @@ static const char bash_completion_script[] =
 "            COMPREPLY=($(compgen -W \"add remove list sync\" -- ${cur}))\n"
 "            return 0\n"
 "            ;;\n"
+"        daemon)\n"
+"            COMPREPLY=($(compgen -W \"run status stop\" -- ${cur}))\n"
+"            return 0\n"
+"            ;;\n"
 "        completion)\n"
 "            COMPREPLY=($(compgen -W \"status install uninstall generate\" -- ${cur}))\n"
 "            return 0\n"
@@ -95,7 +111,21 @@ static const char zsh_completion_script[] =
 "        '--depth[Depth for shallow clones]:depth:(1 5 10 50)' \\\n"
 "        '--org[Organization for forks]:organization:' \\\n"
 "        '--private[Make forked repositories private]' \\\n"
-"        '--recursive[Handle submodules recursively]'\n"
+"        '--recursive[Handle submodules recursively]' \\\n"
+"        '--deep[Verify objects during verify]' \\\n"
+"        '--budget[Seconds verify keeps starting checks]:seconds:(600 3600 14400)' \\\n"
+"        '--local[Build checkouts from the cache without contacting the remote]' \\\n"
+"        '--refs[Branches and tags the cache fetches]:filter:(default tags no-tags)' \\\n"
+"        '--sparse[Directories the checkouts materialize]:directories:' \\\n"
+"        '--no-sparse[Check out the full tree]' \\\n"
+"        '--from-file[Clone every URL listed in file]:manifest:_files' \\\n"
+"        '--jobs[Concurrent batch clone jobs]:jobs:(2 4 8 16)' \\\n"
+"        '--port[Port serve listens on]:port:(9418)' \\\n"
+"        '--listen[Address serve binds]:address:' \\\n"
+"        '--export[Cached repositories serve offers]:repositories:' \\\n"
+"        '--max-size[Size budget for gc]:size:(1G 10G 50G 100G)' \\\n"
+"        '--min-free[Free space for gc to keep]:size:(1G 5G 10G)' \\\n"
+"        '--timings[Print time spent in each phase]'\n"
 "\n"
 "    case $state in\n"
 "        args)\n"
@@ -109,6 +139,9 @@ static const char zsh_completion_script[] =
 "                mirror)\n"
 "                    _arguments '1:mirror command:(add remove list sync)'\n"
 "                    ;;\n"
+"                daemon)\n"
+"                    _arguments '1:daemon command:(run status stop)'\n"
+"                    ;;\n"
 "                completion)\n"
 "                    _arguments '1:completion command:(status install uninstall generate)'\n"
 "                    ;;\n"
@@ -130,8 +163,11 @@ static const char zsh_completion_script[] =
 "        'list:List cached repositories'\n"
 "        'verify:Verify cache integrity and repair if needed'\n"
 "        'repair:Repair outdated checkouts'\n"
+"        'gc:Evict least-recently-used caches'\n"
 "        'config:Show or modify configuration'\n"
 "        'mirror:Manage remote mirrors'\n"
+"        'daemon:Serve clones from a background process'\n"
+"        'serve:Serve the caches to other machines over git://'\n"
 "        'completion:Manage shell completion'\n"
 "    )\n"
 "    _describe 'commands' commands\n"
@@ -153,8 +189,11 @@ static const char fish_completion_script[] =
 "complete -c git-cache -n '__fish_use_subcommand' -a 'list' -d 'List cached repositories'\n"
 "complete -c git-cache -n '__fish_use_subcommand' -a 'verify' -d 'Verify cache integrity'\n"
 "complete -c git-cache -n '__fish_use_subcommand' -a 'repair' -d 'Repair outdated checkouts'\n"
+"complete -c git-cache -n '__fish_use_subcommand' -a 'gc' -d 'Evict least-recently-used caches'\n"
 "complete -c git-cache -n '__fish_use_subcommand' -a 'config' -d 'Show or modify configuration'\n"
 "complete -c git-cache -n '__fish_use_subcommand' -a 'mirror' -d 'Manage remote mirrors'\n"
+"complete -c git-cache -n '__fish_use_subcommand' -a 'daemon' -d 'Serve clones from a background process'\n"
+"complete -c git-cache -n '__fish_use_subcommand' -a 'serve' -d 'Serve the caches to other machines over git://'\n"
 "complete -c git-cache -n '__fish_use_subcommand' -a 'completion' -d 'Manage shell completion'\n"
 "\n"
 "# Global options\n"
@@ -163,6 +202,20 @@ static const char fish_completion_script[] =
 "complete -c git-cache -s V -l version -d 'Show version information'\n"
 "complete -c git-cache -s f -l force -d 'Force operation'\n"
 "complete -c git-cache -l recursive -d 'Handle submodules recursively'\n"
+"complete -c git-cache -l deep -d 'Verify objects during verify'\n"
+"complete -c git-cache -l budget -x -d 'Seconds verify keeps starting checks'\n"
+"complete -c git-cache -l local -d 'Build checkouts from the cache without contacting the remote'\n"
+"complete -c git-cache -l refs -x -a 'default tags no-tags' -d 'Branches and tags the cache fetches'\n"
+"complete -c git-cache -l sparse -x -d 'Directories the checkouts materialize'\n"
+"complete -c git-cache -l no-sparse -d 'Check out the full tree'\n"
+"complete -c git-cache -l from-file -r -d 'Clone every URL listed in file'\n"
+"complete -c git-cache -s j -l jobs -x -d 'Concurrent batch clone jobs'\n"
+"complete -c git-cache -l port -x -d 'Port serve listens on'\n"
+"complete -c git-cache -l listen -x -d 'Address serve binds'\n"
+"complete -c git-cache -l export -x -d 'Cached repositories serve offers'\n"
+"complete -c git-cache -l max-size -x -d 'Size budget for gc'\n"
+"complete -c git-cache -l min-free -x -d 'Free space for gc to keep'\n"
+"complete -c git-cache -l timings -d 'Print time spent in each phase'\n"
 "complete -c git-cache -l private -d 'Make forked repositories private'\n"
 "\n"
 "# Strategy options\n"
@@ -180,6 +233,9 @@ static const char fish_completion_script[] =
 "# Mirror subcommands\n"
 "complete -c git-cache -n '__fish_seen_subcommand_from mirror' -xa 'add remove list sync'\n"
 "\n"
+"# Daemon subcommands\n"
+"complete -c git-cache -n '__fish_seen_subcommand_from daemon' -xa 'run status stop'\n"
+"\n"
 "# Completion subcommands\n"
 "complete -c git-cache -n '__fish_seen_subcommand_from completion' -xa 'status install uninstall generate'\n";
 
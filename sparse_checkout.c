@@ -0,0 +1,188 @@
+/**
+ * @file sparse_checkout.c
+ * @brief Cone-mode sparse checkouts for large repositories
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "sparse_checkout.h"
+#include "cache_exec.h"
+
+/**
+ * @brief Check a directory for components and characters cone mode would mind
+ */
+static int is_valid_dir(const char *dir, size_t len)
+{
+	if (dir[0] == '-') {
+		return 0;
+	}
+	
+	for (size_t i = 0; i < len; i++) {
+		if (!isalnum((unsigned char)dir[i]) && !strchr("._-+@=%#~/", dir[i])) {
+			return 0;
+		}
+	}
+	
+	/* Each component must name a real directory below the top level */
+	const char *component = dir;
+	const char *end = dir + len;
+	while (component < end) {
+		size_t component_len = strcspn(component, "/");
+		if (component + component_len > end) {
+			component_len = (size_t)(end - component);
+		}
+		if (component_len == 0 ||
+		    (component_len == 1 && component[0] == '.') ||
+		    (component_len == 2 && component[0] == '.' && component[1] == '.')) {
+			return 0;
+		}
+		component += component_len + 1;
+	}
+	return 1;
+}
+
+/**
+ * @brief Check whether a canonical spec already lists a directory
+ */
+static int has_dir(const char *cone, const char *dir, size_t len)
+{
+	for (const char *p = cone; *p; ) {
+		size_t word_len = strcspn(p, " ");
+		if (word_len == len && strncmp(p, dir, len) == 0) {
+			return 1;
+		}
+		p += word_len;
+		p += *p == ' ';
+	}
+	return 0;
+}
+
+/**
+ * @brief Parse a sparse spec into its canonical form
+ */
+int sparse_checkout_parse(const char *spec, char *cone, size_t cone_size)
+{
+	if (!spec || !cone || cone_size < sizeof(SPARSE_CHECKOUT_ROOT)) {
+		return SPARSE_CHECKOUT_ERROR_INVALID;
+	}
+	
+	cone[0] = '\0';
+	size_t used = 0;
+	size_t count = 0;
+	
+	const char *p = spec;
+	while (*p) {
+		size_t len = strcspn(p, " \t,");
+		const char *dir = p;
+		p += len;
+		if (*p) {
+			p++;
+		}
+		
+		while (len > 0 && dir[0] == '/') {
+			dir++;
+			len--;
+		}
+		while (len > 0 && dir[len - 1] == '/') {
+			len--;
+		}
+		if (len == 0 || has_dir(cone, dir, len)) {
+			continue;
+		}
+		if (!is_valid_dir(dir, len)) {
+			return SPARSE_CHECKOUT_ERROR_INVALID;
+		}
+		if (count == SPARSE_CHECKOUT_MAX_DIRS || used + len + 2 > cone_size) {
+			cone[0] = '\0';
+			return SPARSE_CHECKOUT_ERROR_TOO_LONG;
+		}
+		
+		if (used > 0) {
+			cone[used++] = ' ';
+		}
+		memcpy(cone + used, dir, len);
+		used += len;
+		cone[used] = '\0';
+		count++;
+	}
+	
+	if (count == 0) {
+		strcpy(cone, SPARSE_CHECKOUT_ROOT);
+	}
+	return SPARSE_CHECKOUT_SUCCESS;
+}
+
+/**
+ * @brief Restrict the working tree of a checkout to a cone
+ */
+int sparse_checkout_apply(const char *checkout_path, const char *cone)
+{
+	if (!checkout_path) {
+		return SPARSE_CHECKOUT_ERROR_INVALID;
+	}
+	
+	/* The cone is split in place, so work on a copy */
+	char dirs[SPARSE_CHECKOUT_SPEC_SIZE] = "";
+	if (cone && strcmp(cone, SPARSE_CHECKOUT_ROOT) != 0) {
+		int len = snprintf(dirs, sizeof(dirs), "%s", cone);
+		if (len < 0 || (size_t)len >= sizeof(dirs)) {
+			return SPARSE_CHECKOUT_ERROR_TOO_LONG;
+		}
+	}
+	
+	const char *argv[SPARSE_CHECKOUT_MAX_DIRS + 6];
+	size_t argc = 0;
+	argv[argc++] = "git";
+	argv[argc++] = "sparse-checkout";
+	if (!cone) {
+		argv[argc++] = "disable";
+	} else {
+		argv[argc++] = "set";
+		argv[argc++] = "--cone";
+		argv[argc++] = "--";
+		for (char *dir = strtok(dirs, " "); dir; dir = strtok(NULL, " ")) {
+			if (argc == SPARSE_CHECKOUT_MAX_DIRS + 5) {
+				return SPARSE_CHECKOUT_ERROR_TOO_LONG;
+			}
+			argv[argc++] = dir;
+		}
+	}
+	argv[argc] = NULL;
+	
+	struct cache_exec_options options;
+	memset(&options, 0, sizeof(options));
+	options.cwd = checkout_path;
+	options.out = CACHE_EXEC_DISCARD;
+	
+	struct cache_exec_result result;
+	int ret = SPARSE_CHECKOUT_ERROR_GIT;
+	if (cache_exec_run(argv, &options, &result) == CACHE_EXEC_SUCCESS && result.exit_code == 0) {
+		ret = SPARSE_CHECKOUT_SUCCESS;
+	}
+	cache_exec_free_result(&result);
+	
+	return ret;
+}
+
+/**
+ * @brief Get human-readable error message for sparse checkout error code
+ */
+const char* sparse_checkout_error_string(int error_code)
+{
+	switch (error_code) {
+		case SPARSE_CHECKOUT_SUCCESS:
+			return "Success";
+		case SPARSE_CHECKOUT_ERROR_INVALID:
+			return "Invalid sparse checkout directory";
+		case SPARSE_CHECKOUT_ERROR_TOO_LONG:
+			return "Too many sparse checkout directories";
+		case SPARSE_CHECKOUT_ERROR_GIT:
+			return "git sparse-checkout failed";
+		default:
+			return "Unknown error";
+	}
+}
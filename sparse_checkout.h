@@ -0,0 +1,75 @@
+#ifndef SPARSE_CHECKOUT_H
+#define SPARSE_CHECKOUT_H
+
+/**
+ * @file sparse_checkout.h
+ * @brief Cone-mode sparse checkouts for large repositories
+ *
+ * A sparse spec lists the directories a checkout materializes, separated
+ * by spaces or commas (e.g. "src/lib,docs"). Files at the top level of the
+ * repository are always checked out as git's cone mode does; the spec "/"
+ * checks out nothing else. Together with a blobless clone only the blobs
+ * inside the cone are ever fetched. The canonical spec of each checkout is
+ * kept in the cache metadata so later clones and updates keep the same
+ * cone.
+ */
+
+#include <stddef.h>
+
+/**
+ * @brief Directories a spec holds at most
+ */
+#define SPARSE_CHECKOUT_MAX_DIRS 64
+
+/**
+ * @brief Buffer size that holds any canonical spec
+ */
+#define SPARSE_CHECKOUT_SPEC_SIZE 4096
+
+/**
+ * @brief Canonical spec of a checkout with only the top-level files
+ */
+#define SPARSE_CHECKOUT_ROOT "/"
+
+/**
+ * @brief Sparse checkout error codes
+ */
+#define SPARSE_CHECKOUT_SUCCESS          0
+#define SPARSE_CHECKOUT_ERROR_INVALID   -1
+#define SPARSE_CHECKOUT_ERROR_TOO_LONG  -2
+#define SPARSE_CHECKOUT_ERROR_GIT       -3
+
+/**
+ * @brief Parse a sparse spec into its canonical form
+ *
+ * Leading and trailing slashes are dropped, duplicates removed and the
+ * directories joined with single spaces. A spec without directories
+ * becomes SPARSE_CHECKOUT_ROOT.
+ *
+ * @param spec Sparse spec
+ * @param cone Buffer for the canonical spec
+ * @param cone_size Size of buffer
+ * @return SPARSE_CHECKOUT_SUCCESS on success, error code on failure
+ */
+int sparse_checkout_parse(const char *spec, char *cone, size_t cone_size);
+
+/**
+ * @brief Restrict the working tree of a checkout to a cone
+ *
+ * Runs git sparse-checkout set --cone, which also works on a clone made
+ * with --no-checkout and then populates the working tree.
+ *
+ * @param checkout_path Checkout path
+ * @param cone Canonical spec, NULL to check out the full tree again
+ * @return SPARSE_CHECKOUT_SUCCESS on success, error code on failure
+ */
+int sparse_checkout_apply(const char *checkout_path, const char *cone);
+
+/**
+ * @brief Get human-readable error message for sparse checkout error code
+ * @param error_code Sparse checkout error code
+ * @return Error message string
+ */
+const char* sparse_checkout_error_string(int error_code);
+
+#endif /* SPARSE_CHECKOUT_H */
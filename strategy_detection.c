@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <time.h>
@@ -18,6 +19,10 @@
 #include "git-cache.h"
 #include "strategy_detection.h"
 #include "github_api.h"
+#include "disk_usage.h"
+#include "repo_probe.h"
+#include "clone_stats.h"
+#include "cache_exec.h"
 
 /* Size thresholds in MB */
 #define SMALL_REPO_THRESHOLD_MB    10
@@ -49,6 +54,9 @@ void get_default_strategy_config(struct strategy_config *config)
 	config->depth_threshold = SHALLOW_COMMIT_THRESHOLD;
 	config->enable_filters = 1;
 	config->respect_user_pref = 1;
+	config->history = NULL;
+	config->history_count = 0;
+	config->history_repo = NULL;
 }
 
 /**
@@ -92,16 +100,100 @@ int load_strategy_config(struct strategy_config *config)
 		}
 	}
 	
+	const char *use_history = getenv("GIT_CACHE_USE_HISTORY");
+	if (use_history && strcmp(use_history, "0") == 0) {
+		config->respect_user_pref = 0;
+	}
+	
 	return 0;
 }
 
 /**
- * @brief Extract repository info from GitHub API (simplified version)
+ * @brief Analyses fetched ahead of time by prefetch_repository_analyses()
+ */
+struct prefetched_analysis {
+	char *owner;
+	char *name;
+	struct repo_analysis analysis;
+};
+
+static struct prefetched_analysis *prefetched = NULL;
+static size_t prefetched_count = 0;
+
+/**
+ * @brief Map the age of the last change to an activity level
+ */
+static int activity_level_from_age(time_t last_activity)
+{
+	int days_since_update = (time(NULL) - last_activity) / (24 * 60 * 60);
+	
+	if (days_since_update < 7) {
+		return 90;
+	} else if (days_since_update < 30) {
+		return 70;
+	} else if (days_since_update < 90) {
+		return 50;
+	}
+	return 30;
+}
+
+/**
+ * @brief Fill an analysis from repository metadata reported by GitHub
+ */
+static int analysis_from_github_repo(const struct github_repo *repo_info, struct repo_analysis *analysis)
+{
+	/* GitHub reports the size of the repository on disk in KiB */
+	analysis->estimated_size = repo_info->size_kb * 1024;
+	analysis->has_large_files = 0;
+	analysis->last_activity = repo_info->pushed_at ? repo_info->pushed_at : time(NULL);
+	analysis->activity_level = activity_level_from_age(analysis->last_activity);
+	analysis->is_monorepo = analysis->estimated_size > (uint64_t)LARGE_REPO_THRESHOLD_MB * 1024 * 1024;
+	analysis->primary_language = strdup(repo_info->language ? repo_info->language : "unknown");
+	
+	return analysis->primary_language ? 0 : -1;
+}
+
+/**
+ * @brief Create a GitHub client using the response cache under the cache root
+ */
+static struct github_client* create_analysis_client(const struct cache_config *config)
+{
+	if (!config || !config->github_token) {
+		return NULL;
+	}
+	
+	struct github_client *client = github_client_create(config->github_token);
+	if (!client) {
+		return NULL;
+	}
+	
+	/* Repeated analyses are answered with 304s from the response cache */
+	if (config->cache_root) {
+		char api_cache_dir[4096];
+		snprintf(api_cache_dir, sizeof(api_cache_dir), "%s/%s", config->cache_root, GITHUB_CACHE_DIR_NAME);
+		github_client_set_cache_dir(client, api_cache_dir);
+	}
+	
+	return client;
+}
+
+/**
+ * @brief Extract repository info from GitHub API
  */
 static int analyze_github_repository(const char *owner, const char *name, 
+	                                const struct cache_config *config,
 	                                struct repo_analysis *analysis)
 {
-	struct github_client *client = github_client_create(NULL);
+	/* Batch operations look repositories up in advance */
+	for (size_t i = 0; i < prefetched_count; i++) {
+		if (strcasecmp(prefetched[i].owner, owner) == 0 && strcasecmp(prefetched[i].name, name) == 0) {
+			*analysis = prefetched[i].analysis;
+			analysis->primary_language = strdup(prefetched[i].analysis.primary_language);
+			return analysis->primary_language ? 0 : -1;
+		}
+	}
+	
+	struct github_client *client = create_analysis_client(config);
 	if (!client) {
 		return -1;
 	}
@@ -113,39 +205,97 @@ static int analyze_github_repository(const char *owner, const char *name,
 		return -1;
 	}
 	
-	/* Use basic repository characteristics for analysis */
-	/* Since we don't have size info from this API, use conservative estimates */
-	analysis->estimated_size = MEDIUM_REPO_THRESHOLD_MB * 1024 * 1024; /* Default to medium */
-	analysis->has_large_files = 0; /* Conservative default */
-	analysis->last_activity = time(NULL); /* Current time as fallback */
-	analysis->activity_level = 50; /* Medium activity */
+	ret = analysis_from_github_repo(repo_info, analysis);
 	
-	/* Check if it's a fork - forks are often smaller */
-	if (repo_info->is_fork) {
-		analysis->estimated_size = SMALL_REPO_THRESHOLD_MB * 1024 * 1024;
-		analysis->activity_level = 30;
+	github_repo_destroy(repo_info);
+	github_client_destroy(client);
+	
+	return ret;
+}
+
+/**
+ * @brief Look up many GitHub repositories with batched GraphQL queries
+ */
+int prefetch_repository_analyses(const char *const *urls, size_t count, const struct cache_config *config)
+{
+	if ((!urls && count > 0) || !config) {
+		return -1;
 	}
 	
-	/* Popular repositories (many forks) might be larger */
-	if (repo_info->fork_count > 100) {
-		analysis->estimated_size = LARGE_REPO_THRESHOLD_MB * 1024 * 1024;
-		analysis->activity_level = 70;
-		analysis->is_monorepo = 1;
+	struct github_client *client = create_analysis_client(config);
+	if (!client) {
+		return -1;
 	}
 	
-	/* Set reasonable defaults */
-	analysis->primary_language = strdup("unknown");
+	struct github_repo_request *requests = calloc(count ? count : 1, sizeof(*requests));
+	struct prefetched_analysis *table = realloc(prefetched, (prefetched_count + count + 1) * sizeof(*prefetched));
+	if (table) {
+		prefetched = table;
+	}
+	if (!requests || !table) {
+		free(requests);
+		github_client_destroy(client);
+		return -1;
+	}
 	
-	github_repo_destroy(repo_info);
+	for (size_t i = 0; i < count; i++) {
+		char *owner = NULL;
+		char *name = NULL;
+		if (urls[i] && strstr(urls[i], "github.com") &&
+		    github_parse_repo_url(urls[i], &owner, &name) == GITHUB_SUCCESS) {
+			requests[i].owner = owner;
+			requests[i].name = name;
+		} else {
+			free(owner);
+			free(name);
+		}
+	}
+	
+	int found = 0;
+	int ret = github_get_repos_graphql(client, requests, count);
+	for (size_t i = 0; i < count; i++) {
+		struct prefetched_analysis *entry = &prefetched[prefetched_count];
+		memset(entry, 0, sizeof(*entry));
+		
+		if (ret == GITHUB_SUCCESS && requests[i].result &&
+		    analysis_from_github_repo(requests[i].result, &entry->analysis) == 0) {
+			entry->owner = (char *)requests[i].owner;
+			entry->name = (char *)requests[i].name;
+			prefetched_count++;
+			found++;
+		} else {
+			free((char *)requests[i].owner);
+			free((char *)requests[i].name);
+		}
+		github_repo_destroy(requests[i].result);
+	}
+	
+	free(requests);
 	github_client_destroy(client);
+	return ret == GITHUB_SUCCESS ? found : -1;
+}
+
+/**
+ * @brief Forget analyses stored by prefetch_repository_analyses()
+ */
+void clear_repository_analyses(void)
+{
+	for (size_t i = 0; i < prefetched_count; i++) {
+		free(prefetched[i].owner);
+		free(prefetched[i].name);
+		cleanup_repo_analysis(&prefetched[i].analysis);
+	}
 	
-	return 0;
+	free(prefetched);
+	prefetched = NULL;
+	prefetched_count = 0;
 }
 
 /**
  * @brief Analyze repository from URL using available APIs
  */
-int analyze_repository_from_url(const char *url, struct repo_analysis *analysis)
+int analyze_repository_from_url(const char *url, const struct cache_config *config,
+	                            struct repo_analysis *analysis)
 {
 	if (!url || !analysis) {
 		return -1;
@@ -177,7 +327,7 @@ int analyze_repository_from_url(const char *url, struct repo_analysis *analysis)
 				}
 				
 				/* Analyze using GitHub API */
-				if (analyze_github_repository(owner, repo, analysis) == 0) {
+				if (analyze_github_repository(owner, repo, config, analysis) == 0) {
 					free(url_copy);
 					return 0;
 				}
@@ -222,94 +372,45 @@ int analyze_repository_from_path(const char *repo_path, struct repo_analysis *an
 	}
 	
 	/* Get repository size */
-	char size_cmd[4096];
-	snprintf(size_cmd, sizeof(size_cmd), "du -sb \"%s\" 2>/dev/null | cut -f1", repo_path);
-	
-	FILE *pipe = popen(size_cmd, "r");
-	if (pipe) {
-		if (fscanf(pipe, "%lu", &analysis->estimated_size) != 1) {
-			analysis->estimated_size = 0;
-		}
-		pclose(pipe);
+	uint64_t size = 0;
+	if (disk_usage_measure(repo_path, &size) == DISK_USAGE_SUCCESS) {
+		analysis->estimated_size = size;
 	}
 	
 	/* Count commits */
-	char commit_cmd[4096];
-	snprintf(commit_cmd, sizeof(commit_cmd), 
-	         "cd \"%s\" && git rev-list --count HEAD 2>/dev/null", repo_path);
-	
-	pipe = popen(commit_cmd, "r");
-	if (pipe) {
-		if (fscanf(pipe, "%d", &analysis->commit_count) != 1) {
-			analysis->commit_count = 0;
-		}
-		pclose(pipe);
+	const char *rev_list[] = {"git", "rev-list", "--count", "HEAD", NULL};
+	char line[64];
+	if (cache_exec_line(rev_list, repo_path, line, sizeof(line)) != 0 ||
+	    sscanf(line, "%d", &analysis->commit_count) != 1) {
+		analysis->commit_count = 0;
 	}
 	
 	/* Count branches */
-	char branch_cmd[4096];
-	snprintf(branch_cmd, sizeof(branch_cmd), 
-	         "cd \"%s\" && git branch -r 2>/dev/null | wc -l", repo_path);
-	
-	pipe = popen(branch_cmd, "r");
-	if (pipe) {
-		if (fscanf(pipe, "%d", &analysis->branch_count) != 1) {
-			analysis->branch_count = 1;
-		}
-		pclose(pipe);
-	}
+	const char *branches[] = {"git", "branch", "-r", NULL};
+	size_t lines;
+	analysis->branch_count = cache_exec_count_lines(branches, repo_path, &lines) == 0 ?
+	                         (int)lines : 1;
 	
 	/* Count tags */
-	char tag_cmd[4096];
-	snprintf(tag_cmd, sizeof(tag_cmd), 
-	         "cd \"%s\" && git tag 2>/dev/null | wc -l", repo_path);
-	
-	pipe = popen(tag_cmd, "r");
-	if (pipe) {
-		if (fscanf(pipe, "%d", &analysis->tag_count) != 1) {
-			analysis->tag_count = 0;
-		}
-		pclose(pipe);
-	}
+	const char *tags[] = {"git", "tag", NULL};
+	analysis->tag_count = cache_exec_count_lines(tags, repo_path, &lines) == 0 ?
+	                      (int)lines : 0;
 	
 	/* Get last activity */
-	char activity_cmd[4096];
-	snprintf(activity_cmd, sizeof(activity_cmd), 
-	         "cd \"%s\" && git log -1 --format=%%ct 2>/dev/null", repo_path);
-	
-	pipe = popen(activity_cmd, "r");
-	if (pipe) {
-		if (fscanf(pipe, "%ld", &analysis->last_activity) != 1) {
-			analysis->last_activity = time(NULL);
-		}
-		pclose(pipe);
+	const char *last_commit[] = {"git", "log", "-1", "--format=%ct", NULL};
+	if (cache_exec_line(last_commit, repo_path, line, sizeof(line)) != 0 ||
+	    sscanf(line, "%ld", &analysis->last_activity) != 1) {
+		analysis->last_activity = time(NULL);
 	}
 	
 	/* Determine activity level */
-	time_t now = time(NULL);
-	int days_since_update = (now - analysis->last_activity) / (24 * 60 * 60);
-	
-	if (days_since_update < 7) {
-		analysis->activity_level = 90;
-	} else if (days_since_update < 30) {
-		analysis->activity_level = 70;
-	} else if (days_since_update < 90) {
-		analysis->activity_level = 50;
-	} else {
-		analysis->activity_level = 30;
-	}
+	analysis->activity_level = activity_level_from_age(analysis->last_activity);
 	
 	/* Check for large files (>10MB) */
-	char large_files_cmd[4096];
-	snprintf(large_files_cmd, sizeof(large_files_cmd),
-	         "cd \"%s\" && find . -type f -size +10M 2>/dev/null | head -1", repo_path);
-	
-	pipe = popen(large_files_cmd, "r");
-	if (pipe) {
-		char buffer[256];
-		analysis->has_large_files = (fgets(buffer, sizeof(buffer), pipe) != NULL);
-		pclose(pipe);
-	}
+	const char *large_files[] = {"find", ".", "-type", "f", "-size", "+10M", "-print", "-quit", NULL};
+	char large_file[256];
+	cache_exec_line(large_files, repo_path, large_file, sizeof(large_file));
+	analysis->has_large_files = large_file[0] != '\0';
 	
 	/* Estimate if monorepo based on size and file count */
 	analysis->is_monorepo = (analysis->estimated_size > (500 * 1024 * 1024)) ||
@@ -318,6 +419,60 @@ int analyze_repository_from_path(const char *repo_path, struct repo_analysis *an
 	return 0;
 }
 
+/**
+ * @brief Recommend the strategy with the lowest recorded time to a usable checkout
+ *
+ * Needs observations for at least two strategies; confidence grows with
+ * the number of observations behind the two candidates being compared.
+ */
+static int recommend_from_history(const struct repo_analysis *analysis,
+	                             const struct strategy_config *config,
+	                             struct strategy_recommendation *recommendation)
+{
+	if (!config->history || config->history_count == 0) {
+		return -1;
+	}
+	
+	struct clone_stats_estimate estimates[CLONE_STATS_STRATEGIES];
+	clone_stats_estimate(config->history, config->history_count, config->history_repo,
+	                     analysis->estimated_size, estimates);
+	
+	int best = -1;
+	int runner_up = -1;
+	for (int s = 0; s < CLONE_STATS_STRATEGIES; s++) {
+		if (estimates[s].observations < 1.0) {
+			continue;
+		}
+		if (best < 0 || estimates[s].expected_ms < estimates[best].expected_ms) {
+			runner_up = best;
+			best = s;
+		} else if (runner_up < 0 || estimates[s].expected_ms < estimates[runner_up].expected_ms) {
+			runner_up = s;
+		}
+	}
+	
+	if (best < 0 || runner_up < 0) {
+		return -1;
+	}
+	
+	double observations = estimates[best].observations < estimates[runner_up].observations ?
+	                      estimates[best].observations : estimates[runner_up].observations;
+	
+	recommendation->strategy = (enum clone_strategy)best;
+	recommendation->fallback = (enum clone_strategy)runner_up;
+	recommendation->confidence = 50 + (int)(45.0 * observations / (observations + 3.0));
+	
+	char reasoning[256];
+	snprintf(reasoning, sizeof(reasoning),
+	         "Recorded clones: %s expected %.1fs vs %s %.1fs (%.1f observations)",
+	         get_strategy_description((enum clone_strategy)best), estimates[best].expected_ms / 1000.0,
+	         get_strategy_description((enum clone_strategy)runner_up), estimates[runner_up].expected_ms / 1000.0,
+	         estimates[best].observations + estimates[runner_up].observations);
+	recommendation->reasoning = strdup(reasoning);
+	
+	return 0;
+}
+
 /**
  * @brief Get optimal clone strategy based on analysis
  */
@@ -333,6 +488,11 @@ int get_optimal_strategy(const struct repo_analysis *analysis,
 	memset(recommendation, 0, sizeof(*recommendation));
 	recommendation->fallback = CLONE_STRATEGY_FULL;
 	
+	/* Measured clone times beat static thresholds once there is enough history */
+	if (config->respect_user_pref && recommend_from_history(analysis, config, recommendation) == 0) {
+		return 0;
+	}
+	
 	uint64_t size_mb = analysis->estimated_size / (1024 * 1024);
 	
 	/* Decision logic based on repository characteristics */
@@ -433,15 +593,32 @@ int auto_detect_strategy(struct repo_info *repo, const struct cache_config *conf
 	
 	/* Analyze repository */
 	struct repo_analysis analysis;
-	int ret = analyze_repository_from_url(repo->original_url, &analysis);
+	int ret = analyze_repository_from_url(repo->original_url, config, &analysis);
 	if (ret != 0) {
 		cleanup_repo_analysis(&analysis);
 		return ret;
 	}
+	repo->estimated_size = analysis.estimated_size;
+	repo->is_monorepo = analysis.is_monorepo;
+	
+	/* Load recorded clone timings */
+	struct clone_stats_record *history = NULL;
+	size_t history_count = 0;
+	char repo_name[256];
+	if (strategy_config.respect_user_pref && config->cache_root &&
+	    clone_stats_load(config->cache_root, &history, &history_count) == CLONE_STATS_SUCCESS) {
+		strategy_config.history = history;
+		strategy_config.history_count = history_count;
+		if (repo->owner && repo->name) {
+			snprintf(repo_name, sizeof(repo_name), "%s/%s", repo->owner, repo->name);
+			strategy_config.history_repo = repo_name;
+		}
+	}
 	
 	/* Get strategy recommendation */
 	struct strategy_recommendation recommendation;
 	ret = get_optimal_strategy(&analysis, &strategy_config, &recommendation);
+	free(history);
 	if (ret != 0) {
 		cleanup_repo_analysis(&analysis);
 		return ret;
@@ -585,17 +762,34 @@ void cleanup_strategy_recommendation(struct strategy_recommendation *recommendat
 }
 
 /**
- * @brief Learn from user's strategy choices (placeholder for future ML)
+ * @brief Record a clone outcome in the stats log used by recommend_from_history()
  */
 int learn_from_strategy_choice(const struct repo_info *repo,
-	                          const struct repo_analysis *analysis,
-	                          int success)
+	                          const struct cache_config *config,
+	                          uint64_t wall_ms, int success)
 {
-	/* For now, this is a placeholder for future machine learning integration */
-	(void)repo;
-	(void)analysis;
-	(void)success;
+	if (!repo || !config || !config->cache_root || !repo->owner || !repo->name ||
+	    repo->strategy == CLONE_STRATEGY_AUTO) {
+		return -1;
+	}
 	
-	/* TODO: Implement learning algorithm to improve recommendations */
-	return 0;
+	struct clone_stats_record record;
+	memset(&record, 0, sizeof(record));
+	record.recorded_at = time(NULL);
+	snprintf(record.repo, sizeof(record.repo), "%s/%s", repo->owner, repo->name);
+	record.strategy = repo->strategy;
+	record.wall_ms = wall_ms;
+	record.estimated_size = repo->estimated_size;
+	record.success = success;
+	
+	/* A fresh cache holds exactly what was received */
+	if (success && repo->cache_path) {
+		struct repo_probe probe;
+		if (repo_probe_repository(repo->cache_path, 1, &probe) == REPO_PROBE_OK) {
+			record.objects = probe.packed_objects;
+		}
+		disk_usage_account(repo->cache_path, &record.bytes);
+	}
+	
+	return clone_stats_append(config->cache_root, &record) == CLONE_STATS_SUCCESS ? 0 : -1;
 }
\ No newline at end of file
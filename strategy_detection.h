@@ -10,6 +10,7 @@
  */
 
 #include "git-cache.h"
+#include "clone_stats.h"
 #include <stdint.h>
 
 /* Forward declarations */
@@ -52,16 +53,40 @@ struct strategy_config {
 	uint64_t size_threshold_mb; /**< Size threshold for strategy switching */
 	int depth_threshold;     /**< Commit count threshold for shallow clones */
 	int enable_filters;      /**< Enable partial clone filters */
-	int respect_user_pref;   /**< Respect user's previous strategy choices */
+	int respect_user_pref;   /**< Prefer strategies that were fastest in recorded clones */
+	const struct clone_stats_record *history; /**< Recorded clones, NULL if none */
+	size_t history_count;    /**< Number of history records */
+	const char *history_repo; /**< Repository being analyzed as owner/name (may be NULL) */
 };
 
 /**
  * @brief Analyze repository characteristics from URL
  * @param url Repository URL to analyze
+ * @param config Cache configuration providing the GitHub token and cache root (may be NULL)
  * @param analysis Output structure for analysis results
  * @return 0 on success, negative error code on failure
  */
-int analyze_repository_from_url(const char *url, struct repo_analysis *analysis);
+int analyze_repository_from_url(const char *url, const struct cache_config *config,
+	                            struct repo_analysis *analysis);
+
+/**
+ * @brief Look up many GitHub repositories ahead of analysis
+ *
+ * Fetches size, last push and language for all GitHub URLs with batched
+ * GraphQL queries. Later analyze_repository_from_url() calls for these
+ * repositories are answered from memory, including in forked workers.
+ *
+ * @param urls Repository URLs; non-GitHub URLs are ignored
+ * @param count Number of URLs
+ * @param config Cache configuration providing the GitHub token and cache root
+ * @return Number of repositories analyzed, negative error code on failure
+ */
+int prefetch_repository_analyses(const char *const *urls, size_t count, const struct cache_config *config);
+
+/**
+ * @brief Forget analyses stored by prefetch_repository_analyses()
+ */
+void clear_repository_analyses(void);
 
 /**
  * @brief Analyze repository characteristics from local path
@@ -91,15 +116,20 @@ int get_optimal_strategy(const struct repo_analysis *analysis,
 int auto_detect_strategy(struct repo_info *repo, const struct cache_config *config);
 
 /**
- * @brief Learn from user's strategy choices to improve recommendations
- * @param repo Repository information with user's chosen strategy
- * @param analysis Repository analysis that led to the choice
- * @param success Whether the chosen strategy worked well
+ * @brief Record how a clone went so later recommendations can learn from it
+ *
+ * Appends the strategy, wall time, received bytes and objects and the
+ * size estimate to CLONE_STATS_FILE under the cache root.
+ *
+ * @param repo Cloned repository with the strategy that was used
+ * @param config Cache configuration providing the cache root
+ * @param wall_ms Time from starting the clone until the checkout was usable
+ * @param success Whether the clone succeeded
  * @return 0 on success, negative error code on failure
  */
 int learn_from_strategy_choice(const struct repo_info *repo,
-	                          const struct repo_analysis *analysis,
-	                          int success);
+	                          const struct cache_config *config,
+	                          uint64_t wall_ms, int success);
 
 /**
  * @brief Get default strategy configuration
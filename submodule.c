@@ -11,11 +11,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
 #include <sys/stat.h>
 #include <errno.h>
 
 #include "git-cache.h"
 #include "submodule.h"
+#include "cache_exec.h"
+#include "cache_metadata.h"
+#include "worker_pool.h"
 
 /**
  * @brief Parse all submodules from .gitmodules file
@@ -166,158 +170,408 @@ void free_submodule_list(struct submodule_list *list)
 	list->capacity = 0;
 }
 
-/* Forward declarations for static functions */
-static int cache_submodule(const struct repo_info *parent_repo, const struct submodule_info *sub, 
-			  struct cache_config *config);
-static int init_submodule_checkout(const struct repo_info *parent_repo, const struct submodule_info *sub,
-				  struct cache_config *config);
+/**
+ * @brief Canonical cache locations already processed in this run
+ *
+ * Shared caches are fetched at most once per process no matter how many
+ * parents reference them.
+ */
+static char **fetched_caches = NULL;
+static size_t fetched_count = 0;
 
-int process_submodules(const struct repo_info *repo, struct cache_config *config, int recursive)
+/**
+ * @brief Chain of caches from the top-level repository down to the current one
+ */
+struct submodule_chain {
+	const char *cache_path;
+	const struct submodule_chain *parent;
+};
+
+/**
+ * @brief A submodule resolved to its cache location
+ */
+struct resolved_submodule {
+	const struct submodule_info *sub;
+	char url[2048];          /**< Absolute URL (relative URLs resolved) */
+	char cache_path[4096];   /**< Canonical shared cache, or per-parent fallback */
+	char owner[256];         /**< GitHub owner of a canonical cache ("" otherwise) */
+	char name[256];          /**< GitHub name of a canonical cache ("" otherwise) */
+	int canonical;           /**< Whether the cache is a shared github.com entry */
+	int skip;                /**< Already an ancestor (cycle) */
+	int cache_ok;            /**< Cache stage succeeded */
+};
+
+/**
+ * @brief Resolve a relative submodule URL against the parent URL
+ */
+static int resolve_submodule_url(const char *parent_url, const char *url, char *out, size_t out_size)
 {
-	char gitmodules_path[4096];
-	struct submodule_list submodules;
-	int ret = 0;
-	
-	/* TODO: Implement recursive submodule processing */
-	(void)recursive; /* Suppress unused parameter warning */
+	if (strncmp(url, "./", 2) != 0 && strncmp(url, "../", 3) != 0) {
+		return snprintf(out, out_size, "%s", url) < (int)out_size ? 0 : -1;
+	}
 	
-	/* Construct path to .gitmodules in the checkout */
-	snprintf(gitmodules_path, sizeof(gitmodules_path), "%s/.gitmodules", repo->checkout_path);
+	if (!parent_url) {
+		return -1;
+	}
 	
-	/* Parse .gitmodules file */
-	if (parse_gitmodules(gitmodules_path, &submodules) != 0) {
+	char base[2048];
+	if (snprintf(base, sizeof(base), "%s", parent_url) >= (int)sizeof(base)) {
 		return -1;
 	}
 	
-	if (config->verbose && submodules.count > 0) {
-		printf("Found %zu submodule(s) in %s\n", submodules.count, repo->name);
+	/* Relative URLs are relative to the parent repository itself */
+	size_t len = strlen(base);
+	while (len > 0 && base[len - 1] == '/') {
+		base[--len] = '\0';
 	}
 	
-	/* Process each submodule */
-	for (size_t i = 0; i < submodules.count; i++) {
-		const struct submodule_info *sub = &submodules.submodules[i];
-		
-		if (config->verbose) {
-			printf("  Submodule '%s' at path '%s' from %s\n", 
-				sub->name, sub->path, sub->url);
-		}
-		
-		/* Create cache entry for submodule */
-		if (cache_submodule(repo, sub, config) != 0) {
-			fprintf(stderr, "Failed to cache submodule '%s'\n", sub->name);
-			ret = -1;
-			/* Continue with other submodules */
-		}
-		
-		/* Initialize submodule in checkout */
-		if (init_submodule_checkout(repo, sub, config) != 0) {
-			fprintf(stderr, "Failed to initialize submodule '%s' checkout\n", sub->name);
-			ret = -1;
+	const char *rest = url;
+	for (;;) {
+		if (strncmp(rest, "./", 2) == 0) {
+			rest += 2;
+		} else if (strncmp(rest, "../", 3) == 0) {
+			char *cut = strrchr(base, '/');
+			char *colon = strrchr(base, ':');
+			if (colon && (!cut || colon > cut)) {
+				cut = colon;
+			}
+			if (!cut) {
+				return -1;
+			}
+			cut[1] = '\0';
+			if (*cut == '/') {
+				*cut = '\0';
+			}
+			rest += 3;
+		} else {
+			break;
 		}
 	}
 	
-	free_submodule_list(&submodules);
-	return ret;
+	size_t base_len = strlen(base);
+	const char *separator = base_len > 0 && base[base_len - 1] == ':' ? "" : "/";
+	return snprintf(out, out_size, "%s%s%s", base, separator, rest) < (int)out_size ? 0 : -1;
 }
 
-static int cache_submodule(const struct repo_info *parent_repo, const struct submodule_info *sub, 
-	                struct cache_config *config)
+/**
+ * @brief Find the cache location for a submodule
+ *
+ * GitHub submodules share the canonical github.com/<owner>/<name> entry
+ * used for top-level clones; anything else stays below the parent cache.
+ */
+static int resolve_submodule(const struct repo_info *parent_repo, const struct submodule_info *sub,
+			     const struct cache_config *config, struct resolved_submodule *resolved)
 {
-	/* Create a repo_info for the submodule */
-	struct repo_info *sub_repo = malloc(sizeof(struct repo_info));
+	memset(resolved, 0, sizeof(*resolved));
+	resolved->sub = sub;
+	
+	if (resolve_submodule_url(parent_repo->original_url, sub->url, resolved->url, sizeof(resolved->url)) != 0) {
+		return -1;
+	}
+	
+	struct repo_info *sub_repo = calloc(1, sizeof(struct repo_info));
 	if (!sub_repo) {
 		return -1;
 	}
 	
-	memset(sub_repo, 0, sizeof(struct repo_info));
-	sub_repo->original_url = strdup(sub->url);
-	sub_repo->strategy = parent_repo->strategy;
+	int canonical = repo_info_parse_url(resolved->url, sub_repo) == 0 &&
+			sub_repo->type == REPO_TYPE_GITHUB && sub_repo->owner && sub_repo->name &&
+			config->cache_root;
 	
-	/* Parse the submodule URL to determine type and extract owner/name */
-	if (repo_info_parse_url(sub->url, sub_repo) != 0) {
-		repo_info_destroy(sub_repo);
-		return -1;
+	int len;
+	if (canonical) {
+		len = snprintf(resolved->cache_path, sizeof(resolved->cache_path), "%s/github.com/%s/%s",
+			       config->cache_root, sub_repo->owner, sub_repo->name);
+		resolved->canonical = snprintf(resolved->owner, sizeof(resolved->owner), "%s",
+					       sub_repo->owner) < (int)sizeof(resolved->owner) &&
+				      snprintf(resolved->name, sizeof(resolved->name), "%s",
+					       sub_repo->name) < (int)sizeof(resolved->name);
+	} else {
+		len = snprintf(resolved->cache_path, sizeof(resolved->cache_path), "%s/submodules/%s",
+			       parent_repo->cache_path, sub->path);
+	}
+	
+	repo_info_destroy(sub_repo);
+	return len > 0 && (size_t)len < sizeof(resolved->cache_path) ? 0 : -1;
+}
+
+/**
+ * @brief Check whether a cache was already processed in this run
+ */
+static int cache_already_fetched(const char *cache_path)
+{
+	for (size_t i = 0; i < fetched_count; i++) {
+		if (strcmp(fetched_caches[i], cache_path) == 0) {
+			return 1;
+		}
 	}
+	return 0;
+}
+
+/**
+ * @brief Remember a processed cache
+ */
+static void remember_fetched_cache(const char *cache_path)
+{
+	char **new_list = realloc(fetched_caches, (fetched_count + 1) * sizeof(*fetched_caches));
+	if (!new_list) {
+		return;
+	}
+	fetched_caches = new_list;
+	fetched_caches[fetched_count] = strdup(cache_path);
+	if (fetched_caches[fetched_count]) {
+		fetched_count++;
+	}
+}
+
+/**
+ * @brief Check whether another process fetched a cache moments ago
+ */
+static int cache_recently_fetched(const char *cache_path)
+{
+	char fetch_head[4096 + 16];
+	snprintf(fetch_head, sizeof(fetch_head), "%s/FETCH_HEAD", cache_path);
 	
-	/* Setup paths for submodule cache */
-	char submodule_cache_base[4096];
-	snprintf(submodule_cache_base, sizeof(submodule_cache_base), 
-		"%s/submodules/%s", parent_repo->cache_path, sub->path);
+	/* A fresh clone has no FETCH_HEAD yet but writes packed-refs */
+	struct stat st;
+	if (stat(fetch_head, &st) != 0) {
+		snprintf(fetch_head, sizeof(fetch_head), "%s/packed-refs", cache_path);
+		if (stat(fetch_head, &st) != 0) {
+			return 0;
+		}
+	}
+	return time(NULL) - st.st_mtime < SUBMODULE_REFETCH_SECONDS;
+}
+
+/**
+ * @brief Run a command without a shell and report whether it succeeded
+ */
+static int run_command(const char *const argv[], const char *cwd)
+{
+	struct cache_exec_options options;
+	memset(&options, 0, sizeof(options));
+	options.cwd = cwd;
 	
-	/* Create submodule cache directory if needed */
-	char mkdir_cmd[8192];
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wformat-truncation"
-	snprintf(mkdir_cmd, sizeof(mkdir_cmd), "mkdir -p $(dirname %s)", submodule_cache_base);
-#pragma GCC diagnostic pop
-	if (system(mkdir_cmd) != 0) {
-		repo_info_destroy(sub_repo);
-		return -1;
+	struct cache_exec_result result;
+	int ret = cache_exec_run(argv, &options, &result);
+	cache_exec_free_result(&result);
+	return ret == CACHE_EXEC_SUCCESS && result.exit_code == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Remove a directory tree, ignoring failures
+ */
+static void remove_tree(const char *path)
+{
+	const char *argv[] = { "rm", "-rf", "--", path, NULL };
+	if (run_command(argv, NULL) != 0) {
+		/* Leftover temp directory is harmless */
+	}
+}
+
+/**
+ * @brief Give a shared submodule cache the metadata of a top-level cache
+ *
+ * Without it the cache index records no size, checkouts or access time,
+ * so gc would evict shared submodule caches first and leave them out of
+ * the size total.
+ */
+static void record_submodule_cache(const struct resolved_submodule *resolved, int fetched)
+{
+	if (!resolved->canonical) {
+		return;
+	}
+	
+	if (cache_metadata_exists(resolved->cache_path) == 1) {
+		if (fetched) {
+			cache_metadata_update_sync(resolved->cache_path);
+			cache_metadata_update_size(resolved->cache_path);
+		}
+		return;
+	}
+	
+	struct repo_info repo;
+	memset(&repo, 0, sizeof(repo));
+	repo.original_url = (char *)resolved->url;
+	repo.owner = (char *)resolved->owner;
+	repo.name = (char *)resolved->name;
+	repo.type = REPO_TYPE_GITHUB;
+	repo.strategy = CLONE_STRATEGY_FULL;
+	
+	struct cache_metadata *metadata = cache_metadata_create(&repo);
+	if (!metadata) {
+		return;
+	}
+	metadata->last_sync_time = time(NULL);
+	if (cache_metadata_save(resolved->cache_path, metadata) == METADATA_SUCCESS) {
+		cache_metadata_update_size(resolved->cache_path);
+	}
+	cache_metadata_destroy(metadata);
+}
+
+/**
+ * @brief Clone or update one submodule cache
+ */
+static int cache_submodule(const struct resolved_submodule *resolved, const struct cache_config *config)
+{
+	const struct submodule_info *sub = resolved->sub;
+	
+	/* Create parent directory of the cache */
+	char parent_dir[4096];
+	snprintf(parent_dir, sizeof(parent_dir), "%s", resolved->cache_path);
+	char *slash = strrchr(parent_dir, '/');
+	if (slash) {
+		*slash = '\0';
+		const char *mkdir_argv[] = { "mkdir", "-p", "--", parent_dir, NULL };
+		if (run_command(mkdir_argv, NULL) != 0) {
+			return -1;
+		}
 	}
 	
-	/* Set the cache path for the submodule */
-	free(sub_repo->cache_path);
-	sub_repo->cache_path = strdup(submodule_cache_base);
+	char head_path[4096 + 8];
+	snprintf(head_path, sizeof(head_path), "%s/HEAD", resolved->cache_path);
 	
-	/* Clone or update the submodule cache */
-	if (access(sub_repo->cache_path, F_OK) != 0) {
+	if (access(head_path, F_OK) != 0) {
 		/* Clone the submodule into cache */
 		if (config->verbose) {
 			printf("    Cloning submodule '%s' into cache...\n", sub->name);
 		}
 		
-		char clone_cmd[8192];
-		snprintf(clone_cmd, sizeof(clone_cmd), 
-			"git clone --bare %s %s %s", 
-			config->verbose ? "" : "-q",
-			sub->url, 
-			sub_repo->cache_path);
+		/* Clone next to the target and rename so concurrent parents never see a partial cache */
+		char temp_path[4096 + 32];
+		snprintf(temp_path, sizeof(temp_path), "%s.tmp.%d", resolved->cache_path, (int)getpid());
 		
-		if (system(clone_cmd) != 0) {
+		/* The URL comes from .gitmodules, so it is passed after "--" and never through a shell */
+		remove_tree(temp_path);
+		const char *clone_argv[8];
+		size_t argc = 0;
+		clone_argv[argc++] = "git";
+		clone_argv[argc++] = "clone";
+		clone_argv[argc++] = "--bare";
+		if (!config->verbose) {
+			clone_argv[argc++] = "-q";
+		}
+		clone_argv[argc++] = "--";
+		clone_argv[argc++] = resolved->url;
+		clone_argv[argc++] = temp_path;
+		clone_argv[argc] = NULL;
+		if (run_command(clone_argv, NULL) != 0) {
 			fprintf(stderr, "Failed to clone submodule '%s'\n", sub->name);
-			repo_info_destroy(sub_repo);
+			remove_tree(temp_path);
 			return -1;
 		}
-	} else {
+		
+		/* An empty directory left by an earlier run may still be in the way */
+		rmdir(resolved->cache_path);
+		if (rename(temp_path, resolved->cache_path) != 0) {
+			remove_tree(temp_path);
+			if (access(head_path, F_OK) != 0) {
+				fprintf(stderr, "Failed to install submodule cache '%s'\n", sub->name);
+				return -1;
+			}
+		}
+		record_submodule_cache(resolved, 1);
+	} else if (!cache_recently_fetched(resolved->cache_path)) {
 		/* Update existing submodule cache */
 		if (config->verbose) {
 			printf("    Updating submodule '%s' cache...\n", sub->name);
 		}
 		
-		char fetch_cmd[8192];
-		snprintf(fetch_cmd, sizeof(fetch_cmd),
-			"cd %s && git fetch %s --all --prune",
-			sub_repo->cache_path,
-			config->verbose ? "" : "-q");
-		
-		if (system(fetch_cmd) != 0) {
+		const char *fetch_argv[7];
+		size_t argc = 0;
+		fetch_argv[argc++] = "git";
+		fetch_argv[argc++] = "fetch";
+		if (!config->verbose) {
+			fetch_argv[argc++] = "-q";
+		}
+		fetch_argv[argc++] = "--prune";
+		fetch_argv[argc++] = "origin";
+		fetch_argv[argc++] = "+refs/heads/*:refs/heads/*";
+		fetch_argv[argc] = NULL;
+		int fetched = run_command(fetch_argv, resolved->cache_path) == 0;
+		if (!fetched) {
 			fprintf(stderr, "Warning: Failed to update submodule '%s' cache\n", sub->name);
 			/* Continue anyway */
 		}
+		record_submodule_cache(resolved, fetched);
+	} else {
+		/* A cache shared with an older parent may predate its metadata */
+		record_submodule_cache(resolved, 0);
 	}
 	
-	repo_info_destroy(sub_repo);
 	return 0;
 }
 
-static int init_submodule_checkout(const struct repo_info *parent_repo, const struct submodule_info *sub,
-	                       struct cache_config *config)
+/**
+ * @brief Worker pool entry point of a submodule cache stage
+ */
+static int cache_submodule_worker(void *job, void *context)
 {
+	return cache_submodule(job, context) == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Run cache stages for all submodules of one parent concurrently
+ */
+static void cache_submodules_parallel(struct resolved_submodule *resolved, size_t count,
+				      const struct cache_config *config)
+{
+	struct worker_pool pool;
+	int pooled = worker_pool_init(&pool, SUBMODULE_MAX_PARALLEL, 0) == WORKER_POOL_SUCCESS;
+	size_t next = 0;
+	
+	for (;;) {
+		/* Start workers up to the limit */
+		while (next < count && (!pooled || worker_pool_has_room(&pool))) {
+			struct resolved_submodule *item = &resolved[next++];
+			
+			if (item->skip) {
+				continue;
+			}
+			
+			/* Each shared cache is handled once even if listed twice */
+			if (cache_already_fetched(item->cache_path)) {
+				item->cache_ok = 1;
+				continue;
+			}
+			remember_fetched_cache(item->cache_path);
+			
+			if (!pooled) {
+				item->cache_ok = cache_submodule(item, config) == 0;
+				continue;
+			}
+			worker_pool_start(&pool, cache_submodule_worker, item, (void *)config);
+		}
+		
+		struct worker_pool_result done;
+		if (!pooled || worker_pool_wait(&pool, &done) != 1) {
+			break;
+		}
+		((struct resolved_submodule *)done.job)->cache_ok = done.exit_code == 0;
+		worker_pool_free_result(&done);
+	}
+	
+	if (pooled) {
+		worker_pool_destroy(&pool);
+	}
+}
+
+/**
+ * @brief Initialize a submodule checkout borrowing objects from its cache
+ */
+static int init_submodule_checkout(const char *checkout_path, const struct resolved_submodule *resolved,
+				   const struct cache_config *config)
+{
+	const struct submodule_info *sub = resolved->sub;
 	char submodule_path[4096];
-	char submodule_cache[4096];
-	char reference_flag[4096];
+	char git_path[4096 + 8];
 	
 	/* Construct full path to submodule in checkout */
-	snprintf(submodule_path, sizeof(submodule_path), 
-		"%s/%s", parent_repo->checkout_path, sub->path);
-	
-	/* Construct path to submodule cache */
-	snprintf(submodule_cache, sizeof(submodule_cache),
-		"%s/submodules/%s", parent_repo->cache_path, sub->path);
+	snprintf(submodule_path, sizeof(submodule_path), "%s/%s", checkout_path, sub->path);
+	snprintf(git_path, sizeof(git_path), "%s/.git", submodule_path);
 	
-	/* Check if submodule directory exists */
-	struct stat st;
-	if (stat(submodule_path, &st) == 0) {
+	/* Check if submodule is already checked out */
+	if (access(git_path, F_OK) == 0) {
 		if (config->verbose) {
 			printf("    Submodule '%s' already initialized\n", sub->name);
 		}
@@ -329,24 +583,153 @@ static int init_submodule_checkout(const struct repo_info *parent_repo, const st
 		printf("    Initializing submodule '%s' with reference to cache...\n", sub->name);
 	}
 	
-	/* Use git submodule update with reference */
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wformat-truncation"
-	snprintf(reference_flag, sizeof(reference_flag), "--reference=%s", submodule_cache);
-#pragma GCC diagnostic pop
-	
-	char init_cmd[8192];
-	snprintf(init_cmd, sizeof(init_cmd),
-		"cd %s && git submodule update --init %s %s -- %s",
-		parent_repo->checkout_path,
-		config->verbose ? "" : "-q",
-		reference_flag,
-		sub->path);
-	
-	if (system(init_cmd) != 0) {
+	char reference[4096 + 16];
+	snprintf(reference, sizeof(reference), "--reference=%s", resolved->cache_path);
+	const char *init_argv[9];
+	size_t argc = 0;
+	init_argv[argc++] = "git";
+	init_argv[argc++] = "submodule";
+	if (!config->verbose) {
+		init_argv[argc++] = "--quiet";
+	}
+	init_argv[argc++] = "update";
+	init_argv[argc++] = "--init";
+	init_argv[argc++] = reference;
+	init_argv[argc++] = "--";
+	init_argv[argc++] = sub->path;
+	init_argv[argc] = NULL;
+	if (run_command(init_argv, checkout_path) != 0) {
 		fprintf(stderr, "Failed to initialize submodule '%s'\n", sub->name);
 		return -1;
 	}
 	
+	/* The new checkout borrows objects from the cache, like a top-level checkout */
+	if (resolved->canonical) {
+		cache_metadata_increment_ref(resolved->cache_path);
+	}
+	
 	return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Process submodules of one checkout, descending up to SUBMODULE_MAX_DEPTH
+ */
+static int process_submodules_at(const struct repo_info *repo, struct cache_config *config, int recursive,
+				 const struct submodule_chain *ancestors, int depth)
+{
+	char gitmodules_path[4096];
+	struct submodule_list submodules;
+	int ret = 0;
+	
+	/* Construct path to .gitmodules in the checkout */
+	snprintf(gitmodules_path, sizeof(gitmodules_path), "%s/.gitmodules", repo->checkout_path);
+	
+	/* Parse .gitmodules file */
+	if (parse_gitmodules(gitmodules_path, &submodules) != 0) {
+		return -1;
+	}
+	
+	if (config->verbose && submodules.count > 0) {
+		printf("Found %zu submodule(s) in %s\n", submodules.count, repo->name ? repo->name : repo->checkout_path);
+	}
+	
+	if (submodules.count == 0) {
+		free_submodule_list(&submodules);
+		return 0;
+	}
+	
+	struct resolved_submodule *resolved = calloc(submodules.count, sizeof(*resolved));
+	if (!resolved) {
+		free_submodule_list(&submodules);
+		return -1;
+	}
+	
+	/* Resolve cache locations and break cycles */
+	for (size_t i = 0; i < submodules.count; i++) {
+		const struct submodule_info *sub = &submodules.submodules[i];
+		
+		if (config->verbose) {
+			printf("  Submodule '%s' at path '%s' from %s\n", 
+				sub->name, sub->path, sub->url);
+		}
+		
+		if (resolve_submodule(repo, sub, config, &resolved[i]) != 0) {
+			fprintf(stderr, "Failed to resolve submodule '%s'\n", sub->name);
+			resolved[i].skip = 1;
+			ret = -1;
+			continue;
+		}
+		
+		for (const struct submodule_chain *link = ancestors; link; link = link->parent) {
+			if (link->cache_path && strcmp(link->cache_path, resolved[i].cache_path) == 0) {
+				fprintf(stderr, "Warning: Submodule cycle at '%s', not descending\n", sub->name);
+				resolved[i].skip = 1;
+				break;
+			}
+		}
+	}
+	
+	/* Fetch all caches of this parent at once */
+	cache_submodules_parallel(resolved, submodules.count, config);
+	
+	/* Checkouts update the parent's git config and run one at a time */
+	for (size_t i = 0; i < submodules.count; i++) {
+		const struct resolved_submodule *item = &resolved[i];
+		if (item->skip) {
+			continue;
+		}
+		
+		if (!item->cache_ok) {
+			fprintf(stderr, "Failed to cache submodule '%s'\n", item->sub->name);
+			ret = -1;
+			/* Continue with other submodules */
+		}
+		
+		if (init_submodule_checkout(repo->checkout_path, item, config) != 0) {
+			fprintf(stderr, "Failed to initialize submodule '%s' checkout\n", item->sub->name);
+			ret = -1;
+			continue;
+		}
+		
+		if (!recursive) {
+			continue;
+		}
+		
+		if (depth + 1 >= SUBMODULE_MAX_DEPTH) {
+			fprintf(stderr, "Warning: Submodule nesting deeper than %d at '%s', not descending\n",
+				SUBMODULE_MAX_DEPTH, item->sub->name);
+			continue;
+		}
+		
+		/* Descend into the submodule checkout */
+		char child_checkout[4096];
+		snprintf(child_checkout, sizeof(child_checkout), "%s/%s", repo->checkout_path, item->sub->path);
+		
+		struct repo_info child;
+		memset(&child, 0, sizeof(child));
+		child.original_url = (char *)item->url;
+		child.name = (char *)item->sub->name;
+		child.cache_path = (char *)item->cache_path;
+		child.checkout_path = child_checkout;
+		child.strategy = repo->strategy;
+		
+		struct submodule_chain link = { item->cache_path, ancestors };
+		if (process_submodules_at(&child, config, recursive, &link, depth + 1) != 0) {
+			ret = -1;
+		}
+	}
+	
+	free(resolved);
+	free_submodule_list(&submodules);
+	return ret;
+}
+
+int process_submodules(const struct repo_info *repo, struct cache_config *config, int recursive)
+{
+	if (!repo || !config || !repo->checkout_path) {
+		return -1;
+	}
+	
+	struct submodule_chain root = { repo->cache_path, NULL };
+	return process_submodules_at(repo, config, recursive, &root, 0);
+}
@@ -11,6 +11,13 @@
 
 #include <stddef.h>
 
+/** @brief Maximum concurrent submodule cache fetches per parent */
+#define SUBMODULE_MAX_PARALLEL 4
+/** @brief Maximum submodule nesting depth followed when recursing */
+#define SUBMODULE_MAX_DEPTH 16
+/** @brief Shared caches fetched this recently by another process are not fetched again */
+#define SUBMODULE_REFETCH_SECONDS 60
+
 /* Forward declarations */
 struct repo_info;
 struct cache_config;
@@ -50,6 +57,13 @@ void free_submodule_list(struct submodule_list *list);
 
 /**
  * @brief Process all submodules in a repository
+ *
+ * GitHub submodules are cached under their own github.com/<owner>/<name>
+ * entry, shared by every parent that uses them. The caches of one parent
+ * are fetched concurrently before its checkouts are initialized against
+ * them. With recursive set, nested submodules are processed as well;
+ * a submodule that is its own ancestor is skipped.
+ *
  * @param repo Repository information
  * @param config Cache configuration
  * @param recursive Whether to process submodules recursively
@@ -0,0 +1,98 @@
+/**
+ * @file test_cache_alternates.c
+ * @brief Tests for fork caches borrowing objects from their upstream
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+
+#include "cache_alternates.h"
+
+static char cache_root[128];
+static char upstream[256];
+static char fork_repo[256];
+static char other_upstream[256];
+
+static void test_find_upstream(void)
+{
+	printf("=== Testing Upstream Lookup ===\n");
+	
+	/* Every dash is a possible split; only the cached one matches */
+	char path[4096];
+	assert(cache_alternates_find_upstream(cache_root, "some-owner-repo", path, sizeof(path)) == 1);
+	assert(strcmp(path, upstream) == 0);
+	printf("✓ Upstream found for a dashed owner\n");
+	
+	assert(!cache_alternates_find_upstream(cache_root, "missing-repo", path, sizeof(path)));
+	assert(!cache_alternates_find_upstream(cache_root, "-repo", path, sizeof(path)));
+	assert(!cache_alternates_find_upstream(cache_root, "norepo", path, sizeof(path)));
+	printf("✓ No upstream for uncached or malformed names\n");
+}
+
+static void test_link(void)
+{
+	printf("\n=== Testing Links ===\n");
+	
+	char path[4096];
+	assert(cache_alternates_upstream(fork_repo, path, sizeof(path)) == 0);
+	assert(!cache_alternates_depends_on(fork_repo, upstream));
+	printf("✓ Unlinked fork has no upstream\n");
+	
+	assert(cache_alternates_link(fork_repo, "relative/path") == CACHE_ALTERNATES_ERROR_INVALID);
+	assert(cache_alternates_link(fork_repo, upstream) == CACHE_ALTERNATES_SUCCESS);
+	assert(cache_alternates_upstream(fork_repo, path, sizeof(path)) == 1);
+	assert(strcmp(path, upstream) == 0);
+	assert(cache_alternates_depends_on(fork_repo, upstream));
+	assert(!cache_alternates_depends_on(upstream, fork_repo));
+	printf("✓ Link read back from the fork only\n");
+	
+	/* git itself has to accept the entry */
+	char command[1024];
+	snprintf(command, sizeof(command),
+	         "git --git-dir=%s count-objects -v | grep -qx 'alternate: %s/objects'",
+	         fork_repo, upstream);
+	assert(system(command) == 0);
+	printf("✓ git sees the alternate\n");
+	
+	/* Relinking replaces the entry instead of adding one */
+	assert(cache_alternates_link(fork_repo, other_upstream) == CACHE_ALTERNATES_SUCCESS);
+	assert(cache_alternates_upstream(fork_repo, path, sizeof(path)) == 1);
+	assert(strcmp(path, other_upstream) == 0);
+	assert(!cache_alternates_depends_on(fork_repo, upstream));
+	snprintf(command, sizeof(command), "test $(wc -l < %s/objects/info/alternates) -eq 1", fork_repo);
+	assert(system(command) == 0);
+	printf("✓ Relinking replaces the upstream\n");
+}
+
+int main(void)
+{
+	printf("Cache Alternates Test Suite\n");
+	printf("===========================\n\n");
+	
+	snprintf(cache_root, sizeof(cache_root), "/tmp/test_cache_alternates_%d", (int)getpid());
+	snprintf(upstream, sizeof(upstream), "%s/github.com/some-owner/repo", cache_root);
+	snprintf(fork_repo, sizeof(fork_repo), "%s/github.com/mirrors/some-owner-repo", cache_root);
+	snprintf(other_upstream, sizeof(other_upstream), "%s/github.com/other/repo", cache_root);
+	char setup[1024];
+	snprintf(setup, sizeof(setup), "git init -q --bare %s && git init -q --bare %s && "
+	         "git init -q --bare %s", upstream, fork_repo, other_upstream);
+	assert(system(setup) == 0);
+	
+	test_find_upstream();
+	test_link();
+	
+	char cleanup[256];
+	snprintf(cleanup, sizeof(cleanup), "rm -rf %s", cache_root);
+	if (system(cleanup) != 0) {
+		printf("Warning: Failed to clean up %s\n", cache_root);
+	}
+	
+	printf("\n=== Test Summary ===\n");
+	printf("All cache alternates tests passed!\n");
+	
+	return 0;
+}
@@ -0,0 +1,116 @@
+/**
+ * @file test_cache_daemon.c
+ * @brief Tests for the daemon request protocol and socket lifecycle
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+#include "cache_daemon.h"
+
+static void test_request_roundtrip(void)
+{
+	printf("=== Testing Request Protocol ===\n");
+	
+	int pair[2];
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+	
+	char *argv[] = { "git-cache", "clone", "https://github.com/owner/repo", NULL };
+	char *env[] = { "GIT_CACHE=/tmp/cache", "GITHUB_TOKEN=secret", NULL };
+	assert(cache_daemon_send_request(pair[0], CACHE_DAEMON_REQUEST_RUN, "/tmp", 3, argv, env) ==
+	       CACHE_DAEMON_SUCCESS);
+	
+	struct cache_daemon_request request;
+	assert(cache_daemon_read_request(pair[1], &request) == CACHE_DAEMON_SUCCESS);
+	assert(request.type == CACHE_DAEMON_REQUEST_RUN && strcmp(request.cwd, "/tmp") == 0);
+	assert(request.argc == 3 && strcmp(request.argv[2], argv[2]) == 0 && request.argv[3] == NULL);
+	assert(request.envc == 2 && strcmp(request.env[1], "GITHUB_TOKEN=secret") == 0);
+	assert(request.env[2] == NULL);
+	printf("✓ Working directory, arguments and environment decoded\n");
+	
+	/* The client's stdin, stdout and stderr travel with the request */
+	assert(request.fds[0] >= 0 && request.fds[1] >= 0 && request.fds[2] >= 0);
+	cache_daemon_request_free(&request);
+	printf("✓ Standard streams passed along\n");
+	
+	int status = 0;
+	assert(cache_daemon_send_status(pair[1], 3) == CACHE_DAEMON_SUCCESS);
+	assert(cache_daemon_read_status(pair[0], &status) == CACHE_DAEMON_SUCCESS && status == 3);
+	printf("✓ Exit status delivered\n");
+	
+	/* A hang-up before the status line is an error, not a success */
+	close(pair[1]);
+	assert(cache_daemon_read_status(pair[0], &status) == CACHE_DAEMON_ERROR_PROTOCOL);
+	close(pair[0]);
+	printf("✓ Missing status detected\n");
+}
+
+static void test_env_forwarding(void)
+{
+	printf("\n=== Testing Environment Forwarding ===\n");
+	
+	assert(cache_daemon_forwards_env("GIT_CACHE=/x"));
+	assert(cache_daemon_forwards_env("GITHUB_TOKEN=t"));
+	assert(!cache_daemon_forwards_env("HOME=/root"));
+	assert(!cache_daemon_forwards_env("GIT_CACHE"));
+	printf("✓ Only git-cache settings are forwarded\n");
+}
+
+static void test_socket_lifecycle(const char *test_dir)
+{
+	printf("\n=== Testing Socket Lifecycle ===\n");
+	
+	char path[4096];
+	char long_root[200];
+	memset(long_root, 'x', sizeof(long_root) - 1);
+	long_root[sizeof(long_root) - 1] = '\0';
+	assert(cache_daemon_socket_path(long_root, path, sizeof(path)) == CACHE_DAEMON_ERROR_INVALID);
+	printf("✓ Overlong socket path refused\n");
+	
+	assert(cache_daemon_socket_path(test_dir, path, sizeof(path)) == CACHE_DAEMON_SUCCESS);
+	assert(cache_daemon_connect(path) == CACHE_DAEMON_ERROR_NOT_RUNNING);
+	printf("✓ No daemon reported as not running\n");
+	
+	int listen_fd = cache_daemon_listen(path);
+	assert(listen_fd >= 0);
+	assert(cache_daemon_listen(path) == CACHE_DAEMON_ERROR_RUNNING);
+	int client = cache_daemon_connect(path);
+	assert(client >= 0);
+	close(client);
+	printf("✓ Second daemon refused while the first listens\n");
+	
+	/* The socket file outlives a daemon that did not clean up */
+	close(listen_fd);
+	listen_fd = cache_daemon_listen(path);
+	assert(listen_fd >= 0);
+	close(listen_fd);
+	unlink(path);
+	printf("✓ Stale socket replaced\n");
+}
+
+int main(void)
+{
+	printf("Cache Daemon Test Suite\n");
+	printf("=======================\n\n");
+	
+	char test_dir[128];
+	snprintf(test_dir, sizeof(test_dir), "/tmp/test_cache_daemon_%d", (int)getpid());
+	assert(mkdir(test_dir, 0755) == 0);
+	
+	test_request_roundtrip();
+	test_env_forwarding();
+	test_socket_lifecycle(test_dir);
+	
+	rmdir(test_dir);
+	
+	printf("\n=== Test Summary ===\n");
+	printf("All cache daemon tests passed!\n");
+	
+	return 0;
+}
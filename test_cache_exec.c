@@ -0,0 +1,206 @@
+/**
+ * @file test_cache_exec.c
+ * @brief Tests for running commands without a shell
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <assert.h>
+#include <sys/stat.h>
+
+#include "cache_exec.h"
+
+static char test_dir[128];
+
+static void test_run_capture(void)
+{
+	printf("=== Testing Captured Commands ===\n");
+	
+	static const char *const env[] = { "CACHE_EXEC_TEST=value", NULL };
+	const char *argv[] = { "sh", "-c", "pwd; echo \"$CACHE_EXEC_TEST\"; echo oops >&2; exit 3", NULL };
+	struct cache_exec_options options;
+	memset(&options, 0, sizeof(options));
+	options.cwd = "/";
+	options.env = env;
+	options.out = CACHE_EXEC_CAPTURE;
+	options.err = CACHE_EXEC_CAPTURE;
+	
+	struct cache_exec_result result;
+	assert(cache_exec_run(argv, &options, &result) == CACHE_EXEC_SUCCESS);
+	assert(result.exit_code == 3 && result.term_signal == 0 && !result.timed_out);
+	assert(result.out && strcmp(result.out, "/\nvalue\n") == 0);
+	assert(result.err && strcmp(result.err, "oops\n") == 0);
+	cache_exec_free_result(&result);
+	printf("✓ Exit code, working directory, environment and both streams captured\n");
+	
+	/* Arguments reach the program verbatim, shell metacharacters and all */
+	const char *quoted[] = { "printf", "%s|", "a b", "$HOME", "'\"", ";rm", NULL };
+	memset(&options, 0, sizeof(options));
+	options.out = CACHE_EXEC_CAPTURE;
+	assert(cache_exec_run(quoted, &options, &result) == CACHE_EXEC_SUCCESS);
+	assert(result.exit_code == 0 && strcmp(result.out, "a b|$HOME|'\"|;rm|") == 0);
+	cache_exec_free_result(&result);
+	printf("✓ Arguments are not interpreted by a shell\n");
+	
+	/* Output past the limit is dropped without blocking the child */
+	const char *flood[] = { "head", "-c", "100000", "/dev/zero", NULL };
+	options.max_output = 1000;
+	assert(cache_exec_run(flood, &options, &result) == CACHE_EXEC_SUCCESS);
+	assert(result.exit_code == 0 && result.out_len == 1000);
+	cache_exec_free_result(&result);
+	printf("✓ Captured output is bounded\n");
+	
+	/* A missing program is a spawn error, not a command result */
+	const char *missing[] = { "git-cache-no-such-program", NULL };
+	if (cache_exec_run(missing, NULL, &result) == CACHE_EXEC_SUCCESS) {
+		assert(result.exit_code == 127);
+	}
+	cache_exec_free_result(&result);
+	printf("✓ Missing program reported as a failure\n");
+}
+
+static void test_stdin_file(void)
+{
+	printf("\n=== Testing stdin From a File ===\n");
+	
+	char path[256];
+	snprintf(path, sizeof(path), "%s/input", test_dir);
+	FILE *f = fopen(path, "w");
+	assert(f != NULL);
+	fputs("one\ntwo\n", f);
+	fclose(f);
+	
+	const char *argv[] = { "wc", "-l", NULL };
+	struct cache_exec_options options;
+	memset(&options, 0, sizeof(options));
+	options.in_path = path;
+	options.out = CACHE_EXEC_CAPTURE;
+	
+	struct cache_exec_result result;
+	assert(cache_exec_run(argv, &options, &result) == CACHE_EXEC_SUCCESS);
+	assert(result.exit_code == 0 && atoi(result.out) == 2);
+	cache_exec_free_result(&result);
+	printf("✓ Command reads stdin from the file\n");
+	
+	/* The path is the caller's, not relative to the command's directory */
+	options.cwd = "/";
+	assert(chdir(test_dir) == 0);
+	options.in_path = "input";
+	assert(cache_exec_run(argv, &options, &result) == CACHE_EXEC_SUCCESS);
+	assert(result.exit_code == 0 && atoi(result.out) == 2);
+	cache_exec_free_result(&result);
+	assert(chdir("/") == 0);
+	printf("✓ Relative stdin path resolved before changing directory\n");
+	
+	options.in_path = "/nonexistent/input";
+	assert(cache_exec_run(argv, &options, &result) != CACHE_EXEC_SUCCESS || result.exit_code != 0);
+	cache_exec_free_result(&result);
+	printf("✓ Unreadable stdin file fails the command\n");
+	unlink(path);
+}
+
+static void test_timeout(void)
+{
+	printf("\n=== Testing Timeouts ===\n");
+	
+	const char *sleeper[] = { "sleep", "10", NULL };
+	struct cache_exec_options options;
+	memset(&options, 0, sizeof(options));
+	options.timeout_ms = 200;
+	
+	struct cache_exec_result result;
+	assert(cache_exec_run(sleeper, &options, &result) == CACHE_EXEC_SUCCESS);
+	assert(result.timed_out && result.exit_code == -1 && result.term_signal != 0);
+	assert(result.elapsed_ms < 5000);
+	cache_exec_free_result(&result);
+	printf("✓ Timed out command is killed\n");
+}
+
+static void test_helpers(void)
+{
+	printf("\n=== Testing Status, Line and Count Helpers ===\n");
+	
+	const char *ok[] = { "true", NULL };
+	const char *fails[] = { "sh", "-c", "exit 5", NULL };
+	const char *killed[] = { "sh", "-c", "kill -TERM $$", NULL };
+	const char *missing[] = { "git-cache-no-such-program", NULL };
+	assert(cache_exec_status(ok, NULL, 1) == 0);
+	assert(cache_exec_status(fails, NULL, 1) == 5);
+	assert(cache_exec_status(killed, NULL, 1) == 128 + SIGTERM);
+	assert(cache_exec_status(missing, NULL, 1) != 0);
+	printf("✓ Exit status, signal and spawn failure distinguished\n");
+	
+	char line[8];
+	const char *lines[] = { "sh", "-c", "echo first-line-long; echo second; echo noise >&2", NULL };
+	assert(cache_exec_line(lines, NULL, line, sizeof(line)) == 0);
+	assert(strcmp(line, "first-l") == 0);
+	const char *silent[] = { "sh", "-c", "exit 2", NULL };
+	assert(cache_exec_line(silent, NULL, line, sizeof(line)) == 2 && line[0] == '\0');
+	printf("✓ First line returned truncated, empty when nothing printed\n");
+	
+	size_t count = 99;
+	const char *three[] = { "printf", "a\nb\nc\n", NULL };
+	assert(cache_exec_count_lines(three, NULL, &count) == 0 && count == 3);
+	assert(cache_exec_count_lines(missing, NULL, &count) != 0 && count == 0);
+	printf("✓ Output lines counted\n");
+}
+
+static void test_loop(void)
+{
+	printf("\n=== Testing Concurrent Commands ===\n");
+	
+	struct cache_exec_loop loop;
+	cache_exec_loop_init(&loop);
+	struct cache_exec_options options;
+	memset(&options, 0, sizeof(options));
+	options.out = CACHE_EXEC_CAPTURE;
+	
+	int tags[3] = { 0, 1, 2 };
+	const char *scripts[3] = { "sleep 0.2; echo 0", "echo 1", "sleep 0.1; echo 2" };
+	for (int i = 0; i < 3; i++) {
+		const char *child[] = { "sh", "-c", scripts[i], NULL };
+		assert(cache_exec_spawn(&loop, child, &options, &tags[i]) == CACHE_EXEC_SUCCESS);
+	}
+	
+	int seen = 0;
+	struct cache_exec_result result;
+	void *data;
+	while (cache_exec_wait(&loop, -1, &result, &data) == 1) {
+		int tag = *(int *)data;
+		char expected[4];
+		snprintf(expected, sizeof(expected), "%d\n", tag);
+		assert(result.out && strcmp(result.out, expected) == 0);
+		assert(!(seen & (1 << tag)));
+		seen |= 1 << tag;
+		cache_exec_free_result(&result);
+	}
+	cache_exec_loop_destroy(&loop);
+	assert(seen == 7);
+	printf("✓ Every command reported once with its own output\n");
+}
+
+int main(void)
+{
+	printf("Cache Exec Test Suite\n");
+	printf("=====================\n\n");
+	
+	snprintf(test_dir, sizeof(test_dir), "/tmp/test_cache_exec_%d", (int)getpid());
+	assert(mkdir(test_dir, 0755) == 0);
+	
+	test_run_capture();
+	test_stdin_file();
+	test_timeout();
+	test_helpers();
+	test_loop();
+	
+	rmdir(test_dir);
+	
+	printf("\n=== Test Summary ===\n");
+	printf("All cache exec tests passed!\n");
+	
+	return 0;
+}
@@ -0,0 +1,188 @@
+/**
+ * @file test_cache_journal.c
+ * @brief Tests for the metadata event journal and its compaction
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <assert.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "cache_journal.h"
+#include "cache_metadata.h"
+
+static char cache_dir[128];
+static char journal_file[256];
+
+static void test_append_read(void)
+{
+	printf("=== Testing Append and Read ===\n");
+	
+	struct cache_journal journal;
+	assert(cache_journal_read(cache_dir, &journal) == CACHE_JOURNAL_SUCCESS);
+	assert(journal.id == 0 && journal.count == 0);
+	cache_journal_free(&journal);
+	printf("✓ Missing journal reads as empty\n");
+	
+	assert(cache_journal_append(cache_dir, CACHE_JOURNAL_HEADER, 1) == CACHE_JOURNAL_ERROR_INVALID);
+	assert(cache_journal_append(cache_dir, CACHE_JOURNAL_ACCESS, 100) == 1);
+	assert(cache_journal_append(cache_dir, CACHE_JOURNAL_REF_ADD, 200) == 2);
+	assert(cache_journal_read(cache_dir, &journal) == CACHE_JOURNAL_SUCCESS);
+	assert(journal.id != 0 && journal.count == 2);
+	assert(journal.records[0].type == CACHE_JOURNAL_ACCESS && journal.records[0].value == 100);
+	assert(journal.records[1].type == CACHE_JOURNAL_REF_ADD && journal.records[1].value == 200);
+	uint64_t id = journal.id;
+	cache_journal_free(&journal);
+	printf("✓ First append creates the journal, records read back in order\n");
+	
+	/* Half a record left by a crash is ignored */
+	int fd = open(journal_file, O_WRONLY | O_APPEND);
+	assert(fd >= 0);
+	assert(write(fd, "torn", 4) == 4);
+	close(fd);
+	assert(cache_journal_read(cache_dir, &journal) == CACHE_JOURNAL_SUCCESS);
+	assert(journal.id == id && journal.count == 2);
+	cache_journal_free(&journal);
+	assert(truncate(journal_file, 3 * sizeof(struct cache_journal_record)) == 0);
+	printf("✓ Torn trailing record skipped\n");
+}
+
+static void test_lock_remove(void)
+{
+	printf("\n=== Testing Compaction Lock ===\n");
+	
+	struct cache_journal journal;
+	assert(cache_journal_lock(cache_dir, &journal) == CACHE_JOURNAL_SUCCESS);
+	assert(journal.count == 2 && journal.lock_fd >= 0);
+	uint64_t id = journal.id;
+	
+	/* An appender waits for the compaction and then starts a new journal */
+	fflush(stdout);
+	pid_t pid = fork();
+	assert(pid >= 0);
+	if (pid == 0) {
+		/* The inherited descriptor shares the parent's lock */
+		close(journal.lock_fd);
+		_exit(cache_journal_append(cache_dir, CACHE_JOURNAL_SYNC, 300) == 1 ? 0 : 1);
+	}
+	usleep(200000);
+	int status;
+	assert(waitpid(pid, &status, WNOHANG) == 0);
+	assert(cache_journal_remove(cache_dir, &journal) == CACHE_JOURNAL_SUCCESS);
+	assert(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	printf("✓ Appender blocked until the journal was removed\n");
+	
+	assert(cache_journal_read(cache_dir, &journal) == CACHE_JOURNAL_SUCCESS);
+	assert(journal.id != id && journal.count == 1);
+	assert(journal.records[0].type == CACHE_JOURNAL_SYNC);
+	cache_journal_free(&journal);
+	printf("✓ Appended event went to a fresh journal\n");
+	
+	assert(unlink(journal_file) == 0);
+	assert(cache_journal_lock(cache_dir, &journal) == CACHE_JOURNAL_ERROR_NOT_FOUND);
+	printf("✓ Locking a missing journal reports it\n");
+}
+
+static void test_metadata_replay(void)
+{
+	printf("\n=== Testing Replay Through Cache Metadata ===\n");
+	
+	struct cache_metadata metadata;
+	memset(&metadata, 0, sizeof(metadata));
+	metadata.original_url = "https://github.com/o/r";
+	metadata.owner = "o";
+	metadata.name = "r";
+	assert(cache_metadata_save(cache_dir, &metadata) == METADATA_SUCCESS);
+	
+	/* Events go to the journal and leave the metadata file alone */
+	char metadata_file[256];
+	snprintf(metadata_file, sizeof(metadata_file), "%s/cache_metadata.json", cache_dir);
+	struct stat before;
+	struct stat after;
+	assert(stat(metadata_file, &before) == 0);
+	assert(cache_metadata_increment_ref(cache_dir) == METADATA_SUCCESS);
+	assert(cache_metadata_increment_ref(cache_dir) == METADATA_SUCCESS);
+	assert(cache_metadata_decrement_ref(cache_dir) == METADATA_SUCCESS);
+	assert(cache_metadata_update_access(cache_dir) == METADATA_SUCCESS);
+	assert(stat(metadata_file, &after) == 0 && before.st_ino == after.st_ino);
+	assert(access(journal_file, F_OK) == 0);
+	printf("✓ Events recorded without rewriting the metadata file\n");
+	
+	struct cache_metadata loaded;
+	assert(cache_metadata_load(cache_dir, &loaded) == METADATA_SUCCESS);
+	assert(loaded.ref_count == 1 && loaded.last_access_time > 0 && loaded.journal_records == 4);
+	cache_metadata_clear(&loaded);
+	printf("✓ Journal replayed on load\n");
+	
+	/* Compaction folds the journal into the file exactly once */
+	assert(cache_metadata_compact(cache_dir) == 1);
+	assert(cache_metadata_compact(cache_dir) == 0);
+	assert(access(journal_file, F_OK) != 0);
+	assert(cache_metadata_load(cache_dir, &loaded) == METADATA_SUCCESS);
+	assert(loaded.ref_count == 1);
+	cache_metadata_clear(&loaded);
+	printf("✓ Compaction keeps the reference count\n");
+}
+
+static void test_concurrent_appenders(void)
+{
+	printf("\n=== Testing Concurrent Appenders ===\n");
+	
+	/* Appenders racing with the compactions they trigger lose nothing */
+	fflush(stdout);
+	pid_t children[4];
+	for (int i = 0; i < 4; i++) {
+		children[i] = fork();
+		assert(children[i] >= 0);
+		if (children[i] == 0) {
+			for (int n = 0; n < CACHE_JOURNAL_COMPACT_RECORDS; n++) {
+				if (cache_metadata_increment_ref(cache_dir) != METADATA_SUCCESS) {
+					_exit(1);
+				}
+			}
+			_exit(0);
+		}
+	}
+	for (int i = 0; i < 4; i++) {
+		int status;
+		assert(waitpid(children[i], &status, 0) == children[i]);
+		assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	}
+	
+	struct cache_metadata loaded;
+	assert(cache_metadata_load(cache_dir, &loaded) == METADATA_SUCCESS);
+	assert(loaded.ref_count == 1 + 4 * CACHE_JOURNAL_COMPACT_RECORDS);
+	cache_metadata_clear(&loaded);
+	printf("✓ Every event counted across compactions\n");
+}
+
+int main(void)
+{
+	printf("Cache Journal Test Suite\n");
+	printf("========================\n\n");
+	
+	snprintf(cache_dir, sizeof(cache_dir), "/tmp/test_cache_journal_%d", (int)getpid());
+	snprintf(journal_file, sizeof(journal_file), "%s/%s", cache_dir, CACHE_JOURNAL_FILE);
+	assert(mkdir(cache_dir, 0755) == 0);
+	
+	test_append_read();
+	test_lock_remove();
+	test_metadata_replay();
+	test_concurrent_appenders();
+	
+	char cleanup[256];
+	snprintf(cleanup, sizeof(cleanup), "rm -rf %s", cache_dir);
+	if (system(cleanup) != 0) {
+		printf("Warning: Failed to clean up %s\n", cache_dir);
+	}
+	
+	printf("\n=== Test Summary ===\n");
+	printf("All cache journal tests passed!\n");
+	
+	return 0;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file test_cache_lock.c
+ * @brief Tests for reader/writer locks between processes
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <assert.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "cache_lock.h"
+
+static char lock_dir[256];
+
+/* Run fn in a child process and return its exit code */
+static int in_child(int (*fn)(void))
+{
+	fflush(stdout);
+	pid_t pid = fork();
+	assert(pid >= 0);
+	if (pid == 0) {
+		_exit(fn());
+	}
+	int status;
+	assert(waitpid(pid, &status, 0) == pid);
+	assert(WIFEXITED(status));
+	return WEXITSTATUS(status);
+}
+
+static int try_shared(void)
+{
+	return cache_lock_try_acquire(lock_dir, CACHE_LOCK_SHARED) == CACHE_LOCK_SUCCESS ? 0 : 1;
+}
+
+static int try_exclusive(void)
+{
+	return cache_lock_try_acquire(lock_dir, CACHE_LOCK_EXCLUSIVE) == CACHE_LOCK_SUCCESS ? 0 : 1;
+}
+
+static void test_shared_exclusive(void)
+{
+	printf("=== Testing Shared and Exclusive Locks ===\n");
+	
+	assert(cache_lock_acquire(lock_dir, CACHE_LOCK_SHARED, 0, 0) == CACHE_LOCK_SUCCESS);
+	assert(in_child(try_shared) == 0);
+	assert(in_child(try_exclusive) == 1);
+	printf("✓ Readers share the lock and keep writers out\n");
+	
+	/* Upgrading to exclusive keeps readers out as well */
+	assert(cache_lock_acquire(lock_dir, CACHE_LOCK_EXCLUSIVE, 0, 0) == CACHE_LOCK_SUCCESS);
+	assert(in_child(try_shared) == 1);
+	assert(cache_lock_release(lock_dir) == CACHE_LOCK_SUCCESS);
+	assert(in_child(try_shared) == 1);
+	assert(cache_lock_release(lock_dir) == CACHE_LOCK_SUCCESS);
+	assert(in_child(try_exclusive) == 0);
+	printf("✓ Nested acquisitions hold the lock until the last release\n");
+	
+	assert(cache_lock_release(lock_dir) == CACHE_LOCK_ERROR_INVALID);
+	printf("✓ Releasing a lock that is not held is refused\n");
+}
+
+static volatile sig_atomic_t caller_alarm = 0;
+
+static void caller_alarm_handler(int signum)
+{
+	(void)signum;
+	caller_alarm = 1;
+}
+
+static int wait_with_caller_alarm(void)
+{
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = caller_alarm_handler;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGALRM, &action, NULL);
+	alarm(30);
+	
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	int ret = cache_lock_acquire(lock_dir, CACHE_LOCK_EXCLUSIVE, 1, 0);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	long waited_ms = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
+	
+	/* The caller's alarm is still pending and its handler still installed */
+	unsigned int left = alarm(0);
+	struct sigaction current;
+	sigaction(SIGALRM, NULL, &current);
+	
+	if (ret != CACHE_LOCK_ERROR_TIMEOUT) {
+		return 1;
+	}
+	if (waited_ms < 900 || waited_ms > 5000) {
+		return 2;
+	}
+	if (left < 25 || caller_alarm || current.sa_handler != caller_alarm_handler) {
+		return 3;
+	}
+	return 0;
+}
+
+static int wait_for_release(void)
+{
+	return cache_lock_acquire(lock_dir, CACHE_LOCK_SHARED, 10, 0) == CACHE_LOCK_SUCCESS ? 0 : 1;
+}
+
+static void test_timeout(void)
+{
+	printf("\n=== Testing Lock Timeout ===\n");
+	
+	assert(cache_lock_acquire(lock_dir, CACHE_LOCK_EXCLUSIVE, 0, 0) == CACHE_LOCK_SUCCESS);
+	assert(in_child(wait_with_caller_alarm) == 0);
+	printf("✓ Contended lock times out without touching the caller's alarm\n");
+	
+	/* A waiter gets the lock once it is released */
+	fflush(stdout);
+	pid_t pid = fork();
+	assert(pid >= 0);
+	if (pid == 0) {
+		_exit(wait_for_release());
+	}
+	usleep(300000);
+	assert(cache_lock_release(lock_dir) == CACHE_LOCK_SUCCESS);
+	int status;
+	assert(waitpid(pid, &status, 0) == pid);
+	assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	printf("✓ Waiter acquires the lock after it is released\n");
+}
+
+static int inherited_lock(void)
+{
+	/* The parent's lock is not ours: releasing it is refused and taking it waits */
+	if (cache_lock_release(lock_dir) != CACHE_LOCK_ERROR_INVALID) {
+		return 1;
+	}
+	if (cache_lock_try_acquire(lock_dir, CACHE_LOCK_SHARED) != CACHE_LOCK_ERROR_BUSY) {
+		return 2;
+	}
+	return 0;
+}
+
+static void test_fork_reentry(void)
+{
+	printf("\n=== Testing Locks Across fork() ===\n");
+	
+	assert(cache_lock_acquire(lock_dir, CACHE_LOCK_EXCLUSIVE, 0, 0) == CACHE_LOCK_SUCCESS);
+	assert(in_child(inherited_lock) == 0);
+	printf("✓ Forked child does not re-enter its parent's lock\n");
+	
+	/* The child closing its inherited copy left the parent's lock in place */
+	assert(in_child(try_shared) == 1);
+	assert(cache_lock_release(lock_dir) == CACHE_LOCK_SUCCESS);
+	assert(in_child(try_exclusive) == 0);
+	printf("✓ Parent keeps its lock until it releases it\n");
+}
+
+int main(void)
+{
+	printf("Cache Lock Test Suite\n");
+	printf("=====================\n\n");
+	
+	char test_dir[128];
+	snprintf(test_dir, sizeof(test_dir), "/tmp/test_cache_lock_%d", (int)getpid());
+	assert(mkdir(test_dir, 0755) == 0);
+	snprintf(lock_dir, sizeof(lock_dir), "%s/repo", test_dir);
+	
+	test_shared_exclusive();
+	test_timeout();
+	test_fork_reentry();
+	
+	char lock_file[256];
+	snprintf(lock_file, sizeof(lock_file), "%s/.repo.lock", test_dir);
+	unlink(lock_file);
+	rmdir(test_dir);
+	
+	printf("\n=== Test Summary ===\n");
+	printf("All cache lock tests passed!\n");
+	
+	return 0;
+}
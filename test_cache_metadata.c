@@ -11,9 +11,22 @@
 #include <sys/stat.h>
 #include <time.h>
 #include <assert.h>
+#include <limits.h>
 
 #include "git-cache.h"
 #include "cache_metadata.h"
+#include "cache_index.h"
+#include "disk_usage.h"
+#include "clone_stats.h"
+#include "ref_tips.h"
+#include "cache_gc.h"
+#include "cache_maintenance.h"
+#include "cache_trace.h"
+#include "cache_seed.h"
+#include "config_file.h"
+#include "remote_sync.h"
+#include "ref_filter.h"
+#include "sparse_checkout.h"
 
 /* Test utilities */
 static int test_count = 0;
@@ -191,9 +204,7 @@ static int test_metadata_save_load(void)
 	}
 	
 	/* Clean up loaded strings */
-	free(loaded.original_url);
-	free(loaded.owner);
-	free(loaded.name);
+	cache_metadata_clear(&loaded);
 	free(original.original_url);
 	free(original.owner);
 	free(original.name);
@@ -256,9 +267,7 @@ static int test_metadata_updates(void)
 		FAIL("Access time not updated after increment");
 	}
 	
-	free(updated.original_url);
-	free(updated.owner);
-	free(updated.name);
+	cache_metadata_clear(&updated);
 	
 	/* Test reference count decrement */
 	ret = cache_metadata_decrement_ref(test_dir);
@@ -276,9 +285,7 @@ static int test_metadata_updates(void)
 		FAIL("Reference count not decremented");
 	}
 	
-	free(updated.original_url);
-	free(updated.owner);
-	free(updated.name);
+	cache_metadata_clear(&updated);
 	
 	/* Test sync time update */
 	time_t before_sync = time(NULL);
@@ -299,9 +306,7 @@ static int test_metadata_updates(void)
 		FAIL("Sync time not updated");
 	}
 	
-	free(updated.original_url);
-	free(updated.owner);
-	free(updated.name);
+	cache_metadata_clear(&updated);
 	
 	/* Clean up */
 	free(original.original_url);
@@ -366,6 +371,980 @@ static int test_metadata_exists(void)
 	return 0;
 }
 
+/**
+ * @brief Test that every fork borrowing from an upstream stays recorded
+ */
+static int test_dependent_forks(void)
+{
+	TEST("dependent fork list");
+	
+	const char *test_dir = "/tmp/git_cache_dependent_forks_test";
+	mkdir(test_dir, 0755);
+	
+	struct cache_metadata metadata;
+	memset(&metadata, 0, sizeof(metadata));
+	metadata.original_url = "https://github.com/test/repo";
+	metadata.fork_url = "https://github.com/mirrors/test-repo";
+	if (cache_metadata_save(test_dir, &metadata) != METADATA_SUCCESS) {
+		FAIL("Failed to save metadata");
+	}
+	
+	if (cache_metadata_add_dependent_fork(test_dir, "https://github.com/a/repo") != 1 ||
+	    cache_metadata_add_dependent_fork(test_dir, "https://github.com/b/repo") != 1 ||
+	    cache_metadata_add_dependent_fork(test_dir, "https://github.com/a/repo") != 0) {
+		FAIL("Forks not added once each");
+	}
+	if (cache_metadata_add_dependent_fork(test_dir, "with space") != METADATA_ERROR_INVALID) {
+		FAIL("Invalid fork URL accepted");
+	}
+	
+	struct cache_metadata loaded;
+	if (cache_metadata_load(test_dir, &loaded) != METADATA_SUCCESS) {
+		FAIL("Failed to load metadata");
+	}
+	int kept = loaded.dependent_forks &&
+	           strcmp(loaded.dependent_forks, "https://github.com/a/repo https://github.com/b/repo") == 0 &&
+	           loaded.fork_url && strcmp(loaded.fork_url, "https://github.com/mirrors/test-repo") == 0;
+	cache_metadata_clear(&loaded);
+	cache_metadata_clear(&loaded);
+	if (!kept) {
+		FAIL("Dependent forks or own fork lost");
+	}
+	
+	char rm_cmd[1024];
+	snprintf(rm_cmd, sizeof(rm_cmd), "rm -rf %s", test_dir);
+	if (system(rm_cmd) != 0) {
+		printf("Warning: Failed to clean up test directory\n");
+	}
+	
+	PASS();
+	return 0;
+}
+
+/**
+ * @brief Test cache index maintenance through metadata save
+ */
+static int test_cache_index(void)
+{
+	TEST("cache index");
+	
+	/* Create a cache root with one bare-looking repository */
+	const char *cache_root = "/tmp/git_cache_index_test";
+	const char *repo_path = "/tmp/git_cache_index_test/github.com/test/repo";
+	if (system("rm -rf /tmp/git_cache_index_test && "
+	           "mkdir -p /tmp/git_cache_index_test/github.com/test/repo && "
+	           "touch /tmp/git_cache_index_test/github.com/test/repo/HEAD") != 0) {
+		FAIL("Failed to create test cache");
+	}
+	
+	char root[4096];
+	if (cache_index_root_from_path(repo_path, root, sizeof(root)) != CACHE_INDEX_SUCCESS ||
+	    strcmp(root, cache_root) != 0) {
+		FAIL("Failed to derive cache root");
+	}
+	
+	if (cache_index_root_from_path("/tmp/not_a_cache", root, sizeof(root)) == CACHE_INDEX_SUCCESS) {
+		FAIL("Derived cache root from non-cache path");
+	}
+	
+	/* Saving metadata must create the index */
+	struct cache_metadata metadata;
+	memset(&metadata, 0, sizeof(metadata));
+	metadata.original_url = "https://github.com/test/repo.git";
+	metadata.owner = "test";
+	metadata.name = "repo";
+	metadata.strategy = CLONE_STRATEGY_BLOBLESS;
+	metadata.cache_size = 4096;
+	metadata.ref_count = 1;
+	metadata.has_submodules = 1;
+	
+	if (cache_metadata_save(repo_path, &metadata) != METADATA_SUCCESS) {
+		FAIL("Failed to save metadata");
+	}
+	
+	struct cache_index index;
+	if (cache_index_open(cache_root, &index) != CACHE_INDEX_SUCCESS) {
+		FAIL("Index not usable after save");
+	}
+	
+	const struct cache_index_record *record = cache_index_find(&index, "test", "repo");
+	if (!record || index.header->record_count != 1) {
+		cache_index_close(&index);
+		FAIL("Record missing from index");
+	}
+	
+	if (record->strategy != CLONE_STRATEGY_BLOBLESS || record->cache_size != 4096 ||
+	    record->ref_count != 1 || !(record->flags & CACHE_INDEX_FLAG_SUBMODULES) ||
+	    record->url_hash != cache_index_hash_url(metadata.original_url) ||
+	    strcmp(cache_index_string(&index, record->url_offset), metadata.original_url) != 0) {
+		cache_index_close(&index);
+		FAIL("Record fields mismatch");
+	}
+	cache_index_close(&index);
+	
+	/* Journaled updates replace the existing record once compacted */
+	if (cache_metadata_increment_ref(repo_path) != METADATA_SUCCESS ||
+	    cache_metadata_compact(repo_path) != 1 ||
+	    cache_index_open(cache_root, &index) != CACHE_INDEX_SUCCESS) {
+		FAIL("Index not usable after update");
+	}
+	record = cache_index_find(&index, "test", "repo");
+	if (!record || record->ref_count != 2 || index.header->record_count != 1) {
+		cache_index_close(&index);
+		FAIL("Record not updated");
+	}
+	cache_index_close(&index);
+	
+	/* Removing the record leaves an empty index */
+	if (cache_index_remove(cache_root, "test", "repo") != CACHE_INDEX_SUCCESS ||
+	    cache_index_open(cache_root, &index) != CACHE_INDEX_SUCCESS) {
+		FAIL("Index not usable after remove");
+	}
+	if (index.header->record_count != 0) {
+		cache_index_close(&index);
+		FAIL("Record not removed");
+	}
+	cache_index_close(&index);
+	
+	/* A new owner directory makes the index stale until rebuilt */
+	if (system("mkdir -p /tmp/git_cache_index_test/github.com/other/repo && "
+	           "touch /tmp/git_cache_index_test/github.com/other/repo/HEAD") != 0) {
+		FAIL("Failed to add repository");
+	}
+	int ret = cache_index_open(cache_root, &index);
+	cache_index_close(&index);
+	if (ret != CACHE_INDEX_ERROR_STALE) {
+		FAIL("Index not detected as stale");
+	}
+	
+	if (cache_index_rebuild(cache_root) != 2) {
+		FAIL("Rebuild did not find both repositories");
+	}
+	
+	/* So does a repository added to or removed from an existing owner directory */
+	if (system("mkdir -p /tmp/git_cache_index_test/github.com/test/second && "
+	           "touch /tmp/git_cache_index_test/github.com/test/second/HEAD") != 0) {
+		FAIL("Failed to add repository");
+	}
+	ret = cache_index_open(cache_root, &index);
+	cache_index_close(&index);
+	if (ret != CACHE_INDEX_ERROR_STALE) {
+		FAIL("New repository under an existing owner not detected");
+	}
+	if (cache_index_rebuild(cache_root) != 3 || cache_index_open(cache_root, &index) != CACHE_INDEX_SUCCESS) {
+		FAIL("Rebuild did not find the new repository");
+	}
+	cache_index_close(&index);
+	
+	if (system("rm -rf /tmp/git_cache_index_test/github.com/test/second") != 0) {
+		FAIL("Failed to remove repository");
+	}
+	ret = cache_index_open(cache_root, &index);
+	cache_index_close(&index);
+	if (ret != CACHE_INDEX_ERROR_STALE) {
+		FAIL("Removed repository under an existing owner not detected");
+	}
+	
+	/* Clean up test directory */
+	if (system("rm -rf /tmp/git_cache_index_test") != 0) {
+		printf("Warning: Failed to clean up test directory\n");
+	}
+	
+	PASS();
+	return 0;
+}
+
+/**
+ * @brief Test native disk usage accounting
+ */
+static int test_disk_usage(void)
+{
+	TEST("disk usage accounting");
+	
+	/* Bare-looking repository with one pack and a hardlinked copy */
+	const char *repo_path = "/tmp/git_cache_usage_test";
+	if (system("rm -rf /tmp/git_cache_usage_test && "
+	           "mkdir -p /tmp/git_cache_usage_test/objects/pack /tmp/git_cache_usage_test/refs && "
+	           "head -c 65536 /dev/zero > /tmp/git_cache_usage_test/objects/pack/a.pack && "
+	           "ln /tmp/git_cache_usage_test/objects/pack/a.pack /tmp/git_cache_usage_test/objects/pack/a.keep && "
+	           "touch -d '2020-01-01' /tmp/git_cache_usage_test/objects/pack") != 0) {
+		FAIL("Failed to create test repository");
+	}
+	
+	struct stat st;
+	if (stat("/tmp/git_cache_usage_test/objects/pack/a.pack", &st) != 0) {
+		FAIL("Failed to stat pack");
+	}
+	uint64_t pack_bytes = (uint64_t)st.st_blocks * 512;
+	
+	uint64_t measured = 0;
+	if (disk_usage_measure(repo_path, &measured) != DISK_USAGE_SUCCESS ||
+	    measured < pack_bytes || measured >= 2 * pack_bytes) {
+		FAIL("Hardlinked file not counted exactly once");
+	}
+	
+	uint64_t accounted = 0;
+	if (disk_usage_account(repo_path, &accounted) != DISK_USAGE_SUCCESS || accounted != measured) {
+		FAIL("Accounting does not match measurement");
+	}
+	
+	/* An unchanged pack directory is reused from the saved state */
+	if (system("head -c 65536 /dev/zero >> /tmp/git_cache_usage_test/objects/pack/a.pack && "
+	           "touch -d '2020-01-01' /tmp/git_cache_usage_test/objects/pack") != 0) {
+		FAIL("Failed to grow pack");
+	}
+	if (disk_usage_account(repo_path, &accounted) != DISK_USAGE_SUCCESS || accounted != measured) {
+		FAIL("Unchanged pack directory was walked again");
+	}
+	
+	/* A new pack changes the directory mtime and is picked up */
+	if (system("head -c 65536 /dev/zero > /tmp/git_cache_usage_test/objects/pack/b.pack") != 0) {
+		FAIL("Failed to add pack");
+	}
+	if (disk_usage_account(repo_path, &accounted) != DISK_USAGE_SUCCESS ||
+	    disk_usage_measure(repo_path, &measured) != DISK_USAGE_SUCCESS ||
+	    stat("/tmp/git_cache_usage_test/" DISK_USAGE_STATE_FILE, &st) != 0) {
+		FAIL("Failed to account repository");
+	}
+	
+	/* The state file itself is excluded from accounting */
+	if (accounted != measured - (uint64_t)st.st_blocks * 512) {
+		FAIL("New pack not accounted");
+	}
+	
+	/* Clean up test directory */
+	if (system("rm -rf /tmp/git_cache_usage_test") != 0) {
+		printf("Warning: Failed to clean up test directory\n");
+	}
+	
+	PASS();
+	return 0;
+}
+
+/**
+ * @brief Test clone stats log and strategy estimates
+ */
+static int test_clone_stats(void)
+{
+	TEST("clone stats estimates");
+	
+	const char *root = "/tmp/git_cache_stats_test";
+	if (system("rm -rf /tmp/git_cache_stats_test && mkdir -p /tmp/git_cache_stats_test") != 0) {
+		FAIL("Failed to create test directory");
+	}
+	
+	/* Blobless is slower here once on-demand fetches are included */
+	struct clone_stats_record record;
+	memset(&record, 0, sizeof(record));
+	record.recorded_at = time(NULL);
+	record.estimated_size = 100 * 1024 * 1024;
+	record.success = 1;
+	
+	strcpy(record.repo, "owner/repo");
+	record.strategy = CLONE_STRATEGY_FULL;
+	record.wall_ms = 1000;
+	if (clone_stats_append(root, &record) != CLONE_STATS_SUCCESS) {
+		FAIL("Failed to append record");
+	}
+	record.strategy = CLONE_STRATEGY_BLOBLESS;
+	record.wall_ms = 3000;
+	clone_stats_append(root, &record);
+	
+	/* A similar-sized repository counts half, scaled by size */
+	strcpy(record.repo, "other/repo");
+	record.strategy = CLONE_STRATEGY_FULL;
+	record.estimated_size = 50 * 1024 * 1024;
+	record.wall_ms = 500;
+	clone_stats_append(root, &record);
+	
+	/* Names with spaces would corrupt the log */
+	strcpy(record.repo, "bad name");
+	if (clone_stats_append(root, &record) != CLONE_STATS_ERROR_INVALID) {
+		FAIL("Invalid repository name accepted");
+	}
+	
+	struct clone_stats_record *records = NULL;
+	size_t count = 0;
+	if (clone_stats_load(root, &records, &count) != CLONE_STATS_SUCCESS || count != 3) {
+		free(records);
+		FAIL("Failed to load records");
+	}
+	
+	struct clone_stats_estimate estimates[CLONE_STATS_STRATEGIES];
+	clone_stats_estimate(records, count, "owner/repo", 100 * 1024 * 1024, estimates);
+	free(records);
+	
+	if (estimates[CLONE_STRATEGY_FULL].observations != 1.5 ||
+	    estimates[CLONE_STRATEGY_FULL].expected_ms != 1000.0 ||
+	    estimates[CLONE_STRATEGY_BLOBLESS].observations != 1.0 ||
+	    estimates[CLONE_STRATEGY_BLOBLESS].expected_ms != 3000.0 ||
+	    estimates[CLONE_STRATEGY_SHALLOW].observations != 0.0) {
+		FAIL("Unexpected estimates");
+	}
+	
+	if (system("rm -rf /tmp/git_cache_stats_test") != 0) {
+		printf("Warning: Failed to clean up test directory\n");
+	}
+	
+	PASS();
+	return 0;
+}
+
+/**
+ * @brief Test reading ref tips from packed-refs and loose refs
+ */
+static int test_ref_tips(void)
+{
+	TEST("ref tips");
+	
+	const char *git_dir = "/tmp/git_cache_refs_test";
+	if (system("rm -rf /tmp/git_cache_refs_test && mkdir -p /tmp/git_cache_refs_test/refs/heads") != 0) {
+		FAIL("Failed to create test directory");
+	}
+	
+	const char *old_sha = "1111111111111111111111111111111111111111";
+	const char *new_sha = "2222222222222222222222222222222222222222";
+	
+	FILE *fp = fopen("/tmp/git_cache_refs_test/packed-refs", "w");
+	if (!fp) {
+		FAIL("Failed to write packed-refs");
+	}
+	fprintf(fp, "# pack-refs with: peeled fully-peeled sorted \n");
+	fprintf(fp, "%s refs/heads/main\n", old_sha);
+	fprintf(fp, "%s refs/tags/v1\n^%s\n", old_sha, new_sha);
+	fclose(fp);
+	
+	fp = fopen("/tmp/git_cache_refs_test/HEAD", "w");
+	if (!fp) {
+		FAIL("Failed to write HEAD");
+	}
+	fprintf(fp, "ref: refs/heads/main\n");
+	fclose(fp);
+	
+	char sha[REF_TIPS_HEX_MAX];
+	char resolved[256];
+	if (ref_tips_resolve(git_dir, "HEAD", sha, resolved, sizeof(resolved)) != REF_TIPS_SUCCESS ||
+	    strcmp(sha, old_sha) != 0 || strcmp(resolved, "refs/heads/main") != 0) {
+		FAIL("Failed to resolve packed ref through HEAD");
+	}
+	if (ref_tips_resolve(git_dir, "refs/heads/missing", sha, NULL, 0) != REF_TIPS_ERROR_NOT_FOUND) {
+		FAIL("Missing ref resolved");
+	}
+	
+	uint64_t before, unchanged, after;
+	if (ref_tips_digest(git_dir, NULL, &before) != REF_TIPS_SUCCESS ||
+	    ref_tips_digest(git_dir, NULL, &unchanged) != REF_TIPS_SUCCESS || before != unchanged) {
+		FAIL("Digest not stable");
+	}
+	
+	/* A loose ref overrides its packed entry */
+	fp = fopen("/tmp/git_cache_refs_test/refs/heads/main", "w");
+	if (!fp) {
+		FAIL("Failed to write loose ref");
+	}
+	fprintf(fp, "%s\n", new_sha);
+	fclose(fp);
+	
+	if (ref_tips_resolve(git_dir, "HEAD", sha, NULL, 0) != REF_TIPS_SUCCESS ||
+	    strcmp(sha, new_sha) != 0) {
+		FAIL("Loose ref did not override packed ref");
+	}
+	if (ref_tips_digest(git_dir, NULL, &after) != REF_TIPS_SUCCESS || after == before) {
+		FAIL("Moved ref not detected");
+	}
+	
+	/* A listing of the same heads from elsewhere gives the same digest */
+	uint64_t heads, listed = REF_TIPS_DIGEST_INIT;
+	listed = ref_tips_digest_add(listed, "refs/heads/main", new_sha);
+	if (ref_tips_digest(git_dir, "refs/heads/", &heads) != REF_TIPS_SUCCESS || heads != listed) {
+		FAIL("Filtered digest does not match listing");
+	}
+	
+	if (system("rm -rf /tmp/git_cache_refs_test") != 0) {
+		printf("Warning: Failed to clean up test directory\n");
+	}
+	
+	PASS();
+	return 0;
+}
+
+/**
+ * @brief Test the LRU eviction policy
+ */
+static int test_cache_gc(void)
+{
+	TEST("cache gc policy");
+	
+	uint64_t bytes;
+	char text[32];
+	if (cache_gc_parse_size("20G", &bytes) != CACHE_GC_SUCCESS || bytes != 20ULL << 30 ||
+	    cache_gc_parse_size("512mb", &bytes) != CACHE_GC_SUCCESS || bytes != 512ULL << 20 ||
+	    cache_gc_parse_size("1000", &bytes) != CACHE_GC_SUCCESS || bytes != 1000) {
+		FAIL("Failed to parse sizes");
+	}
+	if (cache_gc_parse_size("-1G", &bytes) != CACHE_GC_ERROR_INVALID ||
+	    cache_gc_parse_size("10X", &bytes) != CACHE_GC_ERROR_INVALID) {
+		FAIL("Invalid size accepted");
+	}
+	cache_gc_format_size(3ULL << 30, text, sizeof(text));
+	if (strcmp(text, "3G") != 0) {
+		FAIL("Unexpected size format");
+	}
+	cache_gc_format_size(1536, text, sizeof(text));
+	if (cache_gc_parse_size(text, &bytes) != CACHE_GC_SUCCESS || bytes != 1536) {
+		FAIL("Formatted size does not parse back");
+	}
+	
+	/* The larger shortfall of the two limits wins */
+	struct cache_gc_policy policy = { 100, 50 };
+	if (cache_gc_bytes_needed(&policy, 80, 1000, 0) != 0 ||
+	    cache_gc_bytes_needed(&policy, 130, 1000, 0) != 30 ||
+	    cache_gc_bytes_needed(&policy, 130, 10, 0) != 40 ||
+	    cache_gc_bytes_needed(&policy, 80, 1000, 30) != 10) {
+		FAIL("Unexpected bytes needed");
+	}
+	
+	/* Caches with checkouts are never chosen; oldest access goes first */
+	struct cache_gc_candidate candidates[4] = {
+		{ "a", "busy", 10, 100, 1, 0 },
+		{ "a", "new", 10, 300, 0, 0 },
+		{ "a", "old", 10, 200, 0, 0 },
+		{ "a", "older", 10, 50, 2, 0 },
+	};
+	size_t evictable = cache_gc_order(candidates, 4);
+	if (evictable != 2 || strcmp(candidates[0].name, "old") != 0 ||
+	    strcmp(candidates[1].name, "new") != 0) {
+		FAIL("Unexpected eviction order");
+	}
+	
+	/* An upstream with dependents is only evicted after them */
+	struct cache_gc_candidate shared[3] = {
+		{ "a", "upstream", 10, 50, 0, 1 },
+		{ "a", "fork", 10, 200, 0, 0 },
+		{ "a", "other", 10, 100, 0, 0 },
+	};
+	evictable = cache_gc_order(shared, 3);
+	if (evictable != 2 || strcmp(shared[0].name, "other") != 0 ||
+	    strcmp(shared[1].name, "fork") != 0 || strcmp(shared[2].name, "upstream") != 0) {
+		FAIL("Upstream with dependents offered for eviction");
+	}
+	
+	PASS();
+	return 0;
+}
+
+/**
+ * @brief Test when pack maintenance is due
+ */
+static int test_cache_maintenance(void)
+{
+	TEST("cache maintenance triggers");
+	
+	const char *repo = "/tmp/git_cache_maintenance_test";
+	if (system("rm -rf /tmp/git_cache_maintenance_test && "
+	           "mkdir -p /tmp/git_cache_maintenance_test/objects/pack && "
+	           "touch /tmp/git_cache_maintenance_test/objects/pack/pack-1.pack "
+	           "/tmp/git_cache_maintenance_test/objects/pack/pack-2.pack "
+	           "/tmp/git_cache_maintenance_test/objects/pack/pack-2.promisor") != 0) {
+		FAIL("Failed to create test directory");
+	}
+	
+	struct cache_maintenance_state state;
+	if (cache_maintenance_inspect(repo, &state) != CACHE_MAINTENANCE_SUCCESS ||
+	    state.pack_count != 2 || !state.partial || state.loose_estimate != 0) {
+		FAIL("Unexpected object storage state");
+	}
+	
+	time_t now = time(NULL);
+	struct cache_maintenance_policy policy = { 24, 3 };
+	if (cache_maintenance_due(&policy, &state, now - 3600, now) != CACHE_MAINTENANCE_NOT_DUE ||
+	    cache_maintenance_due(&policy, &state, now - 2 * 24 * 3600, now) != CACHE_MAINTENANCE_SCHEDULE) {
+		FAIL("Unexpected schedule decision");
+	}
+	
+	state.pack_count = 3;
+	if (cache_maintenance_due(&policy, &state, now, now) != CACHE_MAINTENANCE_PACKS) {
+		FAIL("Pack threshold ignored");
+	}
+	
+	/* One pack and nothing loose never needs scheduled maintenance */
+	state.pack_count = 1;
+	if (cache_maintenance_due(&policy, &state, 0, now) != CACHE_MAINTENANCE_NOT_DUE) {
+		FAIL("Maintenance scheduled for a fully packed repository");
+	}
+	
+	if (system("rm -rf /tmp/git_cache_maintenance_test") != 0) {
+		printf("Warning: Failed to clean up test directory\n");
+	}
+	
+	PASS();
+	return 0;
+}
+
+/**
+ * @brief Test that a finished span lands in the trace file
+ */
+static int test_cache_trace(void)
+{
+	TEST("cache trace output");
+	
+	const char *trace_file = "/tmp/git_cache_trace_test.jsonl";
+	unlink(trace_file);
+	setenv(CACHE_TRACE_ENV_VAR, trace_file, 1);
+	if (cache_trace_init(0) != CACHE_TRACE_SUCCESS) {
+		FAIL("Failed to open trace file");
+	}
+	
+	struct cache_trace_span span;
+	cache_trace_begin(&span, "test.phase", "repo \"quoted\"");
+	cache_trace_end(&span, 3);
+	unsetenv(CACHE_TRACE_ENV_VAR);
+	
+	char line[1024] = "";
+	FILE *fp = fopen(trace_file, "r");
+	if (!fp || !fgets(line, sizeof(line), fp)) {
+		if (fp) fclose(fp);
+		FAIL("No trace line written");
+	}
+	fclose(fp);
+	
+	if (line[0] != '{' || !strstr(line, "\"phase\":\"test.phase\"") ||
+	    !strstr(line, "\"detail\":\"repo \\\"quoted\\\"\"") || !strstr(line, "\"result\":3}")) {
+		FAIL("Unexpected trace line");
+	}
+	
+	unlink(trace_file);
+	PASS();
+	return 0;
+}
+
+/**
+ * @brief Test mirror ranking and selection from measured history
+ */
+static int test_mirror_selection(void)
+{
+	TEST("mirror selection");
+	
+	time_t now = time(NULL);
+	struct remote_mirror far = { "far", "u1", "backup", 0, 1, 0, 0, NULL, 0, 0, 0, 0, 0, NULL };
+	struct remote_mirror near = { "near", "u2", "backup", 1, 1, 0, 0, NULL, 0, 0, 0, 0, 0, &far };
+	struct remote_mirror down = { "down", "u3", "backup", 0, 1, 0, 0, NULL, 0, 0, 0, 0, 0, &near };
+	
+	record_mirror_probe(&far, 1, 200.0, now);
+	record_mirror_transfer(&far, 64 * 1024 * 1024, 1000.0);
+	record_mirror_probe(&near, 1, 100.0, now);
+	record_mirror_probe(&near, 1, 20.0, now);
+	record_mirror_transfer(&near, 16 * 1024 * 1024, 1000.0);
+	for (int i = 0; i < MIRROR_MAX_FAILURES; i++) {
+		record_mirror_probe(&down, 0, 10.0, now);
+	}
+	if (near.rtt_ms < 75.0 || near.rtt_ms > 77.0 || mirror_is_healthy(&down, now) ||
+	    !mirror_is_healthy(&down, now + MIRROR_PROBE_INTERVAL)) {
+		FAIL("Unexpected mirror history");
+	}
+	
+	/* Round trips decide fetches, throughput decides clones */
+	struct remote_mirror *list = &down;
+	if (rank_mirrors(&list, "fetch", now) != 2 || list != &near || list->next != &far ||
+	    list->next->next != &down) {
+		FAIL("Unexpected fetch ranking");
+	}
+	if (rank_mirrors(&list, "clone", now) != 2 || list != &far || list->next != &near) {
+		FAIL("Unexpected clone ranking");
+	}
+	
+	/* A mirror that answers beats an origin that does not */
+	if (system("rm -rf /tmp/git_cache_mirror_test && mkdir -p /tmp/git_cache_mirror_test && "
+	           "cd /tmp/git_cache_mirror_test && git init -q --bare cache && git init -q --bare up && "
+	           "git -C cache remote add origin /tmp/git_cache_mirror_test/missing && "
+	           "printf 'fast\\t/tmp/git_cache_mirror_test/up\\tperformance\\t1\\t0\\n' "
+	           "> cache/mirrors.txt") != 0) {
+		FAIL("Failed to create test repositories");
+	}
+	
+	struct repo_info repo;
+	memset(&repo, 0, sizeof(repo));
+	repo.cache_path = "/tmp/git_cache_mirror_test/cache";
+	const char *best = get_optimal_mirror(&repo, "fetch");
+	if (!best || strcmp(best, "fast") != 0) {
+		FAIL("Responsive mirror not selected");
+	}
+	
+	struct remote_mirror *mirrors = NULL;
+	if (list_remote_mirrors(&repo, &mirrors) != 2 || strcmp(mirrors->name, "origin") != 0 ||
+	    mirrors->consecutive_failures != 1 || mirrors->next->probe_count != 1) {
+		cleanup_remote_mirrors(mirrors);
+		FAIL("Probe history not saved");
+	}
+	cleanup_remote_mirrors(mirrors);
+	
+	if (system("rm -rf /tmp/git_cache_mirror_test") != 0) {
+		printf("Warning: Failed to clean up test directory\n");
+	}
+	
+	PASS();
+	return 0;
+}
+
+/**
+ * @brief Test seeding a partial cache repository from a bundle
+ */
+static int test_cache_seed(void)
+{
+	TEST("cache seed from bundle");
+	
+	char path[4096];
+	if (cache_seed_bundle_url("https://bundles.example.com//", "owner", "repo", path,
+	                          sizeof(path)) != CACHE_SEED_SUCCESS ||
+	    strcmp(path, "https://bundles.example.com/owner/repo.bundle") != 0) {
+		FAIL("Wrong bundle URL");
+	}
+	
+	const char *root = "/tmp/git_cache_seed_test";
+	if (system("rm -rf /tmp/git_cache_seed_test && mkdir -p /tmp/git_cache_seed_test && "
+	           "cd /tmp/git_cache_seed_test && git init -q src && "
+	           "git -C src -c user.name=t -c user.email=t@t commit -q --allow-empty -m init && "
+	           "git -C src branch -q -m trunk && "
+	           "git -C src bundle create -q ../seed.bundle --all") != 0) {
+		FAIL("Failed to create test bundle");
+	}
+	
+	char cache_path[4096];
+	snprintf(cache_path, sizeof(cache_path), "%s/repo", root);
+	if (cache_seed_partial_path(cache_path, path, sizeof(path)) != CACHE_SEED_SUCCESS ||
+	    strcmp(path, "/tmp/git_cache_seed_test/repo.tmp.partial") != 0) {
+		FAIL("Wrong partial path");
+	}
+	
+	/* First attempt creates the repository, the next one resumes it */
+	if (cache_seed_prepare(path, "/tmp/git_cache_seed_test/src", 0) != 0 ||
+	    cache_seed_prepare(path, "/tmp/git_cache_seed_test/src", 0) != 1) {
+		FAIL("Partial repository not created and resumed");
+	}
+	
+	if (cache_seed_is_seeded(path) ||
+	    cache_seed_from_bundle(path, "/tmp/git_cache_seed_test/missing.bundle", 0) !=
+	    CACHE_SEED_ERROR_DOWNLOAD) {
+		FAIL("Missing bundle not reported");
+	}
+	
+	if (cache_seed_from_bundle(path, "file:///tmp/git_cache_seed_test/seed.bundle", 0) !=
+	    CACHE_SEED_SUCCESS || !cache_seed_is_seeded(path)) {
+		FAIL("Bundle not imported");
+	}
+	
+	/* HEAD follows origin's default branch rather than git init's */
+	if (cache_seed_set_head(path, 0) != CACHE_SEED_SUCCESS ||
+	    system("test \"$(git -C /tmp/git_cache_seed_test/repo.tmp.partial symbolic-ref HEAD)\" = "
+	           "refs/heads/trunk") != 0) {
+		FAIL("HEAD not set from origin");
+	}
+	
+	cache_seed_finish(path);
+	if (cache_seed_is_seeded(path)) {
+		FAIL("Seed marker left behind");
+	}
+	
+	if (system("rm -rf /tmp/git_cache_seed_test") != 0) {
+		printf("Warning: Failed to clean up test directory\n");
+	}
+	
+	PASS();
+	return 0;
+}
+
+/**
+ * @brief Test the merged configuration snapshot and its binary cache
+ */
+static int test_config_snapshot(void)
+{
+	TEST("configuration snapshot");
+	
+	char *old_home = getenv("HOME") ? strdup(getenv("HOME")) : NULL;
+	setenv("HOME", "/tmp/git_cache_config_test", 1);
+	unsetenv("XDG_CACHE_HOME");
+	unsetenv(CONFIG_ENV_VAR);
+	
+	/* Sources older than a second get a snapshot */
+	if (system("rm -rf /tmp/git_cache_config_test && mkdir -p /tmp/git_cache_config_test && "
+	           "printf '[cache]\\nmax_cache_size = 2G\\n[fork]\\norganization = first-org\\n' "
+	           "> /tmp/git_cache_config_test/.gitcacherc && "
+	           "touch -d @1700000000 /tmp/git_cache_config_test/.gitcacherc") != 0) {
+		FAIL("Failed to create test config");
+	}
+	
+	struct cache_config config;
+	memset(&config, 0, sizeof(config));
+	const char *org;
+	if (load_configuration(&config) != CONFIG_SUCCESS || config.max_cache_size != 2ULL << 30 ||
+	    !(org = get_config_string("fork", "organization", NULL)) || strcmp(org, "first-org") != 0) {
+		FAIL("Configuration not loaded");
+	}
+	
+	char path[PATH_MAX];
+	if (get_config_snapshot_path(path, sizeof(path)) != CONFIG_SUCCESS ||
+	    strcmp(path, "/tmp/git_cache_config_test/.cache/git-cache/config.snapshot") != 0 ||
+	    access(path, R_OK) != 0) {
+		FAIL("Snapshot not written");
+	}
+	
+	/* Same size, inode and mtime: the snapshot is trusted without parsing */
+	if (system("printf '[cache]\\nmax_cache_size = 2G\\n[fork]\\norganization = later-org\\n' "
+	           "> /tmp/git_cache_config_test/.gitcacherc && "
+	           "touch -d @1700000000 /tmp/git_cache_config_test/.gitcacherc") != 0) {
+		FAIL("Failed to rewrite test config");
+	}
+	if (load_configuration(&config) != CONFIG_SUCCESS ||
+	    strcmp(get_config_string("fork", "organization", ""), "first-org") != 0) {
+		FAIL("Snapshot not used");
+	}
+	
+	/* A new mtime invalidates it */
+	if (system("touch -d @1700000100 /tmp/git_cache_config_test/.gitcacherc") != 0 ||
+	    load_configuration(&config) != CONFIG_SUCCESS ||
+	    strcmp(get_config_string("fork", "organization", ""), "later-org") != 0) {
+		FAIL("Changed config not reloaded");
+	}
+	
+	/* Clone freshness settings */
+	if (system("printf '[clone]\\nfresh_ttl = 120\\nstale_while_revalidate = true\\n"
+	           "[fork]\\norganization = later-org\\n' > /tmp/git_cache_config_test/.gitcacherc && "
+	           "touch -d @1700000200 /tmp/git_cache_config_test/.gitcacherc") != 0 ||
+	    load_configuration(&config) != CONFIG_SUCCESS || config.fresh_ttl != 120 ||
+	    !config.stale_while_revalidate) {
+		FAIL("Freshness settings not loaded");
+	}
+	
+	/* Lookups keep working as the table grows; no section is not the empty section */
+	char key[32];
+	char value[32];
+	for (int i = 0; i < 200; i++) {
+		snprintf(key, sizeof(key), "key%d", i);
+		snprintf(value, sizeof(value), "%d", i);
+		if (set_config_value("test", key, value) != CONFIG_SUCCESS) {
+			FAIL("Failed to set value");
+		}
+	}
+	if (get_config_int("test", "key0", -1) != 0 || get_config_int("test", "key199", -1) != 199 ||
+	    get_config_int("test", "key200", -1) != -1 ||
+	    strcmp(get_config_string("fork", "organization", ""), "later-org") != 0) {
+		FAIL("Wrong value after growing");
+	}
+	set_config_value(NULL, "scope", "none");
+	set_config_value("", "scope", "empty");
+	if (strcmp(get_config_string(NULL, "scope", ""), "none") != 0 ||
+	    strcmp(get_config_string("", "scope", ""), "empty") != 0) {
+		FAIL("Sections mixed up");
+	}
+	
+	if (old_home) {
+		setenv("HOME", old_home, 1);
+		free(old_home);
+	}
+	if (system("rm -rf /tmp/git_cache_config_test") != 0) {
+		printf("Warning: Failed to clean up test directory\n");
+	}
+	
+	PASS();
+	return 0;
+}
+
+/**
+ * Build the fetch arguments of a filter joined by spaces
+ */
+static int fetch_args_string(const struct ref_filter *filter, int initial, char *buffer, size_t size)
+{
+	struct ref_filter_args args;
+	int ret = ref_filter_fetch_args(filter, "origin", initial, &args);
+	buffer[0] = '\0';
+	for (size_t i = 0; ret == REF_FILTER_SUCCESS && i < args.argc; i++) {
+		size_t used = strlen(buffer);
+		snprintf(buffer + used, size - used, "%s%s", i ? " " : "", args.argv[i]);
+	}
+	return ret == REF_FILTER_SUCCESS && args.argv[args.argc] == NULL ? REF_FILTER_SUCCESS : ret;
+}
+
+/**
+ * @brief Test ref filters and the narrowed sync check
+ */
+static int test_ref_filter(void)
+{
+	TEST("fetch ref filters");
+	
+	struct ref_filter filter;
+	char buffer[REF_FILTER_MAX_ARGS * REF_FILTER_REFSPEC_SIZE];
+	
+	/* No filter keeps the refspecs clone --bare uses */
+	if (ref_filter_parse(NULL, &filter) != REF_FILTER_SUCCESS ||
+	    fetch_args_string(&filter, 1, buffer, sizeof(buffer)) != REF_FILTER_SUCCESS ||
+	    strcmp(buffer, "origin +refs/heads/*:refs/heads/* +refs/tags/*:refs/tags/*") != 0) {
+		FAIL("Unfiltered refspecs changed");
+	}
+	
+	if (ref_filter_parse("release/*, no-tags", &filter) != REF_FILTER_SUCCESS ||
+	    fetch_args_string(&filter, 0, buffer, sizeof(buffer)) != REF_FILTER_SUCCESS ||
+	    strcmp(buffer, "--no-tags origin +refs/heads/*:refs/heads/*") != 0) {
+		FAIL("Filter without a default branch should fetch all branches");
+	}
+	
+	if (ref_filter_set_default(&filter, "refs/heads/main") != REF_FILTER_SUCCESS ||
+	    fetch_args_string(&filter, 0, buffer, sizeof(buffer)) != REF_FILTER_SUCCESS ||
+	    strcmp(buffer, "--no-tags origin +refs/heads/main:refs/heads/main "
+	           "+refs/heads/release/*:refs/heads/release/*") != 0) {
+		FAIL("Narrowed refspecs wrong");
+	}
+	
+	if (!ref_filter_matches(&filter, "refs/heads/main") ||
+	    !ref_filter_matches(&filter, "refs/heads/release/1.0/fix") ||
+	    ref_filter_matches(&filter, "refs/heads/feature") ||
+	    ref_filter_matches(&filter, "refs/tags/v1")) {
+		FAIL("Branch matching wrong");
+	}
+	
+	if (ref_filter_format(&filter, buffer, sizeof(buffer)) != REF_FILTER_SUCCESS ||
+	    strcmp(buffer, "release/* no-tags") != 0) {
+		FAIL("Formatted filter wrong");
+	}
+	
+	if (ref_filter_parse("default tags", &filter) != REF_FILTER_SUCCESS ||
+	    ref_filter_set_default(&filter, "main") != REF_FILTER_SUCCESS ||
+	    fetch_args_string(&filter, 0, buffer, sizeof(buffer)) != REF_FILTER_SUCCESS ||
+	    strcmp(buffer, "origin +refs/heads/main:refs/heads/main +refs/tags/*:refs/tags/*") != 0) {
+		FAIL("Default branch filter wrong");
+	}
+	
+	if (ref_filter_parse("a*b*", &filter) != REF_FILTER_ERROR_INVALID ||
+	    ref_filter_parse("it's", &filter) != REF_FILTER_ERROR_INVALID ||
+	    ref_filter_parse("-x", &filter) != REF_FILTER_ERROR_INVALID) {
+		FAIL("Invalid globs accepted");
+	}
+	
+	/* Only branches the filter fetches decide whether a sync is needed */
+	if (system("rm -rf /tmp/git_cache_filter_test && "
+	           "git init -q /tmp/git_cache_filter_test/up && cd /tmp/git_cache_filter_test/up && "
+	           "git -c user.name=t -c user.email=t@t commit -q --allow-empty -m one && "
+	           "git branch -M main && git branch feature && "
+	           "git clone -q --bare . ../cache.git") != 0) {
+		FAIL("Failed to create test repositories");
+	}
+	
+	struct repo_info repo;
+	memset(&repo, 0, sizeof(repo));
+	repo.cache_path = "/tmp/git_cache_filter_test/cache.git";
+	ref_filter_parse("default", &filter);
+	ref_filter_set_default(&filter, "main");
+	if (needs_synchronization(&repo, NULL, &filter) != 0 ||
+	    needs_synchronization(&repo, NULL, NULL) != 0) {
+		FAIL("Unchanged remote reported as changed");
+	}
+	
+	/* A tag pushed on its own is a change unless the filter leaves tags out */
+	if (system("cd /tmp/git_cache_filter_test/up && git -c user.name=t -c user.email=t@t "
+	           "tag -a -m v1 v1") != 0) {
+		FAIL("Failed to create tag");
+	}
+	struct ref_filter tags_filter;
+	ref_filter_parse("default tags", &tags_filter);
+	ref_filter_set_default(&tags_filter, "main");
+	if (needs_synchronization(&repo, NULL, NULL) != 1 ||
+	    needs_synchronization(&repo, NULL, &tags_filter) != 1 ||
+	    needs_synchronization(&repo, NULL, &filter) != 0) {
+		FAIL("New tag not compared as the filter fetches it");
+	}
+	if (system("git -C /tmp/git_cache_filter_test/cache.git fetch -q origin "
+	           "'refs/tags/*:refs/tags/*'") != 0) {
+		FAIL("Failed to fetch tag");
+	}
+	if (needs_synchronization(&repo, NULL, NULL) != 0 ||
+	    needs_synchronization(&repo, NULL, &tags_filter) != 0) {
+		FAIL("Fetched annotated tag reported as changed");
+	}
+	
+	if (system("cd /tmp/git_cache_filter_test/up && git checkout -q feature && "
+	           "git -c user.name=t -c user.email=t@t commit -q --allow-empty -m two") != 0) {
+		FAIL("Failed to move branch");
+	}
+	if (needs_synchronization(&repo, NULL, &filter) != 0 ||
+	    needs_synchronization(&repo, NULL, NULL) != 1) {
+		FAIL("Filtered-out branch should only matter without a filter");
+	}
+	
+	if (system("rm -rf /tmp/git_cache_filter_test") != 0) {
+		printf("Warning: Failed to clean up test directory\n");
+	}
+	
+	PASS();
+	return 0;
+}
+
+/**
+ * @brief Test sparse specs, cone checkouts and the cones kept in metadata
+ */
+static int test_sparse_checkout(void)
+{
+	TEST("sparse checkouts");
+	
+	char cone[SPARSE_CHECKOUT_SPEC_SIZE];
+	if (sparse_checkout_parse("/src/lib/, docs src/lib", cone, sizeof(cone)) != SPARSE_CHECKOUT_SUCCESS ||
+	    strcmp(cone, "src/lib docs") != 0) {
+		FAIL("Spec not canonicalized");
+	}
+	if (sparse_checkout_parse("/", cone, sizeof(cone)) != SPARSE_CHECKOUT_SUCCESS ||
+	    strcmp(cone, SPARSE_CHECKOUT_ROOT) != 0) {
+		FAIL("Top-level only spec wrong");
+	}
+	if (sparse_checkout_parse("src/../..", cone, sizeof(cone)) != SPARSE_CHECKOUT_ERROR_INVALID ||
+	    sparse_checkout_parse("./src", cone, sizeof(cone)) != SPARSE_CHECKOUT_ERROR_INVALID ||
+	    sparse_checkout_parse("-x", cone, sizeof(cone)) != SPARSE_CHECKOUT_ERROR_INVALID ||
+	    sparse_checkout_parse("src/*", cone, sizeof(cone)) != SPARSE_CHECKOUT_ERROR_INVALID) {
+		FAIL("Invalid directories accepted");
+	}
+	
+	/* A --no-checkout clone gets only the cone once it is reset */
+	if (system("rm -rf /tmp/git_cache_sparse_test && "
+	           "git init -q /tmp/git_cache_sparse_test/up && cd /tmp/git_cache_sparse_test/up && "
+	           "mkdir -p src/lib docs && echo a > README && echo b > src/lib/f && echo c > docs/f && "
+	           "git add . && git -c user.name=t -c user.email=t@t commit -q -m i && "
+	           "git clone -q --no-checkout /tmp/git_cache_sparse_test/up /tmp/git_cache_sparse_test/co") != 0) {
+		FAIL("Could not create test repositories");
+	}
+	if (sparse_checkout_apply("/tmp/git_cache_sparse_test/co", "src/lib") != SPARSE_CHECKOUT_SUCCESS ||
+	    system("cd /tmp/git_cache_sparse_test/co && git reset -q --hard") != 0 ||
+	    access("/tmp/git_cache_sparse_test/co/README", F_OK) != 0 ||
+	    access("/tmp/git_cache_sparse_test/co/src/lib/f", F_OK) != 0 ||
+	    access("/tmp/git_cache_sparse_test/co/docs/f", F_OK) == 0) {
+		FAIL("Cone not applied");
+	}
+	if (sparse_checkout_apply("/tmp/git_cache_sparse_test/co", NULL) != SPARSE_CHECKOUT_SUCCESS ||
+	    access("/tmp/git_cache_sparse_test/co/docs/f", F_OK) != 0) {
+		FAIL("Full tree not restored");
+	}
+	
+	/* Each checkout keeps its own cone */
+	struct cache_metadata metadata;
+	memset(&metadata, 0, sizeof(metadata));
+	metadata.original_url = "https://github.com/o/r";
+	if (cache_metadata_save("/tmp/git_cache_sparse_test/up", &metadata) != METADATA_SUCCESS ||
+	    cache_metadata_update_sparse("/tmp/git_cache_sparse_test/up", 1, "docs") != 1 ||
+	    cache_metadata_update_sparse("/tmp/git_cache_sparse_test/up", 1, "docs") != 0 ||
+	    cache_metadata_load("/tmp/git_cache_sparse_test/up", &metadata) != METADATA_SUCCESS) {
+		FAIL("Cone not stored");
+	}
+	int stored = metadata.sparse_checkout == NULL && metadata.sparse_modifiable &&
+	             strcmp(metadata.sparse_modifiable, "docs") == 0;
+	cache_metadata_clear(&metadata);
+	if (!stored) {
+		FAIL("Stored cones wrong");
+	}
+	
+	if (system("rm -rf /tmp/git_cache_sparse_test") != 0) {
+		FAIL("Could not clean up");
+	}
+	
+	PASS();
+	return 0;
+}
+
 /**
  * @brief Main test function
  */
@@ -379,6 +1358,19 @@ int main(void)
 	// if (test_metadata_save_load() != 0) return 1;
 	// if (test_metadata_updates() != 0) return 1;
 	if (test_metadata_exists() != 0) return 1;
+	if (test_dependent_forks() != 0) return 1;
+	if (test_cache_index() != 0) return 1;
+	if (test_disk_usage() != 0) return 1;
+	if (test_clone_stats() != 0) return 1;
+	if (test_ref_tips() != 0) return 1;
+	if (test_cache_gc() != 0) return 1;
+	if (test_cache_maintenance() != 0) return 1;
+	if (test_cache_trace() != 0) return 1;
+	if (test_mirror_selection() != 0) return 1;
+	if (test_cache_seed() != 0) return 1;
+	if (test_config_snapshot() != 0) return 1;
+	if (test_ref_filter() != 0) return 1;
+	if (test_sparse_checkout() != 0) return 1;
 	
 	/* Print results */
 	printf("\nTest Results: %d/%d passed\n", test_passed, test_count);
@@ -0,0 +1,118 @@
+/**
+ * @file test_cache_serve.c
+ * @brief Tests for git-daemon request handling of the cache server
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <sys/socket.h>
+
+#include "cache_serve.h"
+
+static void test_parse_request(void)
+{
+	printf("=== Testing Request Parsing ===\n");
+	
+	struct cache_serve_request request;
+	static const char packet[] = "git-upload-pack /github.com/o/r.git\0host=node:9418\0\0version=2\0";
+	assert(cache_serve_parse_request(packet, sizeof(packet) - 1, &request) == CACHE_SERVE_SUCCESS);
+	assert(strcmp(request.service, "git-upload-pack") == 0);
+	assert(strcmp(request.path, "/github.com/o/r.git") == 0);
+	assert(strcmp(request.host, "node:9418") == 0);
+	assert(strcmp(request.protocol, "version=2") == 0);
+	printf("✓ Service, path, host and protocol decoded\n");
+	
+	/* Old clients send neither host nor extra parameters */
+	static const char old_packet[] = "git-upload-pack /o/r\n";
+	assert(cache_serve_parse_request(old_packet, sizeof(old_packet) - 1, &request) == CACHE_SERVE_SUCCESS);
+	assert(strcmp(request.path, "/o/r") == 0);
+	assert(request.host[0] == '\0' && request.protocol[0] == '\0');
+	printf("✓ Minimal request decoded\n");
+	
+	assert(cache_serve_parse_request("git-upload-pack", 15, &request) != CACHE_SERVE_SUCCESS);
+	printf("✓ Request without a path refused\n");
+}
+
+static void test_read_request(void)
+{
+	printf("\n=== Testing pkt-line Framing ===\n");
+	
+	int pair[2];
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+	
+	/* Length prefix counts itself; the payload is the request packet */
+	static const char framed[] = "0020git-upload-pack /o/r\0host=h\0";
+	assert(write(pair[0], framed, sizeof(framed) - 1) == (ssize_t)(sizeof(framed) - 1));
+	struct cache_serve_request request;
+	assert(cache_serve_read_request(pair[1], &request) == CACHE_SERVE_SUCCESS);
+	assert(strcmp(request.path, "/o/r") == 0 && strcmp(request.host, "h") == 0);
+	printf("✓ Framed request read from the connection\n");
+	
+	/* A bad length, or a hang-up mid-packet, is a protocol error */
+	assert(write(pair[0], "zzzz", 4) == 4);
+	assert(cache_serve_read_request(pair[1], &request) != CACHE_SERVE_SUCCESS);
+	assert(write(pair[0], "0030git-upload-pack", 19) == 19);
+	close(pair[0]);
+	assert(cache_serve_read_request(pair[1], &request) != CACHE_SERVE_SUCCESS);
+	close(pair[1]);
+	printf("✓ Malformed and truncated packets refused\n");
+}
+
+static void test_repo_url(void)
+{
+	printf("\n=== Testing Path Mapping ===\n");
+	
+	char url[256];
+	assert(cache_serve_repo_url("/github.com/o/r.git", url, sizeof(url)) == CACHE_SERVE_SUCCESS);
+	assert(strcmp(url, "https://github.com/o/r") == 0);
+	assert(cache_serve_repo_url("/o/r/", url, sizeof(url)) == CACHE_SERVE_SUCCESS);
+	assert(strcmp(url, "https://github.com/o/r") == 0);
+	printf("✓ Served paths map to repository URLs\n");
+	
+	/* Nothing outside the cache root is reachable */
+	assert(cache_serve_repo_url("/../etc/passwd", url, sizeof(url)) != CACHE_SERVE_SUCCESS);
+	assert(cache_serve_repo_url("/o/../r", url, sizeof(url)) != CACHE_SERVE_SUCCESS);
+	assert(cache_serve_repo_url("/o/r/objects", url, sizeof(url)) != CACHE_SERVE_SUCCESS);
+	assert(cache_serve_repo_url("/o", url, sizeof(url)) != CACHE_SERVE_SUCCESS);
+	printf("✓ Paths outside the caches refused\n");
+	
+	assert(cache_serve_peer_url("git://node:9418/", "o", "r", url, sizeof(url)) == CACHE_SERVE_SUCCESS);
+	assert(strcmp(url, "git://node:9418/github.com/o/r") == 0);
+	printf("✓ Peer URL built from the peer address\n");
+}
+
+static void test_exports(void)
+{
+	printf("\n=== Testing Export Lists ===\n");
+	
+	assert(cache_serve_exported("o/*, x/y", "o", "r"));
+	assert(cache_serve_exported("*", "a", "b"));
+	assert(cache_serve_exported("x/y", "x", "y"));
+	printf("✓ Listed repositories and owners exported\n");
+	
+	assert(!cache_serve_exported(NULL, "o", "r"));
+	assert(!cache_serve_exported("", "o", "r"));
+	assert(!cache_serve_exported("o/*", "other", "r"));
+	assert(!cache_serve_exported("x/y", "x", "yz"));
+	printf("✓ Nothing else is served\n");
+}
+
+int main(void)
+{
+	printf("Cache Serve Test Suite\n");
+	printf("======================\n\n");
+	
+	test_parse_request();
+	test_read_request();
+	test_repo_url();
+	test_exports();
+	
+	printf("\n=== Test Summary ===\n");
+	printf("All cache serve tests passed!\n");
+	
+	return 0;
+}
@@ -0,0 +1,156 @@
+/**
+ * @file test_worker_pool.c
+ * @brief Tests for forked worker processes
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <assert.h>
+#include <sys/wait.h>
+
+#include "worker_pool.h"
+
+/* Print the job's number, sleep for as many tenths of a second, exit with it */
+static int numbered_job(void *job, void *context)
+{
+	int n = *(int *)job;
+	printf("job %d\n", n);
+	fflush(stdout);
+	usleep(n * 100000);
+	return n + (context ? *(int *)context : 0);
+}
+
+static int killed_job(void *job, void *context)
+{
+	(void)job;
+	(void)context;
+	raise(SIGKILL);
+	return 0;
+}
+
+/* Leave a grandchild holding the output pipe open */
+static int detaching_job(void *job, void *context)
+{
+	(void)job;
+	(void)context;
+	if (fork() == 0) {
+		sleep(2);
+		_exit(0);
+	}
+	return 0;
+}
+
+static void test_captured_results(void)
+{
+	printf("=== Testing Captured Jobs ===\n");
+	
+	struct worker_pool pool;
+	assert(worker_pool_init(&pool, 2, 1) == WORKER_POOL_SUCCESS);
+	
+	int jobs[3] = { 3, 1, 2 };
+	int offset = 10;
+	assert(worker_pool_start(&pool, numbered_job, &jobs[0], &offset) == WORKER_POOL_SUCCESS);
+	assert(worker_pool_start(&pool, numbered_job, &jobs[1], &offset) == WORKER_POOL_SUCCESS);
+	assert(!worker_pool_has_room(&pool));
+	assert(worker_pool_start(&pool, numbered_job, &jobs[2], &offset) == WORKER_POOL_ERROR_FULL);
+	
+	/* The quickest job is reported first and frees its slot */
+	struct worker_pool_result result;
+	assert(worker_pool_wait(&pool, &result) == 1);
+	assert(result.job == &jobs[1] && result.exit_code == 11);
+	worker_pool_free_result(&result);
+	assert(worker_pool_has_room(&pool));
+	assert(worker_pool_start(&pool, numbered_job, &jobs[2], &offset) == WORKER_POOL_SUCCESS);
+	assert(worker_pool_pending(&pool) == 2);
+	
+	int seen = 0;
+	while (worker_pool_wait(&pool, &result) == 1) {
+		int n = *(int *)result.job;
+		char expected[16];
+		snprintf(expected, sizeof(expected), "job %d\n", n);
+		assert(result.exit_code == n + offset && result.term_signal == 0);
+		assert(result.output && strcmp(result.output, expected) == 0);
+		seen |= 1 << n;
+		worker_pool_free_result(&result);
+	}
+	assert(seen == ((1 << 2) | (1 << 3)));
+	assert(worker_pool_pending(&pool) == 0);
+	worker_pool_destroy(&pool);
+	printf("✓ Jobs limited to the pool size, each result carries its own output\n");
+}
+
+static void test_lost_workers(void)
+{
+	printf("\n=== Testing Killed and Detached Workers ===\n");
+	
+	struct worker_pool pool;
+	assert(worker_pool_init(&pool, 2, 1) == WORKER_POOL_SUCCESS);
+	assert(worker_pool_start(&pool, killed_job, NULL, NULL) == WORKER_POOL_SUCCESS);
+	
+	struct worker_pool_result result;
+	assert(worker_pool_wait(&pool, &result) == 1);
+	assert(result.exit_code == -1 && result.term_signal == SIGKILL);
+	worker_pool_free_result(&result);
+	printf("✓ Killed worker reported with its signal\n");
+	
+	/* The grandchild keeps the pipe open, so only the pid check sees the exit */
+	assert(worker_pool_start(&pool, detaching_job, NULL, NULL) == WORKER_POOL_SUCCESS);
+	alarm(10);
+	assert(worker_pool_wait(&pool, &result) == 1);
+	alarm(0);
+	assert(result.exit_code == 0);
+	worker_pool_free_result(&result);
+	printf("✓ Worker exit noticed while its pipe is still held open\n");
+	
+	assert(worker_pool_start(&pool, NULL, NULL, NULL) == WORKER_POOL_ERROR_INVALID);
+	worker_pool_destroy(&pool);
+}
+
+static void test_other_children(void)
+{
+	printf("\n=== Testing Children Outside the Pool ===\n");
+	
+	fflush(stdout);
+	pid_t other = fork();
+	assert(other >= 0);
+	if (other == 0) {
+		_exit(7);
+	}
+	
+	struct worker_pool pool;
+	assert(worker_pool_init(&pool, 1, 0) == WORKER_POOL_SUCCESS);
+	int job = 1;
+	assert(worker_pool_start(&pool, numbered_job, &job, NULL) == WORKER_POOL_SUCCESS);
+	assert(worker_pool_start(&pool, numbered_job, &job, NULL) == WORKER_POOL_ERROR_FULL);
+	
+	struct worker_pool_result result;
+	assert(worker_pool_wait(&pool, &result) == 1);
+	assert(result.exit_code == 1 && result.output == NULL);
+	worker_pool_free_result(&result);
+	assert(worker_pool_wait(&pool, &result) == 0);
+	worker_pool_destroy(&pool);
+	
+	int status;
+	assert(waitpid(other, &status, 0) == other);
+	assert(WIFEXITED(status) && WEXITSTATUS(status) == 7);
+	printf("✓ Pool reaps only its own workers\n");
+}
+
+int main(void)
+{
+	printf("Worker Pool Test Suite\n");
+	printf("======================\n\n");
+	
+	test_captured_results();
+	test_lost_workers();
+	test_other_children();
+	
+	printf("\n=== Test Summary ===\n");
+	printf("All worker pool tests passed!\n");
+	
+	return 0;
+}
@@ -87,6 +87,15 @@ run_test_suite "Git Cache Integration Tests" "$SCRIPT_DIR/run_cache_tests.sh"
 # Run git-cache robustness tests
 run_test_suite "Git Cache Robustness Tests" "$SCRIPT_DIR/run_robustness_tests.sh"
 
+# Run git-cache local checkout tests
+run_test_suite "Git Cache Local Checkout Tests" "$SCRIPT_DIR/run_local_tests.sh"
+
+# Run git-cache command behaviour tests
+run_test_suite "Git Cache Behaviour Tests" "$SCRIPT_DIR/run_behaviour_tests.sh"
+
+# Run git-cache GitHub API behaviour tests against a stub API
+run_test_suite "Git Cache GitHub API Tests" "$SCRIPT_DIR/run_api_tests.sh"
+
 echo -e "${BLUE}Overall Test Suite Summary${NC}"
 echo "=========================="
 echo -e "  Total test suites: $SUITES_RUN"
@@ -0,0 +1,274 @@
+#!/bin/bash
+
+# Git cache GitHub API behaviour test runner
+#
+# Points git-cache at a stub GitHub API on localhost through
+# GITHUB_API_URL and checks the requests it makes: conditional requests
+# answered from the response cache, batched GraphQL lookups, and clone
+# strategies chosen from the reported repository sizes. Repositories are
+# served from disk as in run_behaviour_tests.sh. Needs python3.
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_DIR="$(dirname "$SCRIPT_DIR")"
+BINARY="$PROJECT_DIR/git-cache"
+
+TEST_DIR="$(mktemp -d "${TMPDIR:-/tmp}/git-cache-api-XXXXXX")"
+STUB_PID=""
+
+# Stop the stub API before removing the directory it logs to
+cleanup() {
+	[ -n "$STUB_PID" ] && kill "$STUB_PID" 2>/dev/null
+	wait 2>/dev/null
+	rm -rf "$TEST_DIR"
+}
+trap cleanup EXIT
+
+export HOME="$TEST_DIR/home"
+export GIT_CACHE="$TEST_DIR/cache"
+export GIT_CHECKOUT_ROOT="$TEST_DIR/checkouts"
+export GIT_CACHE_NO_DAEMON=1
+export GIT_AUTHOR_NAME="git-cache test" GIT_AUTHOR_EMAIL="test@example.com"
+export GIT_COMMITTER_NAME="git-cache test" GIT_COMMITTER_EMAIL="test@example.com"
+export GITHUB_TOKEN="stub-token"
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+# Test counters
+TESTS_RUN=0
+TESTS_PASSED=0
+TESTS_FAILED=0
+
+# Function to run a test
+run_test() {
+	local test_name="$1"
+	local expected_exit_code="$2"
+	shift 2
+	local cmd="$@"
+
+	echo -n "Running test: $test_name... "
+	TESTS_RUN=$((TESTS_RUN + 1))
+
+	if eval "$cmd" >/dev/null 2>&1; then
+		actual_exit_code=0
+	else
+		actual_exit_code=$?
+	fi
+
+	if [ "$actual_exit_code" -eq "$expected_exit_code" ]; then
+		echo -e "${GREEN}PASS${NC}"
+		TESTS_PASSED=$((TESTS_PASSED + 1))
+		return 0
+	else
+		echo -e "${RED}FAIL${NC}"
+		echo "  Expected exit code: $expected_exit_code"
+		echo "  Actual exit code: $actual_exit_code"
+		TESTS_FAILED=$((TESTS_FAILED + 1))
+		return 1
+	fi
+}
+
+# Function to check that two values are equal
+check_equal() {
+	local test_name="$1"
+	local expected="$2"
+	local actual="$3"
+
+	echo -n "Running test: $test_name... "
+	TESTS_RUN=$((TESTS_RUN + 1))
+
+	if [ "$expected" = "$actual" ]; then
+		echo -e "${GREEN}PASS${NC}"
+		TESTS_PASSED=$((TESTS_PASSED + 1))
+	else
+		echo -e "${RED}FAIL${NC}"
+		echo "  Expected: $expected"
+		echo "  Actual: $actual"
+		TESTS_FAILED=$((TESTS_FAILED + 1))
+	fi
+}
+
+# Function to wait up to 30 seconds for a command to succeed
+wait_for() {
+	local cmd="$1"
+	local tries=0
+
+	while ! eval "$cmd" >/dev/null 2>&1; do
+		tries=$((tries + 1))
+		if [ $tries -ge 60 ]; then
+			return 1
+		fi
+		sleep 0.5
+	done
+	return 0
+}
+
+# Function to create an upstream repository with one commit
+make_upstream() {
+	local name="$1"
+
+	git init -q --bare -b master "$TEST_DIR/remotes/test/$name.git"
+	git clone -q "$TEST_DIR/remotes/test/$name.git" "$TEST_DIR/work-$name" 2>/dev/null
+	echo "$name" > "$TEST_DIR/work-$name/README"
+	git -C "$TEST_DIR/work-$name" add README
+	git -C "$TEST_DIR/work-$name" commit -q -m "initial"
+	git -C "$TEST_DIR/work-$name" push -q origin HEAD:master
+}
+
+# Function to print the partial clone filter of a cache, empty for a full clone
+cache_filter() {
+	git -C "$GIT_CACHE/github.com/test/$1" config --get remote.origin.partialclonefilter
+}
+
+# Check if binary exists
+if [ ! -f "$BINARY" ]; then
+	echo -e "${RED}Error: Binary not found at $BINARY${NC}"
+	echo "Please run 'make cache' first to build the git-cache program."
+	exit 1
+fi
+
+if ! command -v python3 >/dev/null 2>&1; then
+	echo -e "${YELLOW}Skipping GitHub API behaviour tests: python3 not found${NC}"
+	exit 0
+fi
+
+echo -e "${BLUE}Starting git-cache GitHub API behaviour tests...${NC}"
+echo
+
+# Upstream repositories reached through URL rewriting
+mkdir -p "$HOME" "$TEST_DIR/remotes/test"
+git config --global url."$TEST_DIR/remotes/test/".insteadOf https://github.com/test/
+git config --global protocol.file.allow always
+for name in small big huge; do
+	make_upstream "$name"
+done
+
+# Stub API: sizes in KB as GitHub reports them, one ETag per repository,
+# and a log line for each request with its If-None-Match and status
+cat > "$TEST_DIR/stub_api.py" <<'EOF'
+import http.server
+import json
+import sys
+
+port_file, log_file = sys.argv[1], sys.argv[2]
+sizes = {"small": 100, "big": 2 * 1024 * 1024, "huge": 2 * 1024 * 1024}
+
+
+def repository(name, graphql):
+    if graphql:
+        return {"name": name, "nameWithOwner": "test/" + name, "owner": {"login": "test"},
+                "url": "https://github.com/test/" + name, "isFork": False,
+                "isPrivate": False, "forkCount": 0, "diskUsage": sizes[name]}
+    return {"name": name, "full_name": "test/" + name, "owner": {"login": "test"},
+            "clone_url": "https://github.com/test/%s.git" % name, "fork": False,
+            "private": False, "forks_count": 0, "size": sizes[name]}
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    def log_message(self, *args):
+        pass
+
+    def reply(self, status, body=None, etag=None):
+        data = json.dumps(body).encode() if body is not None else b""
+        self.send_response(status)
+        if etag:
+            self.send_header("ETag", etag)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+        with open(log_file, "a") as log:
+            log.write("%s %s %s %d\n" % (self.command, self.path,
+                                         self.headers.get("If-None-Match", "-"), status))
+
+    def do_GET(self):
+        parts = self.path.strip("/").split("/")
+        if len(parts) == 3 and parts[:2] == ["repos", "test"] and parts[2] in sizes:
+            etag = '"%s-v1"' % parts[2]
+            if self.headers.get("If-None-Match") == etag:
+                self.reply(304, etag=etag)
+            else:
+                self.reply(200, repository(parts[2], False), etag)
+        else:
+            self.reply(404, {"message": "Not Found"})
+
+    def do_POST(self):
+        body = json.loads(self.rfile.read(int(self.headers["Content-Length"])))
+        if self.path != "/graphql":
+            self.reply(404, {"message": "Not Found"})
+            return
+        data = {}
+        for key, value in body["variables"].items():
+            if key.startswith("n") and value in sizes:
+                data["r" + key[1:]] = repository(value, True)
+        self.reply(200, {"data": data})
+
+
+server = http.server.HTTPServer(("127.0.0.1", 0), Handler)
+with open(port_file, "w") as f:
+    f.write(str(server.server_port))
+server.serve_forever()
+EOF
+
+API_LOG="$TEST_DIR/api.log"
+python3 "$TEST_DIR/stub_api.py" "$TEST_DIR/api.port" "$API_LOG" &
+STUB_PID=$!
+if ! wait_for "test -s $TEST_DIR/api.port"; then
+	echo -e "${RED}Error: stub GitHub API did not start${NC}"
+	exit 1
+fi
+export GITHUB_API_URL="http://127.0.0.1:$(cat "$TEST_DIR/api.port")/"
+
+echo -e "${YELLOW}=== Testing batched lookups ===${NC}"
+
+printf '%s\n' "https://github.com/test/small" "https://github.com/test/big" > "$TEST_DIR/repos.txt"
+run_test "Batch clone with automatic strategies" 0 \
+	"$BINARY clone --strategy auto --from-file $TEST_DIR/repos.txt"
+check_equal "One GraphQL query for the batch" "1" "$(grep -c '^POST /graphql ' "$API_LOG")"
+check_equal "Small repository cloned in full" "" "$(cache_filter small)"
+check_equal "Large repository cloned without blobs" "blob:none" "$(cache_filter big)"
+
+echo -e "${YELLOW}=== Testing single lookups ===${NC}"
+
+: > "$API_LOG"
+run_test "Clone with an automatic strategy" 0 "$BINARY clone --strategy auto https://github.com/test/huge"
+run_test "Repository looked up over REST" 0 "grep -q '^GET /repos/test/huge ' $API_LOG"
+check_equal "Strategy chosen from the reported size" "blob:none" "$(cache_filter huge)"
+
+echo -e "${YELLOW}=== Testing the response cache ===${NC}"
+
+run_test "Responses stored under the cache root" 0 "test -n \"\$(ls -A $GIT_CACHE/.github-api)\""
+
+# Every lookup now revalidates what it stored and is answered with 304
+: > "$API_LOG"
+run_test "Clone again" 0 "$BINARY clone --strategy auto https://github.com/test/huge"
+run_test "Lookups made" 0 "grep -q '^GET ' $API_LOG"
+check_equal "Every lookup conditional" "0" "$(grep -c '^GET .* - ' "$API_LOG")"
+check_equal "Every lookup answered with 304" "0" "$(grep '^GET ' "$API_LOG" | grep -vc ' 304$')"
+check_equal "Cached answer used for the strategy" "blob:none" "$(cache_filter huge)"
+
+# Answers for one token are never revalidated or reused for another
+: > "$API_LOG"
+run_test "Clone with another token" 0 \
+	"GITHUB_TOKEN=other-token $BINARY clone --strategy auto https://github.com/test/huge"
+run_test "Lookups made with the other token" 0 "grep -q '^GET ' $API_LOG"
+check_equal "No lookup conditional on the first token's entry" "0" \
+	"$(grep '^GET ' "$API_LOG" | grep -vc ' - ')"
+
+echo
+echo "Git Cache GitHub API Test Summary:"
+echo -e "  Total tests: $TESTS_RUN"
+echo -e "  ${GREEN}Passed: $TESTS_PASSED${NC}"
+echo -e "  ${RED}Failed: $TESTS_FAILED${NC}"
+
+if [ $TESTS_FAILED -eq 0 ]; then
+	echo -e "${GREEN}All GitHub API behaviour tests passed!${NC}"
+	exit 0
+else
+	echo -e "${RED}Some GitHub API behaviour tests failed.${NC}"
+	exit 1
+fi
@@ -0,0 +1,449 @@
+#!/bin/bash
+
+# Git cache command behaviour test runner
+#
+# Runs against throwaway upstream repositories on disk: a private HOME
+# rewrites https://github.com/test/ to them, so no network access is
+# needed.
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_DIR="$(dirname "$SCRIPT_DIR")"
+BINARY="$PROJECT_DIR/git-cache"
+
+TEST_DIR="$(mktemp -d "${TMPDIR:-/tmp}/git-cache-behaviour-XXXXXX")"
+DAEMON_PID=""
+SERVE_PID=""
+
+# Stop background servers before removing the directory they run in
+cleanup() {
+	[ -n "$DAEMON_PID" ] && kill "$DAEMON_PID" 2>/dev/null
+	[ -n "$SERVE_PID" ] && kill "$SERVE_PID" 2>/dev/null
+	wait 2>/dev/null
+	rm -rf "$TEST_DIR"
+}
+trap cleanup EXIT
+
+export HOME="$TEST_DIR/home"
+export GIT_CACHE="$TEST_DIR/cache"
+export GIT_CHECKOUT_ROOT="$TEST_DIR/checkouts"
+export GIT_CACHE_NO_DAEMON=1
+export GIT_AUTHOR_NAME="git-cache test" GIT_AUTHOR_EMAIL="test@example.com"
+export GIT_COMMITTER_NAME="git-cache test" GIT_COMMITTER_EMAIL="test@example.com"
+unset GITHUB_TOKEN
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+# Test counters
+TESTS_RUN=0
+TESTS_PASSED=0
+TESTS_FAILED=0
+
+# Function to run a test
+run_test() {
+	local test_name="$1"
+	local expected_exit_code="$2"
+	shift 2
+	local cmd="$@"
+
+	echo -n "Running test: $test_name... "
+	TESTS_RUN=$((TESTS_RUN + 1))
+
+	if eval "$cmd" >/dev/null 2>&1; then
+		actual_exit_code=0
+	else
+		actual_exit_code=$?
+	fi
+
+	if [ "$actual_exit_code" -eq "$expected_exit_code" ]; then
+		echo -e "${GREEN}PASS${NC}"
+		TESTS_PASSED=$((TESTS_PASSED + 1))
+		return 0
+	else
+		echo -e "${RED}FAIL${NC}"
+		echo "  Expected exit code: $expected_exit_code"
+		echo "  Actual exit code: $actual_exit_code"
+		TESTS_FAILED=$((TESTS_FAILED + 1))
+		return 1
+	fi
+}
+
+# Function to check that two values are equal
+check_equal() {
+	local test_name="$1"
+	local expected="$2"
+	local actual="$3"
+
+	echo -n "Running test: $test_name... "
+	TESTS_RUN=$((TESTS_RUN + 1))
+
+	if [ "$expected" = "$actual" ]; then
+		echo -e "${GREEN}PASS${NC}"
+		TESTS_PASSED=$((TESTS_PASSED + 1))
+	else
+		echo -e "${RED}FAIL${NC}"
+		echo "  Expected: $expected"
+		echo "  Actual: $actual"
+		TESTS_FAILED=$((TESTS_FAILED + 1))
+	fi
+}
+
+# Function to wait up to 30 seconds for a command to succeed
+wait_for() {
+	local cmd="$1"
+	local tries=0
+
+	while ! eval "$cmd" >/dev/null 2>&1; do
+		tries=$((tries + 1))
+		if [ $tries -ge 60 ]; then
+			return 1
+		fi
+		sleep 0.5
+	done
+	return 0
+}
+
+# Function to commit a change to the upstream through a scratch clone
+push_upstream_commit() {
+	local message="$1"
+
+	echo "$message" >> "$TEST_DIR/work/README"
+	git -C "$TEST_DIR/work" commit -q -a -m "$message"
+	git -C "$TEST_DIR/work" push -q origin HEAD:master
+}
+
+# Function to create an upstream with docs and src directories and a scratch clone of it
+make_upstream() {
+	local name="$1"
+
+	git init -q --bare -b master "$TEST_DIR/remotes/test/$name.git"
+	git clone -q "$TEST_DIR/remotes/test/$name.git" "$TEST_DIR/work-$name" 2>/dev/null
+	mkdir -p "$TEST_DIR/work-$name/docs" "$TEST_DIR/work-$name/src"
+	echo "$name" > "$TEST_DIR/work-$name/README"
+	echo "guide" > "$TEST_DIR/work-$name/docs/guide"
+	echo "main" > "$TEST_DIR/work-$name/src/main"
+	git -C "$TEST_DIR/work-$name" add .
+	git -C "$TEST_DIR/work-$name" commit -q -m "initial"
+	git -C "$TEST_DIR/work-$name" push -q origin HEAD:master
+}
+
+# Function to commit a change to an upstream made by make_upstream
+push_commit() {
+	local name="$1"
+	local message="$2"
+
+	echo "$message" >> "$TEST_DIR/work-$name/README"
+	git -C "$TEST_DIR/work-$name" commit -q -a -m "$message"
+	git -C "$TEST_DIR/work-$name" push -q origin HEAD:master
+}
+
+# Check if binary exists
+if [ ! -f "$BINARY" ]; then
+	echo -e "${RED}Error: Binary not found at $BINARY${NC}"
+	echo "Please run 'make cache' first to build the git-cache program."
+	exit 1
+fi
+
+echo -e "${BLUE}Starting git-cache behaviour tests...${NC}"
+echo
+
+# Upstream repositories reached through URL rewriting
+mkdir -p "$HOME" "$TEST_DIR/remotes/test"
+git config --global url."$TEST_DIR/remotes/test/".insteadOf https://github.com/test/
+git config --global protocol.file.allow always
+git init -q --bare -b master "$TEST_DIR/remotes/test/repo.git"
+git clone -q "$TEST_DIR/remotes/test/repo.git" "$TEST_DIR/work" 2>/dev/null
+echo "initial" > "$TEST_DIR/work/README"
+git -C "$TEST_DIR/work" add README
+git -C "$TEST_DIR/work" commit -q -m "initial"
+git -C "$TEST_DIR/work" push -q origin HEAD:master
+
+REPO_URL="https://github.com/test/repo"
+CACHE_PATH="$GIT_CACHE/github.com/test/repo"
+CHECKOUT_PATH="$GIT_CHECKOUT_ROOT/test/repo"
+
+echo -e "${YELLOW}=== Testing cache freshness ===${NC}"
+
+run_test "Initial clone" 0 "$BINARY clone $REPO_URL"
+
+# Without a TTL every clone fetches before it returns
+push_upstream_commit "fetched in the foreground"
+UPSTREAM_HEAD="$(git -C "$TEST_DIR/work" rev-parse HEAD)"
+run_test "Clone with the default TTL" 0 "$BINARY clone $REPO_URL"
+check_equal "Default TTL fetches in the foreground" "$UPSTREAM_HEAD" \
+	"$(git -C "$CACHE_PATH" rev-parse master)"
+
+# Within the TTL the cache is used as is
+push_upstream_commit "not fetched"
+run_test "Clone within the TTL" 0 "GIT_CACHE_FRESH_TTL=3600 $BINARY clone $REPO_URL"
+check_equal "Fresh cache is not fetched into" "$UPSTREAM_HEAD" \
+	"$(git -C "$CACHE_PATH" rev-parse master)"
+
+echo -e "${YELLOW}=== Testing stale-while-revalidate ===${NC}"
+
+UPSTREAM_HEAD="$(git -C "$TEST_DIR/work" rev-parse HEAD)"
+sleep 2
+run_test "Stale clone returns before the fetch" 0 \
+	"GIT_CACHE_FRESH_TTL=1 GIT_CACHE_STALE_WHILE_REVALIDATE=1 $BINARY clone -v $REPO_URL | grep -q 'updated in the background'"
+run_test "Background refresh fetches into the cache" 0 \
+	"wait_for '[ \"\$(git -C $CACHE_PATH rev-parse master)\" = $UPSTREAM_HEAD ]'"
+run_test "Background refresh releases the cache lock" 0 \
+	"wait_for 'flock -n $GIT_CACHE/github.com/test/.repo.lock true'"
+run_test "Cache usable after the background refresh" 0 "$BINARY clone $REPO_URL"
+
+echo -e "${YELLOW}=== Testing batch clone ===${NC}"
+
+for name in one two three; do
+	make_upstream "$name"
+done
+printf '%s\n' "https://github.com/test/one" "# comment" "" "https://github.com/test/two" \
+	"https://github.com/test/one" > "$TEST_DIR/repos.txt"
+
+run_test "Batch clone from a file" 0 \
+	"$BINARY clone --from-file $TEST_DIR/repos.txt --jobs 2 > $TEST_DIR/batch.log"
+run_test "Every listed repository checked out" 0 \
+	"test -f $GIT_CHECKOUT_ROOT/test/one/README && test -f $GIT_CHECKOUT_ROOT/test/two/README"
+run_test "Duplicate URLs cloned once" 0 "grep -q 'Duplicates skipped: 1' $TEST_DIR/batch.log"
+run_test "Batch clone from stdin" 0 "echo https://github.com/test/three | $BINARY clone --from-file -"
+run_test "Batch clone fails when an entry fails" 1 \
+	"echo https://github.com/test/missing | $BINARY clone --from-file -"
+
+echo -e "${YELLOW}=== Testing sync ===${NC}"
+
+push_commit one "synced"
+push_commit two "synced"
+run_test "Sync all caches" 0 "$BINARY sync > $TEST_DIR/sync.log"
+check_equal "Changed caches fetched" \
+	"$(git -C "$TEST_DIR/work-one" rev-parse HEAD) $(git -C "$TEST_DIR/work-two" rev-parse HEAD)" \
+	"$(git -C "$GIT_CACHE/github.com/test/one" rev-parse master) $(git -C "$GIT_CACHE/github.com/test/two" rev-parse master)"
+run_test "Unchanged caches not fetched" 0 \
+	"grep -q 'Synchronized: 2 repositories' $TEST_DIR/sync.log && grep -q 'Unchanged: 2 repositories' $TEST_DIR/sync.log"
+check_equal "Outdated checkout repaired" "$(git -C "$TEST_DIR/work-one" rev-parse HEAD)" \
+	"$(git -C "$GIT_CHECKOUT_ROOT/test/one" rev-parse HEAD)"
+
+# A tag pushed on its own changes no branch but still needs a fetch
+git -C "$TEST_DIR/work-one" tag -a -m "release" v1
+git -C "$TEST_DIR/work-one" push -q origin v1
+run_test "Sync after a new tag" 0 "$BINARY sync > $TEST_DIR/sync.log"
+check_equal "New tag fetched" "$(git -C "$TEST_DIR/work-one" rev-parse v1)" \
+	"$(git -C "$GIT_CACHE/github.com/test/one" rev-parse v1 2>/dev/null)"
+
+# One unreachable upstream fails the sync without stopping the others
+mv "$TEST_DIR/remotes/test/two.git" "$TEST_DIR/remotes/test/two.away"
+push_commit three "synced"
+run_test "Sync with an unreachable upstream fails" 1 "$BINARY sync > $TEST_DIR/sync.log"
+run_test "Failure counted in the summary" 0 "grep -q 'Failed: 1 repositories' $TEST_DIR/sync.log"
+check_equal "Other caches still fetched" "$(git -C "$TEST_DIR/work-three" rev-parse HEAD)" \
+	"$(git -C "$GIT_CACHE/github.com/test/three" rev-parse master)"
+mv "$TEST_DIR/remotes/test/two.away" "$TEST_DIR/remotes/test/two.git"
+
+echo -e "${YELLOW}=== Testing verify ===${NC}"
+
+run_test "Verify intact caches" 0 "$BINARY verify"
+
+# A git that takes two seconds per fsck makes every deep check outlast a one second budget
+mkdir -p "$TEST_DIR/slow-git"
+printf '#!/bin/sh\ncase " $* " in *" fsck "*) sleep 2 ;; esac\nexec %s "$@"\n' \
+	"$(command -v git)" > "$TEST_DIR/slow-git/git"
+chmod +x "$TEST_DIR/slow-git/git"
+SLOW_VERIFY="PATH=$TEST_DIR/slow-git:\$PATH $BINARY verify --deep --budget 1 --jobs 1"
+run_test "Deep verify stops at its budget" 0 "$SLOW_VERIFY > $TEST_DIR/verify1.log"
+run_test "Caches left over are reported" 0 \
+	"grep -q 'Left for the next run (budget spent): 3' $TEST_DIR/verify1.log"
+run_test "Next run within the budget" 0 "$SLOW_VERIFY > $TEST_DIR/verify2.log"
+run_test "Next run starts with a cache left over" 1 \
+	"[ \"\$(grep Checking: $TEST_DIR/verify1.log)\" = \"\$(grep Checking: $TEST_DIR/verify2.log)\" ]"
+run_test "Budget must be positive" 1 "$BINARY verify --budget 0"
+
+# An object stored under the wrong name only shows when objects are hashed
+(
+	cd "$GIT_CACHE/github.com/test/one" &&
+	a=$(echo first | git hash-object -w --stdin) &&
+	b=$(echo second | git hash-object -w --stdin) &&
+	fa="objects/$(echo "$a" | cut -c1-2)/$(echo "$a" | cut -c3-)" &&
+	fb="objects/$(echo "$b" | cut -c1-2)/$(echo "$b" | cut -c3-)" &&
+	chmod u+w "$fa" && cp "$fb" "$fa"
+)
+run_test "Quick verify skips object contents" 0 "$BINARY verify"
+run_test "Deep verify finds a damaged object" 1 "$BINARY verify --deep > $TEST_DIR/verify.log"
+run_test "Damaged cache named" 0 "grep -q 'test/one... CORRUPTED' $TEST_DIR/verify.log"
+run_test "Repair suggested with --deep" 0 "grep -q 'git-cache verify --deep <url>' $TEST_DIR/verify.log"
+run_test "Deep verify repairs the named cache" 0 "$BINARY verify --deep https://github.com/test/one"
+run_test "Repaired cache passes deep verify" 0 "$BINARY verify --deep"
+run_test "Repaired cache keeps its checkouts" 0 "$BINARY list | grep -q 'test/one (.*checkout'"
+run_test "Repair backup not listed" 1 "$BINARY list | grep -q corrupted"
+
+# Damage the native probes see without running git
+mv "$GIT_CACHE/github.com/test/two/HEAD" "$TEST_DIR/two-HEAD"
+run_test "Missing HEAD found" 1 "$BINARY verify > $TEST_DIR/verify.log"
+run_test "Cache without HEAD named" 0 "grep -q 'test/two... CORRUPTED' $TEST_DIR/verify.log"
+run_test "Cache without HEAD repaired" 0 "$BINARY verify https://github.com/test/two"
+git -C "$GIT_CACHE/github.com/test/three" repack -a -d -q
+THREE_IDX="$(ls "$GIT_CACHE"/github.com/test/three/objects/pack/*.idx)"
+chmod u+w "$THREE_IDX"
+truncate -s 100 "$THREE_IDX"
+run_test "Truncated pack index found" 1 "$BINARY verify > $TEST_DIR/verify.log"
+run_test "Cache with a truncated index named" 0 "grep -q 'test/three... CORRUPTED' $TEST_DIR/verify.log"
+run_test "Cache with a truncated index repaired" 0 "$BINARY verify https://github.com/test/three"
+run_test "Repair backups not verified as caches" 0 "$BINARY verify"
+
+echo -e "${YELLOW}=== Testing cache locks ===${NC}"
+
+ONE_LOCK="$GIT_CACHE/github.com/test/.one.lock"
+
+# An exclusive holder, such as another fetch, makes a clone wait
+flock -x "$ONE_LOCK" sleep 2 &
+HOLDER_PID=$!
+wait_for "! flock -n $ONE_LOCK true"
+$BINARY clone https://github.com/test/one >/dev/null 2>&1 &
+CLONE_PID=$!
+sleep 1
+run_test "Clone waits for an exclusive lock" 0 "kill -0 $CLONE_PID"
+wait "$HOLDER_PID"
+run_test "Clone proceeds once the lock is released" 0 "wait $CLONE_PID"
+
+# Readers share the lock
+flock -s "$ONE_LOCK" sleep 3 &
+HOLDER_PID=$!
+wait_for "! flock -n $ONE_LOCK true"
+run_test "Verify runs beside a shared holder" 0 "timeout 2 $BINARY verify"
+wait "$HOLDER_PID"
+
+make_upstream four
+$BINARY clone https://github.com/test/four >/dev/null 2>&1 &
+FIRST_PID=$!
+$BINARY clone https://github.com/test/four >/dev/null 2>&1 &
+SECOND_PID=$!
+run_test "First of two concurrent clones" 0 "wait $FIRST_PID"
+run_test "Second of two concurrent clones" 0 "wait $SECOND_PID"
+run_test "Concurrent clones leave a valid checkout" 0 \
+	"git -C $GIT_CHECKOUT_ROOT/test/four rev-parse --verify HEAD && test -f $GIT_CHECKOUT_ROOT/test/four/README"
+
+echo -e "${YELLOW}=== Testing sparse checkouts ===${NC}"
+
+make_upstream sparse
+run_test "Sparse clone" 0 "$BINARY clone --sparse docs https://github.com/test/sparse"
+run_test "Requested directory checked out" 0 "test -f $GIT_CHECKOUT_ROOT/test/sparse/docs/guide"
+run_test "Other directories left out" 1 "test -e $GIT_CHECKOUT_ROOT/test/sparse/src"
+run_test "Top-level files kept" 0 "test -f $GIT_CHECKOUT_ROOT/test/sparse/README"
+run_test "Modifiable checkout sparse too" 1 "test -e $GIT_CHECKOUT_ROOT/mithro/test-sparse/src"
+run_test "Full tree restored" 0 \
+	"$BINARY clone --no-sparse https://github.com/test/sparse && test -f $GIT_CHECKOUT_ROOT/test/sparse/src/main"
+
+echo -e "${YELLOW}=== Testing shared submodule caches ===${NC}"
+
+make_upstream lib
+for name in app1 app2; do
+	make_upstream "$name"
+	git -C "$TEST_DIR/work-$name" submodule -q add https://github.com/test/lib lib 2>/dev/null
+	git -C "$TEST_DIR/work-$name" commit -q -m "add lib"
+	git -C "$TEST_DIR/work-$name" push -q origin HEAD:master
+done
+
+run_test "Recursive clone of the first parent" 0 "$BINARY clone --recursive https://github.com/test/app1"
+run_test "Recursive clone of the second parent" 0 "$BINARY clone --recursive https://github.com/test/app2"
+run_test "Submodule checked out" 0 "test -f $GIT_CHECKOUT_ROOT/test/app2/lib/README"
+check_equal "Submodule cached at its own github.com entry" "$GIT_CACHE/github.com/test/lib/objects" \
+	"$(cat "$GIT_CHECKOUT_ROOT/test/app1/.git/modules/lib/objects/info/alternates")"
+check_equal "Both parents share the submodule cache" "$GIT_CACHE/github.com/test/lib/objects" \
+	"$(cat "$GIT_CHECKOUT_ROOT/test/app2/.git/modules/lib/objects/info/alternates")"
+
+echo -e "${YELLOW}=== Testing gc ===${NC}"
+
+# A clone whose checkout could not be created leaves a cache without checkouts
+make_upstream orphan
+touch "$GIT_CHECKOUT_ROOT/test/orphan"
+run_test "Clone with a blocked checkout fails" 1 "$BINARY clone https://github.com/test/orphan"
+rm "$GIT_CHECKOUT_ROOT/test/orphan"
+
+run_test "Within the budget" 0 "$BINARY gc --max-size 1G"
+run_test "Nothing evicted within the budget" 0 "test -d $GIT_CACHE/github.com/test/orphan"
+run_test "Over the budget" 0 "$BINARY gc --max-size 1 > $TEST_DIR/gc.log 2>&1"
+run_test "Cache without checkouts evicted" 1 "test -e $GIT_CACHE/github.com/test/orphan"
+run_test "Eviction reported" 0 "grep -q 'Evicting test/orphan' $TEST_DIR/gc.log"
+run_test "Caches with checkouts kept" 0 \
+	"test -d $GIT_CACHE/github.com/test/one && test -d $GIT_CACHE/github.com/test/lib"
+run_test "Remaining overage reported" 0 "grep -q 'still .* over its budget' $TEST_DIR/gc.log"
+run_test "Size must be valid" 1 "$BINARY gc --max-size lots"
+
+echo -e "${YELLOW}=== Testing daemon ===${NC}"
+
+# Commands in this section reach the daemon
+DAEMON_CMD="env -u GIT_CACHE_NO_DAEMON $BINARY"
+run_test "Status without a daemon" 0 "$DAEMON_CMD daemon status | grep -q 'not running'"
+
+# The daemon syncs when it starts and then serves clones from the synced caches
+push_commit one "synced by the daemon"
+ONE_HEAD="$(git -C "$TEST_DIR/work-one" rev-parse HEAD)"
+$DAEMON_CMD daemon run > "$TEST_DIR/daemon.log" 2>&1 &
+DAEMON_PID=$!
+run_test "Daemon starts" 0 "wait_for '$DAEMON_CMD daemon status | grep -q \"daemon running\"'"
+run_test "Second daemon refused" 1 "$DAEMON_CMD daemon run"
+run_test "Daemon syncs on start" 0 \
+	"wait_for '[ \"\$(git -C $GIT_CACHE/github.com/test/one rev-parse master)\" = $ONE_HEAD ]'"
+run_test "Clone through the daemon" 0 "$DAEMON_CMD clone https://github.com/test/one"
+check_equal "Checkout at the synced commit" "$ONE_HEAD" \
+	"$(git -C "$GIT_CHECKOUT_ROOT/test/one" rev-parse HEAD)"
+run_test "Failed clone status returned" 1 "$DAEMON_CMD clone https://github.com/test/missing"
+
+# Within the freshness TTL only a clone that leaves the checkouts as they are skips the work
+run_test "Fresh cache answered from the index" 0 \
+	"GIT_CACHE_FRESH_TTL=3600 $DAEMON_CMD clone -v https://github.com/test/one | grep -q 'checkouts are current'"
+run_test "Sparse clone of a fresh cache" 0 \
+	"GIT_CACHE_FRESH_TTL=3600 $DAEMON_CMD clone --sparse docs https://github.com/test/one"
+run_test "Sparse cone applied by the daemon" 1 "test -e $GIT_CHECKOUT_ROOT/test/one/src"
+run_test "Full tree restored by the daemon" 0 \
+	"GIT_CACHE_FRESH_TTL=3600 $DAEMON_CMD clone --no-sparse https://github.com/test/one && test -f $GIT_CHECKOUT_ROOT/test/one/src/main"
+run_test "Requests counted" 0 "$DAEMON_CMD daemon status | grep -q 'Requests served: 5'"
+run_test "Daemon stops" 0 "$DAEMON_CMD daemon stop"
+run_test "Daemon exits cleanly" 0 "wait $DAEMON_PID"
+DAEMON_PID=""
+run_test "Status after stopping" 0 "$DAEMON_CMD daemon status | grep -q 'not running'"
+
+echo -e "${YELLOW}=== Testing serve ===${NC}"
+
+SERVE_PORT=$((20000 + RANDOM % 20000))
+SERVE_URL="git://127.0.0.1:$SERVE_PORT"
+GIT_CACHE_FRESH_TTL=5 $BINARY serve --port "$SERVE_PORT" --export "test/one test/served" \
+	> "$TEST_DIR/serve.log" 2>&1 &
+SERVE_PID=$!
+run_test "Server accepts connections" 0 "wait_for 'git ls-remote $SERVE_URL/github.com/test/one'"
+run_test "Clone an exported cache" 0 "git clone -q $SERVE_URL/github.com/test/one.git $TEST_DIR/served-one"
+check_equal "Served clone matches the cache" "$(git -C "$GIT_CACHE/github.com/test/one" rev-parse master)" \
+	"$(git -C "$TEST_DIR/served-one" rev-parse HEAD)"
+run_test "Short path served" 0 "git ls-remote $SERVE_URL/test/one"
+
+# An exported miss is cloned for the peer; hits are only fetched once the TTL is over
+make_upstream served
+run_test "Exported miss cloned on request" 0 "git clone -q $SERVE_URL/github.com/test/served $TEST_DIR/served-new"
+run_test "Miss kept in the cache" 0 "git -C $GIT_CACHE/github.com/test/served rev-parse --verify -q master"
+SERVED_HEAD="$(git -C "$TEST_DIR/work-served" rev-parse HEAD)"
+push_commit served "after the fill"
+check_equal "Fresh hit served without a fetch" "$SERVED_HEAD" \
+	"$(git ls-remote "$SERVE_URL/test/served" refs/heads/master | cut -f1)"
+sleep 5
+check_equal "Expired hit fetched first" "$(git -C "$TEST_DIR/work-served" rev-parse HEAD)" \
+	"$(git ls-remote "$SERVE_URL/test/served" refs/heads/master | cut -f1)"
+run_test "Unexported cache refused" 128 "git clone -q $SERVE_URL/github.com/test/two $TEST_DIR/served-two"
+run_test "Serve requires an export list" 1 "$BINARY serve --port $SERVE_PORT"
+kill "$SERVE_PID"
+run_test "Server stops on SIGTERM" 0 "wait $SERVE_PID"
+SERVE_PID=""
+
+echo
+echo "Git Cache Behaviour Test Summary:"
+echo -e "  Total tests: $TESTS_RUN"
+echo -e "  ${GREEN}Passed: $TESTS_PASSED${NC}"
+echo -e "  ${RED}Failed: $TESTS_FAILED${NC}"
+
+if [ $TESTS_FAILED -eq 0 ]; then
+	echo -e "${GREEN}All behaviour tests passed!${NC}"
+	exit 0
+else
+	echo -e "${RED}Some behaviour tests failed.${NC}"
+	exit 1
+fi
@@ -0,0 +1,404 @@
+#!/bin/bash
+
+# Git cache benchmark suite
+#
+# Builds synthetic upstream repositories of several shapes, serves them over
+# file:// (or a local git daemon) in place of github.com, and times the
+# main git-cache operations. Results are written as JSON so runs on
+# different commits can be compared:
+#
+#   make bench
+#   tests/run_benchmarks.sh --compare bench-results/<old>.json bench-results/<new>.json
+#
+# Tunables (environment):
+#   BENCH_SIZES       Repository counts for the scale benchmarks (default: "10 100 1000")
+#   BENCH_RUNS        Timed runs per benchmark; the median is reported (default: 3)
+#   BENCH_JOBS        --jobs for batch clones (default: 4)
+#   BENCH_TRANSPORT   file or daemon (default: file)
+#   BENCH_OUTPUT      Result file (default: bench-results/<commit>.json)
+#   BENCH_DIR         Scratch directory (default: mktemp -d)
+#   BENCH_TRACE       Set to 1 to keep a GIT_CACHE_TRACE file per benchmark next to BENCH_OUTPUT
+
+set -eo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_DIR="$(dirname "$SCRIPT_DIR")"
+BINARY="$PROJECT_DIR/git-cache"
+
+BENCH_SIZES="${BENCH_SIZES:-10 100 1000}"
+BENCH_RUNS="${BENCH_RUNS:-3}"
+BENCH_JOBS="${BENCH_JOBS:-4}"
+BENCH_TRANSPORT="${BENCH_TRANSPORT:-file}"
+
+# Shape parameters; fixed so every commit benchmarks the same repositories
+REFS_COUNT=2000
+DEEP_COMMITS=5000
+BLOB_COUNT=4
+BLOB_MB=8
+SUBMODULE_COUNT=20
+SYNC_CHANGED_PERCENT=10
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+# Compare two result files benchmark by benchmark
+compare_results() {
+    local old="$1"
+    local new="$2"
+
+    if ! command -v jq >/dev/null 2>&1; then
+        echo -e "${RED}error: --compare needs jq${NC}" >&2
+        exit 1
+    fi
+
+    printf "%-28s %-12s %6s %12s %12s %8s\n" "benchmark" "shape" "repos" "old ms" "new ms" "change"
+    jq -r -n --slurpfile old "$old" --slurpfile new "$new" '
+        ($old[0].results | map({key: "\(.name)|\(.shape)|\(.repos)", value: .median_ms}) | from_entries) as $base
+        | $new[0].results[]
+        | "\(.name)|\(.shape)|\(.repos)" as $key
+        | [.name, .shape, (.repos | tostring), ($base[$key] // "-" | tostring), (.median_ms | tostring),
+           (if $base[$key] and $base[$key] > 0
+            then (((.median_ms - $base[$key]) * 1000 / $base[$key] | round) / 10 | tostring) + "%"
+            else "-" end)]
+        | @tsv' |
+    while IFS=$'\t' read -r name shape repos old_ms new_ms change; do
+        printf "%-28s %-12s %6s %12s %12s %8s\n" "$name" "$shape" "$repos" "$old_ms" "$new_ms" "$change"
+    done
+}
+
+if [ "$1" = "--compare" ]; then
+    if [ $# -ne 3 ]; then
+        echo "usage: $0 --compare <old.json> <new.json>" >&2
+        exit 1
+    fi
+    compare_results "$2" "$3"
+    exit 0
+fi
+
+if [ ! -x "$BINARY" ]; then
+    echo -e "${RED}error: $BINARY not found, run make first${NC}" >&2
+    exit 1
+fi
+
+COMMIT="$(git -C "$PROJECT_DIR" rev-parse --short HEAD 2>/dev/null || echo unknown)"
+if [ -n "$(git -C "$PROJECT_DIR" status --porcelain --untracked-files=no 2>/dev/null)" ]; then
+    COMMIT="$COMMIT-dirty"
+fi
+BENCH_OUTPUT="${BENCH_OUTPUT:-$PROJECT_DIR/bench-results/$COMMIT.json}"
+
+BENCH_DIR="${BENCH_DIR:-$(mktemp -d -t git-cache-bench.XXXXXX)}"
+UPSTREAM="$BENCH_DIR/upstream"
+DAEMON_PID=""
+
+cleanup() {
+    if [ -n "$DAEMON_PID" ]; then
+        kill "$DAEMON_PID" 2>/dev/null || true
+    fi
+    rm -rf "$BENCH_DIR"
+}
+trap cleanup EXIT
+
+# Isolated environment: nothing from the user's configuration leaks in
+export HOME="$BENCH_DIR/home"
+export GIT_CONFIG_NOSYSTEM=1
+export GIT_CACHE="$BENCH_DIR/cache"
+export GIT_CHECKOUT_ROOT="$BENCH_DIR/checkouts"
+export GIT_AUTHOR_NAME=bench GIT_AUTHOR_EMAIL=bench@example.com
+export GIT_COMMITTER_NAME=bench GIT_COMMITTER_EMAIL=bench@example.com
+export GIT_AUTHOR_DATE="1700000000 +0000" GIT_COMMITTER_DATE="1700000000 +0000"
+unset GITHUB_TOKEN GIT_CACHE_ROOT GIT_CACHE_TRACE
+mkdir -p "$HOME" "$UPSTREAM"
+git config --global init.defaultBranch main
+git config --global protocol.file.allow always
+
+# Milliseconds on the monotonic-ish wall clock
+now_ms() {
+    echo $(( $(date +%s%N) / 1000000 ))
+}
+
+# Deterministic pseudo-random bytes, so large blobs are identical on every run
+random_bytes() {
+    local bytes="$1"
+    local seed="$2"
+    if command -v openssl >/dev/null 2>&1; then
+        # openssl dies of SIGPIPE once head has enough
+        { openssl enc -aes-128-ctr -nosalt -pass "pass:$seed" -md sha256 </dev/zero 2>/dev/null || true; } |
+            head -c "$bytes"
+    else
+        head -c "$bytes" /dev/urandom
+    fi
+}
+
+# Stream a linear history of N commits touching a few files into fast-import
+fast_import_history() {
+    local commits="$1"
+    local branch="$2"
+    awk -v n="$commits" -v branch="$branch" 'BEGIN {
+        for (i = 1; i <= n; i++) {
+            content = sprintf("line %d\n", i)
+            msg = sprintf("commit %d\n", i)
+            printf "commit refs/heads/%s\n", branch
+            printf "mark :%d\n", i
+            printf "committer bench <bench@example.com> %d +0000\n", 1700000000 + i
+            printf "data %d\n%s", length(msg), msg
+            if (i > 1) printf "from :%d\n", i - 1
+            printf "M 100644 inline file%d.txt\n", i % 16
+            printf "data %d\n%s\n", length(content), content
+        }
+    }'
+}
+
+# Small repository used as the template for the scale benchmarks
+create_template_repo() {
+    local repo="$BENCH_DIR/template.git"
+    git init -q --bare "$repo"
+    fast_import_history 20 main | git -C "$repo" fast-import --quiet
+}
+
+# Shape: one repository with thousands of branches
+create_refs_repo() {
+    local repo="$UPSTREAM/refs.git"
+    git init -q --bare "$repo"
+    fast_import_history 50 main | git -C "$repo" fast-import --quiet
+    git -C "$repo" rev-list main | head -n 50 | awk -v n="$REFS_COUNT" '
+        { commits[NR] = $1 }
+        END { for (i = 1; i <= n; i++) printf "create refs/heads/branch-%05d %s\n", i, commits[(i % NR) + 1] }' |
+        git -C "$repo" update-ref --stdin
+    git -C "$repo" pack-refs --all
+}
+
+# Shape: one repository with a long linear history
+create_deep_repo() {
+    local repo="$UPSTREAM/deep.git"
+    git init -q --bare "$repo"
+    fast_import_history "$DEEP_COMMITS" main | git -C "$repo" fast-import --quiet
+}
+
+# Shape: one repository with a few large incompressible blobs
+create_blobs_repo() {
+    local repo="$UPSTREAM/blobs.git"
+    local work="$BENCH_DIR/blobs-work"
+    git init -q "$work"
+    for i in $(seq 1 "$BLOB_COUNT"); do
+        random_bytes $((BLOB_MB * 1024 * 1024)) "blob-$i" > "$work/blob-$i.bin"
+    done
+    git -C "$work" add .
+    git -C "$work" commit -q -m "large blobs"
+    git clone -q --bare "$work" "$repo"
+    rm -rf "$work"
+}
+
+# Shape: one superproject with many submodules
+create_submodules_repo() {
+    local repo="$UPSTREAM/submodules.git"
+    local work="$BENCH_DIR/submodules-work"
+    git init -q "$work"
+    : > "$work/.gitmodules"
+    for i in $(seq 1 "$SUBMODULE_COUNT"); do
+        local leaf="leaf-$i"
+        cp -r "$BENCH_DIR/template.git" "$UPSTREAM/$leaf.git"
+        local sha
+        sha="$(git -C "$UPSTREAM/$leaf.git" rev-parse main)"
+        printf '[submodule "%s"]\n\tpath = %s\n\turl = https://github.com/bench/%s.git\n' \
+            "$leaf" "$leaf" "$leaf" >> "$work/.gitmodules"
+        git -C "$work" update-index --add --cacheinfo "160000,$sha,$leaf"
+    done
+    git -C "$work" add .gitmodules
+    git -C "$work" commit -q -m "submodules"
+    git clone -q --bare "$work" "$repo"
+    rm -rf "$work"
+}
+
+# Copies of the template for the scale benchmarks
+create_scale_repos() {
+    local count="$1"
+    for i in $(seq 1 "$count"); do
+        local name
+        name="$(printf 's%04d' "$i")"
+        if [ ! -d "$UPSTREAM/$name.git" ]; then
+            cp -r "$BENCH_DIR/template.git" "$UPSTREAM/$name.git"
+        fi
+    done
+}
+
+# Add one commit to the main branch of an upstream repository
+advance_upstream() {
+    local repo="$1"
+    local tree commit
+    tree="$(git -C "$repo" rev-parse 'main^{tree}')"
+    commit="$(echo "bench change $RANDOM" | git -C "$repo" commit-tree "$tree" -p main)"
+    git -C "$repo" update-ref refs/heads/main "$commit"
+}
+
+# Point https://github.com/bench/ at the synthetic upstreams
+setup_transport() {
+    case "$BENCH_TRANSPORT" in
+        file)
+            git config --global url."file://$UPSTREAM/".insteadOf "https://github.com/bench/"
+            ;;
+        daemon)
+            local port=$((20000 + RANDOM % 20000))
+            git daemon --base-path="$UPSTREAM" --export-all --reuseaddr --listen=127.0.0.1 \
+                --port="$port" --pid-file="$BENCH_DIR/daemon.pid" --detach "$UPSTREAM"
+            sleep 0.5
+            DAEMON_PID="$(cat "$BENCH_DIR/daemon.pid")"
+            git config --global url."git://127.0.0.1:$port/".insteadOf "https://github.com/bench/"
+            ;;
+        *)
+            echo -e "${RED}error: unknown BENCH_TRANSPORT '$BENCH_TRANSPORT'${NC}" >&2
+            exit 1
+            ;;
+    esac
+}
+
+RESULTS=()
+
+# Record one benchmark: name, shape, repos, status, then the run times
+record_result() {
+    local name="$1" shape="$2" repos="$3" status="$4"
+    shift 4
+    local runs median
+    runs="$(IFS=,; echo "$*")"
+    median="$(printf '%s\n' "$@" | sort -n | sed -n "$(( ($# + 1) / 2 ))p")"
+    RESULTS+=("{\"name\":\"$name\",\"shape\":\"$shape\",\"repos\":$repos,\"status\":$status,\"median_ms\":$median,\"runs_ms\":[$runs]}")
+    if [ "$status" -eq 0 ]; then
+        printf "  %-28s %-12s %6s %10s ms\n" "$name" "$shape" "$repos" "$median"
+    else
+        printf "  %-28s %-12s %6s %10s ms ${RED}(exit %s)${NC}\n" "$name" "$shape" "$repos" "$median" "$status"
+    fi
+}
+
+# Time a benchmark BENCH_RUNS times; the prepare function runs untimed before each run
+run_benchmark() {
+    local name="$1" shape="$2" repos="$3" prepare="$4"
+    shift 4
+    local times=() status=0
+    for run in $(seq 1 "$BENCH_RUNS"); do
+        $prepare
+        if [ "${BENCH_TRACE:-0}" = "1" ]; then
+            mkdir -p "${BENCH_OUTPUT%.json}-traces"
+            export GIT_CACHE_TRACE="${BENCH_OUTPUT%.json}-traces/$name-$shape-$repos.jsonl"
+        fi
+        local start end
+        start="$(now_ms)"
+        "$@" >/dev/null 2>&1 || status=$?
+        end="$(now_ms)"
+        unset GIT_CACHE_TRACE
+        times+=($((end - start)))
+    done
+    record_result "$name" "$shape" "$repos" "$status" "${times[@]}"
+}
+
+# Prepare functions
+reset_all() {
+    rm -rf "$GIT_CACHE" "$GIT_CHECKOUT_ROOT"
+}
+
+reset_checkouts() {
+    rm -rf "$GIT_CHECKOUT_ROOT"
+}
+
+no_prepare() {
+    :
+}
+
+advance_some_upstreams() {
+    local step=$((100 / SYNC_CHANGED_PERCENT))
+    local i=0
+    for repo in "$UPSTREAM"/s*.git; do
+        if [ $((i % step)) -eq 0 ]; then
+            advance_upstream "$repo"
+        fi
+        i=$((i + 1))
+    done
+}
+
+# Cold and warm clones of one shape repository
+bench_shape() {
+    local shape="$1"
+    shift
+    local url="https://github.com/bench/$shape.git"
+    run_benchmark clone.cold "$shape" 1 reset_all "$BINARY" clone "$@" "$url"
+    run_benchmark clone.warm "$shape" 1 reset_checkouts "$BINARY" clone "$@" "$url"
+    run_benchmark sync.noop "$shape" 1 no_prepare "$BINARY" sync
+}
+
+# Batch clone, sync, list, verify and repair over many repositories
+bench_scale() {
+    local count="$1"
+    local manifest="$BENCH_DIR/manifest-$count.txt"
+
+    create_scale_repos "$count"
+    for i in $(seq 1 "$count"); do
+        printf 'https://github.com/bench/s%04d.git\n' "$i"
+    done > "$manifest"
+
+    run_benchmark clone.cold scale "$count" reset_all \
+        "$BINARY" clone --from-file "$manifest" --jobs "$BENCH_JOBS"
+    run_benchmark clone.warm scale "$count" reset_checkouts \
+        "$BINARY" clone --from-file "$manifest" --jobs "$BENCH_JOBS"
+    run_benchmark sync.noop scale "$count" no_prepare "$BINARY" sync
+    run_benchmark sync.changed scale "$count" advance_some_upstreams "$BINARY" sync
+    run_benchmark list scale "$count" no_prepare "$BINARY" list
+    run_benchmark verify scale "$count" no_prepare "$BINARY" verify
+    run_benchmark repair scale "$count" no_prepare "$BINARY" repair
+
+    reset_all
+}
+
+echo -e "${BLUE}Git Cache Benchmarks${NC}"
+echo "===================="
+echo "Commit:    $COMMIT"
+echo "Transport: $BENCH_TRANSPORT"
+echo "Runs:      $BENCH_RUNS (median reported)"
+echo
+
+echo -e "${YELLOW}Creating synthetic repositories...${NC}"
+create_template_repo
+create_refs_repo
+create_deep_repo
+create_blobs_repo
+create_submodules_repo
+setup_transport
+echo
+
+echo -e "${YELLOW}Repository shapes${NC}"
+bench_shape refs
+bench_shape deep
+bench_shape blobs
+bench_shape submodules --recursive
+reset_all
+echo
+
+echo -e "${YELLOW}Scale${NC}"
+for count in $BENCH_SIZES; do
+    bench_scale "$count"
+done
+echo
+
+mkdir -p "$(dirname "$BENCH_OUTPUT")"
+{
+    printf '{\n'
+    printf '  "commit": "%s",\n' "$COMMIT"
+    printf '  "date": "%s",\n' "$(date -u +%Y-%m-%dT%H:%M:%SZ)"
+    printf '  "git_version": "%s",\n' "$(git --version | awk '{print $3}')"
+    printf '  "nproc": %s,\n' "$(nproc 2>/dev/null || echo 1)"
+    printf '  "transport": "%s",\n' "$BENCH_TRANSPORT"
+    printf '  "runs": %s,\n' "$BENCH_RUNS"
+    printf '  "results": [\n'
+    for i in "${!RESULTS[@]}"; do
+        if [ "$i" -lt $((${#RESULTS[@]} - 1)) ]; then
+            printf '    %s,\n' "${RESULTS[$i]}"
+        else
+            printf '    %s\n' "${RESULTS[$i]}"
+        fi
+    done
+    printf '  ]\n'
+    printf '}\n'
+} > "$BENCH_OUTPUT"
+
+echo -e "${GREEN}Results written to $BENCH_OUTPUT${NC}"
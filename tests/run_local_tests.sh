@@ -0,0 +1,178 @@
+#!/bin/bash
+
+# Git cache local checkout (--local) test runner
+#
+# Runs against throwaway upstream and fork repositories on disk: a private
+# HOME rewrites https://github.com/test/ and https://github.com/fork/ to
+# them, so no network access is needed.
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_DIR="$(dirname "$SCRIPT_DIR")"
+BINARY="$PROJECT_DIR/git-cache"
+
+TEST_DIR="$(mktemp -d "${TMPDIR:-/tmp}/git-cache-local-XXXXXX")"
+trap 'rm -rf "$TEST_DIR"' EXIT
+
+export HOME="$TEST_DIR/home"
+export GIT_CACHE="$TEST_DIR/cache"
+export GIT_CHECKOUT_ROOT="$TEST_DIR/checkouts"
+export GIT_CACHE_NO_DAEMON=1
+export GIT_AUTHOR_NAME="git-cache test" GIT_AUTHOR_EMAIL="test@example.com"
+export GIT_COMMITTER_NAME="git-cache test" GIT_COMMITTER_EMAIL="test@example.com"
+unset GITHUB_TOKEN
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+# Test counters
+TESTS_RUN=0
+TESTS_PASSED=0
+TESTS_FAILED=0
+
+# Function to run a test
+run_test() {
+	local test_name="$1"
+	local expected_exit_code="$2"
+	shift 2
+	local cmd="$@"
+
+	echo -n "Running test: $test_name... "
+	TESTS_RUN=$((TESTS_RUN + 1))
+
+	if eval "$cmd" >/dev/null 2>&1; then
+		actual_exit_code=0
+	else
+		actual_exit_code=$?
+	fi
+
+	if [ "$actual_exit_code" -eq "$expected_exit_code" ]; then
+		echo -e "${GREEN}PASS${NC}"
+		TESTS_PASSED=$((TESTS_PASSED + 1))
+		return 0
+	else
+		echo -e "${RED}FAIL${NC}"
+		echo "  Expected exit code: $expected_exit_code"
+		echo "  Actual exit code: $actual_exit_code"
+		TESTS_FAILED=$((TESTS_FAILED + 1))
+		return 1
+	fi
+}
+
+# Function to check that two values are equal
+check_equal() {
+	local test_name="$1"
+	local expected="$2"
+	local actual="$3"
+
+	echo -n "Running test: $test_name... "
+	TESTS_RUN=$((TESTS_RUN + 1))
+
+	if [ "$expected" = "$actual" ]; then
+		echo -e "${GREEN}PASS${NC}"
+		TESTS_PASSED=$((TESTS_PASSED + 1))
+	else
+		echo -e "${RED}FAIL${NC}"
+		echo "  Expected: $expected"
+		echo "  Actual: $actual"
+		TESTS_FAILED=$((TESTS_FAILED + 1))
+	fi
+}
+
+# Function to commit a change to the upstream through a scratch clone
+push_upstream_commit() {
+	local message="$1"
+
+	echo "$message" >> "$TEST_DIR/work/README"
+	git -C "$TEST_DIR/work" commit -q -a -m "$message"
+	git -C "$TEST_DIR/work" push -q origin HEAD:master
+}
+
+# Check if binary exists
+if [ ! -f "$BINARY" ]; then
+	echo -e "${RED}Error: Binary not found at $BINARY${NC}"
+	echo "Please run 'make cache' first to build the git-cache program."
+	exit 1
+fi
+
+echo -e "${BLUE}Starting git-cache local checkout tests...${NC}"
+echo
+
+# Upstream and fork repositories reached through URL rewriting
+mkdir -p "$HOME" "$TEST_DIR/remotes/test" "$TEST_DIR/remotes/fork"
+git config --global url."$TEST_DIR/remotes/test/".insteadOf https://github.com/test/
+git config --global url."$TEST_DIR/remotes/fork/".insteadOf https://github.com/fork/
+git config --global protocol.file.allow always
+git init -q --bare -b master "$TEST_DIR/remotes/test/repo.git"
+git clone -q "$TEST_DIR/remotes/test/repo.git" "$TEST_DIR/work" 2>/dev/null
+echo "initial" > "$TEST_DIR/work/README"
+git -C "$TEST_DIR/work" add README
+git -C "$TEST_DIR/work" commit -q -m "initial"
+git -C "$TEST_DIR/work" push -q origin HEAD:master
+git clone -q --bare "$TEST_DIR/remotes/test/repo.git" "$TEST_DIR/remotes/fork/test-repo.git"
+
+REPO_URL="https://github.com/test/repo"
+FORK_URL="https://github.com/fork/test-repo"
+CHECKOUT_PATH="$GIT_CHECKOUT_ROOT/test/repo"
+MODIFIABLE_PATH="$GIT_CHECKOUT_ROOT/mithro/test-repo"
+
+echo -e "${YELLOW}=== Testing clone --local ===${NC}"
+
+run_test "Local clone" 0 "$BINARY clone --local $REPO_URL"
+run_test "Read-only checkout created" 0 "test -f $CHECKOUT_PATH/README"
+run_test "Modifiable checkout created" 0 "test -f $MODIFIABLE_PATH/README"
+check_equal "Checkout origin is the remote, not the cache" "$REPO_URL" \
+	"$(git -C "$CHECKOUT_PATH" config --get remote.origin.url)"
+run_test "Checkout borrows objects from the cache" 0 \
+	"test -s $CHECKOUT_PATH/.git/objects/info/alternates"
+
+echo -e "${YELLOW}=== Testing local update ===${NC}"
+
+push_upstream_commit "second"
+UPSTREAM_HEAD="$(git -C "$TEST_DIR/work" rev-parse HEAD)"
+
+# The fork's branches stay where the fork has them
+git -C "$MODIFIABLE_PATH" remote set-url origin "$FORK_URL"
+git -C "$MODIFIABLE_PATH" fetch -q origin
+FORK_HEAD="$(git -C "$MODIFIABLE_PATH" rev-parse origin/master)"
+
+run_test "Local update" 0 "$BINARY clone --local $REPO_URL"
+check_equal "Read-only checkout fast-forwarded from the cache" "$UPSTREAM_HEAD" \
+	"$(git -C "$CHECKOUT_PATH" rev-parse HEAD)"
+check_equal "Checkout origin branch taken from the cache" "$UPSTREAM_HEAD" \
+	"$(git -C "$CHECKOUT_PATH" rev-parse origin/master)"
+check_equal "Fork checkout keeps the fork's origin branch" "$FORK_HEAD" \
+	"$(git -C "$MODIFIABLE_PATH" rev-parse origin/master)"
+check_equal "Fork checkout gets the cache as upstream" "$UPSTREAM_HEAD" \
+	"$(git -C "$MODIFIABLE_PATH" rev-parse upstream/master)"
+check_equal "Fork checkout work branch untouched" "$FORK_HEAD" \
+	"$(git -C "$MODIFIABLE_PATH" rev-parse HEAD)"
+
+echo -e "${YELLOW}=== Testing local checkout without the remote ===${NC}"
+
+# Reference checkouts clone from the remote; local ones only read the cache
+mv "$TEST_DIR/remotes/test/repo.git" "$TEST_DIR/remotes/test/repo.away"
+rm -rf "$CHECKOUT_PATH" "$MODIFIABLE_PATH"
+run_test "Reference clone needs the remote" 1 "$BINARY clone $REPO_URL"
+run_test "Local clone works from the cache alone" 0 "$BINARY clone --local $REPO_URL"
+check_equal "Checkout built at the cached commit" "$UPSTREAM_HEAD" \
+	"$(git -C "$CHECKOUT_PATH" rev-parse HEAD)"
+run_test "Modifiable checkout built from the cache" 0 "test -f $MODIFIABLE_PATH/README"
+mv "$TEST_DIR/remotes/test/repo.away" "$TEST_DIR/remotes/test/repo.git"
+
+echo
+echo "Git Cache Local Checkout Test Summary:"
+echo -e "  Total tests: $TESTS_RUN"
+echo -e "  ${GREEN}Passed: $TESTS_PASSED${NC}"
+echo -e "  ${RED}Failed: $TESTS_FAILED${NC}"
+
+if [ $TESTS_FAILED -eq 0 ]; then
+	echo -e "${GREEN}All local checkout tests passed!${NC}"
+	exit 0
+else
+	echo -e "${RED}Some local checkout tests failed.${NC}"
+	exit 1
+fi
@@ -0,0 +1,349 @@
+/**
+ * @file worker_pool.c
+ * @brief Forked worker processes with captured output
+ *
+ * Every worker gets a pipe whose write end it holds until it exits. With
+ * capture it is the worker's stdout and stderr; without, it is only kept
+ * open. End of file on the pipe wakes the pool as soon as a worker is
+ * done; processes that outlive the worker and keep the pipe open only
+ * delay that to the next poll interval, when its pid is checked directly.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/wait.h>
+
+#include "worker_pool.h"
+
+/**
+ * @brief A started job
+ */
+struct worker_pool_worker {
+	pid_t pid;                  /* Worker process, 0 if the job ran in this process */
+	int fd;                     /* Pipe read end, -1 when closed */
+	char *output;               /* Captured output */
+	size_t output_len;          /* Bytes of captured output */
+	size_t output_capacity;     /* Allocated bytes */
+	int finished;               /* The job is done and waiting to be reported */
+	int status;                 /* waitpid() status once finished, -1 if unknown */
+	int exit_code;              /* Exit status of a job that ran in this process */
+	void *job;                  /* Caller's job */
+};
+
+/**
+ * @brief Append to a worker's captured output, dropping what is beyond the limit
+ */
+static void append_output(struct worker_pool_worker *worker, const char *data, size_t len)
+{
+	if (worker->output_len >= WORKER_POOL_MAX_OUTPUT) {
+		return;
+	}
+	if (len > WORKER_POOL_MAX_OUTPUT - worker->output_len) {
+		len = WORKER_POOL_MAX_OUTPUT - worker->output_len;
+	}
+	
+	if (worker->output_len + len + 1 > worker->output_capacity) {
+		size_t capacity = worker->output_capacity ? worker->output_capacity : 4096;
+		while (capacity < worker->output_len + len + 1) {
+			capacity *= 2;
+		}
+		char *output = realloc(worker->output, capacity);
+		if (!output) {
+			return;
+		}
+		worker->output = output;
+		worker->output_capacity = capacity;
+	}
+	
+	memcpy(worker->output + worker->output_len, data, len);
+	worker->output_len += len;
+	worker->output[worker->output_len] = '\0';
+}
+
+/**
+ * @brief Read what a worker's pipe has without blocking
+ * @return 1 at end of file, 0 otherwise
+ */
+static int drain_worker(struct worker_pool_worker *worker, int capture)
+{
+	char chunk[16384];
+	while (worker->fd >= 0) {
+		ssize_t n = read(worker->fd, chunk, sizeof(chunk));
+		if (n > 0) {
+			if (capture) {
+				append_output(worker, chunk, (size_t)n);
+			}
+		} else if (n < 0 && errno == EINTR) {
+			continue;
+		} else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			return 0;
+		} else {
+			close(worker->fd);
+			worker->fd = -1;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Record that a worker process has been reaped, or was lost
+ */
+static void finish_worker(struct worker_pool_worker *worker, int status, int capture)
+{
+	drain_worker(worker, capture);
+	if (worker->fd >= 0) {
+		close(worker->fd);
+		worker->fd = -1;
+	}
+	worker->status = status;
+	worker->finished = 1;
+}
+
+/**
+ * @brief Check a worker for exit; blocks only if block is set
+ */
+static void reap_worker(struct worker_pool_worker *worker, int block, int capture)
+{
+	int status;
+	pid_t pid;
+	do {
+		pid = waitpid(worker->pid, &status, block ? 0 : WNOHANG);
+	} while (pid < 0 && errno == EINTR);
+	
+	if (pid == worker->pid) {
+		finish_worker(worker, status, capture);
+	} else if (pid < 0) {
+		/* Reaped by someone else, so its status is unknown */
+		finish_worker(worker, -1, capture);
+	}
+}
+
+/**
+ * @brief Hand out a finished worker's result and drop it from the pool
+ */
+static void take_result(struct worker_pool *pool, size_t index, struct worker_pool_result *result)
+{
+	struct worker_pool_worker *worker = &pool->workers[index];
+	
+	memset(result, 0, sizeof(*result));
+	result->job = worker->job;
+	if (worker->pid == 0) {
+		result->exit_code = worker->exit_code;
+	} else if (worker->status != -1 && WIFEXITED(worker->status)) {
+		result->exit_code = WEXITSTATUS(worker->status);
+	} else {
+		result->exit_code = -1;
+		if (worker->status != -1 && WIFSIGNALED(worker->status)) {
+			result->term_signal = WTERMSIG(worker->status);
+		}
+	}
+	result->output = worker->output;
+	result->output_len = worker->output_len;
+	
+	pool->workers[index] = pool->workers[--pool->count];
+}
+
+/**
+ * @brief Initialize an empty pool
+ */
+int worker_pool_init(struct worker_pool *pool, size_t max_workers, int capture)
+{
+	if (!pool) {
+		return WORKER_POOL_ERROR_INVALID;
+	}
+	
+	memset(pool, 0, sizeof(*pool));
+	pool->max_workers = max_workers > 0 ? max_workers : 1;
+	pool->capture = capture;
+	pool->workers = calloc(pool->max_workers, sizeof(*pool->workers));
+	return pool->workers ? WORKER_POOL_SUCCESS : WORKER_POOL_ERROR_MEMORY;
+}
+
+/**
+ * @brief Whether the pool can start another job
+ */
+int worker_pool_has_room(const struct worker_pool *pool)
+{
+	return pool && pool->count < pool->max_workers;
+}
+
+/**
+ * @brief Number of jobs started and not yet returned by worker_pool_wait()
+ */
+size_t worker_pool_pending(const struct worker_pool *pool)
+{
+	return pool ? pool->count : 0;
+}
+
+/**
+ * @brief Start a job in a worker process
+ */
+int worker_pool_start(struct worker_pool *pool, worker_pool_fn fn, void *job, void *context)
+{
+	if (!pool || !pool->workers || !fn) {
+		return WORKER_POOL_ERROR_INVALID;
+	}
+	if (pool->count >= pool->max_workers) {
+		return WORKER_POOL_ERROR_FULL;
+	}
+	
+	struct worker_pool_worker *worker = &pool->workers[pool->count];
+	memset(worker, 0, sizeof(*worker));
+	worker->fd = -1;
+	worker->job = job;
+	
+	fflush(stdout);
+	fflush(stderr);
+	
+	/* Without a pipe a forked worker's output would interleave, so run it here */
+	int fds[2];
+	pid_t pid = -1;
+	if (pipe2(fds, O_CLOEXEC) == 0) {
+		pid = fork();
+		if (pid == 0) {
+			for (size_t i = 0; i < pool->count; i++) {
+				if (pool->workers[i].fd >= 0) {
+					close(pool->workers[i].fd);
+				}
+			}
+			close(fds[0]);
+			if (pool->capture) {
+				dup2(fds[1], STDOUT_FILENO);
+				dup2(fds[1], STDERR_FILENO);
+				close(fds[1]);
+			}
+			_exit(fn(job, context) & 0xff);
+		}
+		close(fds[1]);
+		if (pid < 0) {
+			close(fds[0]);
+		} else {
+			worker->fd = fds[0];
+			fcntl(worker->fd, F_SETFL, fcntl(worker->fd, F_GETFL) | O_NONBLOCK);
+		}
+	}
+	
+	if (pid < 0) {
+		worker->exit_code = fn(job, context) & 0xff;
+		worker->finished = 1;
+		fflush(stdout);
+		fflush(stderr);
+	} else {
+		worker->pid = pid;
+	}
+	
+	pool->count++;
+	return WORKER_POOL_SUCCESS;
+}
+
+/**
+ * @brief Wait until a job has finished
+ */
+int worker_pool_wait(struct worker_pool *pool, struct worker_pool_result *result)
+{
+	if (!pool || !result) {
+		return 0;
+	}
+	
+	struct pollfd *fds = malloc(pool->max_workers * sizeof(*fds));
+	for (;;) {
+		if (pool->count == 0) {
+			free(fds);
+			return 0;
+		}
+	
+		for (size_t i = 0; i < pool->count; i++) {
+			if (!pool->workers[i].finished) {
+				reap_worker(&pool->workers[i], 0, pool->capture);
+			}
+			if (pool->workers[i].finished) {
+				take_result(pool, i, result);
+				free(fds);
+				return 1;
+			}
+		}
+	
+		/* Without room to poll pipes, check the pids each interval */
+		size_t nfds = 0;
+		for (size_t i = 0; fds && i < pool->count; i++) {
+			if (pool->workers[i].fd >= 0) {
+				fds[nfds].fd = pool->workers[i].fd;
+				fds[nfds].events = POLLIN;
+				fds[nfds].revents = 0;
+				nfds++;
+			}
+		}
+		if (poll(fds, nfds, WORKER_POOL_POLL_INTERVAL_MS) <= 0) {
+			continue;
+		}
+	
+		for (size_t i = 0; i < pool->count; i++) {
+			struct worker_pool_worker *worker = &pool->workers[i];
+			if (worker->fd < 0) {
+				continue;
+			}
+			if (drain_worker(worker, pool->capture)) {
+				/* The worker closed its end on exit */
+				reap_worker(worker, 1, pool->capture);
+			}
+		}
+	}
+}
+
+/**
+ * @brief Free the captured output of a result
+ */
+void worker_pool_free_result(struct worker_pool_result *result)
+{
+	if (!result) {
+		return;
+	}
+	
+	free(result->output);
+	result->output = NULL;
+	result->output_len = 0;
+}
+
+/**
+ * @brief Wait for every pending job, discarding the results, and free the pool
+ */
+void worker_pool_destroy(struct worker_pool *pool)
+{
+	if (!pool) {
+		return;
+	}
+	
+	struct worker_pool_result result;
+	while (worker_pool_wait(pool, &result) == 1) {
+		worker_pool_free_result(&result);
+	}
+	free(pool->workers);
+	pool->workers = NULL;
+	pool->count = 0;
+}
+
+/**
+ * @brief Get human-readable error message for worker pool error code
+ */
+const char* worker_pool_error_string(int error_code)
+{
+	switch (error_code) {
+		case WORKER_POOL_SUCCESS:
+			return "Success";
+		case WORKER_POOL_ERROR_INVALID:
+			return "Invalid argument";
+		case WORKER_POOL_ERROR_FULL:
+			return "No room for another worker";
+		case WORKER_POOL_ERROR_MEMORY:
+			return "Memory allocation failed";
+		default:
+			return "Unknown error";
+	}
+}
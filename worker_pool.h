@@ -0,0 +1,141 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+/**
+ * @file worker_pool.h
+ * @brief Forked worker processes running jobs in parallel
+ *
+ * Each job runs a function in a forked process, at most a fixed number at
+ * a time. A worker's stdout and stderr can be captured through a pipe the
+ * pool drains while it waits, so the output of every job is handed back
+ * as one block instead of interleaving with the others.
+ *
+ * The pool reaps only its own workers with waitpid() on their pids, so it
+ * can be used next to cache_exec loops and other children of the process.
+ * When fork() fails the job runs in the calling process instead, with its
+ * output going straight to the caller's streams.
+ */
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * @brief Default limit on captured output per worker, in bytes
+ *
+ * Output beyond the limit is read and dropped so the worker never blocks.
+ */
+#define WORKER_POOL_MAX_OUTPUT (4 * 1024 * 1024)
+
+/**
+ * @brief Longest time worker_pool_wait() sleeps before checking for exits, in ms
+ */
+#define WORKER_POOL_POLL_INTERVAL_MS 50
+
+/**
+ * @brief Worker pool error codes
+ */
+#define WORKER_POOL_SUCCESS         0
+#define WORKER_POOL_ERROR_INVALID  -1
+#define WORKER_POOL_ERROR_FULL     -2
+#define WORKER_POOL_ERROR_MEMORY   -3
+
+/**
+ * @brief Job function, run in the worker process
+ * @param job Job passed to worker_pool_start()
+ * @param context Shared context passed to worker_pool_start()
+ * @return Exit status of the worker, 0 to 255
+ */
+typedef int (*worker_pool_fn)(void *job, void *context);
+
+/**
+ * @brief Outcome of a finished job
+ */
+struct worker_pool_result {
+	void *job;                  /**< Job the result belongs to */
+	int exit_code;              /**< Exit status, -1 if the worker was killed or lost */
+	int term_signal;            /**< Signal that ended the worker, 0 if it exited */
+	char *output;               /**< Captured output, NUL-terminated (NULL if not captured) */
+	size_t output_len;          /**< Bytes of captured output */
+};
+
+struct worker_pool_worker;
+
+/**
+ * @brief Set of running workers
+ */
+struct worker_pool {
+	struct worker_pool_worker *workers; /**< Running and unreported workers */
+	size_t count;               /**< Number of entries in use */
+	size_t max_workers;         /**< Most workers running at once */
+	int capture;                /**< Whether worker output is captured */
+};
+
+/**
+ * @brief Initialize an empty pool
+ * @param pool Pool to initialize
+ * @param max_workers Most workers running at once (at least 1 is used)
+ * @param capture Capture each worker's stdout and stderr instead of sharing the caller's
+ * @return WORKER_POOL_SUCCESS on success, error code on failure
+ */
+int worker_pool_init(struct worker_pool *pool, size_t max_workers, int capture);
+
+/**
+ * @brief Whether the pool can start another job
+ * @param pool Pool to check
+ * @return 1 if fewer than max_workers jobs are running or unreported, 0 otherwise
+ */
+int worker_pool_has_room(const struct worker_pool *pool);
+
+/**
+ * @brief Number of jobs started and not yet returned by worker_pool_wait()
+ * @param pool Pool to check
+ * @return Number of jobs
+ */
+size_t worker_pool_pending(const struct worker_pool *pool);
+
+/**
+ * @brief Start a job in a worker process
+ *
+ * stdout and stderr are flushed first so the worker does not repeat
+ * buffered output. If fork() fails the job runs before this returns and
+ * its result is reported by the next worker_pool_wait().
+ *
+ * @param pool Pool to start the job on
+ * @param fn Function to run
+ * @param job Job handed to fn and back in the result
+ * @param context Shared context handed to fn
+ * @return WORKER_POOL_SUCCESS on success, WORKER_POOL_ERROR_FULL if the pool has no room
+ */
+int worker_pool_start(struct worker_pool *pool, worker_pool_fn fn, void *job, void *context);
+
+/**
+ * @brief Wait until a job has finished
+ *
+ * Drains the output pipes of all running workers meanwhile.
+ *
+ * @param pool Pool to wait on
+ * @param result Output outcome of the finished job, free with worker_pool_free_result()
+ * @return 1 if a job finished, 0 if none is pending
+ */
+int worker_pool_wait(struct worker_pool *pool, struct worker_pool_result *result);
+
+/**
+ * @brief Free the captured output of a result
+ * @param result Result to clean up
+ */
+void worker_pool_free_result(struct worker_pool_result *result);
+
+/**
+ * @brief Wait for every pending job, discarding the results, and free the pool
+ * @param pool Pool to destroy
+ */
+void worker_pool_destroy(struct worker_pool *pool);
+
+/**
+ * @brief Get human-readable error message for worker pool error code
+ * @param error_code Worker pool error code
+ * @return Error message string
+ */
+const char* worker_pool_error_string(int error_code);
+
+#endif /* WORKER_POOL_H */